@@ -0,0 +1,77 @@
+/**
+ * @file greeting.c
+ * @brief The greeting template and a name reader that cannot overflow
+ */
+
+#include "greeting.h"
+
+#include <string.h>
+
+#define PIECE_0 "\nNice to meet you, "
+#define PIECE_1 "!\nHello, "
+#define PIECE_2 "! Welcome to the world of C programming.\n" \
+                "I hope you enjoy learning C, "
+#define PIECE_3 "!\n\n=== Program Information ===\nLanguage: C\nYour name: "
+#define PIECE_4 "\nStatus: First interactive program complete!\n"
+
+const char *const greeting_pieces[GREETING_PIECES] = {
+    PIECE_0, PIECE_1, PIECE_2, PIECE_3, PIECE_4
+};
+
+const size_t greeting_piece_lengths[GREETING_PIECES] = {
+    sizeof(PIECE_0) - 1, sizeof(PIECE_1) - 1, sizeof(PIECE_2) - 1,
+    sizeof(PIECE_3) - 1, sizeof(PIECE_4) - 1
+};
+
+// The template and four names must fit in GREETING_REPLY_MAX
+typedef char reply_fits[sizeof(PIECE_0 PIECE_1 PIECE_2 PIECE_3 PIECE_4) +
+                        4 * GREETING_NAME_MAX <= GREETING_REPLY_MAX ? 1 : -1];
+
+// The spaces scanf("%s") stops at
+static int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+           c == '\f';
+}
+
+void greeting_name_init(greeting_name_t *name) {
+    name->length = 0;
+    name->done = 0;
+    name->text[0] = '\0';
+}
+
+size_t greeting_name_feed(greeting_name_t *name, const char *data,
+                          size_t length) {
+    size_t used = 0;
+    while (used < length && !name->done) {
+        char c = data[used];
+        if (is_space(c)) {
+            // Spaces before the name are skipped, after it they end it
+            name->done = name->length > 0;
+            used++;
+            continue;
+        }
+        name->text[name->length++] = c;
+        used++;
+        if (name->length == GREETING_NAME_MAX) {
+            name->done = 1;
+        }
+    }
+    name->text[name->length] = '\0';
+    return used;
+}
+
+size_t greeting_format(char *out, const char *name, size_t name_length) {
+    char *p = out;
+    if (name_length > GREETING_NAME_MAX) {
+        name_length = GREETING_NAME_MAX;
+    }
+    for (int i = 0; i < GREETING_PIECES; i++) {
+        memcpy(p, greeting_pieces[i], greeting_piece_lengths[i]);
+        p += greeting_piece_lengths[i];
+        if (i + 1 < GREETING_PIECES) {
+            memcpy(p, name, name_length);
+            p += name_length;
+        }
+    }
+    return (size_t)(p - out);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file greeting.h
+ * @brief The greeting of hello_interactive.c, for servers and batch jobs
+ *
+ * hello_interactive.c asks for a name and answers with a few lines that
+ * repeat it. The greeting server and the bulk greeting mode produce
+ * exactly the same text; this header keeps it in one place.
+ *
+ * The answer is fixed text with the name in four places, so it is kept
+ * as five pieces of template around the name:
+ *
+ *     piece 0, name, piece 1, name, piece 2, name, piece 3, name, piece 4
+ *
+ * Names are read the way scanf("%49s", name) reads them: leading
+ * spaces are skipped, and the name ends at the next space or after 49
+ * characters, whichever comes first. Nothing can overflow.
+ */
+
+#ifndef GREETING_H
+#define GREETING_H
+
+#include <stddef.h>
+
+// Longest name, as in hello_interactive.c's char name[50]
+#define GREETING_NAME_MAX 49
+
+// What hello_interactive.c prints before reading the name
+#define GREETING_PROMPT "Hello! Welcome to C programming.\nWhat is your name? "
+
+#define GREETING_PIECES 5
+
+extern const char *const greeting_pieces[GREETING_PIECES];
+extern const size_t greeting_piece_lengths[GREETING_PIECES];
+
+// Longest answer: the template plus four names of maximum length
+#define GREETING_REPLY_MAX 512
+
+// A name being read, a few bytes at a time
+typedef struct {
+    char text[GREETING_NAME_MAX + 1];
+    size_t length;
+    int done;
+} greeting_name_t;
+
+/**
+ * @brief Starts reading a new name
+ */
+void greeting_name_init(greeting_name_t *name);
+
+/**
+ * @brief Feeds received bytes into a name
+ *
+ * @return Bytes used; fewer than length once the name is complete
+ *         (name->done is then 1 and the rest belongs to whatever follows)
+ */
+size_t greeting_name_feed(greeting_name_t *name, const char *data,
+                          size_t length);
+
+/**
+ * @brief Writes the greeting for a name
+ *
+ * @param out At least GREETING_REPLY_MAX bytes
+ * @return Length of the greeting (no terminating NUL is written)
+ */
+size_t greeting_format(char *out, const char *name, size_t name_length);
+
+#endif // GREETING_H
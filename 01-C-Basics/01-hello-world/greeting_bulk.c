@@ -0,0 +1,214 @@
+/**
+ * @file greeting_bulk.c
+ * @brief Bulk greetings: mapped names, page-aligned buffers, vmsplice
+ */
+
+#define _GNU_SOURCE
+
+#include "greeting_bulk.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "greeting.h"
+
+#define BUFFER_BYTES (64 * 1024)
+#define PIPE_BYTES (1024 * 1024)     // Asked for; the kernel may give less
+#define WRITEV_BUFFERS 16            // Buffers per writev() call
+
+typedef struct {
+    int fd;
+    int use_vmsplice;
+    char *ring;                      // buffer_count buffers of BUFFER_BYTES
+    size_t buffer_count;
+    size_t current;
+    size_t used;
+    size_t lengths[WRITEV_BUFFERS];  // writev(): filled buffers not yet sent
+    greeting_bulk_stats_t *stats;
+} writer_t;
+
+static int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+           c == '\f';
+}
+
+// Hands length bytes at data to the pipe, by reference
+static int splice_pages(writer_t *writer, char *data, size_t length) {
+    struct iovec piece = {data, length};
+    while (piece.iov_len > 0) {
+        ssize_t moved = vmsplice(writer->fd, &piece, 1, 0);
+        writer->stats->syscalls++;
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        piece.iov_base = (char *)piece.iov_base + moved;
+        piece.iov_len -= (size_t)moved;
+    }
+    return 0;
+}
+
+// Writes the first count buffers of the ring in one writev()
+static int write_buffers(writer_t *writer, size_t count) {
+    struct iovec pieces[WRITEV_BUFFERS];
+    struct iovec *next = pieces;
+    for (size_t i = 0; i < count; i++) {
+        pieces[i].iov_base = writer->ring + i * BUFFER_BYTES;
+        pieces[i].iov_len = writer->lengths[i];
+    }
+    while (count > 0) {
+        ssize_t written = writev(writer->fd, next, (int)count);
+        writer->stats->syscalls++;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        size_t left = (size_t)written;
+        while (count > 0 && left >= next->iov_len) {
+            left -= next->iov_len;
+            next++;
+            count--;
+        }
+        if (count > 0) {
+            next->iov_base = (char *)next->iov_base + left;
+            next->iov_len -= left;
+        }
+    }
+    return 0;
+}
+
+// Sends the current buffer (or queues it for the next writev())
+static int finish_buffer(writer_t *writer, int last) {
+    char *buffer = writer->ring + writer->current * BUFFER_BYTES;
+    if (writer->use_vmsplice) {
+        if (writer->used > 0 && splice_pages(writer, buffer, writer->used)) {
+            return -1;
+        }
+        writer->current = (writer->current + 1) % writer->buffer_count;
+    } else {
+        writer->lengths[writer->current++] = writer->used;
+        if (writer->current == WRITEV_BUFFERS || last) {
+            if (write_buffers(writer, writer->current) != 0) {
+                return -1;
+            }
+            writer->current = 0;
+        }
+    }
+    writer->used = 0;
+    return 0;
+}
+
+/**
+ * @brief Decides between vmsplice() and writev() and sizes the ring
+ *
+ * A page given to a pipe with vmsplice() stays in use until the reader
+ * has read it, so a buffer may only be refilled once enough newer
+ * pages went into the pipe that it cannot still hold the old ones:
+ * more buffers than fit into the pipe at once, plus two.
+ */
+static void choose_output(writer_t *writer, greeting_output_t mode) {
+    struct stat info;
+    int is_pipe = fstat(writer->fd, &info) == 0 && S_ISFIFO(info.st_mode);
+    writer->use_vmsplice = mode == GREETING_OUTPUT_VMSPLICE ||
+                           (mode == GREETING_OUTPUT_AUTO && is_pipe);
+    writer->buffer_count = WRITEV_BUFFERS;
+    if (writer->use_vmsplice) {
+        fcntl(writer->fd, F_SETPIPE_SZ, PIPE_BYTES);
+        long pipe_bytes = fcntl(writer->fd, F_GETPIPE_SZ);
+        long page = sysconf(_SC_PAGESIZE);
+        if (pipe_bytes <= 0) {
+            pipe_bytes = PIPE_BYTES;
+        }
+        // A full buffer covers at least this many pages of the pipe
+        size_t pages = (BUFFER_BYTES - GREETING_REPLY_MAX) / (size_t)page;
+        writer->buffer_count = (size_t)(pipe_bytes / page) / pages + 2;
+    }
+}
+
+int greeting_bulk(const char *names_path, int out_fd, greeting_output_t mode,
+                  greeting_bulk_stats_t *stats) {
+    stats->names = 0;
+    stats->bytes = 0;
+    stats->syscalls = 0;
+
+    int fd = open(names_path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)info.st_size;
+    const char *names = NULL;
+    if (size > 0) {
+        names = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (names == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise((void *)names, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    writer_t writer = {0};
+    writer.fd = out_fd;
+    writer.stats = stats;
+    choose_output(&writer, mode);
+    stats->used_vmsplice = writer.use_vmsplice;
+    size_t ring_bytes = writer.buffer_count * BUFFER_BYTES;
+    writer.ring = mmap(NULL, ring_bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    int status = writer.ring == MAP_FAILED ? -1 : 0;
+
+    const char *p = names;
+    const char *end = size > 0 ? names + size : names;
+    while (status == 0) {
+        while (p < end && is_space(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+        // Like scanf("%49s"): at most 49 characters per name
+        const char *name = p;
+        const char *limit = (size_t)(end - p) > GREETING_NAME_MAX
+                                ? p + GREETING_NAME_MAX : end;
+        while (p < limit && !is_space(*p)) {
+            p++;
+        }
+
+        if (BUFFER_BYTES - writer.used < GREETING_REPLY_MAX &&
+            (status = finish_buffer(&writer, 0)) != 0) {
+            break;
+        }
+        char *out = writer.ring + writer.current * BUFFER_BYTES + writer.used;
+        size_t length = greeting_format(out, name, (size_t)(p - name));
+        writer.used += length;
+        stats->bytes += length;
+        stats->names++;
+    }
+    if (status == 0 && (writer.used > 0 || writer.current > 0)) {
+        status = finish_buffer(&writer, 1);
+    }
+
+    int saved = errno;
+    if (writer.ring != MAP_FAILED) {
+        munmap(writer.ring, ring_bytes);
+    }
+    if (names != NULL) {
+        munmap((void *)names, size);
+    }
+    errno = saved;
+    return status;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file greeting_bulk.h
+ * @brief hello_interactive.c's greeting for every name in a file, fast
+ *
+ * Greeting millions of names with scanf() and printf() copies every
+ * name several times: from the file into stdio's input buffer, into
+ * name[], into the output buffer for each of the four printf() calls
+ * that repeat it, and finally into the kernel.
+ *
+ * The bulk mode maps the names file into memory instead and builds
+ * each greeting directly from its pieces - the fixed template text and
+ * the name, read straight from the mapped file - into page-aligned
+ * output buffers. When stdout is a pipe, the filled pages are handed
+ * to the pipe with vmsplice(): the kernel references the pages instead
+ * of copying them. Anywhere else (a file, a terminal) several buffers
+ * at a time go out with one writev().
+ *
+ * Names are read like scanf("%49s"): separated by spaces or newlines,
+ * at most 49 characters each (a longer word continues as the next
+ * name), so the output is exactly what the per-name loop prints.
+ */
+
+#ifndef GREETING_BULK_H
+#define GREETING_BULK_H
+
+#include <stdint.h>
+
+typedef enum {
+    GREETING_OUTPUT_AUTO,       // vmsplice() into pipes, writev() otherwise
+    GREETING_OUTPUT_VMSPLICE,   // Pipes only
+    GREETING_OUTPUT_WRITEV
+} greeting_output_t;
+
+typedef struct {
+    uint64_t names;
+    uint64_t bytes;             // Greeting text produced
+    uint64_t syscalls;          // vmsplice()/writev() calls
+    int used_vmsplice;
+} greeting_bulk_stats_t;
+
+/**
+ * @brief Writes the greeting for every name in a file to out_fd
+ *
+ * Blocks until everything is out. With vmsplice(), the pipe's reader
+ * sees the pages in place, so the output buffers are only reused once
+ * the pipe cannot still hold them.
+ *
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int greeting_bulk(const char *names_path, int out_fd, greeting_output_t mode,
+                  greeting_bulk_stats_t *stats);
+
+#endif // GREETING_BULK_H
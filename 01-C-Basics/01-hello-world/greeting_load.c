@@ -0,0 +1,389 @@
+/**
+ * @file greeting_load.c
+ * @brief Load generator for greeting_server: latency and sessions/s
+ *
+ * Keeps N clients busy at the same time, each running the whole
+ * conversation over and over: connect, wait for the prompt, send a
+ * name, read the greeting until the server hangs up, check that it is
+ * exactly the text hello_interactive.c would print, start again. Like
+ * the server it is a single epoll event loop, so one process can keep
+ * tens of thousands of connections going.
+ *
+ * For every level (1,000, 10,000 and 50,000 connections by default)
+ * it reports sessions per second and the 50th, 99th and 99.9th
+ * percentile of session latency, measured from the first connect()
+ * attempt to the last byte of the greeting. A level larger than the
+ * open-file limit allows is reduced to fit, and the report says so.
+ *
+ * Usage: ./greeting_load [--unix path | --tcp port] [--seconds S]
+ *                        [connections ...]
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "greeting.h"
+
+#define DEFAULT_SOCKET "/tmp/greeting.sock"
+#define DEFAULT_SECONDS 3.0
+#define EVENTS_PER_WAIT 1024
+#define SPARE_FILES 64              // For stdio, epoll and the like
+
+#define PROMPT_LENGTH (sizeof(GREETING_PROMPT) - 1)
+
+typedef enum { IDLE, RETRY, CONNECTING, TALKING } client_state_t;
+
+typedef struct {
+    int fd;
+    client_state_t state;
+    int name_sent;
+    uint64_t start_ns;
+    char name[24];
+    size_t name_length;
+    char in[PROMPT_LENGTH + GREETING_REPLY_MAX + 1];
+    size_t received;
+} client_t;
+
+// Where the server is
+static struct sockaddr_storage server;
+static socklen_t server_length;
+
+// Results of the running level
+static uint64_t *latencies;
+static size_t latency_count, latency_capacity;
+static unsigned long long failures, name_counter;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void record_latency(uint64_t ns) {
+    if (latency_count == latency_capacity) {
+        size_t capacity = latency_capacity ? latency_capacity * 2 : 1 << 16;
+        uint64_t *grown = realloc(latencies, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            failures++;
+            return;
+        }
+        latencies = grown;
+        latency_capacity = capacity;
+    }
+    latencies[latency_count++] = ns;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(double fraction) {
+    if (latency_count == 0) {
+        return 0;
+    }
+    size_t index = (size_t)(fraction * (double)(latency_count - 1) + 0.5);
+    return latencies[index] / 1e3;
+}
+
+/**
+ * @brief Starts (or retries) a session on an idle client
+ *
+ * A Unix socket whose accept queue is full refuses at once with
+ * EAGAIN instead of waiting; such clients are retried on the next
+ * round, and the wait counts toward their latency.
+ */
+static void start_session(int epoll_fd, client_t *client) {
+    if (client->state == IDLE) {
+        client->start_ns = now_ns();
+        // Names of different lengths, like a real class list
+        client->name_length = (size_t)snprintf(
+            client->name, sizeof(client->name), "Student%llu",
+            name_counter++ * 2654435761ull % 100000000ull);
+    }
+    client->fd = socket(server.ss_family,
+                        SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (client->fd < 0) {
+        client->state = RETRY;
+        return;
+    }
+    client->received = 0;
+    client->name_sent = 0;
+    if (connect(client->fd, (struct sockaddr *)&server, server_length) != 0 &&
+        errno != EINPROGRESS) {
+        close(client->fd);
+        if (errno != EAGAIN) {
+            failures++;
+        }
+        client->state = RETRY;
+        return;
+    }
+    client->state = CONNECTING;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = client;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->fd, &event) != 0) {
+        close(client->fd);
+        failures++;
+        client->state = RETRY;
+    }
+}
+
+// Ends a session; returns 1 if the greeting was right
+static int end_session(client_t *client) {
+    char expected[PROMPT_LENGTH + GREETING_REPLY_MAX];
+    memcpy(expected, GREETING_PROMPT, PROMPT_LENGTH);
+    size_t length = PROMPT_LENGTH +
+                    greeting_format(expected + PROMPT_LENGTH, client->name,
+                                    client->name_length);
+    close(client->fd);
+    client->state = IDLE;
+    if (client->received != length ||
+        memcmp(client->in, expected, length) != 0) {
+        failures++;
+        return 0;
+    }
+    record_latency(now_ns() - client->start_ns);
+    return 1;
+}
+
+// Handles an epoll event; returns 1 when the client is no longer connected
+static int talk(client_t *client) {
+    if (client->state == CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            close(client->fd);
+            client->state = RETRY;
+            return 1;
+        }
+        client->state = TALKING;
+    }
+    for (;;) {
+        size_t room = sizeof(client->in) - client->received;
+        ssize_t got = recv(client->fd, client->in + client->received,
+                           room, 0);
+        if (got > 0) {
+            client->received += (size_t)got;
+            if (client->received == sizeof(client->in)) {
+                // Longer than any greeting can be
+                close(client->fd);
+                client->state = IDLE;
+                failures++;
+                return 1;
+            }
+        } else if (got == 0) {
+            end_session(client);
+            return 1;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            close(client->fd);
+            client->state = IDLE;
+            failures++;
+            return 1;
+        }
+    }
+    // Answer the prompt once it has arrived in full
+    if (!client->name_sent && client->received >= PROMPT_LENGTH) {
+        char line[sizeof(client->name) + 1];
+        memcpy(line, client->name, client->name_length);
+        line[client->name_length] = '\n';
+        if (send(client->fd, line, client->name_length + 1, MSG_NOSIGNAL) !=
+            (ssize_t)(client->name_length + 1)) {
+            close(client->fd);
+            client->state = IDLE;
+            failures++;
+            return 1;
+        }
+        client->name_sent = 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs connections clients for the given time
+ * @return 0 on success, -1 if a greeting came back wrong
+ */
+static int run_level(size_t connections, size_t requested, double seconds) {
+    client_t *clients = calloc(connections, sizeof(client_t));
+    // Clients waiting to (re)start, and the ones for the next round
+    client_t **ready_list = malloc(connections * sizeof(client_t *));
+    client_t **next_list = malloc(connections * sizeof(client_t *));
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (clients == NULL || ready_list == NULL || next_list == NULL ||
+        epoll_fd < 0) {
+        perror("setup");
+        return -1;
+    }
+    latency_count = 0;
+    failures = 0;
+
+    struct epoll_event events[EVENTS_PER_WAIT];
+    uint64_t start = now_ns();
+    uint64_t stop = start + (uint64_t)(seconds * 1e9);
+    uint64_t last_end = start;
+    size_t ready_count = connections, active = 0;
+    for (size_t i = 0; i < connections; i++) {
+        ready_list[i] = &clients[i];
+    }
+
+    for (;;) {
+        int stopping = now_ns() >= stop;
+        size_t next_count = 0;
+        for (size_t i = 0; i < ready_count; i++) {
+            client_t *client = ready_list[i];
+            // Once time is up, finished clients are not restarted
+            if (stopping && client->state == IDLE) {
+                continue;
+            }
+            start_session(epoll_fd, client);
+            if (client->state == RETRY) {
+                next_list[next_count++] = client;
+            } else {
+                active++;
+            }
+        }
+        client_t **swap = ready_list;
+        ready_list = next_list;
+        next_list = swap;
+        ready_count = next_count;
+        if (active == 0 && (stopping || ready_count == 0)) {
+            break;
+        }
+
+        // Refused clients retry after a millisecond
+        int ready = epoll_wait(epoll_fd, events, EVENTS_PER_WAIT,
+                               ready_count > 0 ? 1 : 100);
+        for (int i = 0; i < ready; i++) {
+            client_t *client = events[i].data.ptr;
+            size_t before = latency_count;
+            if (talk(client)) {
+                active--;
+                ready_list[ready_count++] = client;
+                if (latency_count != before) {
+                    last_end = now_ns();
+                }
+            }
+        }
+    }
+
+    double elapsed = (last_end - start) / 1e9;
+    qsort(latencies, latency_count, sizeof(*latencies), compare_u64);
+    char label[48];
+    if (connections == requested) {
+        snprintf(label, sizeof(label), "%zu", connections);
+    } else {
+        snprintf(label, sizeof(label), "%zu (of %zu)", connections, requested);
+    }
+    printf("%-16s %10zu %12.0f %10.1f %10.1f %10.1f %8llu\n", label,
+           latency_count, latency_count / elapsed, percentile_us(0.50),
+           percentile_us(0.99), percentile_us(0.999), failures);
+    fflush(stdout);
+
+    close(epoll_fd);
+    free(clients);
+    free(ready_list);
+    free(next_list);
+    return failures == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *unix_path = DEFAULT_SOCKET;
+    int tcp_port = 0;
+    double seconds = DEFAULT_SECONDS;
+    size_t levels[32];
+    size_t level_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc) {
+            unix_path = argv[++i];
+        } else if (strcmp(argv[i], "--tcp") == 0 && i + 1 < argc) {
+            tcp_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && level_count < 32 &&
+                   atol(argv[i]) > 0) {
+            levels[level_count++] = (size_t)atol(argv[i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--unix path | --tcp port] "
+                            "[--seconds S] [connections ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (level_count == 0) {
+        levels[0] = 1000;
+        levels[1] = 10000;
+        levels[2] = 50000;
+        level_count = 3;
+    }
+
+    if (tcp_port > 0) {
+        struct sockaddr_in *address = (struct sockaddr_in *)&server;
+        address->sin_family = AF_INET;
+        address->sin_port = htons((uint16_t)tcp_port);
+        address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        server_length = sizeof(*address);
+    } else {
+        struct sockaddr_un *address = (struct sockaddr_un *)&server;
+        address->sun_family = AF_UNIX;
+        if (strlen(unix_path) >= sizeof(address->sun_path)) {
+            fprintf(stderr, "Error: socket path too long\n");
+            return 1;
+        }
+        strcpy(address->sun_path, unix_path);
+        server_length = sizeof(*address);
+    }
+
+    // One file descriptor per connection
+    struct rlimit limit;
+    size_t max_connections = SIZE_MAX;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur != RLIM_INFINITY) {
+            max_connections = (size_t)limit.rlim_cur - SPARE_FILES;
+        }
+    }
+
+    printf("=== GREETING SERVER LOAD TEST ===\n");
+    if (tcp_port > 0) {
+        printf("Server 127.0.0.1:%d", tcp_port);
+    } else {
+        printf("Server %s", unix_path);
+    }
+    printf(", %.1f s per level\n\n", seconds);
+    printf("%-16s %10s %12s %10s %10s %10s %8s\n", "Connections", "Sessions",
+           "Sessions/s", "p50 us", "p99 us", "p99.9 us", "Errors");
+
+    int status = 0;
+    for (size_t i = 0; i < level_count; i++) {
+        size_t connections = levels[i] < max_connections ? levels[i]
+                                                         : max_connections;
+        if (run_level(connections, levels[i], seconds) != 0) {
+            status = 1;
+        }
+    }
+    if (max_connections != SIZE_MAX) {
+        printf("\nOpen-file limit: %zu connections per process "
+               "(ulimit -n)\n", max_connections);
+    }
+    free(latencies);
+    return status;
+}
@@ -0,0 +1,415 @@
+/**
+ * @file greeting_server.c
+ * @brief hello_interactive.c's greeting, served to thousands of clients
+ *
+ * hello_interactive.c talks to one person on stdin and waits for as
+ * long as they take to type. This server plays the same conversation
+ * over a socket with every client that connects:
+ *
+ *     server: Hello! Welcome to C programming.\nWhat is your name?
+ *     client: Ada\n
+ *     server: \nNice to meet you, Ada! ... (the same text), then hangs up
+ *
+ * Waiting for one slow client must not hold up the others, so nothing
+ * blocks. An event loop asks epoll which connections have data or room
+ * to write, handles exactly those, and goes back to waiting. Names
+ * arrive in pieces of any size and are read with the bounded reader in
+ * greeting.h, so a client that never stops typing cannot overflow
+ * anything. Connection state, including its output buffer, comes from
+ * a pool that hands out fixed-size slots and takes them back, so a
+ * session costs no malloc() at all.
+ *
+ * With --loops N, N threads each run their own event loop and take
+ * turns accepting from the same listening socket (EPOLLEXCLUSIVE).
+ *
+ * Usage: ./greeting_server [--unix path | --tcp port] [--loops N]
+ * Stop it with Ctrl+C; it prints how many sessions it served.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "greeting.h"
+
+#define DEFAULT_SOCKET "/tmp/greeting.sock"
+#define MAX_LOOPS 64
+#define EVENTS_PER_WAIT 1024
+#define SLAB_CONNECTIONS 1024
+
+#define PROMPT_LENGTH (sizeof(GREETING_PROMPT) - 1)
+
+typedef struct connection {
+    int fd;
+    greeting_name_t name;
+    char out[PROMPT_LENGTH + GREETING_REPLY_MAX];
+    size_t out_length;
+    size_t out_sent;
+    struct connection *next_free;
+} connection_t;
+
+// Connections are carved from slabs and recycled through a free list
+typedef struct {
+    connection_t *free_list;
+    connection_t **slabs;
+    size_t slab_count;
+    size_t in_use;
+} connection_pool_t;
+
+typedef struct {
+    int listen_fd;
+    int epoll_fd;
+    connection_pool_t pool;
+    unsigned long long sessions;
+    unsigned long long dropped;    // Clients that hung up early
+    pthread_t thread;
+} event_loop_t;
+
+static atomic_int stop_requested;
+
+static void request_stop(int signal_number) {
+    (void)signal_number;
+    atomic_store(&stop_requested, 1);
+}
+
+static connection_t *pool_get(connection_pool_t *pool) {
+    if (pool->free_list == NULL) {
+        connection_t *slab = malloc(SLAB_CONNECTIONS * sizeof(connection_t));
+        connection_t **slabs = realloc(pool->slabs, (pool->slab_count + 1) *
+                                                        sizeof(*slabs));
+        if (slab == NULL || slabs == NULL) {
+            free(slab);
+            if (slabs != NULL) {
+                pool->slabs = slabs;
+            }
+            return NULL;
+        }
+        pool->slabs = slabs;
+        pool->slabs[pool->slab_count++] = slab;
+        for (size_t i = 0; i < SLAB_CONNECTIONS; i++) {
+            slab[i].next_free = pool->free_list;
+            pool->free_list = &slab[i];
+        }
+    }
+    connection_t *connection = pool->free_list;
+    pool->free_list = connection->next_free;
+    pool->in_use++;
+    return connection;
+}
+
+static void pool_put(connection_pool_t *pool, connection_t *connection) {
+    connection->next_free = pool->free_list;
+    pool->free_list = connection;
+    pool->in_use--;
+}
+
+static void pool_free(connection_pool_t *pool) {
+    for (size_t i = 0; i < pool->slab_count; i++) {
+        free(pool->slabs[i]);
+    }
+    free(pool->slabs);
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+}
+
+static void finish(event_loop_t *loop, connection_t *connection,
+                   int completed) {
+    close(connection->fd);  // Also removes it from epoll
+    if (completed) {
+        loop->sessions++;
+    } else {
+        loop->dropped++;
+    }
+    pool_put(&loop->pool, connection);
+}
+
+/**
+ * @brief Sends what is still unsent
+ * @return 1 when everything is out, 0 if the socket is full, -1 on error
+ */
+static int send_pending(connection_t *connection) {
+    while (connection->out_sent < connection->out_length) {
+        ssize_t sent = send(connection->fd,
+                            connection->out + connection->out_sent,
+                            connection->out_length - connection->out_sent,
+                            MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        connection->out_sent += (size_t)sent;
+    }
+    return 1;
+}
+
+// Reads until the name is complete or the socket is empty
+static int receive_name(connection_t *connection) {
+    char data[64];
+    while (!connection->name.done) {
+        ssize_t got = recv(connection->fd, data, sizeof(data), 0);
+        if (got > 0) {
+            greeting_name_feed(&connection->name, data, (size_t)got);
+        } else if (got == 0) {
+            // Hung up: a name without a final newline still counts
+            connection->name.done = connection->name.length > 0;
+            return connection->name.done ? 1 : -1;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Throws away input that came after the name
+ *
+ * Closing a TCP socket with unread data makes the kernel send a reset,
+ * and a reset can destroy the greeting before the client has read it.
+ */
+static void discard_input(connection_t *connection) {
+    char data[4096];
+    while (recv(connection->fd, data, sizeof(data), 0) > 0) {
+    }
+}
+
+// Handles whatever epoll reported for one connection
+static void serve(event_loop_t *loop, connection_t *connection) {
+    if (!connection->name.done) {
+        int status = receive_name(connection);
+        if (status < 0) {
+            finish(loop, connection, 0);
+            return;
+        }
+        if (status == 0) {
+            // Still typing; the prompt may still be on its way
+            if (send_pending(connection) < 0) {
+                finish(loop, connection, 0);
+            }
+            return;
+        }
+        // Queue the greeting behind whatever is left of the prompt
+        size_t left = connection->out_length - connection->out_sent;
+        memmove(connection->out, connection->out + connection->out_sent, left);
+        connection->out_sent = 0;
+        connection->out_length =
+            left + greeting_format(connection->out + left,
+                                   connection->name.text,
+                                   connection->name.length);
+    }
+    int status = send_pending(connection);
+    if (status > 0) {
+        discard_input(connection);
+    }
+    if (status != 0) {
+        finish(loop, connection, status > 0);
+    }
+}
+
+static void accept_clients(event_loop_t *loop) {
+    for (;;) {
+        int fd = accept4(loop->listen_fd, NULL, NULL,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN: no one else is waiting (or another loop took them)
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+                errno != ECONNABORTED) {
+                perror("accept");
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        connection_t *connection = pool_get(&loop->pool);
+        if (connection == NULL) {
+            close(fd);
+            loop->dropped++;
+            continue;
+        }
+        connection->fd = fd;
+        greeting_name_init(&connection->name);
+        memcpy(connection->out, GREETING_PROMPT, PROMPT_LENGTH);
+        connection->out_length = PROMPT_LENGTH;
+        connection->out_sent = 0;
+
+        // Edge-triggered: one wake-up per change, handled until EAGAIN
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = connection;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0 ||
+            send_pending(connection) < 0) {
+            finish(loop, connection, 0);
+        }
+    }
+}
+
+static void *run_loop(void *argument) {
+    event_loop_t *loop = argument;
+    struct epoll_event events[EVENTS_PER_WAIT];
+
+    while (!atomic_load(&stop_requested)) {
+        // Wake up now and then to notice a stop request
+        int ready = epoll_wait(loop->epoll_fd, events, EVENTS_PER_WAIT, 200);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.ptr == NULL) {
+                accept_clients(loop);
+            } else {
+                serve(loop, events[i].data.ptr);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int open_listener(const char *unix_path, int tcp_port) {
+    int fd;
+    if (tcp_port > 0) {
+        struct sockaddr_in address = {0};
+        int on = 1;
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)tcp_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+            bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            perror("tcp socket");
+            return -1;
+        }
+    } else {
+        struct sockaddr_un address = {0};
+        address.sun_family = AF_UNIX;
+        if (strlen(unix_path) >= sizeof(address.sun_path)) {
+            fprintf(stderr, "Error: socket path too long\n");
+            return -1;
+        }
+        strcpy(address.sun_path, unix_path);
+        unlink(unix_path);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0 ||
+            bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            perror(unix_path);
+            return -1;
+        }
+    }
+    // The kernel caps the backlog at net.core.somaxconn
+    if (listen(fd, 65535) != 0) {
+        perror("listen");
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    const char *unix_path = DEFAULT_SOCKET;
+    int tcp_port = 0;
+    int loop_count = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc) {
+            unix_path = argv[++i];
+        } else if (strcmp(argv[i], "--tcp") == 0 && i + 1 < argc) {
+            tcp_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loop_count = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--unix path | --tcp port] "
+                            "[--loops N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (loop_count < 1 || loop_count > MAX_LOOPS) {
+        fprintf(stderr, "Error: --loops must be 1-%d\n", MAX_LOOPS);
+        return 1;
+    }
+
+    // Every client is a file descriptor: allow as many as we may
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    struct sigaction action = {0};
+    action.sa_handler = request_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = open_listener(unix_path, tcp_port);
+    if (listen_fd < 0) {
+        return 1;
+    }
+
+    static event_loop_t loops[MAX_LOOPS];
+    for (int i = 0; i < loop_count; i++) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.ptr = NULL;  // NULL marks the listening socket
+        loops[i].listen_fd = listen_fd;
+        loops[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loops[i].epoll_fd < 0 ||
+            epoll_ctl(loops[i].epoll_fd, EPOLL_CTL_ADD, listen_fd, &event)) {
+            perror("epoll");
+            return 1;
+        }
+    }
+    if (tcp_port > 0) {
+        printf("Greeting server on 127.0.0.1:%d", tcp_port);
+    } else {
+        printf("Greeting server on %s", unix_path);
+    }
+    printf(" with %d event loop(s), open-file limit %llu\n", loop_count,
+           (unsigned long long)limit.rlim_cur);
+    fflush(stdout);
+
+    // Loop 0 runs on the main thread
+    for (int i = 1; i < loop_count; i++) {
+        if (pthread_create(&loops[i].thread, NULL, run_loop, &loops[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+    run_loop(&loops[0]);
+
+    unsigned long long sessions = 0, dropped = 0;
+    for (int i = 0; i < loop_count; i++) {
+        if (i > 0) {
+            pthread_join(loops[i].thread, NULL);
+        }
+        sessions += loops[i].sessions;
+        dropped += loops[i].dropped + loops[i].pool.in_use;
+        pool_free(&loops[i].pool);
+        close(loops[i].epoll_fd);
+    }
+    close(listen_fd);
+    if (tcp_port == 0) {
+        unlink(unix_path);
+    }
+    printf("Served %llu sessions (%llu dropped)\n", sessions, dropped);
+    return 0;
+}
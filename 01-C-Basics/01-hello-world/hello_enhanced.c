@@ -4,33 +4,43 @@
  * @author Tutorial Author
  * @date 2024
  * 
- * This program demonstrates multiple printf statements and
- * shows different formatting options available in C.
+ * This program demonstrates multiple messages and shows different
+ * escape sequences available in C. All lines are collected in one
+ * output buffer (see common/outbuf.h) and written with a single
+ * system call at the end.
  */
 
-#include <stdio.h>
+#include <unistd.h>
+
+#include "outbuf.h"
 
 int main() {
+    static char screen[512];
+    outbuf_t out;
+    outbuf_init(&out, STDOUT_FILENO, screen, sizeof(screen));
+
     // Multiple greeting messages
-    printf("Hello, World!\n");
-    printf("Welcome to C programming!\n");
-    printf("This is my first enhanced C program.\n");
+    outbuf_text(&out, "Hello, World!\n");
+    outbuf_text(&out, "Welcome to C programming!\n");
+    outbuf_text(&out, "This is my first enhanced C program.\n");
     
     // Demonstrate different escape sequences
-    printf("\n");  // Empty line
-    printf("Here are some formatting examples:\n");
-    printf("Tab-separated:\tHello\tWorld\n");
-    printf("Quoted text: \"Hello, World!\"\n");
-    printf("Backslash: C:\\Program Files\\\n");
+    outbuf_text(&out, "\n");  // Empty line
+    outbuf_text(&out, "Here are some formatting examples:\n");
+    outbuf_text(&out, "Tab-separated:\tHello\tWorld\n");
+    outbuf_text(&out, "Quoted text: \"Hello, World!\"\n");
+    outbuf_text(&out, "Backslash: C:\\Program Files\\\n");
     
     // Some simple ASCII art
-    printf("\n");
-    printf("    *    \n");
-    printf("   ***   \n");
-    printf("  *****  \n");
-    printf(" ******* \n");
-    printf("*********\n");
+    outbuf_text(&out, "\n");
+    outbuf_text(&out, "    *    \n");
+    outbuf_text(&out, "   ***   \n");
+    outbuf_text(&out, "  *****  \n");
+    outbuf_text(&out, " ******* \n");
+    outbuf_text(&out, "*********\n");
     
-    printf("\nProgram completed successfully!\n");
-    return 0;
+    outbuf_text(&out, "\nProgram completed successfully!\n");
+
+    // Everything above reaches the screen here, in one write()
+    return outbuf_flush(&out) == 0 ? 0 : 1;
 }
@@ -6,63 +6,75 @@
  * 
  * This program shows how to organize code into separate functions,
  * demonstrating function declarations, definitions, and calls.
+ *
+ * Each function adds its lines to one output buffer (see
+ * common/outbuf.h) instead of printing them, and main() writes the
+ * whole screen at once: one system call instead of one per line.
  */
 
-#include <stdio.h>
+#include <unistd.h>
+
+#include "outbuf.h"
 
 // Function declarations (prototypes)
-void print_welcome_banner(void);
-void print_greeting(void);
-void print_program_info(void);
-void print_separator(void);
+void print_welcome_banner(outbuf_t *out);
+void print_greeting(outbuf_t *out);
+void print_program_info(outbuf_t *out);
+void print_separator(outbuf_t *out);
 
 /**
  * @brief Main function that calls other functions
  * @return 0 on success
  */
 int main() {
-    print_welcome_banner();
-    print_separator();
-    print_greeting();
-    print_separator();
-    print_program_info();
+    static char screen[1024];
+    outbuf_t out;
+    outbuf_init(&out, STDOUT_FILENO, screen, sizeof(screen));
+
+    print_welcome_banner(&out);
+    print_separator(&out);
+    print_greeting(&out);
+    print_separator(&out);
+    print_program_info(&out);
     
-    printf("\nThank you for running this program!\n");
-    return 0;
+    outbuf_text(&out, "\nThank you for running this program!\n");
+    return outbuf_flush(&out) == 0 ? 0 : 1;
 }
 
 /**
- * @brief Prints a welcome banner with ASCII art
+ * @brief Adds a welcome banner with ASCII art
  */
-void print_welcome_banner(void) {
-    printf("╔════════════════════════════════════╗\n");
-    printf("║        WELCOME TO C WORLD!         ║\n");
-    printf("║         Hello, World! Demo        ║\n");
-    printf("╚════════════════════════════════════╝\n");
+void print_welcome_banner(outbuf_t *out) {
+    outbuf_text(out, "╔════════════════════════════════════╗\n"
+                     "║        WELCOME TO C WORLD!         ║\n"
+                     "║         Hello, World! Demo        ║\n"
+                     "╚════════════════════════════════════╝\n");
 }
 
 /**
- * @brief Prints the main greeting message
+ * @brief Adds the main greeting message
  */
-void print_greeting(void) {
-    printf("Hello, World!\n");
-    printf("Greetings from the world of C programming!\n");
-    printf("This message comes from a separate function.\n");
+void print_greeting(outbuf_t *out) {
+    outbuf_text(out, "Hello, World!\n"
+                     "Greetings from the world of C programming!\n"
+                     "This message comes from a separate function.\n");
 }
 
 /**
- * @brief Prints information about the program
+ * @brief Adds information about the program
  */
-void print_program_info(void) {
-    printf("Program: Multi-Function Hello World\n");
-    printf("Language: C Programming Language\n");
-    printf("Functions used: 5 (including main)\n");
-    printf("Purpose: Demonstrate function organization\n");
+void print_program_info(outbuf_t *out) {
+    outbuf_text(out, "Program: Multi-Function Hello World\n"
+                     "Language: C Programming Language\n");
+    outbuf_text(out, "Functions used: ");
+    outbuf_int(out, 5);
+    outbuf_text(out, " (including main)\n"
+                     "Purpose: Demonstrate function organization\n");
 }
 
 /**
- * @brief Prints a separator line
+ * @brief Adds a separator line
  */
-void print_separator(void) {
-    printf("----------------------------------------\n");
+void print_separator(outbuf_t *out) {
+    outbuf_text(out, "----------------------------------------\n");
 }
@@ -0,0 +1,262 @@
+/**
+ * @file hello_output_bench.c
+ * @brief System calls and time per report: printf() against outbuf_t
+ *
+ * Prints the same small report (a banner, fixed text and a few
+ * formatted numbers, like hello_functions.c) many times, once with one
+ * printf() per line and once built in an outbuf_t and flushed once per
+ * report, and measures write system calls and wall time per report.
+ *
+ * Each run happens in a child process whose stdout is either
+ *
+ *   - a pseudo-terminal: stdio sees a terminal and flushes after every
+ *     line, exactly as when the program runs in a terminal window;
+ *   - a pipe: stdio buffers 4 KiB and flushes when it is full, as in
+ *     ./program | less.
+ *
+ * The parent reads everything the child writes and checks that both
+ * methods produce byte-for-byte the same text. System calls are counted
+ * from /proc/self/io (syscw) when the kernel provides it.
+ *
+ * Usage: ./hello_output_bench [reports]
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "outbuf.h"
+
+#define DEFAULT_REPORTS 20000
+
+typedef enum { METHOD_PRINTF, METHOD_OUTBUF, METHOD_OUTBUF_BATCHED } method_t;
+
+static const char *method_names[] = {
+    "printf per line", "outbuf per report", "outbuf, 64 KiB batches"
+};
+
+// What the child measured
+typedef struct {
+    double seconds;
+    long long syscalls;       // From /proc/self/io, -1 if unavailable
+} result_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Write system calls made by this process so far, or -1
+static long long write_syscalls(void) {
+    FILE *io = fopen("/proc/self/io", "r");
+    long long count = -1;
+    char line[128];
+    if (io == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), io) != NULL) {
+        if (sscanf(line, "syscw: %lld", &count) == 1) {
+            break;
+        }
+    }
+    fclose(io);
+    return count;
+}
+
+static void printf_report(int number) {
+    printf("╔════════════════════════════════════╗\n");
+    printf("║        WELCOME TO C WORLD!         ║\n");
+    printf("║         Hello, World! Demo        ║\n");
+    printf("╚════════════════════════════════════╝\n");
+    printf("Report number: %d\n", number);
+    printf("----------------------------------------\n");
+    printf("Hello, World!\n");
+    printf("Greetings from the world of C programming!\n");
+    printf("Students greeted: %d\n", number * 3 + 1);
+    printf("Average greeting length: %.2f characters\n", 12.5 + number % 7);
+    printf("----------------------------------------\n");
+    printf("Thank you for running this program!\n");
+}
+
+static void outbuf_report(outbuf_t *out, int number) {
+    outbuf_text(out, "╔════════════════════════════════════╗\n"
+                     "║        WELCOME TO C WORLD!         ║\n"
+                     "║         Hello, World! Demo        ║\n"
+                     "╚════════════════════════════════════╝\n"
+                     "Report number: ");
+    outbuf_int(out, number);
+    outbuf_text(out, "\n----------------------------------------\n"
+                     "Hello, World!\n"
+                     "Greetings from the world of C programming!\n"
+                     "Students greeted: ");
+    outbuf_int(out, number * 3 + 1);
+    outbuf_printf(out, "\nAverage greeting length: %.2f characters\n",
+                  12.5 + number % 7);
+    outbuf_text(out, "----------------------------------------\n"
+                     "Thank you for running this program!\n");
+}
+
+// The child: prints the reports to stdout and sends back a result_t
+static void run_child(method_t method, int reports, int line_buffered,
+                      int result_fd) {
+    static char storage[65536];
+    outbuf_t out;
+    outbuf_init(&out, STDOUT_FILENO, storage, sizeof(storage));
+    setvbuf(stdout, NULL, line_buffered ? _IOLBF : _IOFBF, BUFSIZ);
+
+    result_t result;
+    long long before = write_syscalls();
+    double start = now_seconds();
+    for (int i = 0; i < reports; i++) {
+        if (method == METHOD_PRINTF) {
+            printf_report(i);
+        } else {
+            outbuf_report(&out, i);
+            if (method == METHOD_OUTBUF) {
+                outbuf_flush(&out);
+            }
+        }
+    }
+    fflush(stdout);
+    outbuf_flush(&out);
+    result.seconds = now_seconds() - start;
+    long long after = write_syscalls();
+    result.syscalls = before >= 0 && after >= 0 ? after - before : -1;
+
+    if (write(result_fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+// Opens a pseudo-terminal that passes bytes through unchanged
+static int open_terminal(int *master, int *slave) {
+    *master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0) {
+        return -1;
+    }
+    *slave = open(ptsname(*master), O_RDWR | O_NOCTTY);
+    if (*slave < 0) {
+        return -1;
+    }
+    // No "\n" -> "\r\n" translation, so the bytes can be compared
+    struct termios settings;
+    tcgetattr(*slave, &settings);
+    settings.c_oflag &= ~(tcflag_t)OPOST;
+    settings.c_lflag &= ~(tcflag_t)ECHO;
+    return tcsetattr(*slave, TCSANOW, &settings);
+}
+
+/**
+ * @brief Runs one method in a child and collects its output
+ * @return 0 on success; fills result, total bytes and a hash of the text
+ */
+static int measure(method_t method, int reports, int terminal,
+                   result_t *result, uint64_t *bytes, uint64_t *hash) {
+    int output[2], results[2];
+    if (terminal ? open_terminal(&output[0], &output[1]) != 0
+                 : pipe(output) != 0) {
+        perror(terminal ? "pseudo-terminal" : "pipe");
+        return -1;
+    }
+    if (pipe(results) != 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (child == 0) {
+        close(output[0]);
+        close(results[0]);
+        dup2(output[1], STDOUT_FILENO);
+        close(output[1]);
+        run_child(method, reports, terminal, results[1]);
+    }
+    close(output[1]);
+    close(results[1]);
+
+    // Drain the output (a closed terminal reads as an error, not EOF)
+    char chunk[65536];
+    ssize_t got;
+    *bytes = 0;
+    *hash = 14695981039346656037ull;  // FNV-1a
+    while ((got = read(output[0], chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < got; i++) {
+            *hash = (*hash ^ (unsigned char)chunk[i]) * 1099511628211ull;
+        }
+        *bytes += (uint64_t)got;
+    }
+    close(output[0]);
+
+    int status;
+    int ok = read(results[0], result, sizeof(*result)) == sizeof(*result);
+    close(results[0]);
+    waitpid(child, &status, 0);
+    if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Error: benchmark child failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int reports = argc >= 2 ? atoi(argv[1]) : DEFAULT_REPORTS;
+    if (reports <= 0) {
+        fprintf(stderr, "Usage: %s [reports]\n", argv[0]);
+        return 1;
+    }
+
+    printf("=== REPORT OUTPUT BENCHMARK ===\n");
+    printf("%d reports per run\n\n", reports);
+    printf("%-24s %-24s %15s %10s %8s\n", "stdout", "Method",
+           "Syscalls/report", "us/report", "Output");
+
+    for (int terminal = 1; terminal >= 0; terminal--) {
+        uint64_t reference_bytes = 0, reference_hash = 0;
+        for (int method = METHOD_PRINTF; method <= METHOD_OUTBUF_BATCHED;
+             method++) {
+            result_t result;
+            uint64_t bytes, hash;
+            if (measure((method_t)method, reports, terminal, &result, &bytes,
+                        &hash) != 0) {
+                return 1;
+            }
+            if (method == METHOD_PRINTF) {
+                reference_bytes = bytes;
+                reference_hash = hash;
+            }
+            int same = bytes == reference_bytes && hash == reference_hash;
+
+            char syscalls[32];
+            if (result.syscalls >= 0) {
+                snprintf(syscalls, sizeof(syscalls), "%.3f",
+                         (double)result.syscalls / reports);
+            } else {
+                snprintf(syscalls, sizeof(syscalls), "n/a");
+            }
+            printf("%-24s %-24s %15s %10.3f %8s\n",
+                   terminal ? "terminal (line-buffered)" : "pipe",
+                   method_names[method], syscalls,
+                   result.seconds / reports * 1e6,
+                   same ? "same" : "DIFFERS");
+            if (!same) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
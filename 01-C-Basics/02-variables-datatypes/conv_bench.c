@@ -0,0 +1,504 @@
+/**
+ * @file conv_bench.c
+ * @brief Bulk conversion benchmark: every type pair, every SIMD level
+ *
+ * First checks the kernels in convert.c:
+ *
+ *   - every level the CPU supports must give byte-identical values,
+ *     report bits and counts to the scalar kernels, for all 121 pairs
+ *     and all four modes, on random values mixed with the hard ones:
+ *     type limits and their neighbours, ties like 2.5, -0.0, NaN and
+ *     infinities, and doubles too large for a float
+ *   - the scalar kernels must agree with a reference that converts one
+ *     value at a time through long double (exact for every type here
+ *     when long double has a 64-bit mantissa, as on x86)
+ *
+ * Then prints how many million elements per second each pair converts
+ * at the best level, as a from x to matrix, and compares the levels
+ * for a few typical pairs.
+ *
+ * Usage: ./conv_bench [elements]   (default 16384, converted repeatedly)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "convert.h"
+
+#define DEFAULT_ELEMENTS 16384UL
+#define CHECK_ELEMENTS 10000UL       // Not a multiple of 64 on purpose
+#define TIMED_TOTAL 8000000UL        // Elements converted per timing
+#define MODE_COUNT 4
+#define MISMATCHES_SHOWN 5
+
+static const int modes[MODE_COUNT] = {
+    CONV_TRUNCATE, CONV_ROUND, CONV_SATURATE, CONV_SATURATE | CONV_ROUND
+};
+static const char *const mode_names[MODE_COUNT] = {
+    "truncate", "round", "saturate", "saturate|round"
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_state = 88172645463325252ull;
+static uint64_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static int is_float_type(conv_type_t type) {
+    return type >= CONV_FLOAT;
+}
+
+// Bytes of a long double that hold its value (the rest is padding)
+static size_t value_bytes(conv_type_t type) {
+    return type == CONV_LONG_DOUBLE && LDBL_MANT_DIG == 64
+               ? 10 : conv_type_size(type);
+}
+
+// ---------------------------------------------------------------------
+// Reading and writing one element of any type
+// ---------------------------------------------------------------------
+
+// An integer element as its two's complement bits, sign-extended
+static uint64_t load_bits(conv_type_t type, const void *array, size_t i) {
+    switch (type) {
+    case CONV_I8:  return (uint64_t)((const int8_t *)array)[i];
+    case CONV_U8:  return ((const uint8_t *)array)[i];
+    case CONV_I16: return (uint64_t)((const int16_t *)array)[i];
+    case CONV_U16: return ((const uint16_t *)array)[i];
+    case CONV_I32: return (uint64_t)((const int32_t *)array)[i];
+    case CONV_U32: return ((const uint32_t *)array)[i];
+    case CONV_I64: return (uint64_t)((const int64_t *)array)[i];
+    default:       return ((const uint64_t *)array)[i];
+    }
+}
+
+// Any element as a long double (exact for every integer type when the
+// mantissa has 64 bits)
+static long double load_value(conv_type_t type, const void *array,
+                              size_t i) {
+    switch (type) {
+    case CONV_FLOAT:       return ((const float *)array)[i];
+    case CONV_DOUBLE:      return ((const double *)array)[i];
+    case CONV_LONG_DOUBLE: return ((const long double *)array)[i];
+    case CONV_I8: case CONV_I16: case CONV_I32: case CONV_I64:
+        return (long double)(int64_t)load_bits(type, array, i);
+    default:
+        return (long double)load_bits(type, array, i);
+    }
+}
+
+static void store_bits(conv_type_t type, void *array, size_t i,
+                       uint64_t bits) {
+    switch (type) {
+    case CONV_I8: case CONV_U8:   ((uint8_t *)array)[i] = (uint8_t)bits; break;
+    case CONV_I16: case CONV_U16: ((uint16_t *)array)[i] = (uint16_t)bits; break;
+    case CONV_I32: case CONV_U32: ((uint32_t *)array)[i] = (uint32_t)bits; break;
+    default:                      ((uint64_t *)array)[i] = bits; break;
+    }
+}
+
+static void store_float(conv_type_t type, void *array, size_t i,
+                        long double value) {
+    switch (type) {
+    case CONV_FLOAT:  ((float *)array)[i] = (float)value; break;
+    case CONV_DOUBLE: ((double *)array)[i] = (double)value; break;
+    default:          ((long double *)array)[i] = value; break;
+    }
+}
+
+static long double type_min(conv_type_t type) {
+    static const long double mins[] = {
+        -0x1p7L, 0, -0x1p15L, 0, -0x1p31L, 0, -0x1p63L, 0,
+        -FLT_MAX, -DBL_MAX, -LDBL_MAX
+    };
+    return mins[type];
+}
+
+static long double type_max(conv_type_t type) {
+    static const long double maxes[] = {
+        0x1p7L - 1, 0x1p8L - 1, 0x1p15L - 1, 0x1p16L - 1, 0x1p31L - 1,
+        0x1p32L - 1, 0x1p63L - 1, 0x1p64L - 1, FLT_MAX, DBL_MAX, LDBL_MAX
+    };
+    return maxes[type];
+}
+
+// ---------------------------------------------------------------------
+// Test values
+// ---------------------------------------------------------------------
+
+// A value of a floating-point type: often one of the hard cases
+static long double random_float_value(void) {
+    static const long double powers[] = {
+        0x1p7L, 0x1p8L, 0x1p15L, 0x1p16L, 0x1p31L, 0x1p32L, 0x1p63L, 0x1p64L
+    };
+    static const long double specials[] = {
+        0.0L, -0.0L, 0.5L, -0.5L, 1.5L, 2.5L, -2.5L, 0.49999999999999994L,
+        FLT_MAX, -FLT_MAX, DBL_MAX, -DBL_MAX, 1e39L, -1e39L, 1e300L,
+        3.4028235677973366e38L, 3.4028235e38L, 1e4000L, -1e4000L,
+        FLT_MIN, 1e-320L, INFINITY, -INFINITY, NAN, -NAN
+    };
+    uint64_t r = next_random();
+    long double sign = (r >> 63) ? -1.0L : 1.0L;
+    switch (r % 5) {
+    case 0:     // Near a limit of an integer type: 2^31 - 0.5, -2^7 - 1, ...
+    {
+        long double power = powers[(r >> 8) % 8];
+        long double offsets[] = {-1.0L, -0.5L, -0.25L, 0.0L, 0.5L, 1.0L};
+        return sign * power + offsets[(r >> 16) % 6];
+    }
+    case 1:
+        return specials[(r >> 8) % (sizeof(specials) / sizeof(specials[0]))];
+    case 2:     // Halves and quarters: ties and near-ties
+        return sign * (long double)((r >> 8) % 4000) / 4.0L;
+    case 3:     // Any magnitude an integer could have
+        return sign * ldexpl((long double)(next_random() >> 11),
+                             (int)((r >> 8) % 80) - 60);
+    default:    // A score
+        return (long double)((r >> 8) % 100001) / 1000.0L;
+    }
+}
+
+// A value of an integer type, as bits: often an edge of some type
+static uint64_t random_integer_bits(void) {
+    static const uint64_t edges[] = {
+        0, 1, UINT64_MAX, 127, 128, 255, 256, 0xFFFFFFFFFFFFFF80ull,
+        0xFFFFFFFFFFFFFF7Full, 32767, 32768, 65535, 65536,
+        0xFFFFFFFFFFFF8000ull, 2147483647ull, 2147483648ull,
+        4294967295ull, 4294967296ull, 0xFFFFFFFF80000000ull,
+        9223372036854775807ull, 9223372036854775808ull,
+        9007199254740993ull, 16777217ull
+    };
+    uint64_t r = next_random();
+    if (r % 3 == 0) {
+        return edges[(r >> 8) % (sizeof(edges) / sizeof(edges[0]))];
+    }
+    uint64_t value = next_random() >> (r >> 2) % 64;
+    return (r >> 63) ? (uint64_t)0 - value : value;
+}
+
+static void fill_random(conv_type_t type, void *array, size_t n) {
+    memset(array, 0, n * conv_type_size(type));     // long double padding
+    for (size_t i = 0; i < n; i++) {
+        if (is_float_type(type)) {
+            store_float(type, array, i, random_float_value());
+        } else {
+            store_bits(type, array, i, random_integer_bits());
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+// Checks
+// ---------------------------------------------------------------------
+
+/**
+ * @brief Converts one element the slow, obvious way
+ * @return 1 if the value was out of range
+ */
+static int reference_element(conv_type_t to, void *out, conv_type_t from,
+                             const void *in, size_t i, int mode) {
+    long double value = load_value(from, in, i);
+
+    if (is_float_type(to)) {
+        long double result = value;
+        int bad = 0;
+        if (is_float_type(from) && isfinite(value)) {
+            // Round to the target first: DBL_MAX + a little is not too big
+            store_float(to, out, i, value);
+            long double rounded = load_value(to, out, i);
+            bad = isinf(rounded) != 0;    // isinf(-inf) may be -1
+            if (bad && (mode & CONV_SATURATE)) {
+                result = value < 0 ? type_min(to) : type_max(to);
+            }
+        }
+        store_float(to, out, i, result);
+        return bad;
+    }
+
+    if (!is_float_type(from)) {
+        int bad = value < type_min(to) || value > type_max(to);
+        uint64_t bits = load_bits(from, in, i);
+        if (bad && (mode & CONV_SATURATE)) {
+            bits = value < 0 ? (uint64_t)(int64_t)type_min(to)
+                             : (uint64_t)type_max(to);
+        }
+        store_bits(to, out, i, bits);
+        return bad;
+    }
+
+    long double t = (mode & CONV_ROUND) ? rintl(value) : truncl(value);
+    int bad = !(t >= type_min(to) && t <= type_max(to));
+    uint64_t bits = 0;
+    if (!bad) {
+        bits = t < 0 ? (uint64_t)(int64_t)t : (uint64_t)t;
+    } else if ((mode & CONV_SATURATE) && t < 0) {
+        bits = (uint64_t)(int64_t)type_min(to);
+    } else if ((mode & CONV_SATURATE) && t > 0) {
+        bits = (uint64_t)type_max(to);
+    }
+    store_bits(to, out, i, bits);
+    return bad;
+}
+
+static int report_bit(const uint64_t *report, size_t i) {
+    return (int)(report[i / 64] >> (i % 64) & 1);
+}
+
+// Same element? NaNs are equal to each other, whatever their bits
+static int same_element(conv_type_t type, const void *a, const void *b,
+                        size_t i) {
+    size_t size = conv_type_size(type);
+    if (is_float_type(type) && isnan(load_value(type, a, i)) &&
+        isnan(load_value(type, b, i))) {
+        return 1;
+    }
+    return memcmp((const char *)a + i * size, (const char *)b + i * size,
+                  value_bytes(type)) == 0;
+}
+
+static void show_mismatch(const char *what, conv_type_t from,
+                          conv_type_t to, int mode, const void *in,
+                          size_t i) {
+    printf("  %s: %s -> %s (%s), element %zu = %.21Lg\n", what,
+           conv_type_name(from), conv_type_name(to), mode_names[mode],
+           i, load_value(from, in, i));
+}
+
+/**
+ * @brief Checks every level against scalar, and scalar against reference
+ * @return Number of mismatches
+ */
+static unsigned long check_all(conv_level_t best, int check_reference) {
+    size_t n = CHECK_ELEMENTS;
+    size_t words = CONV_REPORT_WORDS(n);
+    void *in = malloc(n * sizeof(long double));
+    void *expected = malloc(n * sizeof(long double));
+    void *got = malloc(n * sizeof(long double));
+    uint64_t *expected_report = malloc(words * sizeof(uint64_t));
+    uint64_t *got_report = malloc(words * sizeof(uint64_t));
+    unsigned long mismatches = 0;
+
+    for (int from = 0; from < CONV_TYPE_COUNT; from++) {
+        fill_random((conv_type_t)from, in, n);
+        for (int to = 0; to < CONV_TYPE_COUNT; to++) {
+            for (int m = 0; m < MODE_COUNT; m++) {
+                memset(expected, 0, n * sizeof(long double));
+                long scalar_count = conv_array_level(
+                    CONV_LEVEL_SCALAR, (conv_type_t)to, expected,
+                    (conv_type_t)from, in, n, modes[m], expected_report);
+
+                for (int level = CONV_LEVEL_SSE4; level <= (int)best;
+                     level++) {
+                    memset(got, 0, n * sizeof(long double));
+                    memset(got_report, 0xA5, words * sizeof(uint64_t));
+                    long count = conv_array_level(
+                        (conv_level_t)level, (conv_type_t)to, got,
+                        (conv_type_t)from, in, n, modes[m], got_report);
+                    size_t bytes = n * conv_type_size((conv_type_t)to);
+                    if (count == scalar_count &&
+                        memcmp(got, expected, bytes) == 0 &&
+                        memcmp(got_report, expected_report,
+                               words * sizeof(uint64_t)) == 0) {
+                        continue;
+                    }
+                    for (size_t i = 0; i < n; i++) {
+                        if (memcmp((char *)got + i * bytes / n,
+                                   (char *)expected + i * bytes / n,
+                                   bytes / n) != 0 ||
+                            report_bit(got_report, i) !=
+                                report_bit(expected_report, i)) {
+                            if (mismatches < MISMATCHES_SHOWN) {
+                                show_mismatch(
+                                    conv_level_name((conv_level_t)level),
+                                    (conv_type_t)from, (conv_type_t)to, m,
+                                    in, i);
+                            }
+                            break;
+                        }
+                    }
+                    mismatches++;
+                }
+
+                if (!check_reference) {
+                    continue;
+                }
+                long reference_count = 0;
+                for (size_t i = 0; i < n; i++) {
+                    int bad = reference_element((conv_type_t)to, got,
+                                                (conv_type_t)from, in, i,
+                                                modes[m]);
+                    reference_count += bad;
+                    if (!same_element((conv_type_t)to, got, expected, i) ||
+                        bad != report_bit(expected_report, i)) {
+                        if (mismatches < MISMATCHES_SHOWN) {
+                            show_mismatch("reference", (conv_type_t)from,
+                                          (conv_type_t)to, m, in, i);
+                        }
+                        mismatches++;
+                        break;
+                    }
+                }
+                if (reference_count != scalar_count) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    free(in);
+    free(expected);
+    free(got);
+    free(expected_report);
+    free(got_report);
+    return mismatches;
+}
+
+// ---------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------
+
+// Typical values of a type: scores, ages, amounts - mostly in range
+static void fill_typical(conv_type_t type, void *array, size_t n) {
+    memset(array, 0, n * conv_type_size(type));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t r = next_random();
+        if (is_float_type(type)) {
+            store_float(type, array, i, (long double)(r % 30001) / 100.0L);
+        } else {
+            store_bits(type, array, i, r % 300);
+        }
+    }
+}
+
+// Million elements per second for one pair, mode and level
+static double time_pair(conv_level_t level, conv_type_t from, conv_type_t to,
+                        int mode, size_t n, const void *in, void *out,
+                        uint64_t *report) {
+    unsigned long rounds = TIMED_TOTAL / n + 1;
+    long total = 0;
+
+    conv_array_level(level, to, out, from, in, n, mode, report);   // Warm up
+    double start = now_seconds();
+    for (unsigned long r = 0; r < rounds; r++) {
+        total += conv_array_level(level, to, out, from, in, n, mode, report);
+        __asm__ volatile("" : : "r"(out) : "memory");
+    }
+    double seconds = now_seconds() - start;
+    (void)total;
+    return (double)rounds * (double)n / seconds / 1e6;
+}
+
+static void print_matrix(const char *title, conv_level_t level, int mode,
+                         int with_report, size_t n, void *const inputs[],
+                         void *out, uint64_t *report) {
+    printf("%s (million elements/s, %s, from row to column)\n", title,
+           conv_level_name(level));
+    printf("%-8s", "");
+    for (int to = 0; to < CONV_TYPE_COUNT; to++) {
+        printf("%8s", conv_type_name((conv_type_t)to));
+    }
+    printf("\n");
+    for (int from = 0; from < CONV_TYPE_COUNT; from++) {
+        printf("%-8s", conv_type_name((conv_type_t)from));
+        for (int to = 0; to < CONV_TYPE_COUNT; to++) {
+            double rate = time_pair(level, (conv_type_t)from, (conv_type_t)to,
+                                    mode, n, inputs[from], out,
+                                    with_report ? report : NULL);
+            printf("%8.0f", rate);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc >= 2 ? strtoul(argv[1], NULL, 10) : DEFAULT_ELEMENTS;
+    if (n == 0) {
+        n = DEFAULT_ELEMENTS;
+    }
+    conv_level_t best = conv_detect();
+    int check_reference = LDBL_MANT_DIG >= 64;
+
+    printf("=== BULK CONVERSION BENCHMARK ===\n");
+    printf("Best level on this CPU: %s\n", conv_level_name(best));
+    unsigned long mismatches = check_all(best, check_reference);
+    if (mismatches > 0) {
+        printf("Error: %lu pair/mode/level combinations differ\n",
+               mismatches);
+        return 1;
+    }
+    printf("%d pairs x %d modes x %d levels: identical to scalar on %lu "
+           "values each\n", CONV_TYPE_COUNT * CONV_TYPE_COUNT, MODE_COUNT,
+           (int)best + 1, CHECK_ELEMENTS);
+    if (check_reference) {
+        printf("Scalar kernels agree with the long double reference\n");
+    }
+    printf("\n");
+
+    void *inputs[CONV_TYPE_COUNT];
+    for (int type = 0; type < CONV_TYPE_COUNT; type++) {
+        inputs[type] = malloc(n * conv_type_size((conv_type_t)type));
+        fill_typical((conv_type_t)type, inputs[type], n);
+    }
+    void *out = malloc(n * sizeof(long double));
+    uint64_t *report = malloc(CONV_REPORT_WORDS(n) * sizeof(uint64_t));
+
+    print_matrix("Truncate, like a C cast", best, CONV_TRUNCATE, 0, n,
+                 inputs, out, report);
+    print_matrix("Saturate with range report", best, CONV_SATURATE, 1, n,
+                 inputs, out, report);
+
+    static const conv_type_t pairs[][2] = {
+        {CONV_DOUBLE, CONV_I32}, {CONV_DOUBLE, CONV_U8},
+        {CONV_FLOAT, CONV_I16}, {CONV_DOUBLE, CONV_FLOAT},
+        {CONV_I32, CONV_FLOAT}, {CONV_I64, CONV_DOUBLE},
+        {CONV_I32, CONV_I8}, {CONV_U64, CONV_U32},
+        {CONV_LONG_DOUBLE, CONV_I32},
+    };
+    printf("Saturate with range report, by level (million elements/s)\n");
+    printf("%-16s", "Pair");
+    for (int level = 0; level <= (int)best; level++) {
+        printf(" | %8s", conv_level_name((conv_level_t)level));
+    }
+    printf(" | %7s\n", "Speedup");
+    for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s -> %s", conv_type_name(pairs[p][0]),
+                 conv_type_name(pairs[p][1]));
+        printf("%-16s", name);
+        double scalar = 0.0;
+        double rate = 0.0;
+        for (int level = 0; level <= (int)best; level++) {
+            rate = time_pair((conv_level_t)level, pairs[p][0], pairs[p][1],
+                             CONV_SATURATE, n, inputs[pairs[p][0]], out,
+                             report);
+            if (level == CONV_LEVEL_SCALAR) {
+                scalar = rate;
+            }
+            printf(" | %8.0f", rate);
+        }
+        printf(" | %6.1fx\n", rate / scalar);
+    }
+
+    for (int type = 0; type < CONV_TYPE_COUNT; type++) {
+        free(inputs[type]);
+    }
+    free(out);
+    free(report);
+    return 0;
+}
@@ -0,0 +1,438 @@
+/**
+ * @file convert.c
+ * @brief Bulk conversion kernels for every pair of element types
+ *
+ * One macro writes the kernel for a type pair; lists of pairs expand
+ * it 121 times per instruction set level, each copy compiled with
+ * GCC's target attribute (like the calculator's calc_simd.c) so the
+ * file still builds with plain -O2. The kernels are written without
+ * branches - every element computes its result, its saturated result
+ * and its out-of-range flag, and a select picks one - which is the
+ * form the vectorizer turns into SIMD conversions, compares and
+ * blends. The scalar level has vectorization switched off, as the
+ * baseline.
+ *
+ * Elements are converted in blocks of CONV_BLOCK. The out-of-range
+ * flags of a block are collected as bytes, which vectorizes, and then
+ * packed into report bits eight at a time with one multiplication.
+ * Pairs that can never be out of range (widening, integer to float)
+ * skip the flags altogether.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "convert.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// The range checks compare, e.g., an unsigned value with 0; for some
+// pairs that is always false, which is the point
+#pragma GCC diagnostic ignored "-Wtype-limits"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONV_X86 1
+#else
+#define CONV_X86 0
+#endif
+
+// Elements per block: a multiple of 64, so report words are never shared
+#define CONV_BLOCK 512
+
+// ---------------------------------------------------------------------
+// Type descriptions, looked up by token pasting on the short names
+// ---------------------------------------------------------------------
+
+#define TYPE_i8 int8_t
+#define TYPE_u8 uint8_t
+#define TYPE_i16 int16_t
+#define TYPE_u16 uint16_t
+#define TYPE_i32 int32_t
+#define TYPE_u32 uint32_t
+#define TYPE_i64 int64_t
+#define TYPE_u64 uint64_t
+#define TYPE_f32 float
+#define TYPE_f64 double
+#define TYPE_ld long double
+
+#define ID_i8 CONV_I8
+#define ID_u8 CONV_U8
+#define ID_i16 CONV_I16
+#define ID_u16 CONV_U16
+#define ID_i32 CONV_I32
+#define ID_u32 CONV_U32
+#define ID_i64 CONV_I64
+#define ID_u64 CONV_U64
+#define ID_f32 CONV_FLOAT
+#define ID_f64 CONV_DOUBLE
+#define ID_ld CONV_LONG_DOUBLE
+
+// Integer ranges; LOW and HIGH are min and max + 1 as exact powers of two
+#define MIN_i8 INT8_MIN
+#define MIN_u8 0
+#define MIN_i16 INT16_MIN
+#define MIN_u16 0
+#define MIN_i32 INT32_MIN
+#define MIN_u32 0
+#define MIN_i64 INT64_MIN
+#define MIN_u64 0
+#define MAX_i8 INT8_MAX
+#define MAX_u8 UINT8_MAX
+#define MAX_i16 INT16_MAX
+#define MAX_u16 UINT16_MAX
+#define MAX_i32 INT32_MAX
+#define MAX_u32 UINT32_MAX
+#define MAX_i64 INT64_MAX
+#define MAX_u64 UINT64_MAX
+#define LOW_i8 -0x1p7L
+#define LOW_u8 0.0L
+#define LOW_i16 -0x1p15L
+#define LOW_u16 0.0L
+#define LOW_i32 -0x1p31L
+#define LOW_u32 0.0L
+#define LOW_i64 -0x1p63L
+#define LOW_u64 0.0L
+#define HIGH_i8 0x1p7L
+#define HIGH_u8 0x1p8L
+#define HIGH_i16 0x1p15L
+#define HIGH_u16 0x1p16L
+#define HIGH_i32 0x1p31L
+#define HIGH_u32 0x1p32L
+#define HIGH_i64 0x1p63L
+#define HIGH_u64 0x1p64L
+
+// Floating-point types: largest finite value and the math functions
+#define LARGEST_f32 FLT_MAX
+#define LARGEST_f64 DBL_MAX
+#define LARGEST_ld LDBL_MAX
+#define RINT_f32 rintf
+#define RINT_f64 rint
+#define RINT_ld rintl
+#define FABS_f32 fabsf
+#define FABS_f64 fabs
+#define FABS_ld fabsl
+
+// ---------------------------------------------------------------------
+// One element, per kind of pair
+//
+// Each sets r to the converted value and bad to 1 if v was out of
+// range. MODE is a constant, so the unused branches disappear.
+// ---------------------------------------------------------------------
+
+// Integer to integer: only a narrower range can fail
+#define MAY_FAIL_INT_INT(FROM, TO)                                          \
+    (MIN_##FROM < MIN_##TO || (uint64_t)MAX_##FROM > (uint64_t)MAX_##TO)
+
+#define ELEMENT_INT_INT(FROM, TO, MODE, v, r, bad)                          \
+    do {                                                                    \
+        TYPE_##FROM v_ = (v);                                               \
+        int below_ = MIN_##FROM < MIN_##TO &&                               \
+                     v_ < (TYPE_##FROM)MIN_##TO;                            \
+        int above_ = (uint64_t)MAX_##FROM > (uint64_t)MAX_##TO &&           \
+                     v_ > (TYPE_##FROM)MAX_##TO;                            \
+        TYPE_##TO r_ = (TYPE_##TO)v_;                                       \
+        if ((MODE) & CONV_SATURATE) {                                       \
+            r_ = below_ ? (TYPE_##TO)MIN_##TO : r_;                         \
+            r_ = above_ ? (TYPE_##TO)MAX_##TO : r_;                         \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)(below_ | above_);                                 \
+    } while (0)
+
+// Integer to floating point: always in range
+#define MAY_FAIL_INT_FLOAT(FROM, TO) 0
+
+#define ELEMENT_INT_FLOAT(FROM, TO, MODE, v, r, bad)                        \
+    do {                                                                    \
+        (r) = (TYPE_##TO)(v);                                               \
+        (bad) = 0;                                                          \
+    } while (0)
+
+// Floating point to integer. Truncation is left to the cast itself
+// (trunc() keeps the loop from vectorizing), so the lower limit is
+// exclusive: -128.9 still fits a signed char. It is LOW - 1 unless that
+// is not a FROM value, as for float at -2^31; then no value lies between
+// it and LOW, and LOW is the inclusive limit.
+#define MAY_FAIL_FLOAT_INT(FROM, TO) 1
+
+#define LOW_MINUS_ONE_EXACT(FROM, TO)                                       \
+    ((long double)(TYPE_##FROM)(LOW_##TO - 1) == LOW_##TO - 1)
+
+#define ELEMENT_FLOAT_INT(FROM, TO, MODE, v, r, bad)                        \
+    do {                                                                    \
+        TYPE_##FROM t_ = ((MODE) & CONV_ROUND) ? RINT_##FROM(v) : (v);      \
+        int below_ = LOW_MINUS_ONE_EXACT(FROM, TO)                          \
+                         ? t_ <= (TYPE_##FROM)(LOW_##TO - 1)                \
+                         : t_ < (TYPE_##FROM)LOW_##TO;                      \
+        int above_ = t_ >= (TYPE_##FROM)HIGH_##TO;                          \
+        int fits_ = !below_ & !above_ & (t_ == t_);    /* not NaN */        \
+        TYPE_##TO r_ = (TYPE_##TO)(fits_ ? t_ : 0);                         \
+        if ((MODE) & CONV_SATURATE) {                                       \
+            r_ = below_ ? (TYPE_##TO)MIN_##TO : r_;                         \
+            r_ = above_ ? (TYPE_##TO)MAX_##TO : r_;                         \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)!fits_;                                            \
+    } while (0)
+
+// Floating point to floating point: a finite value can overflow to
+// infinity when the target is narrower
+#define MAY_FAIL_FLOAT_FLOAT(FROM, TO)                                      \
+    ((long double)LARGEST_##TO < (long double)LARGEST_##FROM)
+
+#define ELEMENT_FLOAT_FLOAT(FROM, TO, MODE, v, r, bad)                      \
+    do {                                                                    \
+        TYPE_##FROM v_ = (v);                                               \
+        TYPE_##TO r_ = (TYPE_##TO)v_;                                       \
+        int overflow_ = FABS_##TO(r_) > LARGEST_##TO &&                     \
+                        FABS_##FROM(v_) <= LARGEST_##FROM;                  \
+        if ((MODE) & CONV_SATURATE) {                                       \
+            TYPE_##TO largest_ = v_ < 0 ? -LARGEST_##TO : LARGEST_##TO;     \
+            r_ = overflow_ ? largest_ : r_;                                 \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)overflow_;                                         \
+    } while (0)
+
+/**
+ * @brief Packs 0/1 flag bytes into report words; returns how many are set
+ *
+ * start is a multiple of 64. Multiplying eight flag bytes by
+ * 0x0102040810204080 gathers them into the top byte, first flag in the
+ * lowest bit.
+ */
+static size_t pack_flags(uint8_t *flags, size_t count, uint64_t *report,
+                         size_t start) {
+    size_t set = 0;
+    memset(flags + count, 0, (CONV_BLOCK - count) % 64);
+    for (size_t w = 0; w * 64 < count; w++) {
+        uint64_t word = 0;
+        for (size_t k = 0; k < 8; k++) {
+            uint64_t eight;
+            memcpy(&eight, flags + w * 64 + k * 8, 8);
+            word |= ((eight * 0x0102040810204080ull) >> 56) << (8 * k);
+        }
+        set += (size_t)__builtin_popcountll(word);
+        if (report != NULL) {
+            report[start / 64 + w] = word;
+        }
+    }
+    return set;
+}
+
+// ---------------------------------------------------------------------
+// The kernel for one pair at one level
+// ---------------------------------------------------------------------
+
+#define CONVERT_BLOCK(FROM, TO, KIND, MODE)                                 \
+    for (size_t j = 0; j < count; j++) {                                    \
+        ELEMENT_##KIND(FROM, TO, MODE, src[j], dst[j], flags[j]);           \
+    }
+
+#define DEFINE_KERNEL(LEVEL, FROM, TO, KIND)                                \
+    ATTRIBUTES_##LEVEL                                                      \
+    static size_t conv_##FROM##_##TO##_##LEVEL(void *out, const void *in,  \
+                                               size_t n, int mode,          \
+                                               uint64_t *report) {          \
+        const TYPE_##FROM *source = in;                                     \
+        TYPE_##TO *target = out;                                            \
+        if (!MAY_FAIL_##KIND(FROM, TO)) {                                   \
+            for (size_t i = 0; i < n; i++) {                                \
+                target[i] = (TYPE_##TO)source[i];                           \
+            }                                                               \
+            if (report != NULL) {                                           \
+                memset(report, 0, CONV_REPORT_WORDS(n) * sizeof(uint64_t)); \
+            }                                                               \
+            return 0;                                                       \
+        }                                                                   \
+        size_t out_of_range = 0;                                            \
+        uint8_t flags[CONV_BLOCK];                                          \
+        for (size_t start = 0; start < n; start += CONV_BLOCK) {            \
+            size_t count = n - start < CONV_BLOCK ? n - start : CONV_BLOCK; \
+            const TYPE_##FROM *src = source + start;                        \
+            TYPE_##TO *dst = target + start;                                \
+            switch (mode) {                                                 \
+            case CONV_TRUNCATE:                                             \
+                CONVERT_BLOCK(FROM, TO, KIND, CONV_TRUNCATE)                \
+                break;                                                      \
+            case CONV_ROUND:                                                \
+                CONVERT_BLOCK(FROM, TO, KIND, CONV_ROUND)                   \
+                break;                                                      \
+            case CONV_SATURATE:                                             \
+                CONVERT_BLOCK(FROM, TO, KIND, CONV_SATURATE)                \
+                break;                                                      \
+            default:                                                        \
+                CONVERT_BLOCK(FROM, TO, KIND, CONV_SATURATE | CONV_ROUND)   \
+                break;                                                      \
+            }                                                               \
+            out_of_range += pack_flags(flags, count, report, start);        \
+        }                                                                   \
+        return out_of_range;                                                \
+    }
+
+// ---------------------------------------------------------------------
+// All 121 pairs: X(LEVEL, FROM, TO, KIND)
+// ---------------------------------------------------------------------
+
+#define PAIRS_FROM_INT(X, LEVEL, FROM)                                      \
+    X(LEVEL, FROM, i8, INT_INT)                                             \
+    X(LEVEL, FROM, u8, INT_INT)                                             \
+    X(LEVEL, FROM, i16, INT_INT)                                            \
+    X(LEVEL, FROM, u16, INT_INT)                                            \
+    X(LEVEL, FROM, i32, INT_INT)                                            \
+    X(LEVEL, FROM, u32, INT_INT)                                            \
+    X(LEVEL, FROM, i64, INT_INT)                                            \
+    X(LEVEL, FROM, u64, INT_INT)                                            \
+    X(LEVEL, FROM, f32, INT_FLOAT)                                          \
+    X(LEVEL, FROM, f64, INT_FLOAT)                                          \
+    X(LEVEL, FROM, ld, INT_FLOAT)
+
+#define PAIRS_FROM_FLOAT(X, LEVEL, FROM)                                    \
+    X(LEVEL, FROM, i8, FLOAT_INT)                                           \
+    X(LEVEL, FROM, u8, FLOAT_INT)                                           \
+    X(LEVEL, FROM, i16, FLOAT_INT)                                          \
+    X(LEVEL, FROM, u16, FLOAT_INT)                                          \
+    X(LEVEL, FROM, i32, FLOAT_INT)                                          \
+    X(LEVEL, FROM, u32, FLOAT_INT)                                          \
+    X(LEVEL, FROM, i64, FLOAT_INT)                                          \
+    X(LEVEL, FROM, u64, FLOAT_INT)                                          \
+    X(LEVEL, FROM, f32, FLOAT_FLOAT)                                        \
+    X(LEVEL, FROM, f64, FLOAT_FLOAT)                                        \
+    X(LEVEL, FROM, ld, FLOAT_FLOAT)
+
+#define ALL_PAIRS(X, LEVEL)                                                 \
+    PAIRS_FROM_INT(X, LEVEL, i8)                                            \
+    PAIRS_FROM_INT(X, LEVEL, u8)                                            \
+    PAIRS_FROM_INT(X, LEVEL, i16)                                           \
+    PAIRS_FROM_INT(X, LEVEL, u16)                                           \
+    PAIRS_FROM_INT(X, LEVEL, i32)                                           \
+    PAIRS_FROM_INT(X, LEVEL, u32)                                           \
+    PAIRS_FROM_INT(X, LEVEL, i64)                                           \
+    PAIRS_FROM_INT(X, LEVEL, u64)                                           \
+    PAIRS_FROM_FLOAT(X, LEVEL, f32)                                         \
+    PAIRS_FROM_FLOAT(X, LEVEL, f64)                                         \
+    PAIRS_FROM_FLOAT(X, LEVEL, ld)
+
+typedef size_t conv_kernel_t(void *out, const void *in, size_t n, int mode,
+                             uint64_t *report);
+
+#define TABLE_ENTRY(LEVEL, FROM, TO, KIND)                                  \
+    [ID_##FROM][ID_##TO] = conv_##FROM##_##TO##_##LEVEL,
+
+// The scalar baseline: the same code, not vectorized
+#define ATTRIBUTES_scalar __attribute__((optimize("no-tree-vectorize")))
+ALL_PAIRS(DEFINE_KERNEL, scalar)
+
+static conv_kernel_t *const scalar_kernels[CONV_TYPE_COUNT][CONV_TYPE_COUNT] = {
+    ALL_PAIRS(TABLE_ENTRY, scalar)
+};
+
+#if CONV_X86
+// -O2 only vectorizes loops where it costs nothing extra; ask for more
+#define VECTORIZE optimize("tree-vectorize", "vect-cost-model=dynamic")
+#define ATTRIBUTES_sse4 __attribute__((target("sse4.1"), VECTORIZE))
+#define ATTRIBUTES_avx2 __attribute__((target("avx2"), VECTORIZE))
+#define ATTRIBUTES_avx512                                                   \
+    __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"), VECTORIZE))
+
+ALL_PAIRS(DEFINE_KERNEL, sse4)
+ALL_PAIRS(DEFINE_KERNEL, avx2)
+ALL_PAIRS(DEFINE_KERNEL, avx512)
+
+static conv_kernel_t *const sse4_kernels[CONV_TYPE_COUNT][CONV_TYPE_COUNT] = {
+    ALL_PAIRS(TABLE_ENTRY, sse4)
+};
+
+static conv_kernel_t *const avx2_kernels[CONV_TYPE_COUNT][CONV_TYPE_COUNT] = {
+    ALL_PAIRS(TABLE_ENTRY, avx2)
+};
+
+static conv_kernel_t *const avx512_kernels[CONV_TYPE_COUNT][CONV_TYPE_COUNT] = {
+    ALL_PAIRS(TABLE_ENTRY, avx512)
+};
+#endif // CONV_X86
+
+// ---------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------
+
+const char *conv_type_name(conv_type_t type) {
+    static const char *const names[CONV_TYPE_COUNT] = {
+        "i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64",
+        "float", "double", "ldouble"
+    };
+    return type < CONV_TYPE_COUNT ? names[type] : "unknown";
+}
+
+size_t conv_type_size(conv_type_t type) {
+    static const size_t sizes[CONV_TYPE_COUNT] = {
+        1, 1, 2, 2, 4, 4, 8, 8, sizeof(float), sizeof(double),
+        sizeof(long double)
+    };
+    return type < CONV_TYPE_COUNT ? sizes[type] : 0;
+}
+
+conv_level_t conv_detect(void) {
+    static int detected = -1;
+
+    if (detected < 0) {
+        int level = CONV_LEVEL_SCALAR;
+#if CONV_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") &&
+            __builtin_cpu_supports("avx512bw") &&
+            __builtin_cpu_supports("avx512dq") &&
+            __builtin_cpu_supports("avx512vl")) {
+            level = CONV_LEVEL_AVX512;
+        } else if (__builtin_cpu_supports("avx2")) {
+            level = CONV_LEVEL_AVX2;
+        } else if (__builtin_cpu_supports("sse4.1")) {
+            level = CONV_LEVEL_SSE4;
+        }
+#endif
+        detected = level;
+    }
+    return (conv_level_t)detected;
+}
+
+const char *conv_level_name(conv_level_t level) {
+    static const char *const names[CONV_LEVEL_COUNT] = {
+        "scalar", "SSE4.1", "AVX2", "AVX-512"
+    };
+    return level < CONV_LEVEL_COUNT ? names[level] : "unknown";
+}
+
+long conv_array_level(conv_level_t level, conv_type_t to, void *out,
+                      conv_type_t from, const void *in, size_t n, int mode,
+                      uint64_t *report) {
+    if (to >= CONV_TYPE_COUNT || from >= CONV_TYPE_COUNT || mode < 0 ||
+        mode > (CONV_SATURATE | CONV_ROUND)) {
+        return -1;
+    }
+
+    conv_kernel_t *kernel;
+    switch (level) {
+#if CONV_X86
+    case CONV_LEVEL_AVX512:
+        kernel = avx512_kernels[from][to];
+        break;
+    case CONV_LEVEL_AVX2:
+        kernel = avx2_kernels[from][to];
+        break;
+    case CONV_LEVEL_SSE4:
+        kernel = sse4_kernels[from][to];
+        break;
+#endif
+    default:
+        kernel = scalar_kernels[from][to];
+        break;
+    }
+    return (long)kernel(out, in, n, mode, report);
+}
+
+long conv_array(conv_type_t to, void *out, conv_type_t from, const void *in,
+                size_t n, int mode, uint64_t *report) {
+    return conv_array_level(conv_detect(), to, out, from, in, n, mode,
+                            report);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file convert.h
+ * @brief Bulk type conversion: whole arrays, SIMD, with range checking
+ *
+ * demonstrate_type_conversions() converts one value at a time, and a
+ * plain C cast is fine for that. Converting an array of millions of
+ * values raises two more questions: how to do it fast, and what to do
+ * with values the target type cannot hold. In C, (int)3e10 is
+ * undefined behavior and (unsigned char)300 silently becomes 44.
+ *
+ * conv_array() converts n values between any two of the integer and
+ * floating-point types from demonstrate_integer_types() and
+ * demonstrate_floating_point_types(), in one of these modes:
+ *
+ *   CONV_TRUNCATE  like a C cast: fractions are dropped (3.99 -> 3),
+ *                  integers wrap around ((unsigned char)300 -> 44)
+ *   CONV_ROUND     fractions are rounded to the nearest integer, ties
+ *                  to even (2.5 -> 2, 3.5 -> 4)
+ *   CONV_SATURATE  values beyond the target's range become its minimum
+ *                  or maximum (300 -> 255, -5 -> 0); can be combined
+ *                  with CONV_ROUND
+ *
+ * Values the target cannot hold are "out of range": a float that is
+ * NaN or beyond the integer type's range (it becomes 0 unless
+ * CONV_SATURATE is given), an integer that does not fit the smaller
+ * type, or a finite double too large for a float (it becomes infinity,
+ * or FLT_MAX with CONV_SATURATE). Their number is returned, and bit i
+ * of the optional report bitmap is set when element i was out of range
+ * (bit i lives in word i / 64, position i % 64).
+ *
+ * Integer-to-float and float-to-float conversions round to nearest,
+ * like a C cast, in every mode.
+ *
+ *     double scores[] = {87.5, -3.0, 312.9, NAN};
+ *     unsigned char bytes[4];
+ *     uint64_t report[CONV_REPORT_WORDS(4)];
+ *     conv_array(CONV_U8, bytes, CONV_DOUBLE, scores, 4,
+ *                CONV_SATURATE, report);
+ *     // bytes = {87, 0, 255, 0}, returns 3, report[0] = 0xE
+ *
+ * Each of the 121 type pairs has a kernel per instruction set level,
+ * written so the compiler turns it into SIMD code (conversions, range
+ * comparisons and blends on 16 to 64 values at once); the widest level
+ * the CPU supports is picked at run time. long double has no SIMD
+ * instructions and is always converted one value at a time.
+ */
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The element types. char/short/int/long long are the signed ones on
+// the usual platforms; long is the same as int or long long.
+typedef enum {
+    CONV_I8,                 // signed char
+    CONV_U8,                 // unsigned char
+    CONV_I16,                // short
+    CONV_U16,                // unsigned short
+    CONV_I32,                // int
+    CONV_U32,                // unsigned int
+    CONV_I64,                // long long
+    CONV_U64,                // unsigned long long
+    CONV_FLOAT,
+    CONV_DOUBLE,
+    CONV_LONG_DOUBLE,
+    CONV_TYPE_COUNT
+} conv_type_t;
+
+// Modes (CONV_ROUND and CONV_SATURATE can be combined with |)
+#define CONV_TRUNCATE 0
+#define CONV_ROUND 1
+#define CONV_SATURATE 2
+
+// Number of 64-bit words in the out-of-range report for n elements
+#define CONV_REPORT_WORDS(n) (((n) + 63) / 64)
+
+// Instruction sets the kernels are compiled for, from slowest to fastest
+typedef enum {
+    CONV_LEVEL_SCALAR = 0,   // One value at a time
+    CONV_LEVEL_SSE4,         // SSE4.1 (128-bit; rounding instructions)
+    CONV_LEVEL_AVX2,         // 256-bit
+    CONV_LEVEL_AVX512,       // 512-bit, with the F/BW/DQ/VL extensions
+    CONV_LEVEL_COUNT
+} conv_level_t;
+
+/**
+ * @brief Short name of a type, e.g. "i16" or "double"
+ */
+const char *conv_type_name(conv_type_t type);
+
+/**
+ * @brief Size of one element of the type in bytes
+ */
+size_t conv_type_size(conv_type_t type);
+
+/**
+ * @brief Converts n values of type from into type to
+ *
+ * @param to Element type of out
+ * @param out Converted values (must not overlap in)
+ * @param from Element type of in
+ * @param in Values to convert
+ * @param n Number of values
+ * @param mode CONV_TRUNCATE, CONV_ROUND, CONV_SATURATE or
+ *             CONV_SATURATE | CONV_ROUND
+ * @param report Out-of-range bitmap of CONV_REPORT_WORDS(n) words,
+ *               or NULL
+ * @return Number of values out of range, or -1 for an invalid type
+ *         or mode
+ */
+long conv_array(conv_type_t to, void *out, conv_type_t from, const void *in,
+                size_t n, int mode, uint64_t *report);
+
+/**
+ * @brief Best level supported by this CPU (checked once with CPUID)
+ */
+conv_level_t conv_detect(void);
+
+/**
+ * @brief Human-readable name of a level, e.g. "AVX2"
+ */
+const char *conv_level_name(conv_level_t level);
+
+/**
+ * @brief Same as conv_array() but forces a specific level
+ *
+ * Used by the benchmark to compare levels. The level must not be
+ * higher than conv_detect() returns. Every level gives bit-identical
+ * results.
+ */
+long conv_array_level(conv_level_t level, conv_type_t to, void *out,
+                      conv_type_t from, const void *in, size_t n, int mode,
+                      uint64_t *report);
+
+#endif // CONVERT_H
@@ -0,0 +1,435 @@
+/**
+ * @file fmt_bench.c
+ * @brief Number formatting benchmark: fmt.h against snprintf()
+ *
+ * First checks that the fast formatters print exactly what printf()
+ * prints:
+ *
+ *   - millions of random conversions - every combination of the flags
+ *     "-+ #0", widths, precisions, length modifiers and conversions -
+ *     formatted by fmt_format() and snprintf() must be byte-identical,
+ *     for integers at the edges of their types, scores like 87.125,
+ *     random doubles from 1e-320 to 1e308, zeros, infinities and NaNs
+ *   - fmt_shortest() must read back (strtod()) as the same double, and
+ *     have no more digits than the shortest "%.*g" that reads back
+ *
+ * Then times each way of printing a few typical conversions.
+ *
+ * Usage: ./fmt_bench [cases]   (default 2000000)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+
+#include "fmt.h"
+
+#define DEFAULT_CASES 2000000UL
+#define TIMED_VALUES 4096
+#define TIMED_CALLS 10000000UL
+#define MISMATCHES_SHOWN 5
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_state = 88172645463325252ull;
+static uint64_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// An integer of a random magnitude, often at the edge of some type
+static uint64_t random_integer(void) {
+    static const uint64_t edges[] = {
+        0, 1, 9, 10, 99, 100, 127, 128, 255, 256, 32767, 32768, 65535,
+        2147483647ull, 2147483648ull, 4294967295ull, 999999999999999999ull,
+        9223372036854775807ull, 9223372036854775808ull, UINT64_MAX
+    };
+    uint64_t r = next_random();
+    if (r % 4 == 0) {
+        return edges[(r >> 8) % (sizeof(edges) / sizeof(edges[0]))];
+    }
+    return next_random() >> (r >> 2) % 64;
+}
+
+// A double of one of the kinds a report prints, or a random bit pattern
+static double random_double(void) {
+    static const double specials[] = {
+        0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.005, 1e21, 1e22, 1e-5, 9.5,
+        99.995, 999999.5, 5e-324, 2.2250738585072014e-308,
+        1.7976931348623157e308, INFINITY, -INFINITY, NAN, -NAN
+    };
+    uint64_t r = next_random();
+    uint64_t bits;
+    double value;
+    switch (r % 6) {
+    case 0:     // A score with up to three decimals: 87.125
+        return (double)((r >> 8) % 100001) / 1000.0;
+    case 1:     // A money amount: -12345.67
+        value = (double)((r >> 8) % 100000000) / 100.0;
+        return (r >> 63) ? -value : value;
+    case 2:     // An exact tie at some precision: 0.125, 2.5
+        return (double)((r >> 8) % 4096) / (double)(1u << ((r >> 4) % 12));
+    case 3:
+        return specials[(r >> 8) % (sizeof(specials) / sizeof(specials[0]))];
+    case 4:     // Moderate magnitude, all 53 bits
+        return ldexp((double)(next_random() >> 11), (int)((r >> 8) % 140) - 100);
+    default:    // Any finite double
+        do {
+            bits = next_random();
+            memcpy(&value, &bits, sizeof(value));
+        } while (!isfinite(value));
+        return value;
+    }
+}
+
+/**
+ * @brief Builds a random conversion specification such as "%-+08.3lx"
+ * @return The conversion character
+ */
+static char random_spec(char *spec, const char **length) {
+    static const char conversions[] = "diuxXofFeEgGcs";
+    static const char *integer_lengths[] = {"", "", "h", "hh", "l", "ll", "z"};
+    static const char *flag_chars = "-+ #0";
+    uint64_t r = next_random();
+    char conversion = conversions[r % (sizeof(conversions) - 1)];
+    char *p = spec;
+
+    r >>= 8;
+    *p++ = (char)('a' + r % 26);                    // Some text around it
+    *p++ = '%';
+    for (int i = 0; i < 5; i++) {
+        if ((r >> i) % 4 == 0) {
+            *p++ = flag_chars[i];
+        }
+    }
+    r >>= 10;
+    if (r % 3 != 0) {
+        p += sprintf(p, "%d", (int)((r >> 2) % 30));
+    }
+    r >>= 8;
+    if (r % 2 != 0) {
+        p += sprintf(p, ".%d", (int)((r >> 1) % 24));
+    }
+    r >>= 8;
+    *length = "";
+    if (strchr("diuxXo", conversion) != NULL) {
+        *length = integer_lengths[r % 7];
+    }
+    p += sprintf(p, "%s%c|", *length, conversion);
+    *p = '\0';
+    return conversion;
+}
+
+// Formats one argument with both functions; returns 1 if they agree
+static int check_case(const char *spec, char conversion, const char *length,
+                      char *expected, char *actual, size_t room) {
+    int expected_length;
+    int actual_length;
+    if (strchr("fFeEgG", conversion) != NULL) {
+        double value = random_double();
+        expected_length = snprintf(expected, room, spec, value);
+        actual_length = fmt_format(actual, room, spec, value);
+    } else if (conversion == 'c') {
+        int c = (int)(' ' + next_random() % 95);
+        expected_length = snprintf(expected, room, spec, c);
+        actual_length = fmt_format(actual, room, spec, c);
+    } else if (conversion == 's') {
+        static const char *texts[] = {"", "A", "Alice", "Computer Science"};
+        const char *text = texts[next_random() % 4];
+        expected_length = snprintf(expected, room, spec, text);
+        actual_length = fmt_format(actual, room, spec, text);
+    } else {
+        uint64_t value = random_integer();
+        if (length[0] == 'z') {
+            expected_length = snprintf(expected, room, spec, (size_t)value);
+            actual_length = fmt_format(actual, room, spec, (size_t)value);
+        } else if (strcmp(length, "ll") == 0) {
+            expected_length = snprintf(expected, room, spec,
+                                       (unsigned long long)value);
+            actual_length = fmt_format(actual, room, spec,
+                                       (unsigned long long)value);
+        } else if (length[0] == 'l') {
+            expected_length = snprintf(expected, room, spec,
+                                       (unsigned long)value);
+            actual_length = fmt_format(actual, room, spec,
+                                       (unsigned long)value);
+        } else {
+            expected_length = snprintf(expected, room, spec, (unsigned)value);
+            actual_length = fmt_format(actual, room, spec, (unsigned)value);
+        }
+    }
+    return expected_length == actual_length &&
+           (room == 0 || strcmp(expected, actual) == 0);
+}
+
+/**
+ * @brief Compares fmt_format() with snprintf() on random conversions
+ *
+ * Every tenth case uses a buffer too small for the text, which must be
+ * cut off the same way.
+ *
+ * @return Number of cases that differ
+ */
+static unsigned long check_format(unsigned long cases) {
+    char spec[40];
+    char expected[512];
+    char actual[512];
+    unsigned long mismatches = 0;
+
+    for (unsigned long i = 0; i < cases; i++) {
+        const char *length;
+        char conversion = random_spec(spec, &length);
+        size_t room = i % 10 == 9 ? (size_t)(i / 10 % 12) : sizeof(expected);
+        uint64_t state = random_state;
+        if (!check_case(spec, conversion, length, expected, actual, room)) {
+            if (mismatches++ < MISMATCHES_SHOWN) {
+                random_state = state;               // Show the same case
+                check_case(spec, conversion, length, expected, actual,
+                           sizeof(expected));
+                printf("  Mismatch: \"%s\": snprintf \"%s\", fmt \"%s\"\n",
+                       spec, expected, actual);
+            }
+        }
+    }
+    return mismatches;
+}
+
+// Formats with both functions; counts a mismatch if they differ
+#define CHECK_SAME(mismatches, format, ...)                                  \
+    do {                                                                     \
+        char expected_[128];                                                 \
+        char actual_[128];                                                   \
+        int expected_length_ = snprintf(expected_, sizeof(expected_),        \
+                                        format, __VA_ARGS__);                \
+        int actual_length_ = fmt_format(actual_, sizeof(actual_), format,    \
+                                        __VA_ARGS__);                        \
+        if (expected_length_ != actual_length_ ||                            \
+            strcmp(expected_, actual_) != 0) {                               \
+            printf("  Mismatch: \"%s\": snprintf \"%s\", fmt \"%s\"\n",       \
+                   format, expected_, actual_);                              \
+            (mismatches)++;                                                  \
+        }                                                                    \
+    } while (0)
+
+/**
+ * @brief Checks flags and conversions that fmt_format() passes on to
+ *        snprintf(): each must take its argument, so the conversion
+ *        after it still gets the right one
+ * @return Number of cases that differ
+ */
+static unsigned long check_passed_on(void) {
+    // Not string literals, so the compiler does not check them
+    static const char *grouped_int = "%'d|%s";
+    static const char *grouped_long = "%'12lu|%d";
+    static const char *grouped_short = "%'+hd|%s";
+    static const char *grouped_double = "%'.2f|%s";
+    static const char *locale_digits = "%Id|%s";
+    static const char *unknown = "%y|%s";
+    static const char *wide = "%C%S|%s";
+    unsigned long mismatches = 0;
+
+    CHECK_SAME(mismatches, grouped_int, 1234567, "x");
+    CHECK_SAME(mismatches, grouped_long, 9876543210ul, 42);
+    CHECK_SAME(mismatches, grouped_short, 70000, "short");
+    CHECK_SAME(mismatches, grouped_double, 1234567.891, "y");
+    CHECK_SAME(mismatches, locale_digits, -15, "z");
+    CHECK_SAME(mismatches, unknown, "skipped");
+    CHECK_SAME(mismatches, wide, (wint_t)L'A', L"bc", "d");
+    return mismatches;
+}
+
+/**
+ * @brief Checks that fmt_shortest() reads back and is never longer
+ *        than the shortest "%.*g" that reads back
+ * @return Number of values that fail
+ */
+static unsigned long check_shortest(unsigned long cases) {
+    char text[64];
+    char reference[64];
+    unsigned long failures = 0;
+
+    for (unsigned long i = 0; i < cases; i++) {
+        double value = random_double();
+        if (!isfinite(value)) {
+            continue;
+        }
+        size_t length = fmt_shortest(text, value);
+        text[length] = '\0';
+        double back = strtod(text, NULL);
+
+        // Significant digits written, and the fewest "%.*g" needs
+        int digits = 0;
+        int leading = 1;
+        for (const char *p = text; *p != '\0' && *p != 'e'; p++) {
+            if (*p >= '1' && *p <= '9') {
+                leading = 0;
+            }
+            digits += !leading && *p >= '0' && *p <= '9';
+        }
+        int precision = 1;
+        for (; precision < 17; precision++) {
+            snprintf(reference, sizeof(reference), "%.*g", precision, value);
+            if (strtod(reference, NULL) == value) {
+                break;
+            }
+        }
+        while (digits > 1 && strchr(text, '.') == NULL &&
+               strchr(text, 'e') == NULL && text[length - 1] == '0' &&
+               digits > precision) {
+            digits--;                               // "100": trailing zeros
+            length--;
+        }
+        if (memcmp(&back, &value, sizeof(value)) != 0 ||
+            (value != 0 && digits > precision)) {
+            if (failures++ < MISMATCHES_SHOWN) {
+                fmt_shortest(text, value);
+                printf("  Failure: %.17g: fmt_shortest \"%s\", %%.%dg \"%s\"\n",
+                       value, text, precision, reference);
+            }
+        }
+    }
+    return failures;
+}
+
+typedef enum {
+    WAY_SNPRINTF, WAY_FORMAT, WAY_DIRECT, WAY_COUNT
+} way_t;
+
+typedef struct {
+    const char *name;
+    const char *format;          // For snprintf() and fmt_format()
+    int is_integer;
+} conversion_t;
+
+static const conversion_t conversions[] = {
+    {"%d", "%d", 1},
+    {"%10d", "%10d", 1},
+    {"%x", "%x", 1},
+    {"%.2f score", "%.2f", 0},
+    {"%.2f money", "%.2f", 0},
+    {"%e", "%e", 0},
+    {"%g", "%g", 0},
+    {"%.17g / shortest", "%.17g", 0},
+};
+
+#define CONVERSION_COUNT (sizeof(conversions) / sizeof(conversions[0]))
+
+// Formats TIMED_CALLS values one way; returns the total text length
+static size_t time_conversion(size_t index, way_t way, const int *integers,
+                              const double *scores, const double *money,
+                              const double *doubles) {
+    const conversion_t *c = &conversions[index];
+    const double *values = index == 3 ? scores : index == 4 ? money : doubles;
+    char text[64];
+    size_t total = 0;
+
+    for (unsigned long i = 0; i < TIMED_CALLS; i++) {
+        size_t k = i % TIMED_VALUES;
+        if (way == WAY_SNPRINTF) {
+            total += c->is_integer
+                         ? (size_t)snprintf(text, sizeof(text), c->format,
+                                            integers[k])
+                         : (size_t)snprintf(text, sizeof(text), c->format,
+                                            values[k]);
+        } else if (way == WAY_FORMAT) {
+            total += c->is_integer
+                         ? (size_t)fmt_format(text, sizeof(text), c->format,
+                                              integers[k])
+                         : (size_t)fmt_format(text, sizeof(text), c->format,
+                                              values[k]);
+        } else {
+            switch (index) {
+            case 0:
+                total += fmt_i64(text, integers[k]);
+                break;
+            case 1:     // Width has no direct function: that is fmt_format()
+                total += (size_t)fmt_format(text, sizeof(text), "%10d",
+                                            integers[k]);
+                break;
+            case 2:
+                total += fmt_hex(text, (unsigned)integers[k], 0);
+                break;
+            case 3:
+            case 4:
+                total += fmt_fixed(text, values[k], 2);
+                break;
+            case 5:
+                total += fmt_exp(text, values[k], 6, 0);
+                break;
+            case 6:
+                total += fmt_general(text, values[k], 6, 0);
+                break;
+            default:
+                total += fmt_shortest(text, values[k]);
+                break;
+            }
+        }
+        // Keep the compiler from dropping the unused text
+        __asm__ volatile("" : : "r"(text) : "memory");
+    }
+    return total;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long cases = argc >= 2 ? strtoul(argv[1], NULL, 10)
+                                    : DEFAULT_CASES;
+
+    printf("=== NUMBER FORMATTING BENCHMARK ===\n");
+    unsigned long mismatches = check_format(cases) + check_passed_on();
+    if (mismatches > 0) {
+        printf("Error: %lu of %lu conversions differ from snprintf()\n",
+               mismatches, cases);
+        return 1;
+    }
+    printf("%lu random conversions byte-identical to snprintf()\n", cases);
+    unsigned long failures = check_shortest(cases / 4);
+    if (failures > 0) {
+        printf("Error: %lu values not shortest or not read back\n", failures);
+        return 1;
+    }
+    printf("%lu shortest doubles read back exactly, none longer than %%.*g\n\n",
+           cases / 4);
+
+    static int integers[TIMED_VALUES];
+    static double scores[TIMED_VALUES];
+    static double money[TIMED_VALUES];
+    static double doubles[TIMED_VALUES];
+    for (size_t i = 0; i < TIMED_VALUES; i++) {
+        uint64_t r = next_random();
+        integers[i] = (int)(r >> 32) >> (r % 31);
+        scores[i] = (double)(r % 10001) / 100.0 + 0.001 * (double)(r >> 60);
+        money[i] = (double)((r >> 8) % 100000000) / 100.0;
+        doubles[i] = ldexp((double)(next_random() >> 11), (int)(r % 60) - 73);
+    }
+
+    printf("%-18s | %12s | %12s | %12s | %7s\n", "Conversion",
+           "snprintf ns", "fmt_format ns", "fmt_* ns", "Speedup");
+    printf("-------------------|--------------|--------------|"
+           "--------------|--------\n");
+    for (size_t c = 0; c < CONVERSION_COUNT; c++) {
+        double ns[WAY_COUNT];
+        for (int way = 0; way < WAY_COUNT; way++) {
+            double start = now_seconds();
+            time_conversion(c, (way_t)way, integers, scores, money, doubles);
+            ns[way] = (now_seconds() - start) * 1e9 / TIMED_CALLS;
+        }
+        printf("%-18s | %12.1f | %12.1f | %12.1f | %6.1fx\n",
+               conversions[c].name, ns[WAY_SNPRINTF], ns[WAY_FORMAT],
+               ns[WAY_DIRECT], ns[WAY_SNPRINTF] / ns[WAY_DIRECT]);
+    }
+    printf("\nfmt_* is the direct call: fmt_i64(), fmt_fixed(), "
+           "fmt_shortest(), ...\n");
+    return 0;
+}
@@ -0,0 +1,723 @@
+/**
+ * @file type_bench.c
+ * @brief What each type costs: add, multiply, divide and convert
+ *
+ * variables_demo prints the size and range of char, short, int, long,
+ * long long, float, double and long double. This benchmark measures
+ * what an operation on each of them costs, four ways:
+ *
+ *   latency     one chain of dependent operations (x = x + c; x = x + c;
+ *               ...): how long a single result takes
+ *   throughput  eight independent chains side by side: how many
+ *               operations the CPU overlaps
+ *   array       a[i] = a[i] op b[i] over an array, vectorizer off
+ *   simd        the same loop compiled for the widest SIMD level the CPU
+ *               supports (SSE2, AVX2 or AVX-512), auto-vectorized
+ *
+ * The operations are +, *, / and a round trip through another type
+ * ("conv": to double and back for the integer types, to long long and
+ * back for the floating-point ones). The operands leave the value
+ * unchanged - add 0, multiply and divide by 1 - but are read at run
+ * time, so the compiler cannot drop the work, and an empty asm
+ * statement after each step stops it from folding a chain of adds into
+ * one multiplication.
+ *
+ * To keep the numbers steady the process is pinned to one CPU, spins
+ * for a moment to let the clock speed settle, sizes every measurement
+ * to about 2 ms and repeats it; the median and the median absolute
+ * deviation (MAD) are reported. Where perf_event_open() is permitted
+ * the cycles, instructions and branch misses per operation are read
+ * from the hardware counters as well.
+ *
+ * Usage: ./type_bench [--json] [--reps N] [--cpu N]
+ *   --json    print the results as JSON instead of a table
+ *   --reps N  repetitions per measurement (default 15)
+ *   --cpu N   CPU to pin to (default: the one the program starts on)
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BENCH_X86 1
+#else
+#define BENCH_X86 0
+#endif
+
+#define DEFAULT_REPS 15
+#define TARGET_SECONDS 0.002        // Length of one measurement
+#define WARMUP_SECONDS 0.2
+#define CHAINS 8                    // Independent chains for throughput
+#define ARRAY_ELEMENTS 1024         // Fits in L1 even for long double
+#define SEED 100                    // Start value; fits every type
+
+// ---------------------------------------------------------------------
+// The types and operations
+// ---------------------------------------------------------------------
+
+// X(ID, TYPE, OTHER, NAME): OTHER is the type "conv" goes through
+#define BENCH_TYPES(X)                                                      \
+    X(char, char, double, "char")                                           \
+    X(short, short, double, "short")                                        \
+    X(int, int, double, "int")                                              \
+    X(long, long, double, "long")                                           \
+    X(llong, long long, double, "long long")                                \
+    X(float, float, long long, "float")                                     \
+    X(double, double, long long, "double")                                  \
+    X(ldouble, long double, long long, "long double")
+
+typedef enum {
+#define TYPE_ENUM(ID, TYPE, OTHER, NAME) TYPE_##ID,
+    BENCH_TYPES(TYPE_ENUM)
+#undef TYPE_ENUM
+    TYPE_COUNT
+} type_id_t;
+
+static const char *const type_names[TYPE_COUNT] = {
+#define TYPE_NAME(ID, TYPE, OTHER, NAME) NAME,
+    BENCH_TYPES(TYPE_NAME)
+#undef TYPE_NAME
+};
+
+static const size_t type_sizes[TYPE_COUNT] = {
+#define TYPE_SIZE(ID, TYPE, OTHER, NAME) sizeof(TYPE),
+    BENCH_TYPES(TYPE_SIZE)
+#undef TYPE_SIZE
+};
+
+#define BENCH_OPS(X, ID, TYPE, OTHER)                                       \
+    X(ID, TYPE, OTHER, add)                                                 \
+    X(ID, TYPE, OTHER, mul)                                                 \
+    X(ID, TYPE, OTHER, div)                                                 \
+    X(ID, TYPE, OTHER, conv)
+
+typedef enum { OP_add, OP_mul, OP_div, OP_conv, OP_COUNT } op_id_t;
+
+static const char *const op_names[OP_COUNT] = {"add", "mul", "div", "conv"};
+
+// The right-hand operands, read at run time: x op c == x
+static volatile int operand_add = 0;
+static volatile int operand_mul = 1;
+static volatile int operand_div = 1;
+static volatile int operand_conv = 0;
+
+#define APPLY_add(TYPE, x, c) (TYPE)((x) + (c))
+#define APPLY_mul(TYPE, x, c) (TYPE)((x) * (c))
+#define APPLY_div(TYPE, x, c) (TYPE)((x) / (c))
+
+// An empty asm that claims to change x, kept in a register, so every
+// step must really be computed. The constraint depends on the type.
+#if BENCH_X86
+#define KEEP_char "+r"
+#define KEEP_short "+r"
+#define KEEP_int "+r"
+#define KEEP_long "+r"
+#define KEEP_llong "+r"
+#define KEEP_float "+x"
+#define KEEP_double "+x"
+#define KEEP_ldouble "+t"          // Top of the x87 stack
+#else
+// Elsewhere through memory, which adds a store and load to each step
+#define KEEP_char "+m"
+#define KEEP_short "+m"
+#define KEEP_int "+m"
+#define KEEP_long "+m"
+#define KEEP_llong "+m"
+#define KEEP_float "+m"
+#define KEEP_double "+m"
+#define KEEP_ldouble "+m"
+#endif
+
+#define KEEP(ID, x) __asm__ volatile("" : KEEP_##ID(x))
+
+// The ID of the type conv goes through, for KEEP
+#define VIA_char double
+#define VIA_short double
+#define VIA_int double
+#define VIA_long double
+#define VIA_llong double
+#define VIA_float llong
+#define VIA_double llong
+#define VIA_ldouble llong
+#define KEEP_AS(VIA, x) KEEP(VIA, x)
+#define KEEP_VIA(ID, x) KEEP_AS(VIA_##ID, x)
+
+// One step of a chain. conv keeps the value in between too: otherwise
+// the compiler knows (int)(double)x is x and removes both conversions.
+#define STEP_add(ID, TYPE, OTHER, x, c) x = APPLY_add(TYPE, x, c)
+#define STEP_mul(ID, TYPE, OTHER, x, c) x = APPLY_mul(TYPE, x, c)
+#define STEP_div(ID, TYPE, OTHER, x, c) x = APPLY_div(TYPE, x, c)
+#define STEP_conv(ID, TYPE, OTHER, x, c)                                    \
+    do {                                                                    \
+        OTHER via_ = (OTHER)(x);                                            \
+        KEEP_VIA(ID, via_);                                                 \
+        x = (TYPE)via_;                                                     \
+    } while (0)
+
+// ---------------------------------------------------------------------
+// Chains: latency and throughput
+// ---------------------------------------------------------------------
+
+typedef double chain_kernel_t(unsigned long steps);
+
+#define DEFINE_LATENCY(ID, TYPE, OTHER, OP)                                 \
+    static double latency_##OP##_##ID(unsigned long steps) {                \
+        TYPE c = (TYPE)operand_##OP;                                        \
+        TYPE x = (TYPE)SEED;                                                \
+        (void)c;                                                            \
+        for (unsigned long i = 0; i < steps; i++) {                         \
+            STEP_##OP(ID, TYPE, OTHER, x, c);                               \
+            KEEP(ID, x);                                                    \
+        }                                                                   \
+        return (double)x;                                                   \
+    }
+
+#define THROUGHPUT_DECLARE(k, ID, TYPE, OTHER, OP)                          \
+    TYPE x##k = (TYPE)(SEED + k);
+#define THROUGHPUT_STEP(k, ID, TYPE, OTHER, OP)                             \
+    STEP_##OP(ID, TYPE, OTHER, x##k, c);                                    \
+    KEEP(ID, x##k);
+#define THROUGHPUT_SUM(k, ID, TYPE, OTHER, OP) + (double)x##k
+
+#define EACH_CHAIN(S, ...)                                                  \
+    S(0, __VA_ARGS__) S(1, __VA_ARGS__) S(2, __VA_ARGS__)                   \
+    S(3, __VA_ARGS__) S(4, __VA_ARGS__) S(5, __VA_ARGS__)                   \
+    S(6, __VA_ARGS__) S(7, __VA_ARGS__)
+
+#define DEFINE_THROUGHPUT(ID, TYPE, OTHER, OP)                              \
+    static double throughput_##OP##_##ID(unsigned long steps) {             \
+        TYPE c = (TYPE)operand_##OP;                                        \
+        EACH_CHAIN(THROUGHPUT_DECLARE, ID, TYPE, OTHER, OP)                 \
+        (void)c;                                                            \
+        for (unsigned long i = 0; i < steps; i++) {                         \
+            EACH_CHAIN(THROUGHPUT_STEP, ID, TYPE, OTHER, OP)                \
+        }                                                                   \
+        return 0.0 EACH_CHAIN(THROUGHPUT_SUM, ID, TYPE, OTHER, OP);         \
+    }
+
+#define DEFINE_CHAINS(ID, TYPE, OTHER, NAME)                                \
+    BENCH_OPS(DEFINE_LATENCY, ID, TYPE, OTHER)                              \
+    BENCH_OPS(DEFINE_THROUGHPUT, ID, TYPE, OTHER)
+
+BENCH_TYPES(DEFINE_CHAINS)
+
+#define LATENCY_ENTRY(ID, TYPE, OTHER, OP) [OP_##OP] = latency_##OP##_##ID,
+#define THROUGHPUT_ENTRY(ID, TYPE, OTHER, OP)                               \
+    [OP_##OP] = throughput_##OP##_##ID,
+#define LATENCY_ROW(ID, TYPE, OTHER, NAME)                                  \
+    [TYPE_##ID] = {BENCH_OPS(LATENCY_ENTRY, ID, TYPE, OTHER)},
+#define THROUGHPUT_ROW(ID, TYPE, OTHER, NAME)                               \
+    [TYPE_##ID] = {BENCH_OPS(THROUGHPUT_ENTRY, ID, TYPE, OTHER)},
+
+static chain_kernel_t *const latency_kernels[TYPE_COUNT][OP_COUNT] = {
+    BENCH_TYPES(LATENCY_ROW)
+};
+
+static chain_kernel_t *const throughput_kernels[TYPE_COUNT][OP_COUNT] = {
+    BENCH_TYPES(THROUGHPUT_ROW)
+};
+
+// ---------------------------------------------------------------------
+// Arrays: scalar and auto-vectorized, like convert.c
+// ---------------------------------------------------------------------
+
+typedef enum {
+    LEVEL_SCALAR = 0,
+    LEVEL_SSE2,              // The x86-64 baseline (or plain -O2 elsewhere)
+    LEVEL_AVX2,
+    LEVEL_AVX512,
+    LEVEL_COUNT
+} level_t;
+
+static const char *const level_names[LEVEL_COUNT] = {
+    "scalar", BENCH_X86 ? "SSE2" : "SIMD", "AVX2", "AVX-512"
+};
+
+typedef void array_kernel_t(void *a, const void *b, void *other, size_t n);
+
+// conv goes through a second array: in one loop the compiler would see
+// that (int)(double)x is x and remove it
+#define ARRAY_LOOP(TYPE, OP)                                                \
+    for (size_t i = 0; i < n; i++) {                                        \
+        x[i] = APPLY_##OP(TYPE, x[i], y[i]);                                \
+    }
+#define ARRAY_LOOP_CONV(TYPE, OTHER)                                        \
+    for (size_t i = 0; i < n; i++) {                                        \
+        via[i] = (OTHER)x[i];                                               \
+    }                                                                       \
+    for (size_t i = 0; i < n; i++) {                                        \
+        x[i] = (TYPE)via[i];                                                \
+    }
+#define ARRAY_BODY_add(TYPE, OTHER) ARRAY_LOOP(TYPE, add)
+#define ARRAY_BODY_mul(TYPE, OTHER) ARRAY_LOOP(TYPE, mul)
+#define ARRAY_BODY_div(TYPE, OTHER) ARRAY_LOOP(TYPE, div)
+#define ARRAY_BODY_conv(TYPE, OTHER) ARRAY_LOOP_CONV(TYPE, OTHER)
+
+#define DEFINE_ARRAY(LEVEL, ID, TYPE, OTHER, OP)                            \
+    ATTRIBUTES_##LEVEL                                                      \
+    static void array_##OP##_##ID##_##LEVEL(void *a, const void *b,         \
+                                            void *other, size_t n) {        \
+        TYPE *restrict x = a;                                               \
+        const TYPE *restrict y = b;                                         \
+        OTHER *restrict via = other;                                        \
+        (void)y;                                                            \
+        (void)via;                                                          \
+        ARRAY_BODY_##OP(TYPE, OTHER)                                        \
+    }
+
+#define ARRAY_OPS(X, LEVEL, ID, TYPE, OTHER)                                \
+    X(LEVEL, ID, TYPE, OTHER, add)                                          \
+    X(LEVEL, ID, TYPE, OTHER, mul)                                          \
+    X(LEVEL, ID, TYPE, OTHER, div)                                          \
+    X(LEVEL, ID, TYPE, OTHER, conv)
+
+#define ARRAY_ENTRY(LEVEL, ID, TYPE, OTHER, OP)                             \
+    [OP_##OP] = array_##OP##_##ID##_##LEVEL,
+
+// Expands the kernels, then the table, of one level
+#define ARRAY_TYPES(X, LEVEL)                                               \
+    X(LEVEL, char, char, double)                                            \
+    X(LEVEL, short, short, double)                                          \
+    X(LEVEL, int, int, double)                                              \
+    X(LEVEL, long, long, double)                                            \
+    X(LEVEL, llong, long long, double)                                      \
+    X(LEVEL, float, float, long long)                                       \
+    X(LEVEL, double, double, long long)                                     \
+    X(LEVEL, ldouble, long double, long long)
+
+#define DEFINE_ARRAYS(LEVEL, ID, TYPE, OTHER)                               \
+    ARRAY_OPS(DEFINE_ARRAY, LEVEL, ID, TYPE, OTHER)
+#define ARRAY_ROW(LEVEL, ID, TYPE, OTHER)                                   \
+    [TYPE_##ID] = {ARRAY_OPS(ARRAY_ENTRY, LEVEL, ID, TYPE, OTHER)},
+
+// -O2 only vectorizes loops where it costs nothing extra; ask for more
+#define VECTORIZE optimize("tree-vectorize", "vect-cost-model=dynamic")
+#define ATTRIBUTES_scalar __attribute__((optimize("no-tree-vectorize")))
+#define ATTRIBUTES_sse2 __attribute__((VECTORIZE))
+
+ARRAY_TYPES(DEFINE_ARRAYS, scalar)
+ARRAY_TYPES(DEFINE_ARRAYS, sse2)
+
+#if BENCH_X86
+#define ATTRIBUTES_avx2 __attribute__((target("avx2"), VECTORIZE))
+#define ATTRIBUTES_avx512                                                   \
+    __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"), VECTORIZE))
+
+ARRAY_TYPES(DEFINE_ARRAYS, avx2)
+ARRAY_TYPES(DEFINE_ARRAYS, avx512)
+#endif
+
+static array_kernel_t *const array_kernels[LEVEL_COUNT][TYPE_COUNT][OP_COUNT] = {
+    [LEVEL_SCALAR] = {ARRAY_TYPES(ARRAY_ROW, scalar)},
+    [LEVEL_SSE2] = {ARRAY_TYPES(ARRAY_ROW, sse2)},
+#if BENCH_X86
+    [LEVEL_AVX2] = {ARRAY_TYPES(ARRAY_ROW, avx2)},
+    [LEVEL_AVX512] = {ARRAY_TYPES(ARRAY_ROW, avx512)},
+#endif
+};
+
+static level_t detect_level(void) {
+#if BENCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl")) {
+        return LEVEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return LEVEL_AVX2;
+    }
+#endif
+    return LEVEL_SSE2;
+}
+
+// ---------------------------------------------------------------------
+// Hardware counters
+// ---------------------------------------------------------------------
+
+typedef enum {
+    COUNTER_CYCLES, COUNTER_INSTRUCTIONS, COUNTER_BRANCH_MISSES,
+    COUNTER_COUNT
+} counter_t;
+
+static const char *const counter_names[COUNTER_COUNT] = {
+    "cycles", "instructions", "branch_misses"
+};
+
+static int counter_fds[COUNTER_COUNT] = {-1, -1, -1};
+
+/**
+ * @brief Opens cycles, instructions and branch misses as one group
+ * @return 0, or the errno of the failure (counters are then unused)
+ */
+static int counters_open(void) {
+#ifdef __linux__
+    static const uint64_t configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (int k = 0; k < COUNTER_COUNT; k++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[k];
+        attr.disabled = k == 0;
+        attr.exclude_kernel = 1;    // Allowed at perf_event_paranoid 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1,
+                              counter_fds[0], 0);
+        if (fd < 0) {
+            int error = errno;
+            for (int j = 0; j < k; j++) {
+                close(counter_fds[j]);
+                counter_fds[j] = -1;
+            }
+            return error;
+        }
+        counter_fds[k] = fd;
+    }
+    return 0;
+#else
+    return ENOSYS;
+#endif
+}
+
+static void counters_start(void) {
+#ifdef __linux__
+    if (counter_fds[0] >= 0) {
+        ioctl(counter_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counter_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+// Stops the counters and stores their values (0 if not open)
+static void counters_stop(uint64_t values[COUNTER_COUNT]) {
+    memset(values, 0, COUNTER_COUNT * sizeof(uint64_t));
+#ifdef __linux__
+    if (counter_fds[0] >= 0) {
+        ioctl(counter_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t group[1 + COUNTER_COUNT];
+        if (read(counter_fds[0], group, sizeof(group)) ==
+                (ssize_t)sizeof(group) && group[0] == COUNTER_COUNT) {
+            memcpy(values, group + 1, COUNTER_COUNT * sizeof(uint64_t));
+        }
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------
+// Measuring
+// ---------------------------------------------------------------------
+
+typedef enum {
+    MODE_LATENCY, MODE_THROUGHPUT, MODE_ARRAY, MODE_SIMD, MODE_COUNT
+} bench_mode_t;
+
+static const char *const mode_names[MODE_COUNT] = {
+    "latency", "throughput", "array", "simd"
+};
+
+typedef struct {
+    double ns;                       // Median nanoseconds per operation
+    double ns_mad;                   // Median absolute deviation
+    double counters[COUNTER_COUNT];  // Medians per operation
+} result_t;
+
+// Arrays for the array modes, aligned for any vector width
+static _Alignas(64) long double array_a[ARRAY_ELEMENTS];
+static _Alignas(64) long double array_b[ARRAY_ELEMENTS];
+static _Alignas(64) long double array_via[ARRAY_ELEMENTS];
+
+static volatile double sink;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, int count) {
+    qsort(values, (size_t)count, sizeof(double), compare_doubles);
+    return count % 2 ? values[count / 2]
+                     : (values[count / 2 - 1] + values[count / 2]) / 2.0;
+}
+
+// Fills the arrays with SEED and the operand that leaves it unchanged
+static void fill_arrays(type_id_t type, op_id_t op) {
+    static const volatile int *const operands[OP_COUNT] = {
+        &operand_add, &operand_mul, &operand_div, &operand_conv
+    };
+    int operand = *operands[op];
+    for (size_t i = 0; i < ARRAY_ELEMENTS; i++) {
+        switch (type) {
+#define FILL_CASE(ID, TYPE, OTHER, NAME)                                    \
+        case TYPE_##ID:                                                     \
+            ((TYPE *)array_a)[i] = (TYPE)(SEED + i % 8);                    \
+            ((TYPE *)array_b)[i] = (TYPE)operand;                           \
+            break;
+        BENCH_TYPES(FILL_CASE)
+#undef FILL_CASE
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Runs one kernel for a number of rounds
+ * @return Operations done
+ */
+static double run(bench_mode_t mode, level_t simd, type_id_t type, op_id_t op,
+                  unsigned long rounds) {
+    switch (mode) {
+    case MODE_LATENCY:
+        sink = latency_kernels[type][op](rounds);
+        return (double)rounds;
+    case MODE_THROUGHPUT:
+        sink = throughput_kernels[type][op](rounds);
+        return (double)rounds * CHAINS;
+    default:
+    {
+        array_kernel_t *kernel =
+            array_kernels[mode == MODE_SIMD ? simd : LEVEL_SCALAR][type][op];
+        for (unsigned long r = 0; r < rounds; r++) {
+            kernel(array_a, array_b, array_via, ARRAY_ELEMENTS);
+            __asm__ volatile("" : : : "memory");
+        }
+        return (double)rounds * ARRAY_ELEMENTS;
+    }
+    }
+}
+
+/**
+ * @brief Measures one kernel: sizes it to TARGET_SECONDS, then repeats
+ */
+static result_t measure(bench_mode_t mode, level_t simd, type_id_t type,
+                        op_id_t op, int reps) {
+    if (mode >= MODE_ARRAY) {
+        fill_arrays(type, op);
+    }
+
+    // Size (this also warms up caches and branch predictors)
+    unsigned long rounds = 16;
+    for (;;) {
+        double start = now_seconds();
+        run(mode, simd, type, op, rounds);
+        if (now_seconds() - start >= TARGET_SECONDS / 2) {
+            break;
+        }
+        rounds *= 2;
+    }
+
+    double ns[reps];
+    double per_op[COUNTER_COUNT][reps];
+    for (int r = 0; r < reps; r++) {
+        uint64_t counts[COUNTER_COUNT];
+        counters_start();
+        double start = now_seconds();
+        double ops = run(mode, simd, type, op, rounds);
+        double seconds = now_seconds() - start;
+        counters_stop(counts);
+        ns[r] = seconds * 1e9 / ops;
+        for (int k = 0; k < COUNTER_COUNT; k++) {
+            per_op[k][r] = (double)counts[k] / ops;
+        }
+    }
+
+    result_t result;
+    result.ns = median(ns, reps);
+    for (int r = 0; r < reps; r++) {
+        ns[r] = ns[r] > result.ns ? ns[r] - result.ns : result.ns - ns[r];
+    }
+    result.ns_mad = median(ns, reps);
+    for (int k = 0; k < COUNTER_COUNT; k++) {
+        result.counters[k] = median(per_op[k], reps);
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------------
+// Setup and output
+// ---------------------------------------------------------------------
+
+/**
+ * @brief Pins the process to one CPU
+ * @return The CPU, or -1 if pinning failed
+ */
+static int pin_to_cpu(int cpu) {
+    if (cpu < 0) {
+        cpu = sched_getcpu();
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0 ? cpu : -1;
+}
+
+// Spins so the CPU leaves its power-saving clock speed before measuring
+static void warm_up(void) {
+    double start = now_seconds();
+    unsigned long spins = 0;
+    while (now_seconds() - start < WARMUP_SECONDS) {
+        spins++;
+    }
+    sink = (double)spins;
+}
+
+static void print_table(result_t results[TYPE_COUNT][OP_COUNT][MODE_COUNT],
+                        level_t simd, int counters) {
+    printf("Nanoseconds per operation (median, +- MAD)%s\n",
+           counters ? "; cycles per operation for latency" : "");
+    printf("%-12s %-4s | %-15s | %-15s | %-15s | %-15s%s\n", "Type", "Op",
+           "Latency", "Throughput", "Array", level_names[simd],
+           counters ? " | Cycles" : "");
+    printf("------------------|-----------------|-----------------|"
+           "-----------------|----------------%s\n",
+           counters ? "|-------" : "");
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            printf("%-12s %-4s", op == 0 ? type_names[type] : "",
+                   op_names[op]);
+            for (int mode = 0; mode < MODE_COUNT; mode++) {
+                const result_t *r = &results[type][op][mode];
+                char cell[32];
+                snprintf(cell, sizeof(cell), "%.3f +-%.3f", r->ns, r->ns_mad);
+                printf(" | %-15s", cell);
+            }
+            if (counters) {
+                printf(" | %6.2f",
+                       results[type][op][MODE_LATENCY]
+                           .counters[COUNTER_CYCLES]);
+            }
+            printf("\n");
+        }
+    }
+}
+
+static void print_json(result_t results[TYPE_COUNT][OP_COUNT][MODE_COUNT],
+                       level_t simd, int cpu, int reps, int counters) {
+    printf("{\n");
+    printf("  \"cpu\": %d,\n", cpu);
+    printf("  \"simd_level\": \"%s\",\n", level_names[simd]);
+    printf("  \"repetitions\": %d,\n", reps);
+    printf("  \"counters\": %s,\n", counters ? "true" : "false");
+    printf("  \"results\": [\n");
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            for (int mode = 0; mode < MODE_COUNT; mode++) {
+                const result_t *r = &results[type][op][mode];
+                printf("    {\"type\": \"%s\", \"size\": %zu, "
+                       "\"op\": \"%s\", \"mode\": \"%s\", "
+                       "\"ns_median\": %.4f, \"ns_mad\": %.4f",
+                       type_names[type], type_sizes[type], op_names[op],
+                       mode_names[mode], r->ns, r->ns_mad);
+                if (counters) {
+                    for (int k = 0; k < COUNTER_COUNT; k++) {
+                        printf(", \"%s\": %.4f", counter_names[k],
+                               r->counters[k]);
+                    }
+                }
+                int last = type == TYPE_COUNT - 1 && op == OP_COUNT - 1 &&
+                           mode == MODE_COUNT - 1;
+                printf("}%s\n", last ? "" : ",");
+            }
+        }
+    }
+    printf("  ]\n");
+    printf("}\n");
+}
+
+int main(int argc, char *argv[]) {
+    int json = 0;
+    int reps = DEFAULT_REPS;
+    int cpu = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            cpu = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--json] [--reps N] [--cpu N]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1 || reps > 1000) {
+        fprintf(stderr, "Error: --reps must be between 1 and 1000\n");
+        return 1;
+    }
+
+    int pinned = pin_to_cpu(cpu);
+    if (pinned < 0) {
+        fprintf(stderr, "Warning: could not pin to CPU %d: %s\n", cpu,
+                strerror(errno));
+    }
+    int counter_error = counters_open();
+    int counters = counter_error == 0;
+    level_t simd = detect_level();
+
+    if (!json) {
+        printf("=== TYPE COST BENCHMARK ===\n");
+        printf("Pinned to CPU %d, SIMD level %s, %d repetitions\n", pinned,
+               level_names[simd], reps);
+        if (counters) {
+            printf("Hardware counters: cycles, instructions, branch misses\n");
+        } else {
+            printf("Hardware counters unavailable (perf_event_open: %s)\n",
+                   strerror(counter_error));
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    warm_up();
+    static result_t results[TYPE_COUNT][OP_COUNT][MODE_COUNT];
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            for (int mode = 0; mode < MODE_COUNT; mode++) {
+                results[type][op][mode] =
+                    measure((bench_mode_t)mode, simd, (type_id_t)type,
+                            (op_id_t)op, reps);
+            }
+        }
+    }
+
+    if (json) {
+        print_json(results, simd, pinned, reps, counters);
+    } else {
+        print_table(results, simd, counters);
+        printf("\nLatency: one dependent chain. Throughput: %d chains. "
+               "Array: %d elements, not vectorized.\n", CHAINS,
+               ARRAY_ELEMENTS);
+        printf("conv: to double and back (floating types: to long long "
+               "and back).\n");
+    }
+    return 0;
+}
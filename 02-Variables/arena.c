@@ -0,0 +1,98 @@
+/**
+ * @file arena.c
+ * @brief Bump arena implementation
+ */
+
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct arena_block {
+    arena_block_t *previous;
+    size_t size;        // Usable bytes after the header
+    size_t used;
+    unsigned char data[];
+};
+
+void arena_init(arena_t *arena, size_t block_size) {
+    arena->current = NULL;
+    arena->block_size = block_size;
+    arena->blocks = 0;
+    arena->bytes_reserved = 0;
+}
+
+static arena_block_t *new_block(arena_t *arena, size_t size) {
+    if (size > SIZE_MAX - sizeof(arena_block_t)) {
+        return NULL;
+    }
+    arena_block_t *block = malloc(sizeof(arena_block_t) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->previous = arena->current;
+    block->size = size;
+    block->used = 0;
+    arena->current = block;
+    arena->blocks++;
+    arena->bytes_reserved += size;
+    return block;
+}
+
+// Carves size bytes out of a block, or returns NULL if they do not fit
+static void *bump(arena_block_t *block, size_t size, size_t alignment) {
+    uintptr_t start = (uintptr_t)block->data;
+    uintptr_t next = start + block->used;
+    // Round up to the alignment (a power of two)
+    size_t offset = ((next + alignment - 1) & ~(uintptr_t)(alignment - 1)) -
+                    start;
+    if (offset > block->size || size > block->size - offset) {
+        return NULL;
+    }
+    block->used = offset + size;
+    return block->data + offset;
+}
+
+void *arena_alloc(arena_t *arena, size_t size, size_t alignment) {
+    if (arena->current != NULL) {
+        void *memory = bump(arena->current, size, alignment);
+        if (memory != NULL) {
+            return memory;
+        }
+    }
+
+    // Start a new block, big enough even after aligning
+    size_t needed = size + alignment;
+    if (needed < size) {
+        return NULL;
+    }
+    arena_block_t *block = new_block(
+        arena, needed > arena->block_size ? needed : arena->block_size);
+    return block != NULL ? bump(block, size, alignment) : NULL;
+}
+
+void arena_reset(arena_t *arena) {
+    if (arena->current == NULL) {
+        return;
+    }
+    arena_block_t *block = arena->current->previous;
+    while (block != NULL) {
+        arena_block_t *previous = block->previous;
+        arena->bytes_reserved -= block->size;
+        arena->blocks--;
+        free(block);
+        block = previous;
+    }
+    arena->current->previous = NULL;
+    arena->current->used = 0;
+}
+
+void arena_free(arena_t *arena) {
+    arena_block_t *block = arena->current;
+    while (block != NULL) {
+        arena_block_t *previous = block->previous;
+        free(block);
+        block = previous;
+    }
+    arena_init(arena, arena->block_size);
+}
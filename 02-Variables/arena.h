@@ -0,0 +1,60 @@
+/**
+ * @file arena.h
+ * @brief Bump arena: many allocations carved out of a few big blocks
+ *
+ * malloc() has to remember every allocation so it can be freed on its
+ * own. When a group of objects lives and dies together (all the records
+ * of one load, for example), that bookkeeping is wasted. An arena hands
+ * out memory by moving a pointer forward ("bumping" it) and frees
+ * everything at once:
+ *
+ *     arena_t arena;
+ *     arena_init(&arena, 1 << 20);
+ *     int *ages = arena_alloc(&arena, 1000 * sizeof(int), alignof(int));
+ *     ...
+ *     arena_free(&arena);   // ages and everything else, in one go
+ *
+ * If the arena is created large enough for everything it will hold,
+ * loading any number of records costs exactly one allocation.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct arena_block arena_block_t;
+
+typedef struct {
+    arena_block_t *current;   // Block allocations come from
+    size_t block_size;        // Size of the next block to create
+    size_t blocks;            // Blocks held, one malloc() call each
+    size_t bytes_reserved;    // Total size of all blocks
+} arena_t;
+
+/**
+ * @brief Sets up an empty arena; no memory is taken until the first
+ *        allocation
+ * @param block_size Size of each block (larger requests get their own)
+ */
+void arena_init(arena_t *arena, size_t block_size);
+
+/**
+ * @brief Allocates memory that lives until arena_free() or arena_reset()
+ * @param size Bytes needed
+ * @param alignment Power of two, e.g. alignof(double) or 64
+ * @return Pointer, or NULL if the system is out of memory
+ */
+void *arena_alloc(arena_t *arena, size_t size, size_t alignment);
+
+/**
+ * @brief Makes all memory available again, keeping only the newest block
+ */
+void arena_reset(arena_t *arena);
+
+/**
+ * @brief Frees every block
+ */
+void arena_free(arena_t *arena);
+
+#endif // ARENA_H
@@ -1,10 +1,15 @@
 /*
  * Basic Variables Example
  * This program demonstrates how to create and use different types of variables
+ *
+ * The price is kept in a money_t (see common/money.h), a whole number of
+ * cents: a float cannot hold 19.99 exactly.
  */
 
 #include <stdio.h>
 
+#include "money.h"
+
 int main() {
     // Integer variables (whole numbers)
     int age = 20;
@@ -13,8 +18,11 @@ int main() {
     
     // Float variables (decimal numbers)
     float height = 5.8;
-    float price = 19.99;
     float weight = 70.5;
+
+    // Money variables (exact cents)
+    money_t price = money_from_cents(1999);     // $19.99
+    char price_text[MONEY_TEXT_MAX];
     
     // Character variables (single letters/symbols)
     char grade = 'A';
@@ -29,8 +37,11 @@ int main() {
     
     printf("\n=== FLOAT VARIABLES ===\n");
     printf("Height: %.1f meters\n", height);
-    printf("Price: $%.2f\n", price);
     printf("Weight: %.1f kg\n", weight);
+
+    printf("\n=== MONEY VARIABLES ===\n");
+    money_format(price_text, price);
+    printf("Price: $%s\n", price_text);
     
     printf("\n=== CHARACTER VARIABLES ===\n");
     printf("Grade: %c\n", grade);
@@ -41,11 +52,12 @@ int main() {
     printf("\n=== CHANGING VALUES ===\n");
     age = 21;
     grade = 'A';
-    price = 24.99;
+    price = money_from_cents(2499);
     
     printf("New age: %d years\n", age);
     printf("New grade: %c\n", grade);
-    printf("New price: $%.2f\n", price);
+    money_format(price_text, price);
+    printf("New price: $%s\n", price_text);
     
     return 0;
 }
@@ -0,0 +1,399 @@
+/**
+ * @file money_bench.c
+ * @brief Ledger totals in money_t versus float, double and long double
+ *
+ * A ledger of random charges and payments (default 10 million, each
+ * between -$9999.99 and $9999.99) is read from text into money_t, float,
+ * double and long double. The program then:
+ *
+ *   - checks money.h: parsing and rounding of tricky amounts, format and
+ *     parse round trips, money_mul() and money_div() rounding against the
+ *     definition (nearest unit, ties to even) in 128-bit arithmetic, and
+ *     money_sum() against a plain 128-bit loop
+ *   - adds the ledger up in each type and shows how far each total is
+ *     from the exact one, in cents, and how fast each sum runs
+ *   - times parsing (money_parse() vs strtod()) and formatting
+ *     (money_format() vs snprintf("%.2f"))
+ *
+ * Usage: ./money_bench [transactions]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "money.h"
+
+// Minimum number of rows summed per measurement
+#define ROWS_PER_MEASUREMENT 200000000.0
+
+// Random amounts checked by the round-trip and rounding tests
+#define CHECK_ROWS 1000000
+
+// Longest ledger line: "-9999.99" and the decimals of larger scales
+#define AMOUNT_TEXT_MAX 32
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_state = 0x2545f4914f6cdd1dull;
+
+// xorshift64: rand() only gives 31 bits
+static uint64_t random_bits(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// Keeps the compiler from computing a sum once for all repetitions
+#define TOUCH(pointer) __asm__ volatile("" : : "r"(pointer) : "memory")
+
+// ---------------------------------------------------------------------
+// Checks
+// ---------------------------------------------------------------------
+
+// Writes units as text the slow, obvious way, for comparison
+static void reference_format(char *out, money_int128_t units) {
+    __extension__ typedef unsigned __int128 uint128_t;
+    char digits[64];
+    int n = 0;
+    uint128_t magnitude = units < 0 ? 0 - (uint128_t)units : (uint128_t)units;
+
+    do {
+        digits[n++] = (char)('0' + (int)(magnitude % 10));
+        magnitude /= 10;
+    } while (magnitude != 0 || n <= MONEY_SCALE);
+
+    if (units < 0) {
+        *out++ = '-';
+    }
+    while (n > 0) {
+        *out++ = digits[--n];
+        if (n == MONEY_SCALE) {
+            *out++ = '.';
+        }
+    }
+    *out = '\0';
+}
+
+/**
+ * @brief Is result the correctly rounded value of numerator / divisor?
+ *
+ * The remainder numerator - result * divisor must be at most half the
+ * divisor, and exactly half only if result is even. divisor > 0.
+ */
+static int rounded_correctly(money_int128_t numerator, money_int128_t divisor,
+                             int64_t result) {
+    money_int128_t remainder = numerator - (money_int128_t)result * divisor;
+    money_int128_t twice = remainder < 0 ? -2 * remainder : 2 * remainder;
+    return twice < divisor || (twice == divisor && result % 2 == 0);
+}
+
+/**
+ * @brief Does the rounded numerator / divisor fit in 64 bits?
+ * Rounding moves the truncated quotient at most one step away from zero.
+ *
+ * @return 1 or 0, or -1 when the truncated quotient is one of the limits
+ *         and the rounding decides (not checked)
+ */
+static int quotient_fits(money_int128_t numerator, money_int128_t divisor) {
+    money_int128_t quotient = numerator / divisor;
+    if (quotient > INT64_MAX || quotient < INT64_MIN) {
+        return 0;
+    }
+    return quotient > INT64_MIN && quotient < INT64_MAX ? 1 : -1;
+}
+
+static int check_parsing(void) {
+    int ok = 1;
+#if MONEY_SCALE == 2
+    static const struct {
+        const char *text;
+        int64_t units;      // Cents
+        int result;         // 1 parsed, 0 not a number, -1 ERANGE
+    } cases[] = {
+        {"19.99", 1999, 1}, {"5500", 550000, 1}, {"-.5", -50, 1},
+        {"+7.", 700, 1}, {"0.005", 0, 1}, {"0.015", 2, 1},
+        {"0.025", 2, 1}, {"0.0250001", 3, 1}, {"-0.035", -4, 1},
+        {"1.999", 200, 1}, {"92233720368547758.07", INT64_MAX, 1},
+        {"-92233720368547758.08", INT64_MIN, 1},
+        {"92233720368547758.08", 0, -1}, {"92233720368547758.075", 0, -1},
+        {"100000000000000000000", 0, -1}, {".", 0, 0}, {"-", 0, 0},
+        {"abc", 0, 0},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const char *text = cases[i].text;
+        money_t value = {0};
+        errno = 0;
+        const char *end = money_parse(text, text + strlen(text), &value);
+        int result = end != NULL ? 1 : errno == ERANGE ? -1 : 0;
+        if (result != cases[i].result ||
+            (result == 1 && (value.units != cases[i].units ||
+                             end != text + strlen(text)))) {
+            printf("Parse mismatch: \"%s\"\n", text);
+            ok = 0;
+        }
+    }
+#else
+    printf("(Fixed parsing cases are written for cents; skipped at scale %d)\n",
+           MONEY_SCALE);
+#endif
+
+    // Random amounts, small and as large as they get: format, compare
+    // with the obvious formatting, and parse back
+    for (int i = 0; i < CHECK_ROWS; i++) {
+        uint64_t bits = random_bits();
+        money_t value = {(int64_t)(i % 2 ? bits : bits >> (bits % 64))};
+        if (i % 4 == 3) {
+            value.units = -value.units;
+        }
+        char text[MONEY_TEXT_MAX], expected[64];
+        money_t back;
+        size_t length = money_format(text, value);
+        reference_format(expected, value.units);
+        if (strcmp(text, expected) != 0 || length != strlen(text) ||
+            money_parse(text, text + length, &back) != text + length ||
+            back.units != value.units) {
+            printf("Round trip mismatch: %s\n", expected);
+            ok = 0;
+            break;
+        }
+    }
+    return ok;
+}
+
+static int check_arithmetic(void) {
+    int ok = 1;
+    for (int i = 0; i < CHECK_ROWS && ok; i++) {
+        // Mostly amounts whose products fit, some of any size
+        uint64_t bits = random_bits();
+        int shift = i % 8 == 0 ? 0 : 20 + (int)(bits % 40);
+        money_t a = {(int64_t)random_bits() >> shift};
+        money_t b = {(int64_t)random_bits() >> (i % 3 == 0 ? shift : 40)};
+        money_t result;
+
+        money_int128_t product = (money_int128_t)a.units * b.units;
+        int overflow = money_mul(a, b, &result);
+        int fits = quotient_fits(product, MONEY_ONE);
+        if ((fits >= 0 && overflow == fits) ||
+            (!overflow && !rounded_correctly(product, MONEY_ONE,
+                                             result.units))) {
+            printf("money_mul mismatch: %lld * %lld\n", (long long)a.units,
+                   (long long)b.units);
+            ok = 0;
+        }
+
+        if (b.units != 0) {
+            money_int128_t numerator = (money_int128_t)a.units * MONEY_ONE;
+            money_int128_t divisor = b.units;
+            if (divisor < 0) {
+                numerator = -numerator;
+                divisor = -divisor;
+            }
+            overflow = money_div(a, b, &result);
+            fits = quotient_fits(numerator, divisor);
+            if ((fits >= 0 && overflow == fits) ||
+                (!overflow && !rounded_correctly(numerator, divisor,
+                                                 result.units))) {
+                printf("money_div mismatch: %lld / %lld\n",
+                       (long long)a.units, (long long)b.units);
+                ok = 0;
+            }
+        }
+    }
+
+    money_t result;
+    ok &= money_div(money_from_cents(100), (money_t){0}, &result) == 1 &&
+          result.units == 0;
+    ok &= money_div_int(money_from_cents(100), 3, &result) == 0 &&
+          result.units == MONEY_ONE / 3;        // $0.33...3, rounded down
+    return ok;
+}
+
+static int check_sum(void) {
+    size_t n = CHECK_ROWS;
+    money_t *values = malloc(n * sizeof(money_t));
+    money_int128_t expected = 0;
+
+    if (values == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        values[i].units = (int64_t)random_bits();   // Any size at all
+        expected += values[i].units;
+    }
+    money_wide_t total = money_sum(values, n);
+
+    char text[MONEY_WIDE_TEXT_MAX], reference[64];
+    money_int128_t huge = total.units * 1000000000000ll;   // Over 2^64
+    money_wide_t big = {huge};
+    money_wide_format(text, big);
+    reference_format(reference, huge);
+
+    free(values);
+    return total.units == expected && strcmp(text, reference) == 0;
+}
+
+// ---------------------------------------------------------------------
+// The ledger
+// ---------------------------------------------------------------------
+
+static float sum_float(const float *values, size_t n) {
+    float total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += values[i];
+    }
+    return total;
+}
+
+static double sum_double(const double *values, size_t n) {
+    double total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += values[i];
+    }
+    return total;
+}
+
+static long double sum_long_double(const long double *values, size_t n) {
+    long double total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += values[i];
+    }
+    return total;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 10000000;
+
+    if (argc >= 2) {
+        n = strtoul(argv[1], NULL, 10);
+        if (n == 0) {
+            fprintf(stderr, "Usage: %s [transactions]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("=== MONEY LEDGER BENCHMARK ===\n");
+    printf("Scale: %d decimals (one unit is 1/%lld dollar)\n", MONEY_SCALE,
+           (long long)MONEY_ONE);
+
+    if (!check_parsing() || !check_arithmetic() || !check_sum()) {
+        fprintf(stderr, "Error: money.h gives wrong results!\n");
+        return 1;
+    }
+    printf("Parsing, formatting, rounded * and /, and sums all exact\n");
+
+    char *texts = malloc(n * AMOUNT_TEXT_MAX);
+    money_t *amounts = malloc(n * sizeof(money_t));
+    float *floats = malloc(n * sizeof(float));
+    double *doubles = malloc(n * sizeof(double));
+    long double *long_doubles = malloc(n * sizeof(long double));
+    if (!texts || !amounts || !floats || !doubles || !long_doubles) {
+        fprintf(stderr, "Out of memory for %zu transactions\n", n);
+        return 1;
+    }
+
+    // The ledger as text, then read into every type
+    for (size_t i = 0; i < n; i++) {
+        uint64_t bits = random_bits();
+        money_t amount = money_from_cents((int64_t)(bits % 1999999) - 999999);
+        money_format(texts + i * AMOUNT_TEXT_MAX, amount);
+    }
+
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        const char *text = texts + i * AMOUNT_TEXT_MAX;
+        money_parse(text, text + strlen(text), &amounts[i]);
+    }
+    double money_parse_seconds = now_seconds() - start;
+
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        doubles[i] = strtod(texts + i * AMOUNT_TEXT_MAX, NULL);
+    }
+    double strtod_seconds = now_seconds() - start;
+
+    for (size_t i = 0; i < n; i++) {
+        floats[i] = strtof(texts + i * AMOUNT_TEXT_MAX, NULL);
+        long_doubles[i] = strtold(texts + i * AMOUNT_TEXT_MAX, NULL);
+    }
+
+    // Totals: the exact one, then each type's, timed
+    money_wide_t exact = money_sum(amounts, n);
+    int repeats = (int)(ROWS_PER_MEASUREMENT / n) + 1;
+    char exact_text[MONEY_WIDE_TEXT_MAX];
+    money_wide_format(exact_text, exact);
+
+    printf("\n--- Total of %zu transactions ---\n", n);
+    printf("%-12s %22s %14s %12s\n", "Type", "Total", "Cents off",
+           "M rows/s");
+
+    start = now_seconds();
+    for (int r = 0; r < repeats; r++) {
+        TOUCH(amounts);
+        exact = money_sum(amounts, n);
+    }
+    printf("%-12s %22s %14d %12.0f\n", "money_t", exact_text, 0,
+           (double)n * repeats / (now_seconds() - start) / 1e6);
+
+    // How far a total is from the exact one, in cents
+    long double exact_dollars = (long double)exact.units / MONEY_ONE;
+    long double totals[3];
+    const char *names[3] = {"float", "double", "long double"};
+    for (int type = 0; type < 3; type++) {
+        start = now_seconds();
+        for (int r = 0; r < repeats; r++) {
+            if (type == 0) {
+                TOUCH(floats);
+                totals[type] = sum_float(floats, n);
+            } else if (type == 1) {
+                TOUCH(doubles);
+                totals[type] = sum_double(doubles, n);
+            } else {
+                TOUCH(long_doubles);
+                totals[type] = sum_long_double(long_doubles, n);
+            }
+        }
+        double seconds = now_seconds() - start;
+        printf("%-12s %22.2Lf %14.0Lf %12.0f\n", names[type], totals[type],
+               roundl((totals[type] - exact_dollars) * 100) + 0.0L,
+               (double)n * repeats / seconds / 1e6);
+    }
+
+    // Text in and out
+    char line[64];
+    size_t bytes = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        bytes += money_format(line, amounts[i]);
+    }
+    double money_format_seconds = now_seconds() - start;
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        bytes += (size_t)snprintf(line, sizeof(line), "%.2f", doubles[i]);
+    }
+    double snprintf_seconds = now_seconds() - start;
+
+    printf("\n--- Text (million amounts per second) ---\n");
+    printf("Parse:  money_parse %8.1f   strtod          %8.1f\n",
+           n / money_parse_seconds / 1e6, n / strtod_seconds / 1e6);
+    printf("Format: money_format %7.1f   snprintf(\"%%.2f\") %7.1f\n",
+           n / money_format_seconds / 1e6, n / snprintf_seconds / 1e6);
+    if (bytes == 0) {
+        printf("\n");   // Keeps the formatting loops from being removed
+    }
+
+    free(texts); free(amounts); free(floats); free(doubles);
+    free(long_doubles);
+    return 0;
+}
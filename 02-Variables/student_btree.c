@@ -0,0 +1,412 @@
+/**
+ * @file student_btree.c
+ * @brief B+-tree with 512-byte nodes and branch-free node search
+ */
+
+#include "student_btree.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Marks unused key slots; it sorts after every real key
+#define NO_KEY UINT64_MAX
+
+// Deepest tree: 32^12 leaves is far more than any store can hold
+#define MAX_HEIGHT 12
+
+#define NODE_ALIGNMENT 64
+
+struct student_btree_leaf {
+    uint64_t keys[STUDENT_BTREE_LEAF_KEYS];
+    uint32_t count;
+    struct student_btree_leaf *next;
+};
+
+typedef struct {
+    uint64_t keys[STUDENT_BTREE_INNER_KEYS];
+    uint32_t count;
+    // children[i] holds keys from keys[i - 1] up to, not including, keys[i]
+    void *children[STUDENT_BTREE_INNER_KEYS + 1];
+} inner_node_t;
+
+/**
+ * @brief Number of keys in a leaf smaller than key
+ *
+ * Unused slots hold NO_KEY, so the loop always runs over the whole
+ * node and the compiler turns it into a few SIMD compares.
+ */
+static int leaf_rank(const student_btree_leaf_t *leaf, uint64_t key) {
+    int rank = 0;
+    for (int i = 0; i < STUDENT_BTREE_LEAF_KEYS; i++) {
+        rank += leaf->keys[i] < key;
+    }
+    return rank;
+}
+
+// Child of an inner node that may contain key
+static int inner_rank(const inner_node_t *node, uint64_t key) {
+    int rank = 0;
+    for (int i = 0; i < STUDENT_BTREE_INNER_KEYS; i++) {
+        rank += node->keys[i] <= key;
+    }
+    return rank;
+}
+
+static student_btree_leaf_t *new_leaf(student_btree_t *tree) {
+    student_btree_leaf_t *leaf = arena_alloc(&tree->arena, sizeof(*leaf),
+                                             NODE_ALIGNMENT);
+    if (leaf != NULL) {
+        for (int i = 0; i < STUDENT_BTREE_LEAF_KEYS; i++) {
+            leaf->keys[i] = NO_KEY;
+        }
+        leaf->count = 0;
+        leaf->next = NULL;
+        tree->nodes++;
+    }
+    return leaf;
+}
+
+static inner_node_t *new_inner(student_btree_t *tree) {
+    inner_node_t *node = arena_alloc(&tree->arena, sizeof(*node),
+                                     NODE_ALIGNMENT);
+    if (node != NULL) {
+        for (int i = 0; i < STUDENT_BTREE_INNER_KEYS; i++) {
+            node->keys[i] = NO_KEY;
+        }
+        memset(node->children, 0, sizeof(node->children));
+        node->count = 0;
+        tree->nodes++;
+    }
+    return node;
+}
+
+void student_btree_init(student_btree_t *tree) {
+    tree->root = NULL;
+    tree->height = 0;
+    tree->size = 0;
+    tree->nodes = 0;
+    arena_init(&tree->arena, 1 << 20);
+}
+
+void student_btree_free(student_btree_t *tree) {
+    arena_free(&tree->arena);
+    student_btree_init(tree);
+}
+
+int student_btree_build(student_btree_t *tree, const uint16_t *values,
+                        size_t rows) {
+    size_t leaf_count = rows / STUDENT_BTREE_LEAF_KEYS + 1;
+
+    student_btree_free(tree);
+
+    // All leaves in one allocation, so keys can be scattered into them
+    student_btree_leaf_t *leaves = arena_alloc(
+        &tree->arena, leaf_count * sizeof(student_btree_leaf_t),
+        NODE_ALIGNMENT);
+    size_t *next_position = calloc(UINT16_MAX + 1, sizeof(size_t));
+    if (leaves == NULL || next_position == NULL) {
+        free(next_position);
+        return -1;
+    }
+
+    // Counting sort: where the first key of each value goes...
+    for (size_t row = 0; row < rows; row++) {
+        next_position[values[row]]++;
+    }
+    size_t position = 0;
+    for (size_t value = 0; value <= UINT16_MAX; value++) {
+        size_t count = next_position[value];
+        next_position[value] = position;
+        position += count;
+    }
+    // ...then every key straight into its place. Rows are visited in
+    // order, so keys with the same value come out sorted by row too.
+    for (size_t row = 0; row < rows; row++) {
+        size_t p = next_position[values[row]]++;
+        leaves[p / STUDENT_BTREE_LEAF_KEYS].keys[p % STUDENT_BTREE_LEAF_KEYS] =
+            STUDENT_BTREE_KEY(values[row], row);
+    }
+    free(next_position);
+
+    for (size_t i = 0; i < leaf_count; i++) {
+        size_t first = i * STUDENT_BTREE_LEAF_KEYS;
+        size_t count = rows - first < STUDENT_BTREE_LEAF_KEYS
+                           ? rows - first : STUDENT_BTREE_LEAF_KEYS;
+        for (size_t k = count; k < STUDENT_BTREE_LEAF_KEYS; k++) {
+            leaves[i].keys[k] = NO_KEY;
+        }
+        leaves[i].count = (uint32_t)count;
+        leaves[i].next = i + 1 < leaf_count ? &leaves[i + 1] : NULL;
+    }
+    tree->nodes = leaf_count;
+    tree->size = rows;
+
+    // Stack inner levels on top until one node is left
+    void **level = malloc(leaf_count * sizeof(void *));
+    uint64_t *level_min = malloc(leaf_count * sizeof(uint64_t));
+    if (level == NULL || level_min == NULL) {
+        free(level);
+        free(level_min);
+        return -1;
+    }
+    for (size_t i = 0; i < leaf_count; i++) {
+        level[i] = &leaves[i];
+        level_min[i] = leaves[i].keys[0];
+    }
+    size_t level_size = leaf_count;
+    int height = 0;
+    while (level_size > 1) {
+        size_t parents = 0;
+        for (size_t i = 0; i < level_size; i += STUDENT_BTREE_INNER_KEYS + 1) {
+            inner_node_t *node = new_inner(tree);
+            if (node == NULL) {
+                free(level);
+                free(level_min);
+                return -1;
+            }
+            size_t children = level_size - i < STUDENT_BTREE_INNER_KEYS + 1
+                                  ? level_size - i : STUDENT_BTREE_INNER_KEYS + 1;
+            for (size_t c = 0; c < children; c++) {
+                node->children[c] = level[i + c];
+                if (c > 0) {
+                    node->keys[c - 1] = level_min[i + c];
+                }
+            }
+            node->count = (uint32_t)(children - 1);
+            // Reuse the arrays: parents never overtake their children
+            uint64_t minimum = level_min[i];
+            level[parents] = node;
+            level_min[parents] = minimum;
+            parents++;
+        }
+        level_size = parents;
+        height++;
+    }
+    tree->root = level[0];
+    tree->height = height;
+    free(level);
+    free(level_min);
+    return 0;
+}
+
+/**
+ * @brief Walks from the root to the leaf that may contain key
+ * @param path Receives the inner node at each level (may be NULL)
+ * @param slots Receives the child taken at each level (may be NULL)
+ */
+static student_btree_leaf_t *find_leaf(const student_btree_t *tree,
+                                       uint64_t key, inner_node_t **path,
+                                       int *slots) {
+    void *node = tree->root;
+    for (int level = 0; level < tree->height; level++) {
+        inner_node_t *inner = node;
+        int slot = inner_rank(inner, key);
+        if (path != NULL) {
+            path[level] = inner;
+            slots[level] = slot;
+        }
+        node = inner->children[slot];
+    }
+    return node;
+}
+
+/**
+ * @brief Adds (separator, right) to an inner node just after child slot,
+ *        splitting nodes up to the root as needed
+ */
+static int insert_into_parent(student_btree_t *tree, inner_node_t **path,
+                              int *slots, int level, uint64_t separator,
+                              void *right) {
+    if (level < 0) {
+        // The root was split: grow a new root above it
+        inner_node_t *root = new_inner(tree);
+        if (root == NULL) {
+            return -1;
+        }
+        root->children[0] = tree->root;
+        root->children[1] = right;
+        root->keys[0] = separator;
+        root->count = 1;
+        tree->root = root;
+        tree->height++;
+        return 0;
+    }
+
+    inner_node_t *node = path[level];
+    int slot = slots[level];
+    if (node->count < STUDENT_BTREE_INNER_KEYS) {
+        memmove(&node->keys[slot + 1], &node->keys[slot],
+                (node->count - slot) * sizeof(uint64_t));
+        memmove(&node->children[slot + 2], &node->children[slot + 1],
+                (node->count - slot) * sizeof(void *));
+        node->keys[slot] = separator;
+        node->children[slot + 1] = right;
+        node->count++;
+        return 0;
+    }
+
+    // Full: lay out all keys and children, then share them out
+    uint64_t keys[STUDENT_BTREE_INNER_KEYS + 1];
+    void *children[STUDENT_BTREE_INNER_KEYS + 2];
+    memcpy(keys, node->keys, slot * sizeof(uint64_t));
+    keys[slot] = separator;
+    memcpy(&keys[slot + 1], &node->keys[slot],
+           (STUDENT_BTREE_INNER_KEYS - slot) * sizeof(uint64_t));
+    memcpy(children, node->children, (slot + 1) * sizeof(void *));
+    children[slot + 1] = right;
+    memcpy(&children[slot + 2], &node->children[slot + 1],
+           (STUDENT_BTREE_INNER_KEYS - slot) * sizeof(void *));
+
+    inner_node_t *sibling = new_inner(tree);
+    if (sibling == NULL) {
+        return -1;
+    }
+    const int left_keys = (STUDENT_BTREE_INNER_KEYS + 1) / 2;
+    const int right_keys = STUDENT_BTREE_INNER_KEYS - left_keys;
+
+    for (int i = 0; i < STUDENT_BTREE_INNER_KEYS; i++) {
+        node->keys[i] = i < left_keys ? keys[i] : NO_KEY;
+        node->children[i + 1] = i < left_keys ? children[i + 1] : NULL;
+    }
+    node->count = (uint32_t)left_keys;
+    for (int i = 0; i < right_keys; i++) {
+        sibling->keys[i] = keys[left_keys + 1 + i];
+    }
+    for (int i = 0; i <= right_keys; i++) {
+        sibling->children[i] = children[left_keys + 1 + i];
+    }
+    sibling->count = (uint32_t)right_keys;
+
+    // The middle key moves up to separate the two halves
+    return insert_into_parent(tree, path, slots, level - 1, keys[left_keys],
+                              sibling);
+}
+
+int student_btree_insert(student_btree_t *tree, uint64_t key) {
+    inner_node_t *path[MAX_HEIGHT];
+    int slots[MAX_HEIGHT];
+
+    if (tree->root == NULL) {
+        tree->root = new_leaf(tree);
+        if (tree->root == NULL) {
+            return -1;
+        }
+    }
+
+    student_btree_leaf_t *leaf = find_leaf(tree, key, path, slots);
+    int position = leaf_rank(leaf, key);
+    if (position < (int)leaf->count && leaf->keys[position] == key) {
+        return 0;
+    }
+
+    if (leaf->count < STUDENT_BTREE_LEAF_KEYS) {
+        memmove(&leaf->keys[position + 1], &leaf->keys[position],
+                (leaf->count - position) * sizeof(uint64_t));
+        leaf->keys[position] = key;
+        leaf->count++;
+        tree->size++;
+        return 1;
+    }
+
+    // Full leaf: split it in two and link the new half in after it
+    if (tree->height >= MAX_HEIGHT) {
+        return -1;
+    }
+    student_btree_leaf_t *right = new_leaf(tree);
+    if (right == NULL) {
+        return -1;
+    }
+    uint64_t keys[STUDENT_BTREE_LEAF_KEYS + 1];
+    memcpy(keys, leaf->keys, position * sizeof(uint64_t));
+    keys[position] = key;
+    memcpy(&keys[position + 1], &leaf->keys[position],
+           (STUDENT_BTREE_LEAF_KEYS - position) * sizeof(uint64_t));
+
+    const int left_count = (STUDENT_BTREE_LEAF_KEYS + 1) / 2;
+    const int right_count = STUDENT_BTREE_LEAF_KEYS + 1 - left_count;
+    for (int i = 0; i < STUDENT_BTREE_LEAF_KEYS; i++) {
+        leaf->keys[i] = i < left_count ? keys[i] : NO_KEY;
+    }
+    memcpy(right->keys, &keys[left_count], right_count * sizeof(uint64_t));
+    leaf->count = (uint32_t)left_count;
+    right->count = (uint32_t)right_count;
+    right->next = leaf->next;
+    leaf->next = right;
+    tree->size++;
+
+    return insert_into_parent(tree, path, slots, tree->height - 1,
+                              right->keys[0], right) == 0 ? 1 : -1;
+}
+
+int student_btree_erase(student_btree_t *tree, uint64_t key) {
+    if (tree->root == NULL) {
+        return 0;
+    }
+    student_btree_leaf_t *leaf = find_leaf(tree, key, NULL, NULL);
+    int position = leaf_rank(leaf, key);
+    if (position >= (int)leaf->count || leaf->keys[position] != key) {
+        return 0;
+    }
+    memmove(&leaf->keys[position], &leaf->keys[position + 1],
+            (leaf->count - position - 1) * sizeof(uint64_t));
+    leaf->count--;
+    leaf->keys[leaf->count] = NO_KEY;
+    tree->size--;
+    return 1;
+}
+
+void student_btree_seek(const student_btree_t *tree, uint32_t lowest,
+                        uint32_t highest, student_btree_cursor_t *cursor) {
+    uint64_t first = STUDENT_BTREE_KEY(lowest, 0);
+
+    cursor->last = STUDENT_BTREE_KEY(highest, UINT32_MAX);
+    if (tree->root == NULL || lowest > highest) {
+        cursor->leaf = NULL;
+        cursor->position = 0;
+        return;
+    }
+    cursor->leaf = find_leaf(tree, first, NULL, NULL);
+    cursor->position = leaf_rank(cursor->leaf, first);
+}
+
+int student_btree_next(student_btree_cursor_t *cursor, uint64_t *key) {
+    while (cursor->leaf != NULL) {
+        if (cursor->position < (int)cursor->leaf->count) {
+            uint64_t next = cursor->leaf->keys[cursor->position];
+            if (next > cursor->last) {
+                cursor->leaf = NULL;
+                return 0;
+            }
+            cursor->position++;
+            *key = next;
+            return 1;
+        }
+        cursor->leaf = cursor->leaf->next;
+        cursor->position = 0;
+    }
+    return 0;
+}
+
+size_t student_btree_count(const student_btree_t *tree, uint32_t lowest,
+                           uint32_t highest) {
+    student_btree_cursor_t cursor;
+    size_t count = 0;
+
+    student_btree_seek(tree, lowest, highest, &cursor);
+    const student_btree_leaf_t *leaf = cursor.leaf;
+    int position = cursor.position;
+    while (leaf != NULL) {
+        // Whole leaf inside the range: count it without looking at keys
+        if (leaf->count > 0 && leaf->keys[leaf->count - 1] <= cursor.last) {
+            count += leaf->count - position;
+        } else {
+            count += leaf_rank(leaf, cursor.last + 1) - position;
+            if (leaf->count > 0) {
+                break;
+            }
+        }
+        leaf = leaf->next;
+        position = 0;
+    }
+    return count;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file student_btree.h
+ * @brief B+-tree over one student column, for range queries
+ *
+ * "Which students have at least 90 credits?" needs every student whose
+ * credits fall in a range. A B+-tree keeps (value, row) pairs sorted in
+ * leaves of 62 keys, chained left to right, with a few levels of inner
+ * nodes on top to find the first leaf. A range query walks down the
+ * tree once and then reads consecutive keys, so it costs time for the
+ * matching students only, not for the whole store.
+ *
+ * Each key packs the column value and the row into 64 bits:
+ *
+ *     key = value << 32 | row
+ *
+ * so keys are unique even when many students share a value, and keys
+ * sort by value first. Nodes are 512 bytes (8 cache lines) and are
+ * searched by counting smaller keys, a loop without branches that the
+ * compiler vectorizes.
+ *
+ * Erasing a key never merges nodes; a leaf can become empty and stays
+ * in the chain. Lookups and range queries remain correct, and the
+ * space comes back when the tree is rebuilt.
+ */
+
+#ifndef STUDENT_BTREE_H
+#define STUDENT_BTREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+#define STUDENT_BTREE_KEY(value, row) \
+    (((uint64_t)(value) << 32) | (uint32_t)(row))
+#define STUDENT_BTREE_VALUE(key) ((uint32_t)((key) >> 32))
+#define STUDENT_BTREE_ROW(key) ((uint32_t)(key))
+
+// Keys per leaf and per inner node; both node kinds are 512 bytes
+#define STUDENT_BTREE_LEAF_KEYS 62
+#define STUDENT_BTREE_INNER_KEYS 31
+
+typedef struct student_btree_leaf student_btree_leaf_t;
+
+typedef struct {
+    void *root;
+    int height;            // 0 when the root is a leaf
+    size_t size;           // Keys in the tree
+    size_t nodes;          // Leaves and inner nodes
+    arena_t arena;         // Nodes are carved out of this arena
+} student_btree_t;
+
+// Position in a range query; see student_btree_seek()
+typedef struct {
+    const student_btree_leaf_t *leaf;
+    int position;
+    uint64_t last;
+} student_btree_cursor_t;
+
+void student_btree_init(student_btree_t *tree);
+
+void student_btree_free(student_btree_t *tree);
+
+/**
+ * @brief Builds the tree of (values[row], row) for every row
+ *
+ * Sorts with one counting-sort pass (values are 16 bits) that writes
+ * each key straight into its leaf, then stacks the inner levels on top.
+ * Replaces whatever the tree held before.
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+int student_btree_build(student_btree_t *tree, const uint16_t *values,
+                        size_t rows);
+
+/**
+ * @return 1 if inserted, 0 if the key was already there, -1 if out of
+ *         memory
+ */
+int student_btree_insert(student_btree_t *tree, uint64_t key);
+
+/**
+ * @return 1 if erased, 0 if the key was not in the tree
+ */
+int student_btree_erase(student_btree_t *tree, uint64_t key);
+
+/**
+ * @brief Starts a range query over values lowest..highest (inclusive)
+ */
+void student_btree_seek(const student_btree_t *tree, uint32_t lowest,
+                        uint32_t highest, student_btree_cursor_t *cursor);
+
+/**
+ * @brief Next key of a range query
+ * @return 1 and sets *key, or 0 when the range is exhausted
+ */
+int student_btree_next(student_btree_cursor_t *cursor, uint64_t *key);
+
+/**
+ * @brief Number of keys with values lowest..highest (inclusive)
+ */
+size_t student_btree_count(const student_btree_t *tree, uint32_t lowest,
+                           uint32_t highest);
+
+#endif // STUDENT_BTREE_H
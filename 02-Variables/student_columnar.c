@@ -0,0 +1,555 @@
+/**
+ * @file student_columnar.c
+ * @brief Bit-packed column blocks with min/max statistics
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "student_columnar.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define COLUMNAR_MAGIC "STUCOLS1"
+#define COLUMNAR_VERSION 1
+
+// Widest packed value: 32-bit columns, or differences between them
+#define MAX_BITS 40
+
+// Zero bytes after the last column, so reading any value's 8 bytes
+// stays inside the file
+#define TAIL_PADDING 8
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint64_t count;
+    uint64_t block_count;
+    uint64_t directory_offset;
+} file_header_t;
+
+static int64_t column_value(const student_store_t *store,
+                            student_column_t column, size_t i) {
+    switch (column) {
+    case STUDENT_COLUMN_ID:
+        return store->id[i];
+    case STUDENT_COLUMN_INITIAL:
+        return (unsigned char)store->initial[i];
+    case STUDENT_COLUMN_AGE:
+        return store->age[i];
+    case STUDENT_COLUMN_GPA:
+        return store->gpa_hundredths[i];
+    case STUDENT_COLUMN_CREDITS:
+        return store->credits[i];
+    case STUDENT_COLUMN_GRADE:
+        return store->grade[i];
+    case STUDENT_COLUMN_TUITION:
+        return store->tuition_cents[i];
+    default:
+        return 0;
+    }
+}
+
+// Bits needed for every number from 0 to range
+static uint32_t bit_width(uint64_t range) {
+    return range == 0 ? 0 : 64 - (uint32_t)__builtin_clzll(range);
+}
+
+static size_t packed_bytes(uint32_t bits, uint64_t values) {
+    return (size_t)((bits * values + 7) / 8);
+}
+
+static uint64_t unpack(const unsigned char *packed, uint32_t bits, size_t i) {
+    if (bits == 0) {
+        return 0;
+    }
+    uint64_t position = (uint64_t)i * bits;
+    uint64_t word;
+    memcpy(&word, packed + position / 8, sizeof(word));
+    return (word >> (position % 8)) & ((1ull << bits) - 1);
+}
+
+/**
+ * @brief Packs `count` values of `bits` bits each into zeroed `packed`
+ *        (which has TAIL_PADDING spare bytes)
+ */
+static void pack(unsigned char *packed, uint32_t bits, const uint64_t *values,
+                 size_t count) {
+    if (bits == 0) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint64_t position = (uint64_t)i * bits;
+        uint64_t word;
+        memcpy(&word, packed + position / 8, sizeof(word));
+        word |= values[i] << (position % 8);
+        memcpy(packed + position / 8, &word, sizeof(word));
+    }
+}
+
+/**
+ * @brief Picks the smaller encoding for one column of one block and packs
+ * @param raw Packed values go here (count of them)
+ * @return Bytes of packed data
+ */
+static size_t encode_column(const int64_t *values, size_t count,
+                            student_columnar_column_t *column,
+                            uint64_t *raw) {
+    int64_t min = values[0], max = values[0], sum = 0;
+    int64_t step_min = 0, step_max = 0;
+    for (size_t i = 0; i < count; i++) {
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+        sum += values[i];
+        if (i > 0) {
+            int64_t step = values[i] - values[i - 1];
+            if (i == 1 || step < step_min) {
+                step_min = step;
+            }
+            if (i == 1 || step > step_max) {
+                step_max = step;
+            }
+        }
+    }
+    column->min = min;
+    column->max = max;
+    column->sum = sum;
+
+    uint32_t for_bits = bit_width((uint64_t)(max - min));
+    uint32_t delta_bits = bit_width((uint64_t)(step_max - step_min));
+    if (count > 1 && (uint64_t)delta_bits * (count - 1) <
+                         (uint64_t)for_bits * count) {
+        column->encoding = STUDENT_ENCODING_DELTA;
+        column->bits = delta_bits;
+        column->base = values[0];
+        column->step = step_min;
+        for (size_t i = 1; i < count; i++) {
+            raw[i - 1] = (uint64_t)(values[i] - values[i - 1] - step_min);
+        }
+        return packed_bytes(delta_bits, count - 1);
+    }
+    column->encoding = STUDENT_ENCODING_FOR;
+    column->bits = for_bits;
+    column->base = min;
+    column->step = 0;
+    for (size_t i = 0; i < count; i++) {
+        raw[i] = (uint64_t)(values[i] - min);
+    }
+    return packed_bytes(for_bits, count);
+}
+
+int student_columnar_write(const student_store_t *store, const char *path) {
+    uint64_t block_count = (store->count + STUDENT_COLUMNAR_BLOCK - 1) /
+                           STUDENT_COLUMNAR_BLOCK;
+    size_t buffer_bytes = packed_bytes(MAX_BITS, STUDENT_COLUMNAR_BLOCK) +
+                          TAIL_PADDING;
+    student_columnar_block_t *blocks = calloc(block_count ? block_count : 1,
+                                              sizeof(*blocks));
+    int64_t *values = malloc(STUDENT_COLUMNAR_BLOCK * sizeof(int64_t));
+    uint64_t *raw = malloc(STUDENT_COLUMNAR_BLOCK * sizeof(uint64_t));
+    unsigned char *packed = malloc(buffer_bytes);
+    FILE *out = fopen(path, "wb");
+    int status = -1;
+
+    if (blocks == NULL || values == NULL || raw == NULL || packed == NULL) {
+        errno = ENOMEM;
+        goto done;
+    }
+    if (out == NULL) {
+        goto done;
+    }
+
+    file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLUMNAR_MAGIC, sizeof(header.magic));
+    header.version = COLUMNAR_VERSION;
+    header.block_size = STUDENT_COLUMNAR_BLOCK;
+    header.count = store->count;
+    header.block_count = block_count;
+    if (fwrite(&header, sizeof(header), 1, out) != 1) {
+        goto done;
+    }
+
+    uint64_t offset = sizeof(header);
+    for (uint64_t b = 0; b < block_count; b++) {
+        student_columnar_block_t *block = &blocks[b];
+        block->first = b * STUDENT_COLUMNAR_BLOCK;
+        block->count = store->count - block->first < STUDENT_COLUMNAR_BLOCK
+                           ? store->count - block->first
+                           : STUDENT_COLUMNAR_BLOCK;
+        for (int c = 0; c < STUDENT_COLUMN_COUNT; c++) {
+            for (size_t i = 0; i < block->count; i++) {
+                values[i] = column_value(store, (student_column_t)c,
+                                         block->first + i);
+            }
+            student_columnar_column_t *column = &block->columns[c];
+            size_t bytes = encode_column(values, block->count, column, raw);
+            size_t raw_count = column->encoding == STUDENT_ENCODING_DELTA
+                                   ? block->count - 1
+                                   : block->count;
+            memset(packed, 0, bytes + TAIL_PADDING);
+            pack(packed, column->bits, raw, raw_count);
+            column->offset = offset;
+            if (bytes > 0 && fwrite(packed, bytes, 1, out) != 1) {
+                goto done;
+            }
+            offset += bytes;
+        }
+    }
+
+    // Padding, then the directory on an 8-byte boundary
+    static const unsigned char zeros[2 * TAIL_PADDING];
+    size_t padding = TAIL_PADDING + (size_t)((8 - offset % 8) % 8);
+    if (fwrite(zeros, padding, 1, out) != 1) {
+        goto done;
+    }
+    header.directory_offset = offset + padding;
+    if ((block_count > 0 &&
+         fwrite(blocks, sizeof(*blocks), block_count, out) != block_count) ||
+        fseek(out, 0, SEEK_SET) != 0 ||
+        fwrite(&header, sizeof(header), 1, out) != 1) {
+        goto done;
+    }
+    status = 0;
+
+done:
+    if (out != NULL && fclose(out) != 0) {
+        status = -1;
+    }
+    free(packed);
+    free(raw);
+    free(values);
+    free(blocks);
+    return status;
+}
+
+/**
+ * @brief Checks that a directory entry holds the students it must (a
+ *        full block, or the rest in the last one) and only points
+ *        inside the file
+ */
+static int block_valid(const student_columnar_block_t *block, uint64_t b,
+                       uint64_t count, uint64_t directory_offset) {
+    uint64_t first = b * STUDENT_COLUMNAR_BLOCK;
+    uint64_t expected = count - first < STUDENT_COLUMNAR_BLOCK
+                            ? count - first
+                            : STUDENT_COLUMNAR_BLOCK;
+    if (block->first != first || block->count != expected) {
+        return 0;
+    }
+    for (int c = 0; c < STUDENT_COLUMN_COUNT; c++) {
+        const student_columnar_column_t *column = &block->columns[c];
+        uint64_t values = column->encoding == STUDENT_ENCODING_DELTA
+                              ? block->count - 1
+                              : block->count;
+        if (column->encoding > STUDENT_ENCODING_DELTA ||
+            column->bits > MAX_BITS || column->offset < sizeof(file_header_t) ||
+            column->offset > directory_offset ||
+            directory_offset - column->offset <
+                packed_bytes(column->bits, values) + TAIL_PADDING) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int student_columnar_open(student_columnar_t *file, const char *path) {
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+
+    memset(file, 0, sizeof(*file));
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)info.st_size;
+    if (size < sizeof(file_header_t)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    const unsigned char *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+
+    file_header_t header;
+    memcpy(&header, data, sizeof(header));
+    // Rounded up without adding first, which could wrap a huge count
+    uint64_t block_count = header.count / STUDENT_COLUMNAR_BLOCK +
+                           (header.count % STUDENT_COLUMNAR_BLOCK != 0);
+    int valid =
+        memcmp(header.magic, COLUMNAR_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == COLUMNAR_VERSION &&
+        header.block_size == STUDENT_COLUMNAR_BLOCK &&
+        header.block_count == block_count &&
+        header.directory_offset % 8 == 0 &&
+        header.directory_offset <= size &&
+        (size - header.directory_offset) / sizeof(student_columnar_block_t) ==
+            block_count &&
+        (size - header.directory_offset) % sizeof(student_columnar_block_t) ==
+            0;
+    const student_columnar_block_t *blocks =
+        (const student_columnar_block_t *)(data + header.directory_offset);
+    for (uint64_t b = 0; valid && b < block_count; b++) {
+        valid = block_valid(&blocks[b], b, header.count,
+                            header.directory_offset);
+    }
+    if (!valid) {
+        munmap((void *)data, size);
+        errno = EINVAL;
+        return -1;
+    }
+
+    file->data = data;
+    file->size = size;
+    file->count = header.count;
+    file->block_count = block_count;
+    file->blocks = blocks;
+    return 0;
+}
+
+void student_columnar_close(student_columnar_t *file) {
+    if (file->data != NULL) {
+        munmap((void *)file->data, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+/**
+ * @brief Unpacks one column of one block
+ */
+static void decode_column(const student_columnar_t *file,
+                          const student_columnar_column_t *column,
+                          size_t count, int64_t *values) {
+    const unsigned char *packed = file->data + column->offset;
+    uint32_t bits = column->bits;
+
+    if (column->encoding == STUDENT_ENCODING_DELTA) {
+        int64_t value = column->base;
+        values[0] = value;
+        for (size_t i = 1; i < count; i++) {
+            value += column->step + (int64_t)unpack(packed, bits, i - 1);
+            values[i] = value;
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = column->base + (int64_t)unpack(packed, bits, i);
+        }
+    }
+}
+
+int student_columnar_load(const student_columnar_t *file,
+                          student_store_t *store) {
+    int64_t *values = malloc(STUDENT_COLUMNAR_BLOCK * sizeof(int64_t));
+    if (values == NULL || student_store_init(store, file->count) != 0) {
+        free(values);
+        return -1;
+    }
+    for (uint64_t b = 0; b < file->block_count; b++) {
+        const student_columnar_block_t *block = &file->blocks[b];
+        size_t n = block->count;
+        size_t first = block->first;
+
+        decode_column(file, &block->columns[STUDENT_COLUMN_ID], n, values);
+        for (size_t i = 0; i < n; i++) {
+            store->id[first + i] = (uint32_t)values[i];
+        }
+        decode_column(file, &block->columns[STUDENT_COLUMN_INITIAL], n, values);
+        for (size_t i = 0; i < n; i++) {
+            store->initial[first + i] = (char)values[i];
+        }
+        decode_column(file, &block->columns[STUDENT_COLUMN_AGE], n, values);
+        for (size_t i = 0; i < n; i++) {
+            store->age[first + i] = (uint8_t)values[i];
+        }
+        decode_column(file, &block->columns[STUDENT_COLUMN_GPA], n, values);
+        for (size_t i = 0; i < n; i++) {
+            store->gpa_hundredths[first + i] = (uint16_t)values[i];
+        }
+        decode_column(file, &block->columns[STUDENT_COLUMN_CREDITS], n, values);
+        for (size_t i = 0; i < n; i++) {
+            store->credits[first + i] = (uint16_t)values[i];
+        }
+        decode_column(file, &block->columns[STUDENT_COLUMN_GRADE], n, values);
+        for (size_t i = 0; i < n; i++) {
+            store->grade[first + i] = (uint8_t)values[i];
+        }
+        decode_column(file, &block->columns[STUDENT_COLUMN_TUITION], n, values);
+        for (size_t i = 0; i < n; i++) {
+            store->tuition_cents[first + i] = (int32_t)values[i];
+        }
+    }
+    store->count = file->count;
+    free(values);
+    return 0;
+}
+
+static int64_t value_at(const student_columnar_t *file,
+                        const student_columnar_column_t *column, size_t slot) {
+    const unsigned char *packed = file->data + column->offset;
+
+    if (column->encoding == STUDENT_ENCODING_FOR) {
+        return column->base + (int64_t)unpack(packed, column->bits, slot);
+    }
+    // Delta: add up the steps before the slot
+    int64_t value = column->base;
+    for (size_t i = 0; i < slot; i++) {
+        value += column->step + (int64_t)unpack(packed, column->bits, i);
+    }
+    return value;
+}
+
+void student_columnar_get(const student_columnar_t *file, size_t index,
+                          student_record_t *record) {
+    const student_columnar_block_t *block =
+        &file->blocks[index / STUDENT_COLUMNAR_BLOCK];
+    const student_columnar_column_t *columns = block->columns;
+    size_t slot = index % STUDENT_COLUMNAR_BLOCK;
+
+    record->id = (uint32_t)value_at(file, &columns[STUDENT_COLUMN_ID], slot);
+    record->initial =
+        (char)value_at(file, &columns[STUDENT_COLUMN_INITIAL], slot);
+    record->age = (uint8_t)value_at(file, &columns[STUDENT_COLUMN_AGE], slot);
+    record->gpa_hundredths =
+        (uint16_t)value_at(file, &columns[STUDENT_COLUMN_GPA], slot);
+    record->credits =
+        (uint16_t)value_at(file, &columns[STUDENT_COLUMN_CREDITS], slot);
+    record->grade = (student_grade_t)value_at(
+        file, &columns[STUDENT_COLUMN_GRADE], slot);
+    record->tuition_cents =
+        (int32_t)value_at(file, &columns[STUDENT_COLUMN_TUITION], slot);
+}
+
+void student_filter_all(student_filter_t *filter) {
+    for (int c = 0; c < STUDENT_COLUMN_COUNT; c++) {
+        filter->min[c] = INT64_MIN;
+        filter->max[c] = INT64_MAX;
+    }
+}
+
+/**
+ * @brief Clears match[i] for every value outside low..high
+ *
+ * Frame-of-reference values are compared while still packed: the range
+ * is moved into packed numbers once, instead of adding the base to
+ * every value.
+ */
+static void filter_column(const student_columnar_t *file,
+                          const student_columnar_column_t *column,
+                          size_t count, int64_t low, int64_t high,
+                          int64_t *values, unsigned char *match) {
+    if (column->encoding == STUDENT_ENCODING_DELTA) {
+        decode_column(file, column, count, values);
+        for (size_t i = 0; i < count; i++) {
+            match[i] &= values[i] >= low && values[i] <= high;
+        }
+        return;
+    }
+    // The statistics put part of the block inside the range, so
+    // low <= max and high >= min = base
+    const unsigned char *packed = file->data + column->offset;
+    uint64_t packed_low = low > column->base ? (uint64_t)(low - column->base)
+                                             : 0;
+    uint64_t packed_high = (uint64_t)(high < column->max ? high : column->max) -
+                           (uint64_t)column->base;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t value = unpack(packed, column->bits, i);
+        match[i] &= value >= packed_low && value <= packed_high;
+    }
+}
+
+/**
+ * @brief Adds up the matching values of a column
+ * @param matched Set to the number of matches
+ */
+static int64_t sum_matches(const student_columnar_t *file,
+                           const student_columnar_column_t *column,
+                           size_t count, const unsigned char *match,
+                           int64_t *values, uint64_t *matched) {
+    uint64_t matches = 0;
+    if (column->encoding == STUDENT_ENCODING_DELTA) {
+        int64_t sum = 0;
+        decode_column(file, column, count, values);
+        for (size_t i = 0; i < count; i++) {
+            matches += match[i];
+            sum += match[i] ? values[i] : 0;
+        }
+        *matched = matches;
+        return sum;
+    }
+    // base * matches + the packed values, all still packed
+    const unsigned char *packed = file->data + column->offset;
+    uint64_t packed_sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t value = unpack(packed, column->bits, i);
+        matches += match[i];
+        packed_sum += match[i] ? value : 0;
+    }
+    *matched = matches;
+    return column->base * (int64_t)matches + (int64_t)packed_sum;
+}
+
+void student_columnar_scan(const student_columnar_t *file,
+                           const student_filter_t *filter,
+                           student_scan_result_t *result) {
+    int64_t values[STUDENT_COLUMNAR_BLOCK];
+    unsigned char match[STUDENT_COLUMNAR_BLOCK];
+
+    memset(result, 0, sizeof(*result));
+    for (uint64_t b = 0; b < file->block_count; b++) {
+        const student_columnar_block_t *block = &file->blocks[b];
+        size_t n = block->count;
+
+        // Which columns the statistics cannot settle for this block
+        int skip = 0;
+        int check[STUDENT_COLUMN_COUNT];
+        int checks = 0;
+        for (int c = 0; c < STUDENT_COLUMN_COUNT; c++) {
+            const student_columnar_column_t *column = &block->columns[c];
+            skip |= column->max < filter->min[c] ||
+                    column->min > filter->max[c];
+            if (column->min < filter->min[c] ||
+                column->max > filter->max[c]) {
+                check[checks++] = c;
+            }
+        }
+        if (skip) {
+            result->blocks_skipped++;
+            continue;
+        }
+        if (checks == 0) {
+            result->blocks_whole++;
+            result->count += n;
+            result->tuition_cents +=
+                block->columns[STUDENT_COLUMN_TUITION].sum;
+            continue;
+        }
+
+        // Narrow the block down one column at a time
+        result->blocks_scanned++;
+        memset(match, 1, n);
+        for (int k = 0; k < checks; k++) {
+            int c = check[k];
+            filter_column(file, &block->columns[c], n, filter->min[c],
+                          filter->max[c], values, match);
+        }
+        uint64_t count = 0;
+        int64_t tuition = sum_matches(file,
+                                      &block->columns[STUDENT_COLUMN_TUITION],
+                                      n, match, values, &count);
+        result->count += count;
+        result->tuition_cents += tuition;
+    }
+}
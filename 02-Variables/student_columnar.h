@@ -0,0 +1,144 @@
+/**
+ * @file student_columnar.h
+ * @brief Compressed column file for student profiles, queried through mmap
+ *
+ * A CSV line such as "1001,S,19,3.75,45,B,5500.00" takes about 30 bytes
+ * and has to be parsed digit by digit before anything can be asked of
+ * it. This file format keeps the column store's layout on disk and packs
+ * every value into as few bits as its block needs.
+ *
+ * Students are stored in blocks of STUDENT_COLUMNAR_BLOCK. Within a
+ * block, each column is encoded one of two ways, whichever is smaller:
+ *
+ *   - frame of reference: the block's smallest value is stored once,
+ *     and each value as (value - smallest) in just enough bits for the
+ *     largest difference. Ages 17 to 46 take 5 bits; grades A..F take
+ *     3 bits; GPAs 0.00 to 4.00 (0 to 400 hundredths) take 9 bits.
+ *   - delta: the first value is stored, then each value as its
+ *     difference from the one before, frame-of-reference packed.
+ *     IDs handed out in order become a run of equal steps: 0 bits each.
+ *
+ * Every block also keeps each column's minimum, maximum and sum. A
+ * query for "at least 90 credits" skips every block whose maximum is
+ * below 90 without reading it, and counts (and adds up the tuition of)
+ * a block whose minimum is 90 or more without unpacking it.
+ *
+ * Layout (numbers in the machine's byte order):
+ *
+ *     header | packed columns, block by block | 8 zero bytes | directory
+ *
+ * The directory holds one student_columnar_block_t per block. Opening a
+ * file maps it into memory and checks the directory; nothing is
+ * decoded until a query needs it.
+ */
+
+#ifndef STUDENT_COLUMNAR_H
+#define STUDENT_COLUMNAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "student_store.h"
+
+// Students per block
+#define STUDENT_COLUMNAR_BLOCK 4096
+
+typedef enum {
+    STUDENT_COLUMN_ID,
+    STUDENT_COLUMN_INITIAL,
+    STUDENT_COLUMN_AGE,
+    STUDENT_COLUMN_GPA,             // Hundredths
+    STUDENT_COLUMN_CREDITS,
+    STUDENT_COLUMN_GRADE,           // student_grade_t
+    STUDENT_COLUMN_TUITION,         // Cents
+    STUDENT_COLUMN_COUNT
+} student_column_t;
+
+typedef enum {
+    STUDENT_ENCODING_FOR,           // base + packed
+    STUDENT_ENCODING_DELTA          // previous + step + packed
+} student_encoding_t;
+
+// One column of one block
+typedef struct {
+    uint32_t encoding;              // student_encoding_t
+    uint32_t bits;                  // Per packed value, 0 to 40
+    int64_t base;                   // FOR: smallest value; delta: first value
+    int64_t step;                   // Delta: smallest difference
+    uint64_t offset;                // Of the packed bits, from the file start
+    int64_t min;
+    int64_t max;
+    int64_t sum;
+} student_columnar_column_t;
+
+typedef struct {
+    uint64_t first;                 // Index of the block's first student
+    uint64_t count;
+    student_columnar_column_t columns[STUDENT_COLUMN_COUNT];
+} student_columnar_block_t;
+
+// An open file
+typedef struct {
+    const unsigned char *data;      // The whole file, mapped read-only
+    size_t size;
+    uint64_t count;                 // Students
+    uint64_t block_count;
+    const student_columnar_block_t *blocks;
+} student_columnar_t;
+
+// Inclusive range per column; a student matches if every column is in range
+typedef struct {
+    int64_t min[STUDENT_COLUMN_COUNT];
+    int64_t max[STUDENT_COLUMN_COUNT];
+} student_filter_t;
+
+typedef struct {
+    uint64_t count;                 // Matching students
+    int64_t tuition_cents;          // Their total tuition
+    uint64_t blocks_skipped;        // Ruled out by min/max alone
+    uint64_t blocks_whole;          // Matched whole by min/max alone
+    uint64_t blocks_scanned;        // Unpacked, column by column
+} student_scan_result_t;
+
+/**
+ * @brief Writes a store as a column file
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int student_columnar_write(const student_store_t *store, const char *path);
+
+/**
+ * @brief Maps a column file and checks its header and directory
+ * @return 0 on success, -1 on error (errno is set; EINVAL for a file
+ *         that is not a valid column file)
+ */
+int student_columnar_open(student_columnar_t *file, const char *path);
+
+void student_columnar_close(student_columnar_t *file);
+
+/**
+ * @brief Decodes the whole file into a new store
+ * @return 0 on success, -1 if out of memory
+ */
+int student_columnar_load(const student_columnar_t *file,
+                          student_store_t *store);
+
+/**
+ * @brief Decodes student `index` only
+ */
+void student_columnar_get(const student_columnar_t *file, size_t index,
+                          student_record_t *record);
+
+/**
+ * @brief A filter every student passes; narrow it column by column
+ */
+void student_filter_all(student_filter_t *filter);
+
+/**
+ * @brief Counts the students that match a filter and adds up their
+ *        tuition, reading only the blocks and columns it has to
+ */
+void student_columnar_scan(const student_columnar_t *file,
+                           const student_filter_t *filter,
+                           student_scan_result_t *result);
+
+#endif // STUDENT_COLUMNAR_H
@@ -0,0 +1,396 @@
+/**
+ * @file student_columnar_bench.c
+ * @brief Column file vs CSV: size, load time and filtered scans
+ *
+ * Makes a roster in enrollment order: the first quarter are seniors
+ * (90+ credits, older), the last quarter freshmen, with random GPAs,
+ * grades and tuition. It is written twice, as a CSV and as a column
+ * file (student_columnar.h), and then:
+ *
+ *   - size of each file, in bytes per student
+ *   - load time: the CSV parsed into a column store; the column file
+ *     opened (mapped and checked), and decoded into a column store.
+ *     Both loaded stores must equal the original.
+ *   - filtered scans ("how many students match, and what do they owe?")
+ *     three ways: parsing the CSV again, a loop over the column store
+ *     in memory, and student_columnar_scan() straight on the mapped
+ *     file. All three must give the same answer.
+ *   - two damaged files (a short block in the middle, a student count
+ *     so large that rounding it up to blocks wraps around) must be
+ *     refused by student_columnar_open().
+ *
+ * Files are read right after being written, so they come from the page
+ * cache, not the disk.
+ *
+ * Usage: ./student_columnar_bench [students]   (default 10000000)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "student_columnar.h"
+
+#define CSV_PATH "/tmp/student_columnar_bench.csv"
+#define COLUMNAR_PATH "/tmp/student_columnar_bench.col"
+#define DAMAGED_PATH "/tmp/student_columnar_bench_damaged.col"
+
+// Where student_columnar.c's header keeps the student count and the
+// directory's offset
+#define HEADER_COUNT_OFFSET 16
+#define HEADER_DIRECTORY_OFFSET 32
+
+// Repeat each in-memory scan and keep the fastest run
+#define RUNS 5
+
+typedef struct {
+    const char *name;
+    student_filter_t filter;
+} query_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static int make_roster(student_store_t *store, size_t students) {
+    uint64_t rng = 7;
+
+    if (student_store_init(store, students) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < students; i++) {
+        // 3 for the oldest class (enrolled first), 0 for freshmen
+        int years = 3 - (int)(i * 4 / students);
+        student_record_t record;
+        record.id = (uint32_t)(100000 + i);
+        record.initial = (char)('A' + xorshift64(&rng) % 26);
+        record.age = (uint8_t)(17 + years + xorshift64(&rng) % 4);
+        record.gpa_hundredths = (uint16_t)(xorshift64(&rng) % 401);
+        record.credits = (uint16_t)(years * 30 + xorshift64(&rng) % 33);
+        record.grade = (student_grade_t)(xorshift64(&rng) %
+                                         STUDENT_GRADE_COUNT);
+        record.tuition_cents = (int32_t)(xorshift64(&rng) % 2000000);
+        student_store_append(store, &record);
+    }
+    return 0;
+}
+
+static int write_csv(const student_store_t *store, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    fprintf(file, "id,initial,age,gpa,credits,grade,tuition\n");
+    for (size_t i = 0; i < store->count; i++) {
+        fprintf(file, "%u,%c,%u,%d.%02d,%u,%c,%d.%02d\n", store->id[i],
+                store->initial[i], store->age[i],
+                store->gpa_hundredths[i] / 100, store->gpa_hundredths[i] % 100,
+                store->credits[i],
+                student_grade_letter((student_grade_t)store->grade[i]),
+                store->tuition_cents[i] / 100, store->tuition_cents[i] % 100);
+    }
+    return fclose(file);
+}
+
+static long long file_size(const char *path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? (long long)info.st_size : -1;
+}
+
+static int stores_equal(const student_store_t *a, const student_store_t *b) {
+    size_t n = a->count;
+    return a->count == b->count &&
+           memcmp(a->id, b->id, n * sizeof(*a->id)) == 0 &&
+           memcmp(a->initial, b->initial, n * sizeof(*a->initial)) == 0 &&
+           memcmp(a->age, b->age, n * sizeof(*a->age)) == 0 &&
+           memcmp(a->gpa_hundredths, b->gpa_hundredths,
+                  n * sizeof(*a->gpa_hundredths)) == 0 &&
+           memcmp(a->credits, b->credits, n * sizeof(*a->credits)) == 0 &&
+           memcmp(a->grade, b->grade, n * sizeof(*a->grade)) == 0 &&
+           memcmp(a->tuition_cents, b->tuition_cents,
+                  n * sizeof(*a->tuition_cents)) == 0;
+}
+
+/**
+ * @brief The same query as student_columnar_scan(), on a store in memory
+ */
+static void scan_store(const student_store_t *store,
+                       const student_filter_t *filter,
+                       student_scan_result_t *result) {
+    const int64_t *min = filter->min;
+    const int64_t *max = filter->max;
+
+    memset(result, 0, sizeof(*result));
+    for (size_t i = 0; i < store->count; i++) {
+        int match = store->id[i] >= min[STUDENT_COLUMN_ID] &&
+                    store->id[i] <= max[STUDENT_COLUMN_ID] &&
+                    store->initial[i] >= min[STUDENT_COLUMN_INITIAL] &&
+                    store->initial[i] <= max[STUDENT_COLUMN_INITIAL] &&
+                    store->age[i] >= min[STUDENT_COLUMN_AGE] &&
+                    store->age[i] <= max[STUDENT_COLUMN_AGE] &&
+                    store->gpa_hundredths[i] >= min[STUDENT_COLUMN_GPA] &&
+                    store->gpa_hundredths[i] <= max[STUDENT_COLUMN_GPA] &&
+                    store->credits[i] >= min[STUDENT_COLUMN_CREDITS] &&
+                    store->credits[i] <= max[STUDENT_COLUMN_CREDITS] &&
+                    store->grade[i] >= min[STUDENT_COLUMN_GRADE] &&
+                    store->grade[i] <= max[STUDENT_COLUMN_GRADE] &&
+                    store->tuition_cents[i] >= min[STUDENT_COLUMN_TUITION] &&
+                    store->tuition_cents[i] <= max[STUDENT_COLUMN_TUITION];
+        result->count += match;
+        result->tuition_cents += match ? store->tuition_cents[i] : 0;
+    }
+}
+
+// Reads or overwrites the 8-byte number at offset
+static int poke_u64(const char *path, long offset, uint64_t *value,
+                    int write) {
+    FILE *f = fopen(path, "r+b");
+    int ok = f != NULL && fseek(f, offset, SEEK_SET) == 0 &&
+             (write ? fwrite(value, sizeof(*value), 1, f)
+                    : fread(value, sizeof(*value), 1, f)) == 1;
+    if (f != NULL && fclose(f) != 0) {
+        ok = 0;
+    }
+    return ok ? 0 : -1;
+}
+
+// 1 if the file at path is refused as not a valid column file
+static int refused(const char *path) {
+    student_columnar_t file;
+    if (student_columnar_open(&file, path) == 0) {
+        student_columnar_close(&file);
+        return 0;
+    }
+    return errno == EINVAL;
+}
+
+/**
+ * @brief Damages column files in ways that stay inside the file's
+ *        bounds, which student_columnar_open() must still refuse
+ * @return Number of damaged files that were accepted
+ */
+static int check_damaged_files(const student_store_t *original) {
+    student_store_t small;
+    int failures = 0;
+
+    // Three blocks (the last one short), made of the original's students
+    if (student_store_init(&small, 2 * STUDENT_COLUMNAR_BLOCK + 100) != 0) {
+        return 1;
+    }
+    for (size_t i = 0; i < small.capacity; i++) {
+        student_record_t record;
+        student_store_get(original, i % original->count, &record);
+        student_store_append(&small, &record);
+    }
+
+    // The first block claims fewer students than a full block
+    uint64_t directory, count = 100;
+    if (student_columnar_write(&small, DAMAGED_PATH) != 0 ||
+        refused(DAMAGED_PATH) ||
+        poke_u64(DAMAGED_PATH, HEADER_DIRECTORY_OFFSET, &directory, 0) != 0 ||
+        poke_u64(DAMAGED_PATH, (long)directory + 8, &count, 1) != 0 ||
+        !refused(DAMAGED_PATH)) {
+        failures++;
+    }
+
+    // No students, but a count that wraps to 0 blocks when rounded up
+    small.count = 0;
+    count = UINT64_MAX - 2;
+    if (student_columnar_write(&small, DAMAGED_PATH) != 0 ||
+        refused(DAMAGED_PATH) ||
+        poke_u64(DAMAGED_PATH, HEADER_COUNT_OFFSET, &count, 1) != 0 ||
+        !refused(DAMAGED_PATH)) {
+        failures++;
+    }
+
+    student_store_free(&small);
+    remove(DAMAGED_PATH);
+    printf("\nDamaged files (short block, wrapping count): %s\n",
+           failures == 0 ? "refused" : "FAILED");
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 10000000;
+    student_store_t original, from_csv, from_columnar;
+    student_columnar_t file;
+
+    if (argc >= 2) {
+        n = strtoul(argv[1], NULL, 10);
+    }
+    if (n == 0) {
+        fprintf(stderr, "Usage: %s [students (>= 1)]\n", argv[0]);
+        return 1;
+    }
+
+    printf("=== COLUMN FILE BENCHMARK ===\n");
+    printf("%zu students in enrollment order, seniors first\n", n);
+    if (make_roster(&original, n) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    double start = now_seconds();
+    if (write_csv(&original, CSV_PATH) != 0) {
+        perror(CSV_PATH);
+        return 1;
+    }
+    double csv_write = now_seconds() - start;
+    start = now_seconds();
+    if (student_columnar_write(&original, COLUMNAR_PATH) != 0) {
+        perror(COLUMNAR_PATH);
+        return 1;
+    }
+    double columnar_write = now_seconds() - start;
+
+    // --- Size ---
+    long long csv_bytes = file_size(CSV_PATH);
+    long long columnar_bytes = file_size(COLUMNAR_PATH);
+    printf("\n%-24s %14s %14s %10s\n", "File", "Bytes", "Bytes/student",
+           "Write s");
+    printf("%-24s %14lld %14.2f %10.3f\n", "CSV", csv_bytes,
+           (double)csv_bytes / n, csv_write);
+    printf("%-24s %14lld %14.2f %10.3f\n", "column file", columnar_bytes,
+           (double)columnar_bytes / n, columnar_write);
+    printf("%-24s %14zu %14.2f %10s\n", "(column store in memory)",
+           n * 15, 15.0, "-");
+
+    // --- Load ---
+    start = now_seconds();
+    if (student_store_load(&from_csv, CSV_PATH) != 0) {
+        perror(CSV_PATH);
+        return 1;
+    }
+    double csv_load = now_seconds() - start;
+    start = now_seconds();
+    if (student_columnar_open(&file, COLUMNAR_PATH) != 0) {
+        perror(COLUMNAR_PATH);
+        return 1;
+    }
+    double columnar_open = now_seconds() - start;
+    start = now_seconds();
+    if (student_columnar_load(&file, &from_columnar) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    double columnar_load = now_seconds() - start;
+
+    int failures = 0;
+    if (!stores_equal(&original, &from_csv) ||
+        !stores_equal(&original, &from_columnar)) {
+        printf("Loaded stores differ from the original: FAILED\n");
+        failures++;
+    }
+    for (size_t i = 0; i < n; i += n / 1000 + 1) {
+        student_record_t want, got;
+        student_store_get(&original, i, &want);
+        student_columnar_get(&file, i, &got);
+        if (want.id != got.id || want.initial != got.initial ||
+            want.age != got.age || want.gpa_hundredths != got.gpa_hundredths ||
+            want.credits != got.credits || want.grade != got.grade ||
+            want.tuition_cents != got.tuition_cents) {
+            printf("Student %zu read from the file differs: FAILED\n", i);
+            failures++;
+            break;
+        }
+    }
+
+    printf("\n%-24s %10s %12s\n", "Load", "ms", "vs CSV");
+    printf("%-24s %10.1f %12s\n", "CSV, parsed", csv_load * 1e3, "1.0x");
+    printf("%-24s %10.3f %11.0fx\n", "column file, mapped", columnar_open * 1e3,
+           csv_load / columnar_open);
+    printf("%-24s %10.1f %11.1fx\n", "column file, decoded",
+           columnar_load * 1e3, csv_load / columnar_load);
+
+    // --- Filtered scans ---
+    query_t queries[4];
+    for (int q = 0; q < 4; q++) {
+        student_filter_all(&queries[q].filter);
+    }
+    queries[0].name = "seniors (90+ credits)";
+    queries[0].filter.min[STUDENT_COLUMN_CREDITS] = 90;
+    queries[1].name = "A with GPA 3.50+";
+    queries[1].filter.min[STUDENT_COLUMN_GPA] = 350;
+    queries[1].filter.max[STUDENT_COLUMN_GRADE] = STUDENT_GRADE_A;
+    queries[2].name = "19 or younger, $19000+";
+    queries[2].filter.max[STUDENT_COLUMN_AGE] = 19;
+    queries[2].filter.min[STUDENT_COLUMN_TUITION] = 1900000;
+    queries[3].name = "everyone";
+
+    printf("\n%-24s %10s %10s %10s %9s %17s\n", "Scan (best of 5)",
+           "CSV ms", "Memory ms", "File ms", "Matches", "Blocks skip/whole");
+    for (int q = 0; q < 4; q++) {
+        const student_filter_t *filter = &queries[q].filter;
+        student_scan_result_t csv_result, memory_result, file_result;
+
+        // CSV: the text has to be parsed again for every question
+        student_store_t parsed;
+        start = now_seconds();
+        if (student_store_load(&parsed, CSV_PATH) != 0) {
+            perror(CSV_PATH);
+            return 1;
+        }
+        scan_store(&parsed, filter, &csv_result);
+        double csv_seconds = now_seconds() - start;
+        student_store_free(&parsed);
+
+        double memory_seconds = 1e30, file_seconds = 1e30;
+        for (int run = 0; run < RUNS; run++) {
+            start = now_seconds();
+            scan_store(&original, filter, &memory_result);
+            double middle = now_seconds();
+            student_columnar_scan(&file, filter, &file_result);
+            double end = now_seconds();
+            if (middle - start < memory_seconds) {
+                memory_seconds = middle - start;
+            }
+            if (end - middle < file_seconds) {
+                file_seconds = end - middle;
+            }
+        }
+
+        printf("%-24s %10.1f %10.2f %10.2f %9llu %8llu/%-8llu\n",
+               queries[q].name, csv_seconds * 1e3, memory_seconds * 1e3,
+               file_seconds * 1e3, (unsigned long long)file_result.count,
+               (unsigned long long)file_result.blocks_skipped,
+               (unsigned long long)file_result.blocks_whole);
+        if (csv_result.count != file_result.count ||
+            memory_result.count != file_result.count ||
+            csv_result.tuition_cents != file_result.tuition_cents ||
+            memory_result.tuition_cents != file_result.tuition_cents) {
+            printf("  CSV, memory and file answers differ: FAILED\n");
+            failures++;
+        }
+    }
+    failures += check_damaged_files(&original);
+    printf("\n%llu blocks of %d students\n",
+           (unsigned long long)file.block_count, STUDENT_COLUMNAR_BLOCK);
+    if (failures == 0) {
+        printf("Both loads rebuilt the roster exactly, every scan agreed "
+               "with the CSV,\nand damaged files were refused\n");
+    }
+
+    student_columnar_close(&file);
+    student_store_free(&from_columnar);
+    student_store_free(&from_csv);
+    student_store_free(&original);
+    remove(CSV_PATH);
+    remove(COLUMNAR_PATH);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file student_hash.c
+ * @brief Flat hash table with SIMD-compared control bytes
+ */
+
+#include "student_hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CONTROL_EMPTY 0x80
+#define CONTROL_TOMBSTONE 0xFE
+
+// The table grows when it is more than 7/8 full
+#define MAX_LOAD_NUMERATOR 7
+#define MAX_LOAD_DENOMINATOR 8
+
+static uint64_t hash_id(uint32_t id) {
+    // Multiplying by 2^64 / golden ratio spreads nearby IDs apart
+    return (uint64_t)id * 0x9E3779B97F4A7C15ull;
+}
+
+// Low 7 bits of the hash, stored in the control byte
+static uint8_t hash_tag(uint64_t hash) {
+    return (uint8_t)(hash & 0x7F);
+}
+
+// High bits of the hash choose the first group to look in
+static size_t first_group(const student_hash_t *table, uint64_t hash) {
+    return (size_t)(hash >> 32) & table->group_mask;
+}
+
+static size_t slot_count(const student_hash_t *table) {
+    return (table->group_mask + 1) * STUDENT_HASH_GROUP_SIZE;
+}
+
+/**
+ * @brief Bit i is set if control byte i of the group equals value
+ */
+static unsigned match_byte(const uint8_t *control, uint8_t value) {
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)control);
+    return (unsigned)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < STUDENT_HASH_GROUP_SIZE; i++) {
+        mask |= (unsigned)(control[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief Bit i is set if slot i of the group is empty or a tombstone
+ *        (both have the top bit set)
+ */
+static unsigned match_free(const uint8_t *control) {
+#ifdef __SSE2__
+    return (unsigned)_mm_movemask_epi8(
+        _mm_loadu_si128((const __m128i *)control));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < STUDENT_HASH_GROUP_SIZE; i++) {
+        mask |= (unsigned)(control[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+static int allocate(student_hash_t *table, size_t groups) {
+    size_t slots = groups * STUDENT_HASH_GROUP_SIZE;
+
+    table->control = malloc(slots);
+    table->slots = malloc(slots * sizeof(student_hash_slot_t));
+    if (table->control == NULL || table->slots == NULL) {
+        free(table->control);
+        free(table->slots);
+        return -1;
+    }
+    memset(table->control, CONTROL_EMPTY, slots);
+    table->group_mask = groups - 1;
+    table->size = 0;
+    table->tombstones = 0;
+    return 0;
+}
+
+int student_hash_init(student_hash_t *table, size_t expected) {
+    size_t groups = 1;
+
+    // Smallest power of two that keeps `expected` under the load limit
+    while (groups * STUDENT_HASH_GROUP_SIZE * MAX_LOAD_NUMERATOR /
+               MAX_LOAD_DENOMINATOR < expected) {
+        groups *= 2;
+    }
+    return allocate(table, groups);
+}
+
+void student_hash_free(student_hash_t *table) {
+    free(table->control);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * @brief Index of the slot holding id, or -1
+ */
+static long find_slot(const student_hash_t *table, uint32_t id) {
+    uint64_t hash = hash_id(id);
+    uint8_t tag = hash_tag(hash);
+    size_t group = first_group(table, hash);
+
+    // Triangular steps (1, 2, 3, ...) visit every group exactly once
+    for (size_t step = 1; step <= table->group_mask + 1; step++) {
+        const uint8_t *control =
+            table->control + group * STUDENT_HASH_GROUP_SIZE;
+        const student_hash_slot_t *slots =
+            table->slots + group * STUDENT_HASH_GROUP_SIZE;
+
+        for (unsigned match = match_byte(control, tag); match != 0;
+             match &= match - 1) {
+            int i = __builtin_ctz(match);
+            if (slots[i].id == id) {
+                return (long)(group * STUDENT_HASH_GROUP_SIZE + i);
+            }
+        }
+        // An empty slot means the ID was never placed further along
+        if (match_byte(control, CONTROL_EMPTY) != 0) {
+            return -1;
+        }
+        group = (group + step) & table->group_mask;
+    }
+    return -1;
+}
+
+// Puts an ID that is known not to be in the table into the first free slot
+static void place(student_hash_t *table, uint32_t id, uint32_t row) {
+    uint64_t hash = hash_id(id);
+    size_t group = first_group(table, hash);
+
+    for (size_t step = 1;; step++) {
+        uint8_t *control = table->control + group * STUDENT_HASH_GROUP_SIZE;
+        unsigned free_slots = match_free(control);
+        if (free_slots != 0) {
+            int i = __builtin_ctz(free_slots);
+            if (control[i] == CONTROL_TOMBSTONE) {
+                table->tombstones--;
+            }
+            control[i] = hash_tag(hash);
+            table->slots[group * STUDENT_HASH_GROUP_SIZE + i] =
+                (student_hash_slot_t){id, row};
+            table->size++;
+            return;
+        }
+        group = (group + step) & table->group_mask;
+    }
+}
+
+// Moves every entry into a new table, dropping tombstones
+static int rehash(student_hash_t *table, size_t groups) {
+    student_hash_t bigger;
+
+    if (allocate(&bigger, groups) != 0) {
+        return -1;
+    }
+    size_t slots = slot_count(table);
+    for (size_t i = 0; i < slots; i++) {
+        if ((table->control[i] & 0x80) == 0) {
+            place(&bigger, table->slots[i].id, table->slots[i].row);
+        }
+    }
+    student_hash_free(table);
+    *table = bigger;
+    return 0;
+}
+
+int student_hash_insert(student_hash_t *table, uint32_t id, uint32_t row) {
+    long slot = find_slot(table, id);
+    if (slot >= 0) {
+        table->slots[slot].row = row;
+        return 0;
+    }
+
+    size_t limit = slot_count(table) * MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR;
+    if (table->size + table->tombstones + 1 > limit) {
+        // Grow if really full, otherwise just clear out the tombstones
+        size_t groups = table->group_mask + 1;
+        if (table->size + 1 > limit / 2) {
+            groups *= 2;
+        }
+        if (rehash(table, groups) != 0) {
+            return -1;
+        }
+    }
+    place(table, id, row);
+    return 0;
+}
+
+long student_hash_find(const student_hash_t *table, uint32_t id) {
+    long slot = find_slot(table, id);
+    return slot >= 0 ? (long)table->slots[slot].row : -1;
+}
+
+void student_hash_find_batch(const student_hash_t *table, const uint32_t *ids,
+                             size_t count, long *rows) {
+    // How many IDs ahead to prefetch
+    const size_t distance = 8;
+
+    for (size_t i = 0; i < count; i++) {
+        if (i + distance < count) {
+            size_t group = first_group(table, hash_id(ids[i + distance]));
+            __builtin_prefetch(table->control + group * STUDENT_HASH_GROUP_SIZE);
+            __builtin_prefetch(table->slots + group * STUDENT_HASH_GROUP_SIZE);
+        }
+        rows[i] = student_hash_find(table, ids[i]);
+    }
+}
+
+int student_hash_erase(student_hash_t *table, uint32_t id) {
+    long slot = find_slot(table, id);
+    if (slot < 0) {
+        return 0;
+    }
+    // A tombstone, not an empty slot: lookups must keep probing past it
+    table->control[slot] = CONTROL_TOMBSTONE;
+    table->size--;
+    table->tombstones++;
+    return 1;
+}
+
+size_t student_hash_memory(const student_hash_t *table) {
+    return slot_count(table) * (1 + sizeof(student_hash_slot_t));
+}
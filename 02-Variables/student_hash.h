@@ -0,0 +1,80 @@
+/**
+ * @file student_hash.h
+ * @brief Student ID -> row lookups in a flat open-addressing hash table
+ *
+ * Finding a student by ID in student_store_t means looking at every ID
+ * until the right one turns up. This table finds it with usually one
+ * cache miss, no matter how many students there are.
+ *
+ * All entries live in one flat array, grouped 16 at a time. Next to
+ * every group are 16 control bytes: 0x80 for an empty slot, or 7 bits
+ * of the ID's hash for a full one. A lookup compares all 16 control
+ * bytes with one SIMD instruction and only looks at the slots whose
+ * hash bits match, which is almost always just the right one.
+ */
+
+#ifndef STUDENT_HASH_H
+#define STUDENT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Slots per group, one SSE2 register of control bytes
+#define STUDENT_HASH_GROUP_SIZE 16
+
+typedef struct {
+    uint32_t id;
+    uint32_t row;
+} student_hash_slot_t;
+
+typedef struct {
+    uint8_t *control;              // One byte per slot
+    student_hash_slot_t *slots;
+    size_t group_mask;             // Number of groups - 1 (a power of two)
+    size_t size;                   // Students in the table
+    size_t tombstones;             // Slots freed by student_hash_erase()
+} student_hash_t;
+
+/**
+ * @brief Creates a table with room for `expected` students
+ * @return 0 on success, -1 if out of memory
+ */
+int student_hash_init(student_hash_t *hash, size_t expected);
+
+void student_hash_free(student_hash_t *hash);
+
+/**
+ * @brief Adds a student, or moves an existing one to a new row
+ * @return 0 on success, -1 if out of memory
+ */
+int student_hash_insert(student_hash_t *hash, uint32_t id, uint32_t row);
+
+/**
+ * @brief Row of a student
+ * @return The row, or -1 if the ID is not in the table
+ */
+long student_hash_find(const student_hash_t *hash, uint32_t id);
+
+/**
+ * @brief Looks up many IDs at once
+ *
+ * Fetches the groups of upcoming IDs into the cache while the current
+ * one is compared, so several cache misses are in flight at a time.
+ *
+ * @param rows Receives the row of each ID, or -1
+ */
+void student_hash_find_batch(const student_hash_t *hash, const uint32_t *ids,
+                             size_t count, long *rows);
+
+/**
+ * @brief Removes a student
+ * @return 1 if removed, 0 if the ID was not in the table
+ */
+int student_hash_erase(student_hash_t *hash, uint32_t id);
+
+/**
+ * @brief Bytes of memory the table uses
+ */
+size_t student_hash_memory(const student_hash_t *hash);
+
+#endif // STUDENT_HASH_H
@@ -0,0 +1,218 @@
+/**
+ * @file student_index.c
+ * @brief Keeping the hash and B+-tree indexes in step with the store
+ */
+
+#include "student_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Updates looked up together before any of them is applied
+#define LOOKUP_BATCH 256
+
+int student_indexes_build(student_indexes_t *indexes,
+                          const student_store_t *store) {
+    memset(indexes, 0, sizeof(*indexes));
+    student_btree_init(&indexes->by_gpa);
+    student_btree_init(&indexes->by_credits);
+
+    if (student_hash_init(&indexes->by_id, store->count) != 0) {
+        return -1;
+    }
+    for (size_t row = 0; row < store->count; row++) {
+        if (student_hash_find(&indexes->by_id, store->id[row]) >= 0 ||
+            student_hash_insert(&indexes->by_id, store->id[row],
+                                (uint32_t)row) != 0) {
+            student_indexes_free(indexes);
+            return -1;
+        }
+    }
+    if (student_btree_build(&indexes->by_gpa, store->gpa_hundredths,
+                            store->count) != 0 ||
+        student_btree_build(&indexes->by_credits, store->credits,
+                            store->count) != 0) {
+        student_indexes_free(indexes);
+        return -1;
+    }
+    return 0;
+}
+
+void student_indexes_free(student_indexes_t *indexes) {
+    student_hash_free(&indexes->by_id);
+    student_btree_free(&indexes->by_gpa);
+    student_btree_free(&indexes->by_credits);
+}
+
+long student_indexes_find(const student_indexes_t *indexes, uint32_t id) {
+    return student_hash_find(&indexes->by_id, id);
+}
+
+/**
+ * @brief First half of moving a row to another value in a B+-tree: adds
+ *        the key at the new value, leaving the old one in place
+ */
+static int add_moved_key(student_btree_t *tree, uint32_t row, uint16_t from,
+                         uint16_t to) {
+    if (from == to) {
+        return 0;
+    }
+    return student_btree_insert(tree, STUDENT_BTREE_KEY(to, row)) < 0 ? -1 : 0;
+}
+
+// Second half: erases the key at the old value (cannot fail)
+static void erase_moved_key(student_btree_t *tree, uint32_t row,
+                            uint16_t from, uint16_t to) {
+    if (from != to) {
+        student_btree_erase(tree, STUDENT_BTREE_KEY(from, row));
+    }
+}
+
+/**
+ * @brief Applies one update whose row is known (-1 for a new student)
+ *
+ * Every step that can run out of memory comes before anything is taken
+ * away, and is undone if a later one fails: on failure the store and
+ * the indexes are exactly as they were.
+ */
+static int apply_one(student_indexes_t *indexes, student_store_t *store,
+                     const student_record_t *update, long row) {
+    if (row < 0) {
+        row = student_store_append(store, update);
+        if (row < 0) {
+            return -1;
+        }
+        uint64_t gpa_key = STUDENT_BTREE_KEY(update->gpa_hundredths, row);
+        if (student_hash_insert(&indexes->by_id, update->id,
+                                (uint32_t)row) != 0) {
+            store->count--;
+            return -1;
+        }
+        if (student_btree_insert(&indexes->by_gpa, gpa_key) < 0 ||
+            student_btree_insert(&indexes->by_credits,
+                                 STUDENT_BTREE_KEY(update->credits, row)) < 0) {
+            student_btree_erase(&indexes->by_gpa, gpa_key);
+            student_hash_erase(&indexes->by_id, update->id);
+            store->count--;
+            return -1;
+        }
+        return 0;
+    }
+
+    uint16_t gpa = store->gpa_hundredths[row];
+    uint16_t credits = store->credits[row];
+    if (add_moved_key(&indexes->by_gpa, (uint32_t)row, gpa,
+                      update->gpa_hundredths) != 0) {
+        return -1;
+    }
+    if (add_moved_key(&indexes->by_credits, (uint32_t)row, credits,
+                      update->credits) != 0) {
+        // Take the new GPA key back out
+        erase_moved_key(&indexes->by_gpa, (uint32_t)row,
+                        update->gpa_hundredths, gpa);
+        return -1;
+    }
+    erase_moved_key(&indexes->by_gpa, (uint32_t)row, gpa,
+                    update->gpa_hundredths);
+    erase_moved_key(&indexes->by_credits, (uint32_t)row, credits,
+                    update->credits);
+    student_store_set(store, (size_t)row, update);
+    return 0;
+}
+
+size_t student_indexes_apply(student_indexes_t *indexes,
+                             student_store_t *store,
+                             const student_record_t *updates, size_t count) {
+    uint32_t ids[LOOKUP_BATCH];
+    long rows[LOOKUP_BATCH];
+
+    for (size_t start = 0; start < count; start += LOOKUP_BATCH) {
+        size_t n = count - start < LOOKUP_BATCH ? count - start : LOOKUP_BATCH;
+
+        // Find every row of this batch first, with many misses in flight
+        for (size_t i = 0; i < n; i++) {
+            ids[i] = updates[start + i].id;
+        }
+        student_hash_find_batch(&indexes->by_id, ids, n, rows);
+
+        for (size_t i = 0; i < n; i++) {
+            long row = rows[i];
+            if (row < 0) {
+                // May have been added by an earlier update in this batch
+                row = student_hash_find(&indexes->by_id, ids[i]);
+            }
+            if (apply_one(indexes, store, &updates[start + i], row) != 0) {
+                return start + i;
+            }
+        }
+    }
+    return count;
+}
+
+size_t student_indexes_near_graduation(const student_indexes_t *indexes,
+                                       int remaining, uint32_t *rows,
+                                       size_t max_rows) {
+    int min_credits = STUDENT_CREDITS_TO_GRADUATE - remaining;
+    student_btree_cursor_t cursor;
+    uint64_t key;
+    size_t found = 0;
+
+    if (min_credits < 0) {
+        min_credits = 0;
+    }
+    student_btree_seek(&indexes->by_credits, (uint32_t)min_credits,
+                       UINT16_MAX, &cursor);
+    while (found < max_rows && student_btree_next(&cursor, &key)) {
+        rows[found++] = STUDENT_BTREE_ROW(key);
+    }
+    if (found == max_rows) {
+        found = student_btree_count(&indexes->by_credits,
+                                    (uint32_t)min_credits, UINT16_MAX);
+    }
+    return found;
+}
+
+// Every row appears exactly once in the tree, under its current value
+static int check_tree(const student_btree_t *tree, const uint16_t *column,
+                      size_t rows, uint8_t *seen) {
+    student_btree_cursor_t cursor;
+    uint64_t key, previous = 0;
+    size_t keys = 0;
+
+    memset(seen, 0, rows);
+    student_btree_seek(tree, 0, UINT32_MAX, &cursor);
+    while (student_btree_next(&cursor, &key)) {
+        uint32_t row = STUDENT_BTREE_ROW(key);
+        if ((keys > 0 && key <= previous) || row >= rows || seen[row] ||
+            column[row] != STUDENT_BTREE_VALUE(key)) {
+            return 0;
+        }
+        seen[row] = 1;
+        previous = key;
+        keys++;
+    }
+    return keys == rows && tree->size == rows;
+}
+
+int student_indexes_check(const student_indexes_t *indexes,
+                          const student_store_t *store) {
+    if (indexes->by_id.size != store->count) {
+        return 0;
+    }
+    for (size_t row = 0; row < store->count; row++) {
+        if (student_hash_find(&indexes->by_id, store->id[row]) != (long)row) {
+            return 0;
+        }
+    }
+
+    uint8_t *seen = malloc(store->count + 1);
+    if (seen == NULL) {
+        return 0;
+    }
+    int consistent =
+        check_tree(&indexes->by_gpa, store->gpa_hundredths, store->count,
+                   seen) &&
+        check_tree(&indexes->by_credits, store->credits, store->count, seen);
+    free(seen);
+    return consistent;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file student_index.h
+ * @brief Indexes over a student store, kept in step with batched updates
+ *
+ * student_profile.c's "END OF SEMESTER UPDATE" changes one student's
+ * fields. Applied to millions of students keyed by ID, each update
+ * needs to find the student (the hash index) and, if GPA or credits
+ * change, move the student within the range indexes (the B+-trees).
+ *
+ * student_indexes_apply() does all of that for a whole batch of
+ * updates, so after it returns the store and all three indexes agree.
+ */
+
+#ifndef STUDENT_INDEX_H
+#define STUDENT_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "student_btree.h"
+#include "student_hash.h"
+#include "student_store.h"
+
+// Credits needed to graduate, as assumed in student_profile.c
+#define STUDENT_CREDITS_TO_GRADUATE 120
+
+typedef struct {
+    student_hash_t by_id;          // ID -> row
+    student_btree_t by_gpa;        // (GPA in hundredths, row)
+    student_btree_t by_credits;    // (credits, row)
+} student_indexes_t;
+
+/**
+ * @brief Builds all indexes for the students already in the store
+ * @return 0 on success, -1 if out of memory or IDs are not unique
+ */
+int student_indexes_build(student_indexes_t *indexes,
+                          const student_store_t *store);
+
+void student_indexes_free(student_indexes_t *indexes);
+
+/**
+ * @brief Row of the student with this ID, or -1
+ */
+long student_indexes_find(const student_indexes_t *indexes, uint32_t id);
+
+/**
+ * @brief Applies a batch of updates to the store and every index
+ *
+ * Each update replaces all fields of the student with the same ID; a
+ * new ID adds a student. When a batch has several updates for one ID,
+ * the last one wins, as if they had been applied one by one.
+ *
+ * @return Number of updates applied; fewer than count only if the store
+ *         is full or memory runs out. The update that failed changed
+ *         nothing, so the store and indexes still agree.
+ */
+size_t student_indexes_apply(student_indexes_t *indexes,
+                             student_store_t *store,
+                             const student_record_t *updates, size_t count);
+
+/**
+ * @brief Rows of students with at most `remaining` credits left to
+ *        graduate (credits >= STUDENT_CREDITS_TO_GRADUATE - remaining)
+ * @param rows Receives up to max_rows rows, in credits order
+ * @return Number of matching students (may be more than max_rows)
+ */
+size_t student_indexes_near_graduation(const student_indexes_t *indexes,
+                                       int remaining, uint32_t *rows,
+                                       size_t max_rows);
+
+/**
+ * @brief Checks that every index matches the store exactly
+ * @return 1 if consistent, 0 otherwise (slow: visits every student)
+ */
+int student_indexes_check(const student_indexes_t *indexes,
+                          const student_store_t *store);
+
+#endif // STUDENT_INDEX_H
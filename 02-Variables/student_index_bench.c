@@ -0,0 +1,278 @@
+/**
+ * @file student_index_bench.c
+ * @brief Lookup, range-scan and update benchmark for the student indexes
+ *
+ * For each store size (1M, 10M and 100M students by default) this
+ * builds a store of random students and its indexes, then measures:
+ *
+ *   - ID lookups: hash index one at a time and in batches, against
+ *     scanning the ID column
+ *   - range queries: "at most 30 credits left to graduate" and narrow
+ *     GPA ranges, B+-tree against scanning the column
+ *   - batched end-of-semester updates, followed by a full check that
+ *     the store and all indexes still agree
+ *
+ * Sizes that would not fit in the free memory are skipped.
+ *
+ * Usage: ./student_index_bench [students ...]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "student_index.h"
+
+#define LOOKUPS 10000000
+#define SCAN_LOOKUPS 20
+#define GPA_QUERIES 100000
+#define UPDATES 1000000
+#define UPDATE_BATCH 10000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift64: rand() is too slow for 100 million students
+static uint64_t random_state = 88172645463325252ull;
+static uint32_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return (uint32_t)(random_state >> 16);
+}
+
+// Distinct IDs for distinct rows: odd multipliers are invertible mod 2^32
+static uint32_t id_for(size_t row) {
+    return (uint32_t)(row * 2654435761u + 1000);
+}
+
+static student_record_t random_student(uint32_t id) {
+    student_record_t record;
+    record.id = id;
+    record.initial = (char)('A' + next_random() % 26);
+    record.age = (uint8_t)(17 + next_random() % 30);
+    record.gpa_hundredths = (uint16_t)(next_random() % 401);
+    record.credits = (uint16_t)(next_random() % 150);
+    record.grade = (student_grade_t)(next_random() % STUDENT_GRADE_COUNT);
+    record.tuition_cents = (int32_t)(next_random() % 2000000);
+    return record;
+}
+
+// Rough peak memory of one benchmark run, in bytes
+static double memory_needed(size_t n) {
+    double hash_slots = 16;
+    while (hash_slots * 7 / 8 < n + (double)UPDATES / 100) {
+        hash_slots *= 2;
+    }
+    return n * (15.0 + 2 * 8.3) + hash_slots * 9 +
+           LOOKUPS * (4.0 + 8.0) + UPDATES * sizeof(student_record_t);
+}
+
+static long scan_for_id(const student_store_t *store, uint32_t id) {
+    for (size_t row = 0; row < store->count; row++) {
+        if (store->id[row] == id) {
+            return (long)row;
+        }
+    }
+    return -1;
+}
+
+static void print_row(const char *name, double index_ns, double scan_ns) {
+    printf("  %-30s %12.1f %14.1f %10.0fx\n", name, index_ns, scan_ns,
+           scan_ns / index_ns);
+}
+
+static int run(size_t n) {
+    student_store_t store;
+    student_indexes_t indexes;
+
+    printf("\n=== %zu students ===\n", n);
+    double available = (double)sysconf(_SC_AVPHYS_PAGES) *
+                       (double)sysconf(_SC_PAGESIZE);
+    if (memory_needed(n) > available) {
+        printf("Skipped: needs about %.1f GB, %.1f GB free\n",
+               memory_needed(n) / 1e9, available / 1e9);
+        return 0;
+    }
+
+    if (student_store_init(&store, n + UPDATES / 100 + 1) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    for (size_t row = 0; row < n; row++) {
+        student_record_t record = random_student(id_for(row));
+        student_store_append(&store, &record);
+    }
+
+    double start = now_seconds();
+    if (student_indexes_build(&indexes, &store) != 0) {
+        fprintf(stderr, "Error: building indexes failed\n");
+        return 1;
+    }
+    printf("Index build: %.2f s   hash %.0f MB, B+-trees %.0f MB\n",
+           now_seconds() - start,
+           student_hash_memory(&indexes.by_id) / 1e6,
+           (indexes.by_gpa.arena.bytes_reserved +
+            indexes.by_credits.arena.bytes_reserved) / 1e6);
+
+    printf("\n  %-30s %12s %14s %10s\n", "Query", "Index ns", "Scan ns",
+           "Speedup");
+
+    // --- ID lookups ---
+    uint32_t *ids = malloc(LOOKUPS * sizeof(uint32_t));
+    long *rows = malloc(LOOKUPS * sizeof(long));
+    if (ids == NULL || rows == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        ids[i] = id_for(next_random() % n);
+    }
+
+    long checksum = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        checksum += student_indexes_find(&indexes, ids[i]);
+    }
+    double single = (now_seconds() - start) / LOOKUPS;
+
+    start = now_seconds();
+    student_hash_find_batch(&indexes.by_id, ids, LOOKUPS, rows);
+    double batched = (now_seconds() - start) / LOOKUPS;
+
+    start = now_seconds();
+    long scan_checksum = 0;
+    for (size_t i = 0; i < SCAN_LOOKUPS; i++) {
+        scan_checksum += scan_for_id(&store, ids[i]);
+    }
+    double scan = (now_seconds() - start) / SCAN_LOOKUPS;
+
+    for (size_t i = 0; i < SCAN_LOOKUPS; i++) {
+        scan_checksum -= rows[i];
+    }
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        checksum -= rows[i];
+    }
+    if (checksum != 0 || scan_checksum != 0) {
+        fprintf(stderr, "Error: lookups disagree!\n");
+        return 1;
+    }
+    print_row("ID lookup", single * 1e9, scan * 1e9);
+    print_row("ID lookup, batched", batched * 1e9, scan * 1e9);
+
+    // --- Range queries ---
+    // A wide range (about a fifth of all students), best of 5 runs
+    double tree_near = 1e30, scan_near = 1e30;
+    for (int run = 0; run < 5; run++) {
+        start = now_seconds();
+        size_t near = student_indexes_near_graduation(&indexes, 30, NULL, 0);
+        double middle = now_seconds();
+        size_t scanned_near = student_store_count_credits_at_least(
+            &store, STUDENT_CREDITS_TO_GRADUATE - 30);
+        double end = now_seconds();
+        if (near != scanned_near) {
+            fprintf(stderr, "Error: range counts disagree!\n");
+            return 1;
+        }
+        tree_near = middle - start < tree_near ? middle - start : tree_near;
+        scan_near = end - middle < scan_near ? end - middle : scan_near;
+    }
+    print_row("count: <= 30 credits left", tree_near * 1e9, scan_near * 1e9);
+
+    // Narrow ranges: GPA between g and g + 0.02
+    static uint32_t lows[GPA_QUERIES];
+    static size_t tree_counts[GPA_QUERIES];
+    for (int q = 0; q < GPA_QUERIES; q++) {
+        lows[q] = next_random() % 399;
+    }
+    start = now_seconds();
+    for (int q = 0; q < GPA_QUERIES; q++) {
+        student_btree_cursor_t cursor;
+        uint64_t key;
+        size_t count = 0;
+        student_btree_seek(&indexes.by_gpa, lows[q], lows[q] + 2, &cursor);
+        while (student_btree_next(&cursor, &key)) {
+            count += STUDENT_BTREE_ROW(key) < store.count;
+        }
+        tree_counts[q] = count;
+    }
+    double tree_gpa = (now_seconds() - start) / GPA_QUERIES;
+    // Scanning is so slow that only a few queries are timed
+    start = now_seconds();
+    for (int q = 0; q < SCAN_LOOKUPS; q++) {
+        size_t count = 0;
+        for (size_t row = 0; row < store.count; row++) {
+            uint16_t gpa = store.gpa_hundredths[row];
+            count += gpa >= lows[q] && gpa <= lows[q] + 2;
+        }
+        if (count != tree_counts[q]) {
+            fprintf(stderr, "Error: GPA range counts disagree!\n");
+            return 1;
+        }
+    }
+    double scan_gpa = (now_seconds() - start) / SCAN_LOOKUPS;
+    print_row("rows: GPA in [g, g + 0.02]", tree_gpa * 1e9, scan_gpa * 1e9);
+
+    // --- Batched updates ---
+    student_record_t *updates = malloc(UPDATES * sizeof(student_record_t));
+    if (updates == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < UPDATES; i++) {
+        // About 1 in 100 updates is a new student
+        size_t row = i % 100 == 0 ? n + i : next_random() % n;
+        updates[i] = random_student(id_for(row));
+    }
+    start = now_seconds();
+    for (size_t i = 0; i < UPDATES; i += UPDATE_BATCH) {
+        size_t batch = UPDATES - i < UPDATE_BATCH ? UPDATES - i : UPDATE_BATCH;
+        if (student_indexes_apply(&indexes, &store, &updates[i], batch) !=
+            batch) {
+            fprintf(stderr, "Error: update batch failed\n");
+            return 1;
+        }
+    }
+    double update_seconds = now_seconds() - start;
+    start = now_seconds();
+    int consistent = student_indexes_check(&indexes, &store);
+    printf("\nUpdates: %d in batches of %d, %.0f updates/s; "
+           "indexes %s (checked in %.2f s)\n",
+           UPDATES, UPDATE_BATCH, UPDATES / update_seconds,
+           consistent ? "consistent" : "INCONSISTENT",
+           now_seconds() - start);
+
+    free(updates);
+    free(ids);
+    free(rows);
+    student_indexes_free(&indexes);
+    student_store_free(&store);
+    return consistent ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    size_t default_sizes[] = {1000000, 10000000, 100000000};
+
+    printf("=== STUDENT INDEX BENCHMARK ===\n");
+    if (argc >= 2) {
+        for (int i = 1; i < argc; i++) {
+            if (run(strtoul(argv[i], NULL, 10)) != 0) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]);
+         i++) {
+        if (run(default_sizes[i]) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
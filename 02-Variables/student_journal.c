@@ -0,0 +1,494 @@
+/**
+ * @file student_journal.c
+ * @brief Delta encoding, group commit and replay for the student journal
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "student_journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define JOURNAL_MAGIC "STUJRNL1"
+#define JOURNAL_MAGIC_SIZE 8
+
+// Frame header: payload length and checksum
+#define FRAME_HEADER_SIZE 8
+
+// Largest encoded update: mask, ID, all fields, 64-bit tuition change
+#define MAX_RECORD_SIZE 32
+
+// Which fields a delta record carries
+enum {
+    FIELD_INITIAL = 1 << 0,
+    FIELD_AGE = 1 << 1,
+    FIELD_GPA = 1 << 2,
+    FIELD_CREDITS = 1 << 3,
+    FIELD_GRADE = 1 << 4,
+    FIELD_TUITION = 1 << 5,
+    RECORD_NEW_STUDENT = 1 << 6,    // All fields, tuition not a change
+    FIELD_ALL = 0x3F
+};
+
+// --- CRC-32C (Castagnoli), one table lookup per byte ---
+
+static uint32_t crc_table[256];
+
+static void build_crc_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+        }
+        crc_table[i] = crc;
+    }
+}
+
+static uint32_t crc32c(const unsigned char *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFFu;
+
+    if (crc_table[1] == 0) {
+        build_crc_table();
+    }
+    for (size_t i = 0; i < length; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// --- Variable-length numbers: 7 bits per byte, top bit = more follow ---
+
+static unsigned char *put_varint(unsigned char *p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (unsigned char)value;
+    return p;
+}
+
+static const unsigned char *get_varint(const unsigned char *p,
+                                       const unsigned char *end,
+                                       uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        unsigned char byte = *p++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Small negative numbers become small unsigned ones: 0, -1, 1, -2, ...
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int write_all(int fd, const unsigned char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Encodes the change from before to after
+ * @param before Current fields, or NULL for a new student
+ * @return Pointer just past the record
+ */
+static unsigned char *encode_update(unsigned char *p,
+                                    const student_record_t *before,
+                                    const student_record_t *after) {
+    unsigned mask = RECORD_NEW_STUDENT | FIELD_ALL;
+    int64_t tuition = after->tuition_cents;
+
+    if (before != NULL) {
+        mask = (before->initial != after->initial ? FIELD_INITIAL : 0) |
+               (before->age != after->age ? FIELD_AGE : 0) |
+               (before->gpa_hundredths != after->gpa_hundredths ? FIELD_GPA : 0) |
+               (before->credits != after->credits ? FIELD_CREDITS : 0) |
+               (before->grade != after->grade ? FIELD_GRADE : 0) |
+               (before->tuition_cents != after->tuition_cents ? FIELD_TUITION
+                                                              : 0);
+        // Tuition changes by payments, which are smaller than balances
+        tuition -= before->tuition_cents;
+    }
+
+    *p++ = (unsigned char)mask;
+    p = put_varint(p, after->id);
+    if (mask & FIELD_INITIAL) {
+        *p++ = (unsigned char)after->initial;
+    }
+    if (mask & FIELD_AGE) {
+        *p++ = after->age;
+    }
+    if (mask & FIELD_GPA) {
+        p = put_varint(p, after->gpa_hundredths);
+    }
+    if (mask & FIELD_CREDITS) {
+        p = put_varint(p, after->credits);
+    }
+    if (mask & FIELD_GRADE) {
+        *p++ = (unsigned char)after->grade;
+    }
+    if (mask & FIELD_TUITION) {
+        p = put_varint(p, zigzag(tuition));
+    }
+    return p;
+}
+
+/**
+ * @brief Decodes one record on top of the current fields
+ * @param record In: nothing (new student) or the student's current
+ *               fields, out: the fields after the update
+ * @return Pointer past the record, or NULL if it is malformed
+ */
+static const unsigned char *decode_update(const unsigned char *p,
+                                          const unsigned char *end,
+                                          unsigned *mask, uint32_t *id,
+                                          student_record_t *record,
+                                          const student_indexes_t *indexes,
+                                          const student_store_t *store) {
+    uint64_t value;
+
+    if (p >= end) {
+        return NULL;
+    }
+    *mask = *p++;
+    p = get_varint(p, end, &value);
+    if (p == NULL || value > UINT32_MAX) {
+        return NULL;
+    }
+    *id = (uint32_t)value;
+
+    if (*mask & RECORD_NEW_STUDENT) {
+        memset(record, 0, sizeof(*record));
+    } else {
+        long row = student_indexes_find(indexes, *id);
+        if (row < 0) {
+            return NULL;  // A change to a student that does not exist
+        }
+        student_store_get(store, (size_t)row, record);
+    }
+    record->id = *id;
+
+    if (*mask & FIELD_INITIAL) {
+        if (p >= end) {
+            return NULL;
+        }
+        record->initial = (char)*p++;
+    }
+    if (*mask & FIELD_AGE) {
+        if (p >= end) {
+            return NULL;
+        }
+        record->age = *p++;
+    }
+    if (*mask & FIELD_GPA) {
+        p = get_varint(p, end, &value);
+        if (p == NULL || value > UINT16_MAX) {
+            return NULL;
+        }
+        record->gpa_hundredths = (uint16_t)value;
+    }
+    if (*mask & FIELD_CREDITS) {
+        p = get_varint(p, end, &value);
+        if (p == NULL || value > UINT16_MAX) {
+            return NULL;
+        }
+        record->credits = (uint16_t)value;
+    }
+    if (*mask & FIELD_GRADE) {
+        if (p >= end || *p >= STUDENT_GRADE_COUNT) {
+            return NULL;
+        }
+        record->grade = (student_grade_t)*p++;
+    }
+    if (*mask & FIELD_TUITION) {
+        p = get_varint(p, end, &value);
+        if (p == NULL) {
+            return NULL;
+        }
+        record->tuition_cents = (int32_t)(record->tuition_cents +
+                                          unzigzag(value));
+    }
+    return p;
+}
+
+student_journal_options_t student_journal_defaults(void) {
+    student_journal_options_t options = {256, 2000, 1};
+    return options;
+}
+
+int student_journal_replay(const char *path, student_indexes_t *indexes,
+                           student_store_t *store,
+                           student_journal_replay_t *result) {
+    struct stat info;
+
+    memset(result, 0, sizeof(*result));
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)info.st_size;
+    if (size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    const unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    size_t valid = 0;
+    int status = 0;
+    if (size < JOURNAL_MAGIC_SIZE) {
+        // The header itself was torn: start the file over
+        if (memcmp(data, JOURNAL_MAGIC, size) != 0) {
+            errno = EINVAL;
+            status = -1;
+        }
+    } else if (memcmp(data, JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE) != 0) {
+        errno = EINVAL;
+        status = -1;
+    } else {
+        valid = JOURNAL_MAGIC_SIZE;
+    }
+
+    while (status == 0 && valid > 0 && size - valid >= FRAME_HEADER_SIZE) {
+        uint32_t length, checksum;
+        memcpy(&length, data + valid, 4);
+        memcpy(&checksum, data + valid + 4, 4);
+        const unsigned char *payload = data + valid + FRAME_HEADER_SIZE;
+        if (length > size - valid - FRAME_HEADER_SIZE ||
+            crc32c(payload, length) != checksum) {
+            break;  // Torn frame: everything from here on is discarded
+        }
+
+        // A checksummed frame must decode cleanly; if not, the journal
+        // does not belong to this starting state
+        const unsigned char *p = payload;
+        const unsigned char *end = payload + length;
+        while (p < end) {
+            unsigned mask;
+            uint32_t id;
+            student_record_t record;
+            p = decode_update(p, end, &mask, &id, &record, indexes, store);
+            if (p == NULL ||
+                student_indexes_apply(indexes, store, &record, 1) != 1) {
+                errno = EINVAL;
+                status = -1;
+                break;
+            }
+            result->updates++;
+        }
+        if (status == 0) {
+            result->frames++;
+            valid += FRAME_HEADER_SIZE + length;
+        }
+    }
+    munmap((void *)data, size);
+
+    if (status == 0 && valid < size) {
+        result->discarded_bytes = size - valid;
+        if (ftruncate(fd, (off_t)valid) != 0 || fsync(fd) != 0) {
+            status = -1;
+        }
+    }
+    result->valid_bytes = valid;
+    close(fd);
+    return status;
+}
+
+int student_journal_open(student_journal_t *journal, const char *path,
+                         const student_journal_options_t *options) {
+    struct stat info;
+
+    memset(journal, 0, sizeof(*journal));
+    journal->options = *options;
+    if (journal->options.batch_updates == 0) {
+        journal->options.batch_updates = 1;
+    }
+
+    journal->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (journal->fd < 0) {
+        return -1;
+    }
+    if (fstat(journal->fd, &info) != 0 ||
+        (info.st_size == 0 &&
+         (write_all(journal->fd, (const unsigned char *)JOURNAL_MAGIC,
+                    JOURNAL_MAGIC_SIZE) != 0 ||
+          fsync(journal->fd) != 0))) {
+        close(journal->fd);
+        return -1;
+    }
+    journal->committed_size = info.st_size > 0 ? (uint64_t)info.st_size
+                                               : JOURNAL_MAGIC_SIZE;
+
+    journal->capacity = FRAME_HEADER_SIZE +
+                        journal->options.batch_updates * MAX_RECORD_SIZE;
+    if (journal->capacity < 4096) {
+        journal->capacity = 4096;
+    }
+    journal->buffer = malloc(journal->capacity);
+    if (journal->buffer == NULL) {
+        close(journal->fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    journal->used = FRAME_HEADER_SIZE;
+    return 0;
+}
+
+// Whether the oldest pending update has waited the whole window
+static int window_passed(const student_journal_t *journal) {
+    return journal->pending > 0 && journal->options.window_us > 0 &&
+           now_ns() - journal->first_pending_ns >=
+               journal->options.window_us * 1000ull;
+}
+
+int student_journal_commit(student_journal_t *journal) {
+    if (journal->error != 0) {
+        errno = journal->error;
+        return -1;
+    }
+    if (journal->pending == 0) {
+        return 0;
+    }
+    uint32_t length = (uint32_t)(journal->used - FRAME_HEADER_SIZE);
+    uint32_t checksum = crc32c(journal->buffer + FRAME_HEADER_SIZE, length);
+    memcpy(journal->buffer, &length, 4);
+    memcpy(journal->buffer + 4, &checksum, 4);
+
+    if (write_all(journal->fd, journal->buffer, journal->used) != 0 ||
+        (journal->options.sync && fdatasync(journal->fd) != 0)) {
+        // Cut off whatever part of the frame got out, and stop
+        int error = errno != 0 ? errno : EIO;
+        if (ftruncate(journal->fd, (off_t)journal->committed_size) != 0) {
+            // Stopped either way: a torn frame left behind is cut off by
+            // replay, a whole one is replayed once (never acknowledged,
+            // never repeated)
+        }
+        journal->error = error;
+        errno = error;
+        return -1;
+    }
+    journal->committed_size += journal->used;
+    journal->commits++;
+    journal->bytes += journal->used;
+    journal->used = FRAME_HEADER_SIZE;
+    journal->pending = 0;
+    return 0;
+}
+
+int student_journal_update(student_journal_t *journal,
+                           student_indexes_t *indexes, student_store_t *store,
+                           const student_record_t *updates, size_t count) {
+    if (journal->error != 0) {
+        errno = journal->error;
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        student_record_t before;
+        long row = student_indexes_find(indexes, updates[i].id);
+        if (row >= 0) {
+            student_store_get(store, (size_t)row, &before);
+        } else if (store->count == store->capacity) {
+            errno = ENOSPC;
+            return -1;
+        }
+
+        if (journal->capacity - journal->used < MAX_RECORD_SIZE) {
+            unsigned char *bigger = realloc(journal->buffer,
+                                            journal->capacity * 2);
+            if (bigger == NULL) {
+                errno = ENOMEM;
+                return -1;
+            }
+            journal->buffer = bigger;
+            journal->capacity *= 2;
+        }
+
+        // Write ahead: the record goes into the journal first...
+        size_t used = journal->used;
+        unsigned char *end = encode_update(journal->buffer + journal->used,
+                                           row >= 0 ? &before : NULL,
+                                           &updates[i]);
+        journal->used = (size_t)(end - journal->buffer);
+        if (journal->pending++ == 0) {
+            journal->first_pending_ns = now_ns();
+        }
+        journal->updates++;
+
+        // ...then the store and the indexes change
+        if (student_indexes_apply(indexes, store, &updates[i], 1) != 1) {
+            // Nothing changed, so the record must not be committed
+            journal->used = used;
+            journal->pending--;
+            journal->updates--;
+            errno = ENOMEM;
+            return -1;
+        }
+
+        if (journal->pending >= journal->options.batch_updates ||
+            window_passed(journal)) {
+            if (student_journal_commit(journal) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int student_journal_poll(student_journal_t *journal) {
+    if (journal->error != 0) {
+        errno = journal->error;
+        return -1;
+    }
+    return window_passed(journal) ? student_journal_commit(journal) : 0;
+}
+
+int student_journal_close(student_journal_t *journal) {
+    int status = student_journal_commit(journal);
+    if (close(journal->fd) != 0) {
+        status = -1;
+    }
+    free(journal->buffer);
+    journal->buffer = NULL;
+    journal->fd = -1;
+    return status;
+}
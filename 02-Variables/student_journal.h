@@ -0,0 +1,147 @@
+/**
+ * @file student_journal.h
+ * @brief Write-ahead journal for student updates, with group commit
+ *
+ * student_profile.c's semester update changes variables in memory; if
+ * the program crashes, the changes are gone. The journal writes every
+ * update to a file *before* it is applied, so after a crash the state
+ * can be rebuilt by replaying the file.
+ *
+ * Updates are stored as small binary deltas: a byte saying which
+ * fields changed, the student ID and only the changed fields, numbers
+ * in a variable-length format (small numbers take one byte). A typical
+ * semester update takes 10-15 bytes instead of a full record.
+ *
+ * Writing to the disk for real (fsync) takes milliseconds, far longer
+ * than an update. With group commit, updates collect in memory and one
+ * write + fsync makes the whole group durable at once. A group is
+ * committed when it holds batch_updates updates, when its oldest update
+ * has waited window_us microseconds, or when student_journal_commit()
+ * is called. The journal has no thread or timer of its own: the window
+ * is checked by the next student_journal_update(), or by
+ * student_journal_poll(), which a caller with no more updates coming
+ * calls from its event loop or a timer. Without either, a lone update
+ * waits. Only committed updates are guaranteed to survive a crash.
+ *
+ * File layout: an 8-byte header, then one frame per commit:
+ *
+ *     uint32 payload length | uint32 CRC-32C of payload | payload
+ *
+ * A frame that is incomplete or fails its checksum (the machine died
+ * while writing it) ends the replay, and the file is cut back to the
+ * last good frame.
+ *
+ * If a commit's write or fsync fails, the file is cut back to the end
+ * of the last good commit and the journal stops: every later update
+ * and commit fails with the same error. A commit is never retried,
+ * because a retried write would land after the bytes of the failed
+ * one, and after a failed fsync the kernel may already have dropped
+ * the data while reporting the next fsync as a success. The updates
+ * of the failed group were already applied in memory; the caller
+ * reloads and replays the journal to get back to the durable state.
+ */
+
+#ifndef STUDENT_JOURNAL_H
+#define STUDENT_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "student_index.h"
+#include "student_store.h"
+
+// Group commit settings
+typedef struct {
+    size_t batch_updates;     // Commit after this many updates (>= 1)
+    unsigned window_us;       // ... or when the oldest waited this long
+                              //     (0: no time limit)
+    int sync;                 // 1: fdatasync each commit, 0: only write
+} student_journal_options_t;
+
+typedef struct {
+    int fd;
+    student_journal_options_t options;
+    unsigned char *buffer;    // Frame being filled, header space first
+    size_t used;
+    size_t capacity;
+    size_t pending;           // Updates in the buffer
+    uint64_t first_pending_ns;
+    uint64_t committed_size;  // File length after the last good commit
+    int error;                // errno of the failure that stopped it, or 0
+    // Totals since the journal was opened
+    uint64_t updates;
+    uint64_t commits;
+    uint64_t bytes;
+} student_journal_t;
+
+// What student_journal_replay() found
+typedef struct {
+    uint64_t frames;
+    uint64_t updates;
+    uint64_t valid_bytes;     // Length of the file after replay
+    uint64_t discarded_bytes; // Torn tail that was cut off
+} student_journal_replay_t;
+
+/**
+ * @brief Default settings: commit every 256 updates or 2 ms, with fsync
+ */
+student_journal_options_t student_journal_defaults(void);
+
+/**
+ * @brief Replays a journal into a store and its indexes
+ *
+ * The store must hold the state the journal started from (for
+ * example, loaded from the same CSV file). A missing journal is not an
+ * error: there is nothing to replay. A torn tail is cut off so that
+ * new frames can be appended after the last good one.
+ *
+ * @return 0 on success, -1 on an I/O error or a bad header (errno set)
+ */
+int student_journal_replay(const char *path, student_indexes_t *indexes,
+                           student_store_t *store,
+                           student_journal_replay_t *result);
+
+/**
+ * @brief Opens (or creates) a journal for appending
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int student_journal_open(student_journal_t *journal, const char *path,
+                         const student_journal_options_t *options);
+
+/**
+ * @brief Writes updates ahead, then applies them to the store and indexes
+ *
+ * Each update is encoded as a delta against the student's current
+ * fields (a full record for a new ID) before the store changes. The
+ * group is committed whenever the batch size or time window is reached.
+ * An update that cannot be applied (the store is full, memory runs
+ * out) is taken back out of the journal; the updates before it stay.
+ *
+ * @return 0 on success, -1 on an I/O error, if the store is full or
+ *         memory runs out, or if an earlier commit failed (errno is set)
+ */
+int student_journal_update(student_journal_t *journal,
+                           student_indexes_t *indexes, student_store_t *store,
+                           const student_record_t *updates, size_t count);
+
+/**
+ * @brief Makes every update so far durable: one write and one fsync
+ * @return 0 on success, -1 on an I/O error now or in an earlier commit
+ *         (errno is set)
+ */
+int student_journal_commit(student_journal_t *journal);
+
+/**
+ * @brief Commits the pending group if its oldest update has waited
+ *        window_us microseconds; call it while no updates arrive
+ * @return 0 if nothing was due or the commit succeeded, -1 on an I/O
+ *         error now or in an earlier commit (errno is set)
+ */
+int student_journal_poll(student_journal_t *journal);
+
+/**
+ * @brief Commits what is pending and closes the file
+ */
+int student_journal_close(student_journal_t *journal);
+
+#endif // STUDENT_JOURNAL_H
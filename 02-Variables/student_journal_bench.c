@@ -0,0 +1,398 @@
+/**
+ * @file student_journal_bench.c
+ * @brief Group-commit throughput and crash recovery for the journal
+ *
+ * Throughput: applies end-of-semester updates to 100,000 students
+ * through the journal with group sizes from 1 to 4096 and reports
+ * updates per second, fsyncs per second and bytes per update. Each
+ * journal is then replayed onto a fresh copy of the starting state and
+ * must rebuild exactly the same store.
+ *
+ * Crash test (--crash-test): a child process applies updates and
+ * reports every commit through a pipe. After every 1000 updates it
+ * pauses, and student_journal_poll() must commit what is waiting. The
+ * parent kills it with SIGKILL at a random moment, sometimes adds a
+ * torn half-written frame to the file, replays the journal and checks
+ * that the result is the starting state plus exactly the first K
+ * updates, with K at least the number of updates the child saw
+ * committed.
+ *
+ * Every third round the disk "fills up" instead: the child's file size
+ * limit (RLIMIT_FSIZE) cuts a commit's write short. The child must see
+ * that commit fail and every later update and commit rejected, and the
+ * replay must find exactly the acknowledged updates, with no partial
+ * frame left in the file.
+ *
+ * Usage: ./student_journal_bench [journal_path]
+ *        ./student_journal_bench --crash-test [rounds] [journal_path]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "student_journal.h"
+
+#define DEFAULT_PATH "/tmp/student_journal_bench.wal"
+#define STUDENTS 100000
+#define MAX_UPDATES 2000000
+#define SECONDS_PER_SETTING 1.0
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_state;
+static uint32_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return (uint32_t)(random_state >> 16);
+}
+
+static uint32_t id_for(size_t row) {
+    return (uint32_t)(row * 2654435761u + 1000);
+}
+
+// The same starting students every time
+static int build_start(student_store_t *store, student_indexes_t *indexes) {
+    if (student_store_init(store, STUDENTS + MAX_UPDATES / 50) != 0) {
+        return -1;
+    }
+    random_state = 12345;
+    for (size_t row = 0; row < STUDENTS; row++) {
+        student_record_t record = {id_for(row), (char)('A' + next_random() % 26),
+                                   (uint8_t)(17 + next_random() % 10),
+                                   (uint16_t)(next_random() % 401),
+                                   (uint16_t)(next_random() % 120),
+                                   (student_grade_t)(next_random() % 5),
+                                   (int32_t)(next_random() % 2000000)};
+        student_store_append(store, &record);
+    }
+    return student_indexes_build(indexes, store);
+}
+
+/**
+ * @brief Update number i of the stream (call with i = 0, 1, 2, ... in
+ *        order after seeding random_state)
+ *
+ * Like the semester update in student_profile.c: a birthday now and
+ * then, new GPA and credits, a grade change and a tuition payment.
+ * One update in 100 enrolls a new student.
+ */
+static student_record_t next_update(const student_store_t *store,
+                                    const student_indexes_t *indexes,
+                                    size_t i) {
+    student_record_t record;
+    if (i % 100 == 99) {
+        record = (student_record_t){id_for(STUDENTS + i), 'N', 18, 0, 0,
+                                    STUDENT_GRADE_C, 550000};
+        return record;
+    }
+    long row = student_indexes_find(indexes, id_for(next_random() % STUDENTS));
+    student_store_get(store, (size_t)row, &record);
+    if (next_random() % 4 == 0) {
+        record.age++;
+    }
+    record.gpa_hundredths = (uint16_t)(next_random() % 401);
+    record.credits = (uint16_t)(record.credits + 15);
+    record.grade = (student_grade_t)(next_random() % 5);
+    record.tuition_cents -= (int32_t)(next_random() % 100000);
+    return record;
+}
+
+static int stores_equal(const student_store_t *a, const student_store_t *b) {
+    size_t n = a->count;
+    return a->count == b->count &&
+           memcmp(a->id, b->id, n * sizeof(*a->id)) == 0 &&
+           memcmp(a->initial, b->initial, n) == 0 &&
+           memcmp(a->age, b->age, n) == 0 &&
+           memcmp(a->gpa_hundredths, b->gpa_hundredths, n * 2) == 0 &&
+           memcmp(a->credits, b->credits, n * 2) == 0 &&
+           memcmp(a->grade, b->grade, n) == 0 &&
+           memcmp(a->tuition_cents, b->tuition_cents, n * 4) == 0;
+}
+
+/**
+ * @brief Replays path onto a fresh starting state and compares it
+ * @return 1 if the replayed store equals expected
+ */
+static int replay_matches(const char *path, const student_store_t *expected,
+                          student_journal_replay_t *result) {
+    student_store_t store;
+    student_indexes_t indexes;
+    int ok = build_start(&store, &indexes) == 0 &&
+             student_journal_replay(path, &indexes, &store, result) == 0 &&
+             stores_equal(&store, expected) &&
+             student_indexes_check(&indexes, &store);
+    student_indexes_free(&indexes);
+    student_store_free(&store);
+    return ok;
+}
+
+static int run_throughput(const char *path) {
+    static const size_t batch_sizes[] = {1, 4, 16, 64, 256, 1024, 4096};
+    const size_t settings = sizeof(batch_sizes) / sizeof(batch_sizes[0]);
+
+    printf("=== STUDENT JOURNAL BENCHMARK ===\n");
+    printf("%d students, journal at %s\n\n", STUDENTS, path);
+    printf("%-20s %12s %10s %12s %12s %8s\n", "Group commit", "Updates/s",
+           "fsyncs/s", "Updates", "Bytes/update", "Replay");
+
+    // One extra run without fsync shows what the disk costs
+    for (size_t s = 0; s <= settings; s++) {
+        student_store_t store;
+        student_indexes_t indexes;
+        student_journal_t journal;
+        student_journal_options_t options = student_journal_defaults();
+        options.window_us = 0;
+        options.batch_updates = s < settings ? batch_sizes[s] : 256;
+        options.sync = s < settings;
+
+        unlink(path);
+        if (build_start(&store, &indexes) != 0 ||
+            student_journal_open(&journal, path, &options) != 0) {
+            perror(path);
+            return 1;
+        }
+
+        random_state = 777;
+        size_t done = 0;
+        double start = now_seconds();
+        double elapsed = 0;
+        while (done < MAX_UPDATES && elapsed < SECONDS_PER_SETTING) {
+            // Check the clock every 64 updates
+            for (int k = 0; k < 64 && done < MAX_UPDATES; k++, done++) {
+                student_record_t update = next_update(&store, &indexes, done);
+                if (student_journal_update(&journal, &indexes, &store,
+                                           &update, 1) != 0) {
+                    perror("student_journal_update");
+                    return 1;
+                }
+            }
+            elapsed = now_seconds() - start;
+        }
+        if (student_journal_close(&journal) != 0) {
+            perror("student_journal_close");
+            return 1;
+        }
+        elapsed = now_seconds() - start;
+
+        student_journal_replay_t replay;
+        int ok = replay_matches(path, &store, &replay) &&
+                 replay.updates == done;
+
+        char label[32];
+        if (options.sync) {
+            snprintf(label, sizeof(label), "%zu per fsync",
+                     options.batch_updates);
+        } else {
+            snprintf(label, sizeof(label), "no fsync (256)");
+        }
+        printf("%-20s %12.0f %10.0f %12zu %12.1f %8s\n", label,
+               done / elapsed, journal.commits / elapsed, done,
+               (double)journal.bytes / done, ok ? "ok" : "FAILED");
+
+        student_indexes_free(&indexes);
+        student_store_free(&store);
+        if (!ok) {
+            return 1;
+        }
+    }
+    unlink(path);
+    return 0;
+}
+
+// Exit status of a child whose journal stopped at a full disk as it should
+#define CHILD_STOPPED 5
+
+/**
+ * @brief Child of the crash test: update forever, report each commit
+ * @param size_limit If not 0, the most the file may grow to; the child
+ *        then exits with CHILD_STOPPED once the journal refuses updates
+ */
+static void crash_child(const char *path, int report_fd, rlim_t size_limit) {
+    student_store_t store;
+    student_indexes_t indexes;
+    student_journal_t journal;
+    student_journal_options_t options = {64, 1000, 1};
+
+    if (build_start(&store, &indexes) != 0 ||
+        student_journal_open(&journal, path, &options) != 0) {
+        _exit(2);
+    }
+    if (size_limit != 0) {
+        struct rlimit limit = {size_limit, size_limit};
+        signal(SIGXFSZ, SIG_IGN);               // Short write, then EFBIG
+        if (setrlimit(RLIMIT_FSIZE, &limit) != 0) {
+            _exit(2);
+        }
+    }
+    random_state = 999;
+    uint64_t commits = 0;
+    for (size_t i = 0; i < MAX_UPDATES; i++) {
+        student_record_t update = next_update(&store, &indexes, i);
+        int status = student_journal_update(&journal, &indexes, &store,
+                                            &update, 1);
+        // Now and then go quiet for two windows: poll must commit the rest
+        if (status == 0 && i % 1000 == 999) {
+            struct timespec quiet = {0, 2 * options.window_us * 1000L};
+            nanosleep(&quiet, NULL);
+            status = student_journal_poll(&journal);
+            if (status == 0 && journal.pending != 0) {
+                _exit(6);
+            }
+        }
+        if (status != 0) {
+            // After a failed commit, nothing more may get through
+            int stopped = size_limit != 0 && journal.error != 0 &&
+                          student_journal_update(&journal, &indexes, &store,
+                                                 &update, 1) != 0 &&
+                          student_journal_commit(&journal) != 0;
+            _exit(stopped ? CHILD_STOPPED : 3);
+        }
+        if (journal.commits != commits) {
+            commits = journal.commits;
+            uint64_t durable = journal.updates - journal.pending;
+            if (write(report_fd, &durable, sizeof(durable)) < 0) {
+                _exit(4);
+            }
+        }
+    }
+    _exit(0);
+}
+
+static int run_crash_test(const char *path, int rounds) {
+    printf("=== STUDENT JOURNAL CRASH TEST ===\n");
+    srand((unsigned)time(NULL));
+
+    for (int round = 1; round <= rounds; round++) {
+        int pipe_fds[2];
+        unlink(path);
+        if (pipe(pipe_fds) != 0) {
+            perror("pipe");
+            return 1;
+        }
+        pid_t child = fork();
+        if (child < 0) {
+            perror("fork");
+            return 1;
+        }
+        // Every third round, the disk fills up after 4-260 KB
+        int full = round % 3 == 0;
+        rlim_t size_limit = full ? (rlim_t)(4096 + rand() % (256 * 1024)) : 0;
+        if (child == 0) {
+            close(pipe_fds[0]);
+            crash_child(path, pipe_fds[1], size_limit);
+        }
+        close(pipe_fds[1]);
+
+        int status = 0;
+        if (full) {
+            waitpid(child, &status, 0);
+        } else {
+            // Let it run for 100-600 ms, then pull the plug
+            struct timespec pause = {0, (100 + rand() % 500) * 1000000L};
+            nanosleep(&pause, NULL);
+            kill(child, SIGKILL);
+            waitpid(child, &status, 0);
+        }
+
+        uint64_t acknowledged = 0, value;
+        while (read(pipe_fds[0], &value, sizeof(value)) == sizeof(value)) {
+            acknowledged = value;
+        }
+        close(pipe_fds[0]);
+
+        // Every other round, pretend the last write was cut short
+        int torn = !full && round % 2 == 0;
+        if (torn) {
+            unsigned char garbage[37];
+            uint32_t length = 1000;
+            for (size_t i = 0; i < sizeof(garbage); i++) {
+                garbage[i] = (unsigned char)rand();
+            }
+            memcpy(garbage, &length, sizeof(length));
+            int fd = open(path, O_WRONLY | O_APPEND);
+            if (fd < 0 || write(fd, garbage, sizeof(garbage)) < 0) {
+                perror(path);
+                return 1;
+            }
+            close(fd);
+        }
+
+        // What the state must be: the start plus the first K updates
+        student_store_t scratch;
+        student_indexes_t scratch_indexes;
+        student_journal_replay_t replay;
+        if (build_start(&scratch, &scratch_indexes) != 0 ||
+            student_journal_replay(path, &scratch_indexes, &scratch,
+                                   &replay) != 0) {
+            fprintf(stderr, "Error: replay failed: %s\n", strerror(errno));
+            return 1;
+        }
+        student_store_t expected;
+        student_indexes_t expected_indexes;
+        if (build_start(&expected, &expected_indexes) != 0) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 1;
+        }
+        random_state = 999;
+        for (uint64_t i = 0; i < replay.updates; i++) {
+            student_record_t update = next_update(&expected, &expected_indexes,
+                                                  (size_t)i);
+            student_indexes_apply(&expected_indexes, &expected, &update, 1);
+        }
+
+        int ok = replay.updates >= acknowledged &&
+                 stores_equal(&scratch, &expected) &&
+                 student_indexes_check(&scratch_indexes, &scratch);
+        if (!full) {
+            ok = ok && WIFSIGNALED(status);     // Not stopped by an error
+        } else {
+            // Stopped cleanly: the failed frame was cut off, not replayed
+            ok = ok && WIFEXITED(status) &&
+                 WEXITSTATUS(status) == CHILD_STOPPED &&
+                 replay.updates == acknowledged &&
+                 replay.discarded_bytes == 0;
+        }
+        printf("Round %2d: committed %7llu, recovered %7llu in %5llu frames, "
+               "cut %3llu torn bytes%s  %s\n",
+               round, (unsigned long long)acknowledged,
+               (unsigned long long)replay.updates,
+               (unsigned long long)replay.frames,
+               (unsigned long long)replay.discarded_bytes,
+               torn ? " (torn)" : full ? " (full)" : "       ",
+               ok ? "ok" : "FAILED");
+
+        student_indexes_free(&scratch_indexes);
+        student_store_free(&scratch);
+        student_indexes_free(&expected_indexes);
+        student_store_free(&expected);
+        if (!ok) {
+            return 1;
+        }
+    }
+    unlink(path);
+    printf("All rounds recovered every committed update\n");
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--crash-test") == 0) {
+        int rounds = argc >= 3 ? atoi(argv[2]) : 10;
+        return run_crash_test(argc >= 4 ? argv[3] : DEFAULT_PATH, rounds);
+    }
+    return run_throughput(argc >= 2 ? argv[1] : DEFAULT_PATH);
+}
@@ -1,59 +1,77 @@
 /*
  * Student Profile Example
  * A complete example showing how to use variables for real-world data
+ *
+ * The profile is collected in one output buffer (see common/outbuf.h),
+ * with the numbers formatted by common/fmt.h, and written with a single
+ * system call at the end. Money is kept in money_t (common/money.h), in
+ * exact cents rather than float.
  */
 
-#include <stdio.h>
+#include <unistd.h>
+
+#include "money.h"
+#include "outbuf.h"
 
 int main() {
+    static char screen[2048];
+    outbuf_t out;
+    outbuf_init(&out, STDOUT_FILENO, screen, sizeof(screen));
+
     // Student information using different variable types
     char initial = 'S';        // First initial
     int age = 19;             // Age in years
     float gpa = 3.75;         // Grade Point Average
     int creditsCompleted = 45; // Credits completed
     char letterGrade = 'B';    // Current grade
-    float tuitionOwed = 5500.00; // Tuition balance
+    money_t tuitionOwed = money_from_cents(550000); // Tuition balance, $5500.00
+    char money_text[MONEY_TEXT_MAX];
     
     // Display student profile
-    printf("╔═══════════════════════════════╗\n");
-    printf("║        STUDENT PROFILE        ║\n");
-    printf("╚═══════════════════════════════╝\n");
-    printf("\nPersonal Information:\n");
-    printf("  Initial: %c\n", initial);
-    printf("  Age: %d years old\n", age);
+    outbuf_text(&out, "╔═══════════════════════════════╗\n");
+    outbuf_text(&out, "║        STUDENT PROFILE        ║\n");
+    outbuf_text(&out, "╚═══════════════════════════════╝\n");
+    outbuf_text(&out, "\nPersonal Information:\n");
+    outbuf_printf(&out, "  Initial: %c\n", initial);
+    outbuf_printf(&out, "  Age: %d years old\n", age);
     
-    printf("\nAcademic Information:\n");
-    printf("  Current GPA: %.2f\n", gpa);
-    printf("  Credits Completed: %d\n", creditsCompleted);
-    printf("  Current Grade: %c\n", letterGrade);
+    outbuf_text(&out, "\nAcademic Information:\n");
+    outbuf_printf(&out, "  Current GPA: %.2f\n", gpa);
+    outbuf_printf(&out, "  Credits Completed: %d\n", creditsCompleted);
+    outbuf_printf(&out, "  Current Grade: %c\n", letterGrade);
     
-    printf("\nFinancial Information:\n");
-    printf("  Tuition Balance: $%.2f\n", tuitionOwed);
+    outbuf_text(&out, "\nFinancial Information:\n");
+    money_format(money_text, tuitionOwed);
+    outbuf_printf(&out, "  Tuition Balance: $%s\n", money_text);
     
     // Simulate end of semester updates
-    printf("\n" "═" "═" "═" " END OF SEMESTER UPDATE " "═" "═" "═" "\n");
+    outbuf_text(&out, "\n" "═" "═" "═" " END OF SEMESTER UPDATE " "═" "═" "═" "\n");
     
     // Update values
     age = 20;                 // Birthday!
     gpa = 3.80;              // Improved GPA
     creditsCompleted = 60;    // Completed more credits
     letterGrade = 'A';        // Better grade
-    tuitionOwed = 3200.00;    // Paid some tuition
+    tuitionOwed = money_from_cents(320000); // Paid some tuition
     
-    printf("\nUpdated Profile:\n");
-    printf("  Age: %d years old (Happy Birthday!)\n", age);
-    printf("  New GPA: %.2f (Great improvement!)\n", gpa);
-    printf("  Credits Completed: %d\n", creditsCompleted);
-    printf("  New Grade: %c (Excellent work!)\n", letterGrade);
-    printf("  Tuition Balance: $%.2f\n", tuitionOwed);
+    outbuf_text(&out, "\nUpdated Profile:\n");
+    outbuf_printf(&out, "  Age: %d years old (Happy Birthday!)\n", age);
+    outbuf_printf(&out, "  New GPA: %.2f (Great improvement!)\n", gpa);
+    outbuf_printf(&out, "  Credits Completed: %d\n", creditsCompleted);
+    outbuf_printf(&out, "  New Grade: %c (Excellent work!)\n", letterGrade);
+    money_format(money_text, tuitionOwed);
+    outbuf_printf(&out, "  Tuition Balance: $%s\n", money_text);
     
     // Calculate some derived information
     int creditsRemaining = 120 - creditsCompleted;  // Assuming 120 total credits needed
-    float amountPaid = 5500.00 - tuitionOwed;
+    money_t amountPaid;
+    money_sub(money_from_cents(550000), tuitionOwed, &amountPaid); // Exact
     
-    printf("\nCalculated Information:\n");
-    printf("  Credits remaining to graduate: %d\n", creditsRemaining);
-    printf("  Amount paid this semester: $%.2f\n", amountPaid);
+    outbuf_text(&out, "\nCalculated Information:\n");
+    outbuf_printf(&out, "  Credits remaining to graduate: %d\n", creditsRemaining);
+    money_format(money_text, amountPaid);
+    outbuf_printf(&out, "  Amount paid this semester: $%s\n", money_text);
     
-    return 0;
+    // Everything above reaches the screen here, in one write()
+    return outbuf_flush(&out) == 0 ? 0 : 1;
 }
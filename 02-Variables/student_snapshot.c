@@ -0,0 +1,370 @@
+/**
+ * @file student_snapshot.c
+ * @brief Copy-on-write versions, published by pointer, freed by epoch
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "student_snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Chunks start on their own cache line
+#define CHUNK_ALIGNMENT 64
+
+static student_chunk_t *chunk_new(void) {
+    return aligned_alloc(CHUNK_ALIGNMENT, sizeof(student_chunk_t));
+}
+
+// A chunk for a copy: a reclaimed one if there is one
+static student_chunk_t *chunk_reuse(student_snapshots_t *snapshots) {
+    if (snapshots->spare_count > 0) {
+        return snapshots->spare[--snapshots->spare_count];
+    }
+    return chunk_new();
+}
+
+static void chunk_release(student_snapshots_t *snapshots,
+                          student_chunk_t *chunk) {
+    if (snapshots->spare_count < STUDENT_SPARE_CHUNKS) {
+        snapshots->spare[snapshots->spare_count++] = chunk;
+    } else {
+        free(chunk);
+    }
+}
+
+// Students in chunk c (only the last chunk can be partly used)
+static size_t chunk_students(const student_snapshot_t *snapshot, size_t c) {
+    size_t start = c * STUDENT_CHUNK;
+    return snapshot->count - start < STUDENT_CHUNK ? snapshot->count - start
+                                                   : STUDENT_CHUNK;
+}
+
+static student_snapshot_t *snapshot_new(size_t chunk_count) {
+    return malloc(sizeof(student_snapshot_t) +
+                  chunk_count * sizeof(student_chunk_t *));
+}
+
+static void snapshot_free_all(student_snapshot_t *snapshot) {
+    for (size_t c = 0; c < snapshot->chunk_count; c++) {
+        free(snapshot->chunks[c]);
+    }
+    free(snapshot);
+}
+
+int student_snapshots_init(student_snapshots_t *snapshots,
+                           const student_store_t *store) {
+    size_t chunk_count = (store->count + STUDENT_CHUNK - 1) / STUDENT_CHUNK;
+
+    memset(snapshots, 0, sizeof(*snapshots));
+    snapshots->spare = malloc(STUDENT_SPARE_CHUNKS * sizeof(student_chunk_t *));
+    student_snapshot_t *first = snapshot_new(chunk_count);
+    if (snapshots->spare == NULL || first == NULL) {
+        free(snapshots->spare);
+        free(first);
+        return -1;
+    }
+    first->number = 1;
+    first->count = store->count;
+    first->chunk_count = 0;
+    for (size_t c = 0; c < chunk_count; c++) {
+        student_chunk_t *chunk = chunk_new();
+        if (chunk == NULL) {
+            free(snapshots->spare);
+            snapshot_free_all(first);
+            return -1;
+        }
+        first->chunks[first->chunk_count++] = chunk;
+        memset(chunk, 0, sizeof(*chunk));
+
+        size_t start = c * STUDENT_CHUNK;
+        size_t n = chunk_students(first, c);
+        memcpy(chunk->id, store->id + start, n * sizeof(*chunk->id));
+        memcpy(chunk->tuition_cents, store->tuition_cents + start,
+               n * sizeof(*chunk->tuition_cents));
+        memcpy(chunk->gpa_hundredths, store->gpa_hundredths + start,
+               n * sizeof(*chunk->gpa_hundredths));
+        memcpy(chunk->credits, store->credits + start,
+               n * sizeof(*chunk->credits));
+        memcpy(chunk->age, store->age + start, n * sizeof(*chunk->age));
+        memcpy(chunk->grade, store->grade + start, n * sizeof(*chunk->grade));
+        memcpy(chunk->initial, store->initial + start,
+               n * sizeof(*chunk->initial));
+    }
+
+    atomic_init(&snapshots->current, first);
+    atomic_init(&snapshots->epoch, 1);
+    for (int r = 0; r < STUDENT_MAX_READERS; r++) {
+        atomic_init(&snapshots->readers[r].epoch, 0);
+        atomic_init(&snapshots->readers[r].registered, 0);
+    }
+    pthread_mutex_init(&snapshots->write_lock, NULL);
+    return 0;
+}
+
+void student_snapshots_free(student_snapshots_t *snapshots) {
+    student_snapshot_t *current = atomic_load_explicit(&snapshots->current,
+                                                       memory_order_relaxed);
+    if (current == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < snapshots->retired_count; i++) {
+        free(snapshots->retired[i].memory);
+    }
+    free(snapshots->retired);
+    for (size_t i = 0; i < snapshots->spare_count; i++) {
+        free(snapshots->spare[i]);
+    }
+    free(snapshots->spare);
+    snapshot_free_all(current);
+    pthread_mutex_destroy(&snapshots->write_lock);
+    memset(snapshots, 0, sizeof(*snapshots));
+}
+
+int student_snapshots_add_reader(student_snapshots_t *snapshots) {
+    for (int r = 0; r < STUDENT_MAX_READERS; r++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&snapshots->readers[r].registered,
+                                           &expected, 1)) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+void student_snapshots_remove_reader(student_snapshots_t *snapshots,
+                                     int reader) {
+    atomic_store(&snapshots->readers[reader].epoch, 0);
+    atomic_store(&snapshots->readers[reader].registered, 0);
+}
+
+// Pin and update use sequentially consistent operations (the default
+// for atomic_load and atomic_store), which put them in one order every
+// thread agrees on. Either the writer sees a reader's epoch and keeps
+// what that reader might use, or the reader pinned after the new
+// version was published and cannot reach the old one.
+
+const student_snapshot_t *student_snapshot_pin(student_snapshots_t *snapshots,
+                                               int reader) {
+    atomic_store(&snapshots->readers[reader].epoch,
+                 atomic_load(&snapshots->epoch));
+    return atomic_load(&snapshots->current);
+}
+
+void student_snapshot_unpin(student_snapshots_t *snapshots, int reader) {
+    // Release: every read of the version is done before the slot clears
+    atomic_store_explicit(&snapshots->readers[reader].epoch, 0,
+                          memory_order_release);
+}
+
+/**
+ * @brief Frees retired memory that every pinned reader has moved past
+ */
+static void reclaim(student_snapshots_t *snapshots) {
+    uint64_t oldest = UINT64_MAX;
+    for (int r = 0; r < STUDENT_MAX_READERS; r++) {
+        uint64_t epoch = atomic_load(&snapshots->readers[r].epoch);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < snapshots->retired_count; i++) {
+        student_retired_t *retired = &snapshots->retired[i];
+        if (retired->epoch < oldest) {
+            if (retired->snapshot) {
+                free(retired->memory);
+            } else {
+                chunk_release(snapshots, retired->memory);
+            }
+            snapshots->retired_bytes -= retired->bytes;
+            snapshots->freed_versions += retired->snapshot;
+        } else {
+            snapshots->retired[kept++] = *retired;
+        }
+    }
+    snapshots->retired_count = kept;
+}
+
+static void retire(student_snapshots_t *snapshots, void *memory, size_t bytes,
+                   int snapshot, uint64_t epoch) {
+    student_retired_t *retired = &snapshots->retired[snapshots->retired_count++];
+    retired->memory = memory;
+    retired->bytes = bytes;
+    retired->snapshot = snapshot;
+    retired->epoch = epoch;
+    snapshots->retired_bytes += bytes;
+    if (snapshots->retired_bytes > snapshots->peak_retired_bytes) {
+        snapshots->peak_retired_bytes = snapshots->retired_bytes;
+    }
+}
+
+static void set_student(student_chunk_t *chunk, size_t slot,
+                        const student_record_t *record) {
+    chunk->id[slot] = record->id;
+    chunk->tuition_cents[slot] = record->tuition_cents;
+    chunk->gpa_hundredths[slot] = record->gpa_hundredths;
+    chunk->credits[slot] = record->credits;
+    chunk->age[slot] = record->age;
+    chunk->grade[slot] = (uint8_t)record->grade;
+    chunk->initial[slot] = record->initial;
+}
+
+uint64_t student_snapshots_update(student_snapshots_t *snapshots,
+                                  const student_update_t *updates,
+                                  size_t count) {
+    pthread_mutex_lock(&snapshots->write_lock);
+    // Only writers store the pointer, and they hold the lock
+    student_snapshot_t *old = atomic_load_explicit(&snapshots->current,
+                                                   memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        if (updates[i].index >= old->count) {
+            pthread_mutex_unlock(&snapshots->write_lock);
+            return 0;
+        }
+    }
+
+    // Room to retire every chunk the batch copies, plus the old version,
+    // so nothing can fail once the new version is out
+    size_t most_copies = count < old->chunk_count ? count : old->chunk_count;
+    size_t needed = snapshots->retired_count + most_copies + 1;
+    if (needed > snapshots->retired_capacity) {
+        size_t capacity = snapshots->retired_capacity * 2;
+        capacity = capacity < needed ? needed : capacity;
+        student_retired_t *grown = realloc(snapshots->retired,
+                                           capacity * sizeof(*grown));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&snapshots->write_lock);
+            return 0;
+        }
+        snapshots->retired = grown;
+        snapshots->retired_capacity = capacity;
+    }
+
+    student_snapshot_t *next = snapshot_new(old->chunk_count);
+    if (next == NULL) {
+        pthread_mutex_unlock(&snapshots->write_lock);
+        return 0;
+    }
+    next->number = old->number + 1;
+    next->count = old->count;
+    next->chunk_count = old->chunk_count;
+    memcpy(next->chunks, old->chunks,
+           old->chunk_count * sizeof(student_chunk_t *));
+
+    // Only writers move the epoch on, so it stays put until this batch
+    // is published: the chunks copied below can be retired right away
+    uint64_t epoch = atomic_load_explicit(&snapshots->epoch,
+                                          memory_order_relaxed);
+    size_t first_retired = snapshots->retired_count;
+    for (size_t i = 0; i < count; i++) {
+        size_t c = updates[i].index / STUDENT_CHUNK;
+        if (next->chunks[c] == old->chunks[c]) {
+            student_chunk_t *copy = chunk_reuse(snapshots);
+            if (copy == NULL) {
+                for (size_t undo = 0; undo < next->chunk_count; undo++) {
+                    if (next->chunks[undo] != old->chunks[undo]) {
+                        chunk_release(snapshots, next->chunks[undo]);
+                        snapshots->retired_bytes -= sizeof(student_chunk_t);
+                    }
+                }
+                snapshots->retired_count = first_retired;
+                free(next);
+                pthread_mutex_unlock(&snapshots->write_lock);
+                return 0;
+            }
+            memcpy(copy, old->chunks[c], sizeof(*copy));
+            retire(snapshots, old->chunks[c], sizeof(student_chunk_t), 0,
+                   epoch);
+            next->chunks[c] = copy;
+        }
+        set_student(next->chunks[c], updates[i].index % STUDENT_CHUNK,
+                    &updates[i].record);
+    }
+
+    atomic_store(&snapshots->current, next);
+    retire(snapshots, old,
+           sizeof(*old) + old->chunk_count * sizeof(student_chunk_t *), 1,
+           epoch);
+    // Readers pinned from here on get the new epoch and the new version
+    atomic_store(&snapshots->epoch, epoch + 1);
+    reclaim(snapshots);
+
+    uint64_t number = next->number;
+    pthread_mutex_unlock(&snapshots->write_lock);
+    return number;
+}
+
+void student_snapshot_get(const student_snapshot_t *snapshot, size_t index,
+                          student_record_t *record) {
+    const student_chunk_t *chunk = snapshot->chunks[index / STUDENT_CHUNK];
+    size_t slot = index % STUDENT_CHUNK;
+
+    record->id = chunk->id[slot];
+    record->initial = chunk->initial[slot];
+    record->age = chunk->age[slot];
+    record->gpa_hundredths = chunk->gpa_hundredths[slot];
+    record->credits = chunk->credits[slot];
+    record->grade = (student_grade_t)chunk->grade[slot];
+    record->tuition_cents = chunk->tuition_cents[slot];
+}
+
+// The scans are the store's column loops, one chunk at a time
+
+int64_t student_snapshot_total_tuition(const student_snapshot_t *snapshot) {
+    int64_t total = 0;
+
+    for (size_t c = 0; c < snapshot->chunk_count; c++) {
+        const int32_t *tuition = snapshot->chunks[c]->tuition_cents;
+        size_t n = chunk_students(snapshot, c);
+        for (size_t i = 0; i < n; i++) {
+            total += tuition[i];
+        }
+    }
+    return total;
+}
+
+void student_snapshot_grade_counts(const student_snapshot_t *snapshot,
+                                   size_t counts[STUDENT_GRADE_COUNT]) {
+    size_t a = 0, b = 0, c = 0, d = 0;
+
+    // 16-bit counters per chunk: a chunk has fewer than 65536 students
+    for (size_t k = 0; k < snapshot->chunk_count; k++) {
+        const uint8_t *grade = snapshot->chunks[k]->grade;
+        size_t n = chunk_students(snapshot, k);
+        uint16_t block_a = 0, block_b = 0, block_c = 0, block_d = 0;
+        for (size_t i = 0; i < n; i++) {
+            block_a += grade[i] == STUDENT_GRADE_A;
+            block_b += grade[i] == STUDENT_GRADE_B;
+            block_c += grade[i] == STUDENT_GRADE_C;
+            block_d += grade[i] == STUDENT_GRADE_D;
+        }
+        a += block_a;
+        b += block_b;
+        c += block_c;
+        d += block_d;
+    }
+    counts[STUDENT_GRADE_A] = a;
+    counts[STUDENT_GRADE_B] = b;
+    counts[STUDENT_GRADE_C] = c;
+    counts[STUDENT_GRADE_D] = d;
+    counts[STUDENT_GRADE_F] = snapshot->count - a - b - c - d;
+}
+
+double student_snapshot_average_gpa(const student_snapshot_t *snapshot) {
+    uint64_t total = 0;
+
+    if (snapshot->count == 0) {
+        return 0;
+    }
+    for (size_t c = 0; c < snapshot->chunk_count; c++) {
+        const uint16_t *gpa = snapshot->chunks[c]->gpa_hundredths;
+        size_t n = chunk_students(snapshot, c);
+        for (size_t i = 0; i < n; i++) {
+            total += gpa[i];
+        }
+    }
+    return (double)total / 100.0 / (double)snapshot->count;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file student_snapshot.h
+ * @brief Copy-on-write versions of the student store for lock-free reports
+ *
+ * student_profile.c's semester update changes fields in place. With
+ * millions of students and a report adding up the whole store at the
+ * same time, the report either sees half of an update (tuition moved
+ * out of one account but not yet into the other) or both sides take a
+ * lock and the update waits for the whole report to finish.
+ *
+ * Here the store is never changed in place. It is cut into chunks of
+ * STUDENT_CHUNK students, each with its own columns, and a version is
+ * an array of pointers to chunks. An update batch:
+ *
+ *   1. copies the pointer array, and every chunk the batch touches
+ *      (untouched chunks are shared with the previous version)
+ *   2. changes the copies
+ *   3. publishes the new version with one atomic pointer store
+ *
+ * A reader pins the current version and reads it for as long as it
+ * likes; it sees every update of a batch or none of them. Pinning is a
+ * store to the reader's own cache line and a load of the pointer; the
+ * writer never waits for a reader.
+ *
+ * The old pointer array and the chunks that were copied cannot be freed
+ * at once, because a reader may still be using them. They are retired
+ * with the current epoch number, and the epoch is moved on. A reader
+ * records the epoch when it pins and clears it when it unpins; anything
+ * retired before the oldest epoch a reader still holds is freed (epoch
+ * based reclamation). A reader that stays pinned only delays freeing.
+ * Freed chunks are kept for the next copies, so a steady stream of
+ * updates does not go back to malloc() for every chunk.
+ *
+ * Writers take a mutex among themselves; readers never take it.
+ */
+
+#ifndef STUDENT_SNAPSHOT_H
+#define STUDENT_SNAPSHOT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "student_store.h"
+
+// Students per chunk, the unit that is copied on write (1.9 KB)
+#define STUDENT_CHUNK 128
+
+// Freed chunks kept for reuse instead of going back to malloc()
+#define STUDENT_SPARE_CHUNKS 1024
+
+// Most reader threads that can be registered at once
+#define STUDENT_MAX_READERS 64
+
+// Columns of STUDENT_CHUNK students, laid out like student_store_t
+typedef struct {
+    uint32_t id[STUDENT_CHUNK];
+    int32_t tuition_cents[STUDENT_CHUNK];
+    uint16_t gpa_hundredths[STUDENT_CHUNK];
+    uint16_t credits[STUDENT_CHUNK];
+    uint8_t age[STUDENT_CHUNK];
+    uint8_t grade[STUDENT_CHUNK];
+    char initial[STUDENT_CHUNK];
+} student_chunk_t;
+
+// One version of the whole store; never changed once published
+typedef struct {
+    uint64_t number;            // 1 for the first version, then +1
+    size_t count;               // Students
+    size_t chunk_count;
+    student_chunk_t *chunks[];
+} student_snapshot_t;
+
+// A reader's epoch, alone on its cache line
+typedef struct {
+    _Alignas(64) _Atomic uint64_t epoch;    // 0 while not pinned
+    _Atomic int registered;
+} student_reader_slot_t;
+
+// Memory waiting for readers to move on
+typedef struct {
+    void *memory;
+    size_t bytes;
+    int snapshot;               // 1: a version's pointer array, 0: a chunk
+    uint64_t epoch;             // Epoch it was retired in
+} student_retired_t;
+
+typedef struct {
+    _Atomic(student_snapshot_t *) current;
+    _Alignas(64) _Atomic uint64_t epoch;
+    student_reader_slot_t readers[STUDENT_MAX_READERS];
+
+    // Writers only, under write_lock
+    pthread_mutex_t write_lock;
+    student_retired_t *retired;
+    size_t retired_count;
+    size_t retired_capacity;
+    size_t retired_bytes;
+    size_t peak_retired_bytes;
+    uint64_t freed_versions;
+    student_chunk_t **spare;        // Reclaimed chunks, ready for copies
+    size_t spare_count;
+} student_snapshots_t;
+
+// One change in an update batch: student `index` becomes `record`
+typedef struct {
+    size_t index;
+    student_record_t record;
+} student_update_t;
+
+/**
+ * @brief Makes version 1 from a copy of every student in the store
+ * @return 0 on success, -1 if out of memory
+ */
+int student_snapshots_init(student_snapshots_t *snapshots,
+                           const student_store_t *store);
+
+/**
+ * @brief Frees every version (no reader may be pinned)
+ */
+void student_snapshots_free(student_snapshots_t *snapshots);
+
+/**
+ * @brief Gives a reader thread its epoch slot
+ * @return Slot number for pin/unpin, or -1 if all slots are taken
+ */
+int student_snapshots_add_reader(student_snapshots_t *snapshots);
+
+/**
+ * @brief Gives a reader slot back
+ */
+void student_snapshots_remove_reader(student_snapshots_t *snapshots,
+                                     int reader);
+
+/**
+ * @brief Pins the current version; valid until student_snapshot_unpin()
+ */
+const student_snapshot_t *student_snapshot_pin(student_snapshots_t *snapshots,
+                                               int reader);
+
+/**
+ * @brief Lets the writer free what the reader's pinned version used
+ */
+void student_snapshot_unpin(student_snapshots_t *snapshots, int reader);
+
+/**
+ * @brief Applies a batch of updates as one new version
+ *
+ * Updates are applied in order, so a student can appear more than
+ * once. Readers see either all of the batch or none of it. Afterwards,
+ * memory no reader can reach any more is freed.
+ *
+ * @return Number of the new version, or 0 if an index is out of range
+ *         or memory runs out (nothing is changed then)
+ */
+uint64_t student_snapshots_update(student_snapshots_t *snapshots,
+                                  const student_update_t *updates,
+                                  size_t count);
+
+/**
+ * @brief Copies student `index` out of a version
+ */
+void student_snapshot_get(const student_snapshot_t *snapshot, size_t index,
+                          student_record_t *record);
+
+/**
+ * @brief Total tuition owed in a version, in cents
+ */
+int64_t student_snapshot_total_tuition(const student_snapshot_t *snapshot);
+
+/**
+ * @brief Number of students with each grade in a version
+ */
+void student_snapshot_grade_counts(const student_snapshot_t *snapshot,
+                                   size_t counts[STUDENT_GRADE_COUNT]);
+
+/**
+ * @brief Mean GPA in a version (0 if it has no students)
+ */
+double student_snapshot_average_gpa(const student_snapshot_t *snapshot);
+
+#endif // STUDENT_SNAPSHOT_H
@@ -0,0 +1,493 @@
+/**
+ * @file student_snapshot_bench.c
+ * @brief Reports during semester updates: snapshots vs a reader-writer lock
+ *
+ * One writer thread applies end-of-semester update batches to a million
+ * students, BATCHES_PER_SECOND of them, while 1, 2, 4 ... reader threads run
+ * reports over the whole store (total tuition, grade counts, mean GPA).
+ * Every batch moves tuition between pairs of students, so the total
+ * never changes: a report that sees part of a batch gets the wrong
+ * total and is counted as torn.
+ *
+ * Three ways to share the store:
+ *
+ *   - rwlock, readers first: pthread_rwlock_t around one student store
+ *     (glibc's default: a writer waits while any reader holds the lock)
+ *   - rwlock, writer first: the same, but new readers queue behind a
+ *     waiting writer
+ *   - snapshots: student_snapshot.h, no lock between readers and writer
+ *
+ * For each one: reports per second, update batches per second, and the
+ * time from when a batch was due until readers could see it (p50, p99,
+ * max). A writer that falls behind schedule counts the lag as well, so
+ * a writer locked out by readers shows up in both columns.
+ * After every run the final store must equal the writer's own copy.
+ *
+ * Usage: ./student_snapshot_bench [students] [max_readers]
+ *        (default 1000000, 4)
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "student_snapshot.h"
+
+#define SECONDS_PER_RUN 1.0
+
+// Updates per batch: BATCH / 2 tuition transfers
+#define BATCH 64
+
+// Update batches the writer is asked to apply each second
+#define BATCHES_PER_SECOND 2000
+
+// Batch latencies kept per run
+#define MAX_BATCHES ((size_t)(BATCHES_PER_SECOND * SECONDS_PER_RUN) + 1)
+
+typedef enum {
+    MODE_RWLOCK_READERS,
+    MODE_RWLOCK_WRITER,
+    MODE_SNAPSHOTS,
+    MODE_COUNT
+} mode_t_;
+
+static const char *MODE_NAMES[MODE_COUNT] = {
+    "rwlock, readers first", "rwlock, writer first", "snapshots"
+};
+
+typedef struct {
+    _Alignas(64) uint64_t reports;
+    uint64_t torn;
+} reader_local_t;
+
+typedef struct {
+    mode_t_ mode;
+    size_t students;
+    int64_t expected_total;
+
+    // The store, shared one of two ways
+    pthread_rwlock_t lock;
+    student_store_t store;
+    student_snapshots_t snapshots;
+
+    // Threads wait here until all have started (or one could not)
+    pthread_mutex_t gate;
+    pthread_cond_t started;
+    int go;
+    int cancelled;
+    _Atomic int stop;
+
+    reader_local_t *readers;
+
+    // Writer results
+    student_record_t *shadow;       // What the store must end up as
+    uint64_t *latencies_ns;
+    size_t batches;
+    int writer_failed;
+} bench_t;
+
+typedef struct {
+    bench_t *bench;
+    int index;
+} reader_arg_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Waits until every thread is running
+ * @return 1 if the run was called off instead
+ */
+static int wait_for_start(bench_t *bench) {
+    pthread_mutex_lock(&bench->gate);
+    while (!bench->go) {
+        pthread_cond_wait(&bench->started, &bench->gate);
+    }
+    int cancelled = bench->cancelled;
+    pthread_mutex_unlock(&bench->gate);
+    return cancelled;
+}
+
+static void *reader_main(void *arg) {
+    reader_arg_t *self = arg;
+    bench_t *bench = self->bench;
+    reader_local_t *local = &bench->readers[self->index];
+    int slot = -1;
+
+    if (wait_for_start(bench)) {
+        return NULL;
+    }
+    if (bench->mode == MODE_SNAPSHOTS) {
+        slot = student_snapshots_add_reader(&bench->snapshots);
+    }
+    while (!atomic_load_explicit(&bench->stop, memory_order_relaxed)) {
+        size_t counts[STUDENT_GRADE_COUNT];
+        int64_t total;
+        double gpa;
+        size_t students;
+
+        if (bench->mode == MODE_SNAPSHOTS) {
+            const student_snapshot_t *snapshot =
+                student_snapshot_pin(&bench->snapshots, slot);
+            total = student_snapshot_total_tuition(snapshot);
+            student_snapshot_grade_counts(snapshot, counts);
+            gpa = student_snapshot_average_gpa(snapshot);
+            students = snapshot->count;
+            student_snapshot_unpin(&bench->snapshots, slot);
+        } else {
+            pthread_rwlock_rdlock(&bench->lock);
+            total = student_store_total_tuition(&bench->store);
+            student_store_grade_counts(&bench->store, counts);
+            gpa = student_store_average_gpa(&bench->store);
+            students = bench->store.count;
+            pthread_rwlock_unlock(&bench->lock);
+        }
+
+        size_t graded = 0;
+        for (int g = 0; g < STUDENT_GRADE_COUNT; g++) {
+            graded += counts[g];
+        }
+        local->reports++;
+        local->torn += total != bench->expected_total || graded != students ||
+                       gpa < 0.0 || gpa > 4.0;
+    }
+    if (slot >= 0) {
+        student_snapshots_remove_reader(&bench->snapshots, slot);
+    }
+    return NULL;
+}
+
+static void *writer_main(void *arg) {
+    bench_t *bench = arg;
+    student_update_t updates[BATCH];
+    uint64_t rng = 0x5eed5eed5eedull;
+
+    if (wait_for_start(bench)) {
+        return NULL;
+    }
+    uint64_t due = now_ns();
+    while (!atomic_load_explicit(&bench->stop, memory_order_relaxed) &&
+           bench->batches < MAX_BATCHES) {
+        // Tuition payments moved from one student's account to another's,
+        // with the semester's new credits and GPA for the receiver
+        for (int u = 0; u < BATCH; u += 2) {
+            size_t from = xorshift64(&rng) % bench->students;
+            size_t to = xorshift64(&rng) % bench->students;
+            int32_t amount = (int32_t)(xorshift64(&rng) % 10000);
+            student_record_t *payer = &bench->shadow[from];
+            student_record_t *payee = &bench->shadow[to];
+
+            payer->tuition_cents -= amount;
+            updates[u].index = from;
+            updates[u].record = *payer;
+            payee->tuition_cents += amount;
+            payee->credits = (uint16_t)(payee->credits % 150 + 3);
+            payee->gpa_hundredths = (uint16_t)(xorshift64(&rng) % 401);
+            updates[u + 1].index = to;
+            updates[u + 1].record = *payee;
+        }
+
+        if (now_ns() < due) {
+            struct timespec until = { (time_t)(due / 1000000000ull),
+                                      (long)(due % 1000000000ull) };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+        }
+        if (bench->mode == MODE_SNAPSHOTS) {
+            if (student_snapshots_update(&bench->snapshots, updates,
+                                         BATCH) == 0) {
+                bench->writer_failed = 1;
+                break;
+            }
+        } else {
+            pthread_rwlock_wrlock(&bench->lock);
+            for (int u = 0; u < BATCH; u++) {
+                student_store_set(&bench->store, updates[u].index,
+                                  &updates[u].record);
+            }
+            pthread_rwlock_unlock(&bench->lock);
+        }
+        bench->latencies_ns[bench->batches++] = now_ns() - due;
+        due += 1000000000ull / BATCHES_PER_SECOND;
+    }
+    return NULL;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const uint64_t *sorted, size_t count, double p) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t i = (size_t)(p * (double)(count - 1));
+    return (double)sorted[i] / 1e3;
+}
+
+/**
+ * @brief Checks the final store against the writer's copy
+ * @return Number of students that differ
+ */
+static size_t count_mismatches(bench_t *bench) {
+    size_t wrong = 0;
+    const student_snapshot_t *snapshot = NULL;
+    int slot = -1;
+
+    if (bench->mode == MODE_SNAPSHOTS) {
+        slot = student_snapshots_add_reader(&bench->snapshots);
+        snapshot = student_snapshot_pin(&bench->snapshots, slot);
+    }
+    for (size_t i = 0; i < bench->students; i++) {
+        student_record_t record;
+        if (snapshot != NULL) {
+            student_snapshot_get(snapshot, i, &record);
+        } else {
+            student_store_get(&bench->store, i, &record);
+        }
+        const student_record_t *want = &bench->shadow[i];
+        wrong += record.id != want->id ||
+                 record.tuition_cents != want->tuition_cents ||
+                 record.credits != want->credits ||
+                 record.gpa_hundredths != want->gpa_hundredths ||
+                 record.grade != want->grade;
+    }
+    if (slot >= 0) {
+        student_snapshot_unpin(&bench->snapshots, slot);
+        student_snapshots_remove_reader(&bench->snapshots, slot);
+    }
+    return wrong;
+}
+
+/**
+ * @brief One run: the writer and `readers` reader threads for a second
+ * @return Number of failed checks, or -1 if the run cannot start
+ */
+static int run(bench_t *bench, const student_store_t *initial, mode_t_ mode,
+               int readers) {
+    bench->mode = mode;
+    bench->batches = 0;
+    bench->writer_failed = 0;
+    bench->go = 0;
+    bench->cancelled = 0;
+    atomic_store(&bench->stop, 0);
+    memset(bench->readers, 0, (size_t)readers * sizeof(reader_local_t));
+    for (size_t i = 0; i < bench->students; i++) {
+        student_store_get(initial, i, &bench->shadow[i]);
+    }
+
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(
+        &attr, mode == MODE_RWLOCK_WRITER
+                   ? PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP
+                   : PTHREAD_RWLOCK_PREFER_READER_NP);
+    pthread_rwlock_init(&bench->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    if (mode == MODE_SNAPSHOTS) {
+        if (student_snapshots_init(&bench->snapshots, initial) != 0) {
+            pthread_rwlock_destroy(&bench->lock);
+            return -1;
+        }
+    } else {
+        if (student_store_init(&bench->store, bench->students) != 0) {
+            pthread_rwlock_destroy(&bench->lock);
+            return -1;
+        }
+        for (size_t i = 0; i < bench->students; i++) {
+            student_store_append(&bench->store, &bench->shadow[i]);
+        }
+    }
+
+    pthread_t writer;
+    pthread_t *ids = malloc((size_t)readers * sizeof(pthread_t));
+    reader_arg_t *args = malloc((size_t)readers * sizeof(reader_arg_t));
+    int started = 0;
+    int writer_started = 0;
+    int status = ids != NULL && args != NULL ? 0 : -1;
+    for (int r = 0; r < readers && status == 0; r++) {
+        args[r].bench = bench;
+        args[r].index = r;
+        if (pthread_create(&ids[r], NULL, reader_main, &args[r]) != 0) {
+            status = -1;
+        } else {
+            started++;
+        }
+    }
+    if (status == 0) {
+        if (pthread_create(&writer, NULL, writer_main, bench) != 0) {
+            status = -1;
+        } else {
+            writer_started = 1;
+        }
+    }
+
+    pthread_mutex_lock(&bench->gate);
+    bench->go = 1;
+    bench->cancelled = status != 0;
+    pthread_cond_broadcast(&bench->started);
+    pthread_mutex_unlock(&bench->gate);
+
+    double start = now_seconds();
+    if (status == 0) {
+        struct timespec pause = { (time_t)SECONDS_PER_RUN,
+                                  (long)((SECONDS_PER_RUN -
+                                          (time_t)SECONDS_PER_RUN) * 1e9) };
+        nanosleep(&pause, NULL);
+    }
+    atomic_store(&bench->stop, 1);
+    if (writer_started) {
+        pthread_join(writer, NULL);
+    }
+    for (int r = 0; r < started; r++) {
+        pthread_join(ids[r], NULL);
+    }
+    double seconds = now_seconds() - start;
+    free(ids);
+    free(args);
+
+    int failures = 0;
+    if (status == 0) {
+        uint64_t reports = 0, torn = 0;
+        for (int r = 0; r < readers; r++) {
+            reports += bench->readers[r].reports;
+            torn += bench->readers[r].torn;
+        }
+        size_t wrong = count_mismatches(bench);
+        qsort(bench->latencies_ns, bench->batches, sizeof(uint64_t),
+              compare_u64);
+
+        printf("%-22s %7d %11.0f %10.0f %9.1f %9.1f %10.1f", MODE_NAMES[mode],
+               readers, reports / seconds, bench->batches / seconds,
+               percentile_us(bench->latencies_ns, bench->batches, 0.5),
+               percentile_us(bench->latencies_ns, bench->batches, 0.99),
+               percentile_us(bench->latencies_ns, bench->batches, 1.0));
+        if (mode == MODE_SNAPSHOTS) {
+            printf(" %9.1f", bench->snapshots.peak_retired_bytes / 1e6);
+        } else {
+            printf(" %9s", "-");
+        }
+        printf("\n");
+
+        if (torn != 0) {
+            printf("  %llu of %llu reports saw a half-applied batch: FAILED\n",
+                   (unsigned long long)torn, (unsigned long long)reports);
+            failures++;
+        }
+        if (wrong != 0 || bench->writer_failed) {
+            printf("  %zu students differ from the writer's copy: FAILED\n",
+                   wrong);
+            failures++;
+        }
+    }
+
+    if (mode == MODE_SNAPSHOTS) {
+        student_snapshots_free(&bench->snapshots);
+    } else {
+        student_store_free(&bench->store);
+    }
+    pthread_rwlock_destroy(&bench->lock);
+    return status != 0 ? -1 : failures;
+}
+
+int main(int argc, char *argv[]) {
+    size_t students = argc > 1 ? (size_t)atoll(argv[1]) : 1000000;
+    int max_readers = argc > 2 ? atoi(argv[2]) : 4;
+    if (students < 2 || max_readers < 1 ||
+        max_readers > STUDENT_MAX_READERS - 1) {
+        fprintf(stderr, "Usage: %s [students (>= 2)] [max_readers (1-%d)]\n",
+                argv[0], STUDENT_MAX_READERS - 1);
+        return 1;
+    }
+
+    student_store_t initial;
+    bench_t bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.students = students;
+    bench.shadow = malloc(students * sizeof(student_record_t));
+    bench.latencies_ns = malloc(MAX_BATCHES * sizeof(uint64_t));
+    bench.readers = aligned_alloc(_Alignof(reader_local_t),
+                                  (size_t)max_readers *
+                                      sizeof(reader_local_t));
+    if (bench.shadow == NULL || bench.latencies_ns == NULL ||
+        bench.readers == NULL || student_store_init(&initial, students) != 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    pthread_mutex_init(&bench.gate, NULL);
+    pthread_cond_init(&bench.started, NULL);
+
+    uint64_t rng = 42;
+    for (size_t i = 0; i < students; i++) {
+        student_record_t record;
+        record.id = (uint32_t)(100000 + i);
+        record.initial = (char)('A' + xorshift64(&rng) % 26);
+        record.age = (uint8_t)(17 + xorshift64(&rng) % 30);
+        record.gpa_hundredths = (uint16_t)(xorshift64(&rng) % 401);
+        record.credits = (uint16_t)(xorshift64(&rng) % 150);
+        record.grade = (student_grade_t)(xorshift64(&rng) %
+                                         STUDENT_GRADE_COUNT);
+        record.tuition_cents = (int32_t)(xorshift64(&rng) % 1000000);
+        student_store_append(&initial, &record);
+    }
+    bench.expected_total = student_store_total_tuition(&initial);
+
+    printf("=== SNAPSHOT BENCHMARK ===\n");
+    printf("%zu students, 1 writer asked for %d batches of %d updates per "
+           "second, %.0f s per run\n", students, BATCHES_PER_SECOND, BATCH,
+           SECONDS_PER_RUN);
+    printf("Update latency: from when a batch was due until readers can see "
+           "it\n\n");
+    printf("%-22s %7s %11s %10s %9s %9s %10s %9s\n", "", "readers",
+           "reports/s", "batches/s", "p50 us", "p99 us", "max us",
+           "limbo MB");
+
+    int failures = 0;
+    for (int readers = 1; readers <= max_readers; readers *= 2) {
+        for (int mode = 0; mode < MODE_COUNT; mode++) {
+            int result = run(&bench, &initial, (mode_t_)mode, readers);
+            if (result < 0) {
+                fprintf(stderr, "Cannot start the run\n");
+                return 1;
+            }
+            failures += result;
+        }
+        printf("\n");
+    }
+    if (failures == 0) {
+        printf("Every report saw whole batches only, and every final store "
+               "matched the writer's copy\n");
+    }
+
+    pthread_cond_destroy(&bench.started);
+    pthread_mutex_destroy(&bench.gate);
+    student_store_free(&initial);
+    free(bench.readers);
+    free(bench.latencies_ns);
+    free(bench.shadow);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+/**
+ * @file student_store.c
+ * @brief Column store for student profiles
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "student_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Columns start on their own cache line
+#define COLUMN_ALIGNMENT 64
+
+static const char GRADE_LETTERS[STUDENT_GRADE_COUNT] = {'A', 'B', 'C', 'D', 'F'};
+
+char student_grade_letter(student_grade_t grade) {
+    return GRADE_LETTERS[grade];
+}
+
+int student_grade_from_letter(char letter) {
+    for (int grade = 0; grade < STUDENT_GRADE_COUNT; grade++) {
+        if (GRADE_LETTERS[grade] == letter) {
+            return grade;
+        }
+    }
+    return -1;
+}
+
+int student_store_init(student_store_t *store, size_t capacity) {
+    // Bytes per student over all columns
+    const size_t record_bytes = sizeof(*store->id) + sizeof(*store->initial) +
+                                sizeof(*store->age) +
+                                sizeof(*store->gpa_hundredths) +
+                                sizeof(*store->credits) + sizeof(*store->grade) +
+                                sizeof(*store->tuition_cents);
+
+    memset(store, 0, sizeof(*store));
+    if (capacity > (SIZE_MAX - 8 * COLUMN_ALIGNMENT) / record_bytes) {
+        return -1;
+    }
+    // One block that holds every column, padding included
+    arena_init(&store->arena, capacity * record_bytes + 8 * COLUMN_ALIGNMENT);
+
+    store->id = arena_alloc(&store->arena, capacity * sizeof(*store->id),
+                            COLUMN_ALIGNMENT);
+    store->initial = arena_alloc(&store->arena,
+                                 capacity * sizeof(*store->initial),
+                                 COLUMN_ALIGNMENT);
+    store->age = arena_alloc(&store->arena, capacity * sizeof(*store->age),
+                             COLUMN_ALIGNMENT);
+    store->gpa_hundredths = arena_alloc(
+        &store->arena, capacity * sizeof(*store->gpa_hundredths),
+        COLUMN_ALIGNMENT);
+    store->credits = arena_alloc(&store->arena,
+                                 capacity * sizeof(*store->credits),
+                                 COLUMN_ALIGNMENT);
+    store->grade = arena_alloc(&store->arena, capacity * sizeof(*store->grade),
+                               COLUMN_ALIGNMENT);
+    store->tuition_cents = arena_alloc(
+        &store->arena, capacity * sizeof(*store->tuition_cents),
+        COLUMN_ALIGNMENT);
+
+    if (!store->id || !store->initial || !store->age ||
+        !store->gpa_hundredths || !store->credits || !store->grade ||
+        !store->tuition_cents) {
+        student_store_free(store);
+        return -1;
+    }
+    store->capacity = capacity;
+    return 0;
+}
+
+void student_store_free(student_store_t *store) {
+    arena_free(&store->arena);
+    memset(store, 0, sizeof(*store));
+}
+
+long student_store_append(student_store_t *store,
+                          const student_record_t *record) {
+    if (store->count == store->capacity) {
+        return -1;
+    }
+    student_store_set(store, store->count, record);
+    return (long)store->count++;
+}
+
+void student_store_get(const student_store_t *store, size_t index,
+                       student_record_t *record) {
+    record->id = store->id[index];
+    record->initial = store->initial[index];
+    record->age = store->age[index];
+    record->gpa_hundredths = store->gpa_hundredths[index];
+    record->credits = store->credits[index];
+    record->grade = (student_grade_t)store->grade[index];
+    record->tuition_cents = store->tuition_cents[index];
+}
+
+void student_store_set(student_store_t *store, size_t index,
+                       const student_record_t *record) {
+    store->id[index] = record->id;
+    store->initial[index] = record->initial;
+    store->age[index] = record->age;
+    store->gpa_hundredths[index] = record->gpa_hundredths;
+    store->credits[index] = record->credits;
+    store->grade[index] = (uint8_t)record->grade;
+    store->tuition_cents[index] = record->tuition_cents;
+}
+
+/**
+ * @brief Parses a whole number field ending at a comma or end
+ * @return Pointer just past the field, or NULL if invalid or > max
+ */
+static const char *parse_unsigned(const char *p, const char *end,
+                                  unsigned long max, unsigned long *value) {
+    unsigned long result = 0;
+    const char *start = p;
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (unsigned long)(*p - '0');
+        if (result > max) {
+            return NULL;
+        }
+        p++;
+    }
+    if (p == start) {
+        return NULL;
+    }
+    *value = result;
+    return p;
+}
+
+/**
+ * @brief Parses "123", "123.4" or "123.45" into hundredths, exactly
+ * @return Pointer just past the field, or NULL if invalid or > max
+ */
+static const char *parse_hundredths(const char *p, const char *end,
+                                    unsigned long max, unsigned long *value) {
+    unsigned long whole;
+
+    p = parse_unsigned(p, end, max / 100, &whole);
+    if (p == NULL) {
+        return NULL;
+    }
+    unsigned long fraction = 0;
+    if (p < end && *p == '.') {
+        p++;
+        int digits = 0;
+        while (p < end && *p >= '0' && *p <= '9' && digits < 2) {
+            fraction = fraction * 10 + (unsigned long)(*p - '0');
+            digits++;
+            p++;
+        }
+        if (digits == 0) {
+            return NULL;
+        }
+        if (digits == 1) {
+            fraction *= 10;
+        }
+    }
+    if (whole * 100 + fraction > max) {
+        return NULL;
+    }
+    *value = whole * 100 + fraction;
+    return p;
+}
+
+static const char *expect_comma(const char *p, const char *end) {
+    return (p != NULL && p < end && *p == ',') ? p + 1 : NULL;
+}
+
+int student_parse_line(const char *line, const char *end,
+                       student_record_t *record) {
+    const char *p = line;
+    unsigned long value = 0;
+
+    p = parse_unsigned(p, end, UINT32_MAX, &value);
+    record->id = (uint32_t)value;
+    p = expect_comma(p, end);
+    if (p == NULL || p + 1 >= end || p[1] != ',') {
+        return 0;
+    }
+    record->initial = *p;
+    p = expect_comma(p + 1, end);
+
+    p = p ? parse_unsigned(p, end, UINT8_MAX, &value) : NULL;
+    record->age = (uint8_t)value;
+    p = expect_comma(p, end);
+
+    p = p ? parse_hundredths(p, end, UINT16_MAX, &value) : NULL;
+    record->gpa_hundredths = (uint16_t)value;
+    p = expect_comma(p, end);
+
+    p = p ? parse_unsigned(p, end, UINT16_MAX, &value) : NULL;
+    record->credits = (uint16_t)value;
+    p = expect_comma(p, end);
+
+    if (p == NULL || p >= end || student_grade_from_letter(*p) < 0) {
+        return 0;
+    }
+    record->grade = (student_grade_t)student_grade_from_letter(*p);
+    p = expect_comma(p + 1, end);
+
+    // Tuition may be negative (a credit balance)
+    int negative = p != NULL && p < end && *p == '-';
+    p = p ? parse_hundredths(p + negative, end, INT32_MAX, &value) : NULL;
+    if (p != end) {
+        return 0;
+    }
+    record->tuition_cents = negative ? -(int32_t)value : (int32_t)value;
+    return 1;
+}
+
+int student_store_load(student_store_t *store, const char *path) {
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+
+    memset(store, 0, sizeof(*store));
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)info.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    // Count lines first so the store is allocated once, at the right size
+    size_t lines = 0;
+    for (const char *p = data; p != NULL && p < data + size; p++) {
+        p = memchr(p, '\n', (size_t)(data + size - p));
+        if (p == NULL) {
+            break;
+        }
+        lines++;
+    }
+    if (size > 0 && data[size - 1] != '\n') {
+        lines++;
+    }
+
+    if (student_store_init(store, lines) != 0) {
+        if (data != NULL) {
+            munmap((void *)data, size);
+        }
+        errno = ENOMEM;
+        return -1;
+    }
+
+    const char *p = data;
+    const char *end = data + size;
+    unsigned long long line_number = 0;
+    student_record_t record;
+
+    while (p < end) {
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        line_number++;
+
+        const char *content_end = line_end;
+        if (content_end > p && content_end[-1] == '\r') {
+            content_end--;
+        }
+        if (content_end > p) {
+            if (student_parse_line(p, content_end, &record)) {
+                student_store_append(store, &record);
+            } else if (line_number > 1) {
+                // Only the first line may be something else (a header)
+                fprintf(stderr, "Line %llu: Error: invalid record\n",
+                        line_number);
+            }
+        }
+        p = line_end + 1;
+    }
+
+    if (data != NULL) {
+        munmap((void *)data, size);
+    }
+    return 0;
+}
+
+// The scans below are plain loops over one column; the compiler turns
+// each of them into SIMD code that handles many students at a time.
+
+int64_t student_store_total_tuition(const student_store_t *store) {
+    const int32_t *tuition = store->tuition_cents;
+    int64_t total = 0;
+
+    for (size_t i = 0; i < store->count; i++) {
+        total += tuition[i];
+    }
+    return total;
+}
+
+size_t student_store_count_credits_at_least(const student_store_t *store,
+                                            uint16_t min_credits) {
+    const uint16_t *credits = store->credits;
+    size_t count = 0;
+
+    for (size_t i = 0; i < store->count; i++) {
+        count += credits[i] >= min_credits;
+    }
+    return count;
+}
+
+void student_store_grade_counts(const student_store_t *store,
+                                size_t counts[STUDENT_GRADE_COUNT]) {
+    const uint8_t *grade = store->grade;
+    size_t a = 0, b = 0, c = 0, d = 0;
+
+    // Count four grades side by side in byte-sized counters, 255
+    // students at a time so they cannot overflow; everyone else got an F
+    for (size_t start = 0; start < store->count; start += 255) {
+        size_t stop = store->count - start < 255 ? store->count : start + 255;
+        uint8_t block_a = 0, block_b = 0, block_c = 0, block_d = 0;
+        for (size_t i = start; i < stop; i++) {
+            block_a += grade[i] == STUDENT_GRADE_A;
+            block_b += grade[i] == STUDENT_GRADE_B;
+            block_c += grade[i] == STUDENT_GRADE_C;
+            block_d += grade[i] == STUDENT_GRADE_D;
+        }
+        a += block_a;
+        b += block_b;
+        c += block_c;
+        d += block_d;
+    }
+    counts[STUDENT_GRADE_A] = a;
+    counts[STUDENT_GRADE_B] = b;
+    counts[STUDENT_GRADE_C] = c;
+    counts[STUDENT_GRADE_D] = d;
+    counts[STUDENT_GRADE_F] = store->count - a - b - c - d;
+}
+
+double student_store_average_gpa(const student_store_t *store) {
+    const uint16_t *gpa = store->gpa_hundredths;
+    uint64_t total = 0;
+
+    if (store->count == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < store->count; i++) {
+        total += gpa[i];
+    }
+    return (double)total / 100.0 / (double)store->count;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file student_store.h
+ * @brief Millions of student profiles stored column by column
+ *
+ * student_profile.c keeps one student in loose variables:
+ *
+ *     char initial; int age; float gpa; int creditsCompleted;
+ *     char letterGrade; float tuitionOwed;
+ *
+ * Putting those in a struct and making an array of them (an "array of
+ * structs") stores each student's fields next to each other. A question
+ * about one field, such as "how much tuition is owed in total?", then
+ * drags every other field through the cache as well.
+ *
+ * The store keeps one array per field instead (a "structure of arrays")
+ * and uses the narrowest type that fits each one:
+ *
+ *     age      uint8_t    0 to 255 years
+ *     credits  uint16_t   0 to 65535
+ *     grade    uint8_t    STUDENT_GRADE_A ... STUDENT_GRADE_F
+ *     gpa      uint16_t   hundredths: 3.75 is stored as 375
+ *     tuition  int32_t    cents: $5500.00 is stored as 550000
+ *
+ * A scan of one field reads only that field's array, 1 to 4 bytes per
+ * student. Money in whole cents also adds up exactly, which floats do
+ * not. All arrays come from a single arena allocation (see arena.h).
+ */
+
+#ifndef STUDENT_STORE_H
+#define STUDENT_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+// Letter grades, stored in one byte each
+typedef enum {
+    STUDENT_GRADE_A,
+    STUDENT_GRADE_B,
+    STUDENT_GRADE_C,
+    STUDENT_GRADE_D,
+    STUDENT_GRADE_F,
+    STUDENT_GRADE_COUNT
+} student_grade_t;
+
+// One student, as passed in and out of the store
+typedef struct {
+    uint32_t id;
+    char initial;
+    uint8_t age;
+    uint16_t gpa_hundredths;
+    uint16_t credits;
+    student_grade_t grade;
+    int32_t tuition_cents;
+} student_record_t;
+
+// The columns; element i of every array belongs to student i
+typedef struct {
+    size_t count;
+    size_t capacity;
+    uint32_t *id;
+    char *initial;
+    uint8_t *age;
+    uint16_t *gpa_hundredths;
+    uint16_t *credits;
+    uint8_t *grade;
+    int32_t *tuition_cents;
+    arena_t arena;
+} student_store_t;
+
+/**
+ * @brief Letter for a grade ('A', 'B', 'C', 'D' or 'F')
+ */
+char student_grade_letter(student_grade_t grade);
+
+/**
+ * @brief Grade for a letter
+ * @return The grade, or -1 if the letter is not A, B, C, D or F
+ */
+int student_grade_from_letter(char letter);
+
+/**
+ * @brief Creates an empty store with room for capacity students
+ *
+ * All columns are carved out of one arena block: one allocation, no
+ * matter how many students.
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+int student_store_init(student_store_t *store, size_t capacity);
+
+/**
+ * @brief Frees all columns
+ */
+void student_store_free(student_store_t *store);
+
+/**
+ * @brief Adds a student at the end
+ * @return Index of the new student, or -1 if the store is full
+ */
+long student_store_append(student_store_t *store,
+                          const student_record_t *record);
+
+/**
+ * @brief Copies student `index` out of the columns
+ */
+void student_store_get(const student_store_t *store, size_t index,
+                       student_record_t *record);
+
+/**
+ * @brief Overwrites student `index` in the columns
+ */
+void student_store_set(student_store_t *store, size_t index,
+                       const student_record_t *record);
+
+/**
+ * @brief Parses one CSV line "id,initial,age,gpa,credits,grade,tuition"
+ *
+ * Example: "1001,S,19,3.75,45,B,5500.00". GPA and tuition take at most
+ * two decimals and are converted exactly.
+ *
+ * @param end End of the line (the newline is not included)
+ * @return 1 on success, 0 if a field is missing or out of range
+ */
+int student_parse_line(const char *line, const char *end,
+                       student_record_t *record);
+
+/**
+ * @brief Loads a whole CSV file into a new store
+ *
+ * The file is memory-mapped and its lines counted first, so the store
+ * is created at the right size with one allocation. A header line is
+ * allowed; other invalid lines are reported on stderr and skipped.
+ *
+ * @return 0 on success, -1 if the file cannot be read (errno is set)
+ */
+int student_store_load(student_store_t *store, const char *path);
+
+/**
+ * @brief Total tuition owed by all students, in cents
+ */
+int64_t student_store_total_tuition(const student_store_t *store);
+
+/**
+ * @brief Number of students with at least min_credits credits
+ */
+size_t student_store_count_credits_at_least(const student_store_t *store,
+                                            uint16_t min_credits);
+
+/**
+ * @brief Number of students with each grade
+ */
+void student_store_grade_counts(const student_store_t *store,
+                                size_t counts[STUDENT_GRADE_COUNT]);
+
+/**
+ * @brief Mean GPA of all students (0 if the store is empty)
+ */
+double student_store_average_gpa(const student_store_t *store);
+
+#endif // STUDENT_STORE_H
@@ -0,0 +1,259 @@
+/**
+ * @file student_store_bench.c
+ * @brief Column store vs array of structs for student profiles
+ *
+ * Writes a CSV roster of random students to /tmp and loads it twice:
+ * into the column store (one arena allocation) and into an array of
+ * pointers to malloc()ed structs laid out like student_profile.c's
+ * variables (one allocation per student). Then it runs the same scans
+ * on the column store and on a flat array of those structs:
+ *
+ *   - total tuition owed
+ *   - students with at least 60 credits
+ *   - number of students with each grade
+ *
+ * Usage: ./student_store_bench [students]   (default 10000000)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "student_store.h"
+
+#define CSV_PATH "/tmp/student_store_bench.csv"
+
+// Repeat each scan and keep the fastest run
+#define RUNS 5
+
+// student_profile.c's variables gathered into one struct, plus an ID
+typedef struct {
+    int id;
+    char initial;
+    int age;
+    float gpa;
+    int creditsCompleted;
+    char letterGrade;
+    float tuitionOwed;
+} student_profile_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int write_csv(const char *path, size_t students) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    srand(7);
+    fprintf(file, "id,initial,age,gpa,credits,grade,tuition\n");
+    for (size_t i = 0; i < students; i++) {
+        fprintf(file, "%zu,%c,%d,%d.%02d,%d,%c,%d.%02d\n", 1000 + i,
+                'A' + rand() % 26, 17 + rand() % 30, rand() % 4,
+                rand() % 100, rand() % 150, "ABCDF"[rand() % 5],
+                rand() % 20000, rand() % 100);
+    }
+    return fclose(file);
+}
+
+static student_profile_t to_profile(const student_record_t *record) {
+    student_profile_t profile;
+    profile.id = (int)record->id;
+    profile.initial = record->initial;
+    profile.age = record->age;
+    profile.gpa = record->gpa_hundredths / 100.0f;
+    profile.creditsCompleted = record->credits;
+    profile.letterGrade = student_grade_letter(record->grade);
+    profile.tuitionOwed = record->tuition_cents / 100.0f;
+    return profile;
+}
+
+/**
+ * @brief Loads the CSV with one malloc() per student
+ * @return Array of pointers (NULL on error), *count set to its length
+ */
+static student_profile_t **load_with_malloc(const char *path, size_t *count) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        return NULL;
+    }
+    size_t size = (size_t)info.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    size_t capacity = 1024;
+    size_t n = 0;
+    student_profile_t **profiles = malloc(capacity * sizeof(*profiles));
+    const char *p = data;
+    const char *end = data + size;
+    student_record_t record;
+
+    while (p < end && profiles != NULL) {
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        if (student_parse_line(p, line_end, &record)) {
+            if (n == capacity) {
+                capacity *= 2;
+                student_profile_t **bigger =
+                    realloc(profiles, capacity * sizeof(*profiles));
+                if (bigger == NULL) {
+                    free(profiles);
+                    profiles = NULL;
+                    break;
+                }
+                profiles = bigger;
+            }
+            profiles[n] = malloc(sizeof(student_profile_t));
+            *profiles[n] = to_profile(&record);
+            n++;
+        }
+        p = line_end + 1;
+    }
+    munmap((void *)data, size);
+    *count = n;
+    return profiles;
+}
+
+static void print_scan(const char *name, double store_seconds,
+                       size_t store_bytes, double aos_seconds,
+                       size_t aos_bytes) {
+    printf("%-24s %9.2f %9.2f %9.2f %9.2f %8.2fx\n", name,
+           store_seconds * 1e3, store_bytes / store_seconds / 1e9,
+           aos_seconds * 1e3, aos_bytes / aos_seconds / 1e9,
+           aos_seconds / store_seconds);
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 10000000;
+    student_store_t store;
+
+    if (argc >= 2) {
+        n = strtoul(argv[1], NULL, 10);
+    }
+
+    printf("=== STUDENT STORE BENCHMARK ===\n");
+    printf("Writing %zu students to %s...\n", n, CSV_PATH);
+    if (write_csv(CSV_PATH, n) != 0) {
+        perror(CSV_PATH);
+        return 1;
+    }
+
+    // --- Loading ---
+    double start = now_seconds();
+    if (student_store_load(&store, CSV_PATH) != 0) {
+        perror(CSV_PATH);
+        return 1;
+    }
+    double store_load = now_seconds() - start;
+
+    size_t profile_count = 0;
+    start = now_seconds();
+    student_profile_t **pointers = load_with_malloc(CSV_PATH, &profile_count);
+    double malloc_load = now_seconds() - start;
+    if (pointers == NULL || profile_count != store.count) {
+        fprintf(stderr, "Error: loading with malloc failed\n");
+        return 1;
+    }
+
+    printf("\n%-24s %10s %14s %12s\n", "Load", "Seconds", "Allocations",
+           "Bytes/student");
+    printf("%-24s %10.3f %14zu %12.1f\n", "column store + arena",
+           store_load, store.arena.blocks,
+           (double)store.arena.bytes_reserved / store.count);
+    printf("%-24s %10.3f %14zu %12zu\n", "malloc per student", malloc_load,
+           profile_count + 1, sizeof(student_profile_t));
+
+    // Scans run on a flat array of structs, the fair baseline
+    student_profile_t *profiles = malloc(n * sizeof(student_profile_t));
+    if (profiles == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < profile_count; i++) {
+        profiles[i] = *pointers[i];
+        free(pointers[i]);
+    }
+    free(pointers);
+
+    // --- Scans ---
+    int64_t tuition_cents = 0;
+    double tuition_float = 0;
+    size_t store_seniors = 0, aos_seniors = 0;
+    size_t store_counts[STUDENT_GRADE_COUNT], aos_counts[STUDENT_GRADE_COUNT];
+    double best[6] = {1e30, 1e30, 1e30, 1e30, 1e30, 1e30};
+
+    for (int run = 0; run < RUNS; run++) {
+        double t[7];
+        t[0] = now_seconds();
+        tuition_cents = student_store_total_tuition(&store);
+        t[1] = now_seconds();
+        tuition_float = 0;
+        for (size_t i = 0; i < n; i++) {
+            tuition_float += profiles[i].tuitionOwed;
+        }
+        t[2] = now_seconds();
+        store_seniors = student_store_count_credits_at_least(&store, 60);
+        t[3] = now_seconds();
+        aos_seniors = 0;
+        for (size_t i = 0; i < n; i++) {
+            aos_seniors += profiles[i].creditsCompleted >= 60;
+        }
+        t[4] = now_seconds();
+        student_store_grade_counts(&store, store_counts);
+        t[5] = now_seconds();
+        memset(aos_counts, 0, sizeof(aos_counts));
+        for (size_t i = 0; i < n; i++) {
+            aos_counts[student_grade_from_letter(profiles[i].letterGrade)]++;
+        }
+        t[6] = now_seconds();
+        for (int s = 0; s < 6; s++) {
+            if (t[s + 1] - t[s] < best[s]) {
+                best[s] = t[s + 1] - t[s];
+            }
+        }
+    }
+
+    if (store_seniors != aos_seniors ||
+        memcmp(store_counts, aos_counts, sizeof(store_counts)) != 0) {
+        fprintf(stderr, "Error: column store and structs disagree!\n");
+        return 1;
+    }
+
+    printf("\n%-24s %9s %9s %9s %9s %9s\n", "Scan (best of 5)", "Store ms",
+           "GB/s", "Structs ms", "GB/s", "Speedup");
+    // GB/s counts the bytes each layout has to bring in from memory
+    size_t aos_bytes = n * sizeof(student_profile_t);
+    print_scan("total tuition", best[0], n * sizeof(int32_t), best[1],
+               aos_bytes);
+    print_scan("credits >= 60", best[2], n * sizeof(uint16_t), best[3],
+               aos_bytes);
+    print_scan("grade counts", best[4], n * sizeof(uint8_t), best[5],
+               aos_bytes);
+
+    printf("\nTotal tuition, exact cents: $%lld.%02lld\n",
+           (long long)(tuition_cents / 100), (long long)(tuition_cents % 100));
+    printf("Total tuition, float sum:   $%.2f\n", tuition_float);
+    printf("Students with >= 60 credits: %zu\n", store_seniors);
+    printf("Average GPA: %.2f\n", student_store_average_gpa(&store));
+
+    free(profiles);
+    student_store_free(&store);
+    remove(CSV_PATH);
+    return 0;
+}
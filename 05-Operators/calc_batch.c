@@ -0,0 +1,318 @@
+/**
+ * @file calc_batch.c
+ * @brief Streaming batch mode for the simple calculator
+ *
+ * The interactive calculator pays for three scanf calls and one printf
+ * call per operation. Batch mode instead reads the input in 1 MiB
+ * blocks, parses the numbers with the shared parser of scanner.h,
+ * evaluates records a chunk at a time and collects the output, formatted
+ * with fmt.h, in one buffer that is written with a single write() call
+ * whenever it fills up.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "calc_batch.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fmt.h"
+#include "scanner.h"
+#include "trace.h"
+
+// Room kept free in the output buffer before formatting one line
+#define CALC_LINE_RESERVE 256
+
+/**
+ * @brief Output buffer that is flushed with one write() per fill
+ */
+typedef struct {
+    char *data;
+    size_t used;
+    int fd;
+    int failed;
+} out_buffer_t;
+
+static void out_flush(out_buffer_t *out) {
+    size_t written = 0;
+    TRACE_BEGIN(write);
+
+    while (written < out->used && !out->failed) {
+        ssize_t n = write(out->fd, out->data + written, out->used - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            out->failed = 1;
+            break;
+        }
+        written += (size_t)n;
+    }
+    out->used = 0;
+    TRACE_END(write);
+}
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+int calc_parse_record(const char *line, const char *end,
+                      float *num1, char *operation, float *num2) {
+    const char *p = line;
+
+    while (p < end && is_blank(*p)) {
+        p++;
+    }
+    p = scan_parse_float(p, end, num1);
+    if (p == NULL) {
+        return 0;
+    }
+
+    while (p < end && is_blank(*p)) {
+        p++;
+    }
+    if (p == end) {
+        return 0;
+    }
+    *operation = *p++;
+
+    while (p < end && is_blank(*p)) {
+        p++;
+    }
+    p = scan_parse_float(p, end, num2);
+    if (p == NULL) {
+        return 0;
+    }
+
+    // Nothing but whitespace may follow the second number
+    while (p < end && is_blank(*p)) {
+        p++;
+    }
+    return p == end;
+}
+
+void calc_evaluate_chunk(calc_chunk_t *chunk) {
+    TRACE_BEGIN(evaluate);
+    for (size_t i = 0; i < chunk->count; i++) {
+        float num1 = chunk->num1[i];
+        float num2 = chunk->num2[i];
+
+        if (chunk->status[i] == CALC_ERROR_MALFORMED_RECORD) {
+            continue;
+        }
+
+        // Same decisions as the interactive calculator
+        chunk->status[i] = CALC_OK;
+        if (chunk->operation[i] == '+') {
+            chunk->result[i] = num1 + num2;
+        } else if (chunk->operation[i] == '-') {
+            chunk->result[i] = num1 - num2;
+        } else if (chunk->operation[i] == '*') {
+            chunk->result[i] = num1 * num2;
+        } else if (chunk->operation[i] == '/') {
+            if (num2 != 0) {
+                chunk->result[i] = num1 / num2;
+            } else {
+                chunk->status[i] = CALC_ERROR_DIVIDE_BY_ZERO;
+            }
+        } else {
+            chunk->status[i] = CALC_ERROR_INVALID_OPERATION;
+        }
+    }
+    TRACE_END(evaluate);
+}
+
+/**
+ * @brief Formats one successful result as "num1 op num2 = result"
+ */
+static int format_result(char *dst, float num1, char operation, float num2,
+                         float result) {
+    int n = 0;
+
+    n += (int)fmt_fixed(dst + n, num1, 2);
+    dst[n++] = ' ';
+    dst[n++] = operation;
+    dst[n++] = ' ';
+    n += (int)fmt_fixed(dst + n, num2, 2);
+    memcpy(dst + n, " = ", 3);
+    n += 3;
+    n += (int)fmt_fixed(dst + n, result, 2);
+    dst[n++] = '\n';
+    return n;
+}
+
+/**
+ * @brief Formats the results of one chunk into the output buffer
+ */
+static void write_chunk(const calc_chunk_t *chunk,
+                        unsigned long long first_record,
+                        out_buffer_t *out, calc_batch_stats_t *stats) {
+    TRACE_BEGIN(format);
+    for (size_t i = 0; i < chunk->count; i++) {
+        unsigned long long record = first_record + i;
+        char *dst;
+        size_t room;
+        int n;
+
+        // The longest possible line ("-3.4e38" printed with %.2f three
+        // times) is well under CALC_LINE_RESERVE bytes
+        if (CALC_IO_BUFFER_SIZE - out->used < CALC_LINE_RESERVE) {
+            out_flush(out);
+        }
+        dst = out->data + out->used;
+        room = CALC_IO_BUFFER_SIZE - out->used;
+
+        switch (chunk->status[i]) {
+        case CALC_OK:
+            n = format_result(dst, chunk->num1[i], chunk->operation[i],
+                              chunk->num2[i], chunk->result[i]);
+            break;
+        case CALC_ERROR_DIVIDE_BY_ZERO:
+            n = fmt_format(dst, room,
+                         "Record %llu: Error: Cannot divide by zero!\n",
+                         record);
+            break;
+        case CALC_ERROR_INVALID_OPERATION:
+            n = fmt_format(dst, room,
+                         "Record %llu: Error: Invalid operation '%c'. "
+                         "Please use +, -, *, or /\n",
+                         record, chunk->operation[i]);
+            break;
+        default:
+            n = fmt_format(dst, room,
+                         "Record %llu: Error: Malformed record\n", record);
+            break;
+        }
+
+        if (n > 0) {
+            out->used += (size_t)n;
+        }
+
+        if (chunk->status[i] != CALC_OK) {
+            stats->errors++;
+        }
+    }
+    stats->records += chunk->count;
+    TRACE_END(format);
+    TRACE_COUNTER(records, stats->records);
+}
+
+/**
+ * @brief Adds one input line to the chunk, evaluating it when full
+ */
+static void add_record(calc_chunk_t *chunk, const char *line, const char *end,
+                       out_buffer_t *out, calc_batch_stats_t *stats) {
+    const char *p = line;
+
+    // Blank lines are not records
+    while (p < end && is_blank(*p)) {
+        p++;
+    }
+    if (p == end) {
+        return;
+    }
+
+    size_t i = chunk->count++;
+    TRACE_BEGIN(parse);
+    if (calc_parse_record(line, end, &chunk->num1[i], &chunk->operation[i],
+                          &chunk->num2[i])) {
+        chunk->status[i] = CALC_OK;
+    } else {
+        chunk->status[i] = CALC_ERROR_MALFORMED_RECORD;
+    }
+    TRACE_END(parse);
+
+    if (chunk->count == CALC_CHUNK_SIZE) {
+        calc_evaluate_chunk(chunk);
+        write_chunk(chunk, stats->records + 1, out, stats);
+        chunk->count = 0;
+    }
+}
+
+int calc_batch_run(int in_fd, int out_fd, calc_batch_stats_t *stats) {
+    calc_batch_stats_t local_stats = {0, 0};
+    char *in_data = malloc(CALC_IO_BUFFER_SIZE);
+    char *out_data = malloc(CALC_IO_BUFFER_SIZE);
+    calc_chunk_t *chunk = malloc(sizeof(*chunk));
+    out_buffer_t out = {out_data, 0, out_fd, 0};
+    size_t filled = 0;
+    int skipping_long_line = 0;
+    int read_failed = 0;
+
+    if (in_data == NULL || out_data == NULL || chunk == NULL) {
+        free(in_data);
+        free(out_data);
+        free(chunk);
+        return -1;
+    }
+    chunk->count = 0;
+
+    for (;;) {
+        TRACE_POLL();
+        TRACE_BEGIN(read);
+        ssize_t n = read(in_fd, in_data + filled, CALC_IO_BUFFER_SIZE - filled);
+        TRACE_END(read);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            read_failed = 1;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        filled += (size_t)n;
+
+        // Hand every complete line in the buffer to the chunk
+        char *line = in_data;
+        char *buffer_end = in_data + filled;
+        char *newline;
+        while ((newline = memchr(line, '\n', (size_t)(buffer_end - line)))) {
+            if (skipping_long_line) {
+                skipping_long_line = 0;
+            } else {
+                add_record(chunk, line, newline, &out, &local_stats);
+            }
+            line = newline + 1;
+        }
+
+        // Keep the partial last line for the next read
+        filled = (size_t)(buffer_end - line);
+        if (filled == CALC_IO_BUFFER_SIZE) {
+            // A single line longer than the whole buffer: report it once
+            // and drop everything up to the next newline
+            if (!skipping_long_line) {
+                static const char marker[] = "?";
+                add_record(chunk, marker, marker + 1, &out, &local_stats);
+            }
+            skipping_long_line = 1;
+            filled = 0;
+        } else {
+            memmove(in_data, line, filled);
+        }
+    }
+
+    // Last line without a trailing newline
+    if (filled > 0 && !skipping_long_line && !read_failed) {
+        add_record(chunk, in_data, in_data + filled, &out, &local_stats);
+    }
+    if (chunk->count > 0) {
+        calc_evaluate_chunk(chunk);
+        write_chunk(chunk, local_stats.records + 1, &out, &local_stats);
+        chunk->count = 0;
+    }
+    out_flush(&out);
+
+    if (stats != NULL) {
+        *stats = local_stats;
+    }
+    free(in_data);
+    free(out_data);
+    free(chunk);
+    return (read_failed || out.failed) ? -1 : 0;
+}
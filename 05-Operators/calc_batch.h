@@ -0,0 +1,74 @@
+/**
+ * @file calc_batch.h
+ * @brief Streaming batch mode for the simple calculator
+ *
+ * Batch mode reads one "num1 op num2" record per line (for example
+ * "3.5 * 2"), evaluates the records a chunk at a time and writes one
+ * result line per record through a single large output buffer.
+ * Errors such as division by zero are reported on the record's own
+ * output line, so the output always lines up with the input.
+ */
+
+#ifndef CALC_BATCH_H
+#define CALC_BATCH_H
+
+#include <stddef.h>
+
+// Number of records parsed and evaluated together
+#define CALC_CHUNK_SIZE 4096
+
+// Size of the input and output buffers (1 MiB each)
+#define CALC_IO_BUFFER_SIZE (1 << 20)
+
+// Per-record status after evaluation
+typedef enum {
+    CALC_OK = 0,
+    CALC_ERROR_DIVIDE_BY_ZERO,
+    CALC_ERROR_INVALID_OPERATION,
+    CALC_ERROR_MALFORMED_RECORD
+} calc_status_t;
+
+// One chunk of records stored column by column
+typedef struct {
+    float num1[CALC_CHUNK_SIZE];
+    float num2[CALC_CHUNK_SIZE];
+    float result[CALC_CHUNK_SIZE];
+    char operation[CALC_CHUNK_SIZE];
+    unsigned char status[CALC_CHUNK_SIZE];
+    size_t count;
+} calc_chunk_t;
+
+// Totals reported at the end of a batch run
+typedef struct {
+    unsigned long long records;
+    unsigned long long errors;
+} calc_batch_stats_t;
+
+/**
+ * @brief Parses one "num1 op num2" record
+ * @param line Start of the record (does not need to be NUL-terminated)
+ * @param end One past the last character of the record
+ * @param num1 Receives the first operand
+ * @param operation Receives the operator character
+ * @param num2 Receives the second operand
+ * @return 1 if the record was well formed, 0 otherwise
+ */
+int calc_parse_record(const char *line, const char *end,
+                      float *num1, char *operation, float *num2);
+
+/**
+ * @brief Evaluates every record of a chunk and fills in result/status
+ * @param chunk Chunk whose num1, operation and num2 columns are filled in
+ */
+void calc_evaluate_chunk(calc_chunk_t *chunk);
+
+/**
+ * @brief Streams records from in_fd to out_fd until end of input
+ * @param in_fd File descriptor to read records from
+ * @param out_fd File descriptor to write results to
+ * @param stats Optional pointer that receives record and error counts
+ * @return 0 on success, -1 on a read or write error
+ */
+int calc_batch_run(int in_fd, int out_fd, calc_batch_stats_t *stats);
+
+#endif // CALC_BATCH_H
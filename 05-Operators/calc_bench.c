@@ -0,0 +1,154 @@
+/**
+ * @file calc_bench.c
+ * @brief Throughput benchmark: interactive scanf/printf path vs batch mode
+ *
+ * Generates a file of random "num1 op num2" records, then evaluates it
+ * twice: once the way calculator.c's interactive path does (three
+ * scanf-style reads and one printf per operation) and once with the
+ * streaming batch mode. Output goes to /dev/null so only the cost of
+ * parsing, evaluating and formatting is measured.
+ *
+ * Usage: ./calc_bench [records]   (default 5000000)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "calc_batch.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Writes random records to a temporary file
+ * @return Path of the file (static buffer)
+ */
+static const char *generate_records(unsigned long count) {
+    static char path[] = "/tmp/calc_bench_XXXXXX";
+    static const char operations[] = "+-*/";
+    int fd = mkstemp(path);
+    FILE *file = (fd >= 0) ? fdopen(fd, "w") : NULL;
+
+    if (file == NULL) {
+        perror("calc_bench: cannot create input file");
+        exit(1);
+    }
+
+    srand(42);
+    for (unsigned long i = 0; i < count; i++) {
+        // Operands like 123.45; about 1 in 1000 divisions is by zero
+        int a = rand() % 100000;
+        int b = rand() % 100000;
+        char op = operations[rand() % 4];
+        if (op == '/' && rand() % 1000 == 0) {
+            b = 0;
+        }
+        fprintf(file, "%d.%02d %c %d.%02d\n", a / 100, a % 100, op,
+                b / 100, b % 100);
+    }
+    fclose(file);
+    return path;
+}
+
+/**
+ * @brief The interactive calculator's per-operation I/O, in a loop
+ */
+static unsigned long run_interactive_path(const char *path) {
+    FILE *in = fopen(path, "r");
+    FILE *out = fopen("/dev/null", "w");
+    unsigned long operations = 0;
+    float num1, num2, result;
+    char operation;
+
+    if (in == NULL || out == NULL) {
+        perror("calc_bench");
+        exit(1);
+    }
+
+    while (fscanf(in, "%f", &num1) == 1 &&
+           fscanf(in, " %c", &operation) == 1 &&
+           fscanf(in, "%f", &num2) == 1) {
+        if (operation == '+') {
+            result = num1 + num2;
+            fprintf(out, "%.2f + %.2f = %.2f\n", num1, num2, result);
+        } else if (operation == '-') {
+            result = num1 - num2;
+            fprintf(out, "%.2f - %.2f = %.2f\n", num1, num2, result);
+        } else if (operation == '*') {
+            result = num1 * num2;
+            fprintf(out, "%.2f * %.2f = %.2f\n", num1, num2, result);
+        } else if (operation == '/') {
+            if (num2 != 0) {
+                result = num1 / num2;
+                fprintf(out, "%.2f / %.2f = %.2f\n", num1, num2, result);
+            } else {
+                fprintf(out, "Error: Cannot divide by zero!\n");
+            }
+        }
+        operations++;
+    }
+
+    fclose(in);
+    fclose(out);
+    return operations;
+}
+
+static unsigned long run_batch_path(const char *path) {
+    int in_fd = open(path, O_RDONLY);
+    int out_fd = open("/dev/null", O_WRONLY);
+    calc_batch_stats_t stats;
+
+    if (in_fd < 0 || out_fd < 0 || calc_batch_run(in_fd, out_fd, &stats) != 0) {
+        perror("calc_bench");
+        exit(1);
+    }
+    close(in_fd);
+    close(out_fd);
+    return (unsigned long)stats.records;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long count = 5000000;
+
+    if (argc >= 2) {
+        count = strtoul(argv[1], NULL, 10);
+    }
+
+    printf("=== CALCULATOR THROUGHPUT BENCHMARK ===\n");
+    printf("Generating %lu records...\n", count);
+    const char *path = generate_records(count);
+
+    // Warm the page cache so both runs read from memory
+    run_batch_path(path);
+
+    double start = now_seconds();
+    unsigned long interactive_ops = run_interactive_path(path);
+    double interactive_time = now_seconds() - start;
+
+    start = now_seconds();
+    unsigned long batch_ops = run_batch_path(path);
+    double batch_time = now_seconds() - start;
+
+    double interactive_rate = interactive_ops / interactive_time;
+    double batch_rate = batch_ops / batch_time;
+
+    printf("\n%-20s | %12s | %10s | %14s\n", "Path", "Operations", "Seconds",
+           "Ops/sec");
+    printf("---------------------|--------------|------------|---------------\n");
+    printf("%-20s | %12lu | %10.3f | %14.0f\n", "interactive (scanf)",
+           interactive_ops, interactive_time, interactive_rate);
+    printf("%-20s | %12lu | %10.3f | %14.0f\n", "batch", batch_ops,
+           batch_time, batch_rate);
+    printf("\nSpeedup: %.1fx\n", batch_rate / interactive_rate);
+
+    unlink(path);
+    return 0;
+}
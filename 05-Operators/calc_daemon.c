@@ -0,0 +1,738 @@
+/**
+ * @file calc_daemon.c
+ * @brief Socket and shared-memory transports and the batched evaluator
+ *
+ * The socket side is one thread with poll(): every round it reads what
+ * each client has sent, puts every complete request (of every client)
+ * into one batch, evaluates the batch and writes the replies back. A
+ * client that sends faster than it reads is not read from until it has
+ * taken its replies, so no buffer grows without limit.
+ *
+ * The shared-memory side is a second thread that takes whatever is in
+ * the request ring as one batch. When the ring is empty it checks a
+ * little longer and then sleeps in futex(), on the ring's head; the
+ * client wakes it only if it says it is sleeping, so a busy client and
+ * daemon never make a system call.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "calc_daemon.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "calc_batch.h"
+#include "calc_simd.h"
+#include "trace.h"
+
+// Identifies a calc_shm_t ("CALC")
+#define SHM_MAGIC 0x43414c43u
+
+// Bytes a socket client's requests are read into
+#define CLIENT_INPUT_SIZE (64 * 1024)
+
+// Replies a client may leave unread before the daemon stops reading it
+#define CLIENT_BACKLOG (1 << 20)
+
+// Times an empty ring is checked again before sleeping
+#define SPIN_CHECKS 200
+
+static const char operations[] = "+-*/";
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+// ---------------------------------------------------------------------
+// Batches
+// ---------------------------------------------------------------------
+
+// Requests evaluated together, and the scratch columns for one operator
+typedef struct {
+    size_t count;
+    uint8_t operation[CALC_DAEMON_BATCH];
+    double num1[CALC_DAEMON_BATCH];
+    double num2[CALC_DAEMON_BATCH];
+    double result[CALC_DAEMON_BATCH];
+    uint8_t status[CALC_DAEMON_BATCH];
+
+    double column_a[CALC_DAEMON_BATCH];
+    double column_b[CALC_DAEMON_BATCH];
+    double column_out[CALC_DAEMON_BATCH];
+    uint32_t column_row[CALC_DAEMON_BATCH];
+    uint64_t errors[CALC_ERROR_WORDS(CALC_DAEMON_BATCH)];
+} batch_t;
+
+static void batch_add(batch_t *batch, const calc_request_t *request) {
+    size_t row = batch->count++;
+    batch->operation[row] = request->operation;
+    batch->num1[row] = request->num1;
+    batch->num2[row] = request->num2;
+}
+
+/**
+ * @brief Fills in result and status for every request of the batch,
+ *        one operator at a time
+ */
+static void evaluate_batch(batch_t *batch) {
+    TRACE_BEGIN(evaluate);
+    for (size_t i = 0; i < batch->count; i++) {
+        batch->result[i] = 0;
+        batch->status[i] = CALC_ERROR_INVALID_OPERATION;
+    }
+    for (int op = 0; op < 4; op++) {
+        size_t k = 0;
+        for (size_t i = 0; i < batch->count; i++) {
+            if (batch->operation[i] == (uint8_t)operations[op]) {
+                batch->column_a[k] = batch->num1[i];
+                batch->column_b[k] = batch->num2[i];
+                batch->column_row[k] = (uint32_t)i;
+                k++;
+            }
+        }
+        if (k == 0) {
+            continue;
+        }
+        calc_columns_f64(operations[op], batch->column_a, batch->column_b,
+                         batch->column_out, batch->errors, k);
+        for (size_t j = 0; j < k; j++) {
+            uint32_t row = batch->column_row[j];
+            int failed = (int)((batch->errors[j / 64] >> (j % 64)) & 1);
+            batch->result[row] = batch->column_out[j];
+            batch->status[row] = failed ? CALC_ERROR_DIVIDE_BY_ZERO : CALC_OK;
+        }
+    }
+    TRACE_END(evaluate);
+    TRACE_COUNTER(batch, batch->count);
+}
+
+// ---------------------------------------------------------------------
+// Socket clients
+// ---------------------------------------------------------------------
+
+typedef struct {
+    int fd;
+    int closing;             // Sent end of input: close once answered
+    int failed;              // Bad frame or I/O error: close now
+    size_t in_used;
+    char *out;
+    size_t out_used;         // Replies written so far
+    size_t out_sent;         // Of which sent
+    size_t out_capacity;
+    char in[CLIENT_INPUT_SIZE];
+} client_t;
+
+typedef struct {
+    int listen_fd;
+    int client_count;
+    client_t *clients[CALC_DAEMON_MAX_CLIENTS];
+    batch_t batch;
+    // Where the reply to each batch row goes
+    client_t *reply_client[CALC_DAEMON_BATCH];
+    size_t reply_offset[CALC_DAEMON_BATCH];
+} server_t;
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static void write_reply(char *out, const calc_reply_t *reply) {
+    uint32_t length = sizeof(*reply);
+    memcpy(out, &length, 4);
+    memcpy(out + 4, reply, sizeof(*reply));
+}
+
+/**
+ * @brief Evaluates the batch and writes each reply into the place kept
+ *        for it in its client's output
+ */
+static void finish_batch(server_t *server) {
+    batch_t *batch = &server->batch;
+    evaluate_batch(batch);
+    for (size_t i = 0; i < batch->count; i++) {
+        char *frame = server->reply_client[i]->out + server->reply_offset[i];
+        calc_reply_t reply;
+        memcpy(&reply, frame + 4, sizeof(reply));   // The id is already there
+        reply.status = batch->status[i];
+        reply.result = batch->result[i];
+        memcpy(frame + 4, &reply, sizeof(reply));
+    }
+    batch->count = 0;
+}
+
+static int reserve_output(client_t *client, size_t bytes) {
+    if (client->out_capacity - client->out_used >= bytes) {
+        return 0;
+    }
+    size_t capacity = client->out_capacity ? client->out_capacity * 2 : 4096;
+    while (capacity - client->out_used < bytes) {
+        capacity *= 2;
+    }
+    char *bigger = realloc(client->out, capacity);
+    if (bigger == NULL) {
+        return -1;
+    }
+    client->out = bigger;
+    client->out_capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Moves every complete request of a client into the batch and
+ *        keeps room for its reply, in request order
+ */
+static void take_requests(server_t *server, client_t *client) {
+    size_t pos = 0;
+
+    while (client->in_used - pos >= 4) {
+        uint32_t length;
+        memcpy(&length, client->in + pos, 4);
+        if (length > CALC_FRAME_MAX) {
+            client->failed = 1;
+            return;
+        }
+        if (client->in_used - pos - 4 < length) {
+            break;              // The rest has not arrived yet
+        }
+        if (reserve_output(client, CALC_REPLY_FRAME) != 0) {
+            client->failed = 1;
+            return;
+        }
+
+        const char *body = client->in + pos + 4;
+        calc_reply_t reply;
+        memset(&reply, 0, sizeof(reply));
+        if (length >= 4) {
+            memcpy(&reply.id, body, 4);
+        }
+        if (length == sizeof(calc_request_t)) {
+            calc_request_t request;
+            memcpy(&request, body, sizeof(request));
+            if (server->batch.count == CALC_DAEMON_BATCH) {
+                finish_batch(server);
+            }
+            server->reply_client[server->batch.count] = client;
+            server->reply_offset[server->batch.count] = client->out_used;
+            batch_add(&server->batch, &request);
+        } else {
+            reply.status = CALC_ERROR_MALFORMED_RECORD;
+        }
+        write_reply(client->out + client->out_used, &reply);
+        client->out_used += CALC_REPLY_FRAME;
+        pos += 4 + length;
+    }
+    memmove(client->in, client->in + pos, client->in_used - pos);
+    client->in_used -= pos;
+}
+
+static void read_client(client_t *client) {
+    while (client->in_used < CLIENT_INPUT_SIZE) {
+        ssize_t n = read(client->fd, client->in + client->in_used,
+                         CLIENT_INPUT_SIZE - client->in_used);
+        if (n > 0) {
+            client->in_used += (size_t)n;
+        } else if (n == 0) {
+            client->closing = 1;
+            return;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            client->failed = errno != EAGAIN && errno != EWOULDBLOCK;
+            return;
+        }
+    }
+}
+
+static void write_client(client_t *client) {
+    while (client->out_sent < client->out_used) {
+        ssize_t n = send(client->fd, client->out + client->out_sent,
+                         client->out_used - client->out_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            client->failed = errno != EAGAIN && errno != EWOULDBLOCK;
+            return;
+        }
+        client->out_sent += (size_t)n;
+    }
+    client->out_used = 0;
+    client->out_sent = 0;
+}
+
+static void accept_clients(server_t *server) {
+    while (server->client_count < CALC_DAEMON_MAX_CLIENTS) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return;             // EAGAIN: no one else is waiting
+        }
+        client_t *client = calloc(1, sizeof(*client));
+        if (client == NULL || set_nonblocking(fd) != 0) {
+            free(client);
+            close(fd);
+            continue;
+        }
+        client->fd = fd;
+        server->clients[server->client_count++] = client;
+    }
+}
+
+static void close_client(server_t *server, int index) {
+    client_t *client = server->clients[index];
+    close(client->fd);
+    free(client->out);
+    free(client);
+    server->clients[index] = server->clients[--server->client_count];
+}
+
+static int backlogged(const client_t *client) {
+    return client->out_used - client->out_sent >= CLIENT_BACKLOG;
+}
+
+/**
+ * @brief One poll() round: read, evaluate everything, write
+ */
+static int serve_round(server_t *server) {
+    struct pollfd fds[CALC_DAEMON_MAX_CLIENTS + 1];
+    int count = server->client_count;
+
+    fds[0].fd = server->listen_fd;
+    fds[0].events = count < CALC_DAEMON_MAX_CLIENTS ? POLLIN : 0;
+    for (int i = 0; i < count; i++) {
+        const client_t *client = server->clients[i];
+        fds[i + 1].fd = client->fd;
+        fds[i + 1].events = (short)((backlogged(client) ? 0 : POLLIN) |
+                                    (client->out_used > client->out_sent
+                                         ? POLLOUT : 0));
+    }
+    if (poll(fds, (nfds_t)count + 1, -1) < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    TRACE_POLL();
+
+    TRACE_BEGIN(read);
+    for (int i = 0; i < count; i++) {
+        client_t *client = server->clients[i];
+        if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+            read_client(client);
+            take_requests(server, client);
+        }
+    }
+    TRACE_END(read);
+    if (server->batch.count > 0) {
+        finish_batch(server);
+    }
+
+    TRACE_BEGIN(write);
+    for (int i = count - 1; i >= 0; i--) {
+        client_t *client = server->clients[i];
+        if (!client->failed) {
+            write_client(client);
+        }
+        if (client->failed ||
+            (client->closing && client->out_used == client->out_sent)) {
+            close_client(server, i);
+        }
+    }
+    TRACE_END(write);
+
+    if (fds[0].revents & POLLIN) {
+        accept_clients(server);
+    }
+    return 0;
+}
+
+static int listen_on(const char *socket_path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(socket_path);        // Left over from a daemon that was killed
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0 || set_nonblocking(fd) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+int calc_daemon_connect(const char *socket_path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+void calc_frame_request(char *out, const calc_request_t *request) {
+    uint32_t length = sizeof(*request);
+    memcpy(out, &length, 4);
+    memcpy(out + 4, request, sizeof(*request));
+}
+
+long calc_unframe_reply(const char *p, const char *end, calc_reply_t *reply) {
+    uint32_t length;
+    if (end - p < 4) {
+        return 0;
+    }
+    memcpy(&length, p, 4);
+    if (length != sizeof(*reply)) {
+        return -1;
+    }
+    if ((size_t)(end - p) < CALC_REPLY_FRAME) {
+        return 0;
+    }
+    memcpy(reply, p + 4, sizeof(*reply));
+    return (long)CALC_REPLY_FRAME;
+}
+
+// ---------------------------------------------------------------------
+// Shared-memory rings
+// ---------------------------------------------------------------------
+
+static void futex_wait(_Atomic uint32_t *word, uint32_t expected) {
+    // Wake up now and then to notice a daemon or client that has gone
+    struct timespec timeout = {0, 100 * 1000 * 1000};
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, &timeout,
+            NULL, 0);
+}
+
+static void futex_wake(_Atomic uint32_t *word) {
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/**
+ * @brief Makes new slots visible to the consumer, waking it if it sleeps
+ *
+ * Both stores and loads here are sequentially consistent: either the
+ * consumer sees the new head before it sleeps, or the producer sees
+ * that it is sleeping.
+ */
+static void ring_publish(calc_ring_t *ring, uint32_t head) {
+    atomic_store(&ring->head, head);
+    if (atomic_load(&ring->consumer_waiting)) {
+        futex_wake(&ring->head);
+    }
+}
+
+/**
+ * @brief Waits until the ring's head moves past seen (or stop is set)
+ */
+static void ring_wait(calc_ring_t *ring, uint32_t seen,
+                      _Atomic uint32_t *stop) {
+    for (int i = 0; i < SPIN_CHECKS; i++) {
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) != seen) {
+            return;
+        }
+    }
+    atomic_store(&ring->consumer_waiting, 1);
+    if (atomic_load(&ring->head) == seen && !atomic_load(stop)) {
+        futex_wait(&ring->head, seen);
+    }
+    atomic_store(&ring->consumer_waiting, 0);
+}
+
+static calc_shm_t *shm_map(int fd) {
+    void *memory = mmap(NULL, sizeof(calc_shm_t), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    close(fd);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+static calc_shm_t *shm_create(const char *shm_name) {
+    shm_unlink(shm_name);       // Left over from a daemon that was killed
+    int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(calc_shm_t)) != 0) {
+        close(fd);
+        shm_unlink(shm_name);
+        return NULL;
+    }
+    calc_shm_t *shm = shm_map(fd);     // New pages are zero: empty rings
+    if (shm == NULL) {
+        shm_unlink(shm_name);
+        return NULL;
+    }
+    shm->magic = SHM_MAGIC;
+    return shm;
+}
+
+// Times the rings are handed over (futex_wait() wakes every 100 ms)
+#define RESET_WAITS 20
+
+calc_shm_t *calc_shm_attach(const char *shm_name) {
+    int fd = shm_open(shm_name, O_RDWR, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    calc_shm_t *shm = shm_map(fd);
+    if (shm == NULL) {
+        return NULL;
+    }
+    if (shm->magic != SHM_MAGIC) {
+        munmap(shm, sizeof(*shm));
+        errno = EBUSY;
+        return NULL;
+    }
+
+    // Take the region if it is free, or if its owner has died
+    uint32_t self = (uint32_t)getpid();
+    uint32_t owner = 0;
+    while (!atomic_compare_exchange_strong(&shm->owner, &owner, self)) {
+        if (kill((pid_t)owner, 0) == 0 || errno != ESRCH) {
+            munmap(shm, sizeof(*shm));
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+
+    // Have the daemon empty both rings: only it may move their indices
+    // while it runs, and a dead client may have left slots behind
+    atomic_store(&shm->reset, 1);
+    for (int i = 0; i < RESET_WAITS && atomic_load(&shm->reset); i++) {
+        if (atomic_load(&shm->stop)) {
+            break;
+        }
+        futex_wake(&shm->requests.head);
+        futex_wait(&shm->reset, 1);
+    }
+    if (atomic_load(&shm->reset)) {
+        atomic_store(&shm->owner, 0);
+        munmap(shm, sizeof(*shm));
+        errno = ETIMEDOUT;
+        return NULL;
+    }
+    return shm;
+}
+
+void calc_shm_detach(calc_shm_t *shm) {
+    atomic_store(&shm->owner, 0);
+    munmap(shm, sizeof(*shm));
+}
+
+size_t calc_shm_submit(calc_shm_t *shm, const calc_request_t *requests,
+                       size_t count) {
+    calc_ring_t *ring = &shm->requests;
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t room = CALC_SHM_SLOTS - (head - tail);
+    size_t n = count < room ? count : room;
+
+    for (size_t i = 0; i < n; i++) {
+        shm->request_slots[(head + i) % CALC_SHM_SLOTS] = requests[i];
+    }
+    if (n > 0) {
+        ring_publish(ring, head + (uint32_t)n);
+    }
+    return n;
+}
+
+size_t calc_shm_receive(calc_shm_t *shm, calc_reply_t *replies, size_t max) {
+    calc_ring_t *ring = &shm->replies;
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head;
+
+    while ((head = atomic_load_explicit(&ring->head, memory_order_acquire)) ==
+           tail) {
+        if (atomic_load(&shm->stop)) {
+            return 0;
+        }
+        ring_wait(ring, tail, &shm->stop);
+    }
+    size_t n = head - tail < max ? head - tail : max;
+    for (size_t i = 0; i < n; i++) {
+        replies[i] = shm->reply_slots[(tail + i) % CALC_SHM_SLOTS];
+    }
+    atomic_store_explicit(&ring->tail, tail + (uint32_t)n,
+                          memory_order_release);
+    return n;
+}
+
+typedef struct {
+    calc_shm_t *shm;
+    batch_t batch;
+    uint32_t ids[CALC_DAEMON_BATCH];
+} shm_server_t;
+
+/**
+ * @brief The shared-memory thread: takes what is queued, evaluates it
+ *        as one batch and queues the replies
+ */
+static void *serve_shm(void *argument) {
+    shm_server_t *server = argument;
+    calc_shm_t *shm = server->shm;
+    batch_t *batch = &server->batch;
+
+    TRACE_THREAD_NAME("shm");
+    while (!atomic_load(&shm->stop)) {
+        if (atomic_load(&shm->reset)) {
+            // A new client: drop what the last one left behind
+            calc_ring_t *rings[] = {&shm->requests, &shm->replies};
+            for (int r = 0; r < 2; r++) {
+                atomic_store(&rings[r]->head, 0);
+                atomic_store(&rings[r]->tail, 0);
+                atomic_store(&rings[r]->consumer_waiting, 0);
+            }
+            atomic_store(&shm->reset, 0);
+            futex_wake(&shm->reset);
+            continue;
+        }
+        uint32_t tail = atomic_load_explicit(&shm->requests.tail,
+                                             memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&shm->requests.head,
+                                             memory_order_acquire);
+        uint32_t reply_head = atomic_load_explicit(&shm->replies.head,
+                                                   memory_order_relaxed);
+        uint32_t reply_tail = atomic_load_explicit(&shm->replies.tail,
+                                                   memory_order_acquire);
+        size_t n = head - tail;
+        size_t room = CALC_SHM_SLOTS - (reply_head - reply_tail);
+
+        if (n == 0) {
+            ring_wait(&shm->requests, head, &shm->stop);
+            continue;
+        }
+        if (room == 0) {
+            sched_yield();      // The client is not taking its replies
+            continue;
+        }
+        n = n < room ? n : room;
+        n = n < CALC_DAEMON_BATCH ? n : CALC_DAEMON_BATCH;
+
+        batch->count = 0;
+        for (size_t i = 0; i < n; i++) {
+            const calc_request_t *request =
+                &shm->request_slots[(tail + i) % CALC_SHM_SLOTS];
+            server->ids[i] = request->id;
+            batch_add(batch, request);
+        }
+        atomic_store_explicit(&shm->requests.tail, tail + (uint32_t)n,
+                              memory_order_release);
+
+        evaluate_batch(batch);
+        for (size_t i = 0; i < n; i++) {
+            calc_reply_t *reply =
+                &shm->reply_slots[(reply_head + i) % CALC_SHM_SLOTS];
+            reply->id = server->ids[i];
+            reply->status = batch->status[i];
+            reply->result = batch->result[i];
+        }
+        ring_publish(&shm->replies, reply_head + (uint32_t)n);
+        TRACE_POLL();
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------
+// The daemon
+// ---------------------------------------------------------------------
+
+int calc_daemon_run(const char *socket_path, const char *shm_name) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);   // No SA_RESTART: poll() returns
+    sigaction(SIGTERM, &action, NULL);
+
+    server_t *server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        return -1;
+    }
+    server->listen_fd = listen_on(socket_path);
+    if (server->listen_fd < 0) {
+        perror(socket_path);
+        free(server);
+        return -1;
+    }
+
+    shm_server_t *shm_server = NULL;
+    pthread_t shm_thread;
+    if (shm_name != NULL) {
+        shm_server = calloc(1, sizeof(*shm_server));
+        if (shm_server == NULL ||
+            (shm_server->shm = shm_create(shm_name)) == NULL ||
+            pthread_create(&shm_thread, NULL, serve_shm, shm_server) != 0) {
+            perror(shm_name);
+            if (shm_server != NULL && shm_server->shm != NULL) {
+                munmap(shm_server->shm, sizeof(calc_shm_t));
+                shm_unlink(shm_name);
+            }
+            free(shm_server);
+            close(server->listen_fd);
+            unlink(socket_path);
+            free(server);
+            return -1;
+        }
+    }
+
+    int status = 0;
+    while (!stop_requested && status == 0) {
+        status = serve_round(server);
+    }
+
+    if (shm_server != NULL) {
+        calc_shm_t *shm = shm_server->shm;
+        atomic_store(&shm->stop, 1);
+        futex_wake(&shm->requests.head);
+        futex_wake(&shm->replies.head);
+        pthread_join(shm_thread, NULL);
+        munmap(shm, sizeof(*shm));
+        shm_unlink(shm_name);
+        free(shm_server);
+    }
+    while (server->client_count > 0) {
+        close_client(server, server->client_count - 1);
+    }
+    close(server->listen_fd);
+    unlink(socket_path);
+    free(server);
+    return status;
+}
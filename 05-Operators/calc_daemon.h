@@ -0,0 +1,152 @@
+/**
+ * @file calc_daemon.h
+ * @brief The calculator as a long-running server
+ *
+ * Starting ./calculator for every single operation costs a fork(), an
+ * exec(), the dynamic loader and stdio setup: about a millisecond, a
+ * million times more than the addition itself. Daemon mode starts once
+ * and answers operations sent to it:
+ *
+ *   - over a Unix domain socket, as binary frames: a 4-byte length and
+ *     then a calc_request_t; each reply is a 4-byte length and then a
+ *     calc_reply_t. A client may send many requests without waiting
+ *     for the replies ("pipelining"); replies come back in request order
+ *   - through shared memory (same host only): two rings of fixed-size
+ *     slots, one for requests and one for replies, with no system call
+ *     at all while both sides are busy
+ *
+ * Whatever has arrived since the last round (from every client) is
+ * evaluated together as one batch: grouped by operator into columns and
+ * computed with calc_columns_f64(), the SIMD kernels of calc_simd.h.
+ * Division by zero and unknown operators are reported per request, with
+ * the same calc_status_t codes as batch mode.
+ *
+ * Numbers are sent in the machine's own byte order and double format:
+ * the daemon only talks to clients on the same host.
+ */
+
+#ifndef CALC_DAEMON_H
+#define CALC_DAEMON_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest frame the daemon accepts; longer ones close the connection
+#define CALC_FRAME_MAX 1024
+
+// Requests evaluated together at most
+#define CALC_DAEMON_BATCH 4096
+
+// Socket clients served at once
+#define CALC_DAEMON_MAX_CLIENTS 64
+
+// Slots of each shared-memory ring (a power of two)
+#define CALC_SHM_SLOTS 4096
+
+// One operation; id is chosen by the client and returned in the reply
+typedef struct {
+    uint32_t id;
+    uint8_t operation;       // '+', '-', '*' or '/'
+    uint8_t reserved[3];
+    double num1;
+    double num2;
+} calc_request_t;
+
+// status is a calc_status_t; result is 0 unless status is CALC_OK
+typedef struct {
+    uint32_t id;
+    uint8_t status;
+    uint8_t reserved[3];
+    double result;
+} calc_reply_t;
+
+_Static_assert(sizeof(calc_request_t) == 24, "calc_request_t has padding");
+_Static_assert(sizeof(calc_reply_t) == 16, "calc_reply_t has padding");
+
+// Bytes of a framed request or reply on the socket
+#define CALC_REQUEST_FRAME (4 + sizeof(calc_request_t))
+#define CALC_REPLY_FRAME (4 + sizeof(calc_reply_t))
+
+// Indices of one single-producer, single-consumer ring. head and tail
+// count slots ever written and taken, and live on separate cache lines
+// because different processes write them.
+typedef struct {
+    _Alignas(64) _Atomic uint32_t head;      // Written by the producer
+    _Atomic uint32_t consumer_waiting;       // Consumer sleeps on head
+    _Alignas(64) _Atomic uint32_t tail;      // Written by the consumer
+} calc_ring_t;
+
+// The shared-memory region: one client at a time. A client that dies
+// without detaching is noticed by the next one to attach (its pid is
+// gone), and the daemon empties both rings before the new client uses
+// them.
+typedef struct {
+    uint32_t magic;
+    _Atomic uint32_t owner;                  // Client's pid, 0 if free
+    _Atomic uint32_t reset;                  // 1: daemon, empty the rings
+    _Atomic uint32_t stop;                   // Set when the daemon exits
+    calc_ring_t requests;
+    calc_ring_t replies;
+    calc_request_t request_slots[CALC_SHM_SLOTS];
+    calc_reply_t reply_slots[CALC_SHM_SLOTS];
+} calc_shm_t;
+
+/**
+ * @brief Runs the daemon until SIGINT or SIGTERM
+ * @param socket_path Path of the Unix socket to create
+ * @param shm_name Name of the shared-memory region to create (e.g.
+ *                 "/calculator"), or NULL for the socket only
+ * @return 0 after a clean shutdown, -1 if it could not start
+ */
+int calc_daemon_run(const char *socket_path, const char *shm_name);
+
+/**
+ * @brief Connects to a daemon's socket
+ * @return A blocking socket, or -1
+ */
+int calc_daemon_connect(const char *socket_path);
+
+/**
+ * @brief Writes a request as a frame (CALC_REQUEST_FRAME bytes)
+ */
+void calc_frame_request(char *out, const calc_request_t *request);
+
+/**
+ * @brief Reads a reply frame from [p, end)
+ * @return Bytes used, 0 if the frame is not complete yet, or -1 if it
+ *         is not a reply
+ */
+long calc_unframe_reply(const char *p, const char *end, calc_reply_t *reply);
+
+/**
+ * @brief Maps a daemon's shared-memory region as its client
+ *
+ * The region is taken over from a client that exited without
+ * detaching. Whatever it left in the rings is thrown away first.
+ *
+ * @return The region, or NULL (errno is EBUSY if a running client has
+ *         it, ETIMEDOUT if no daemon empties the rings)
+ */
+calc_shm_t *calc_shm_attach(const char *shm_name);
+
+/**
+ * @brief Lets the next client have the region; every reply must have
+ *        been received
+ */
+void calc_shm_detach(calc_shm_t *shm);
+
+/**
+ * @brief Queues up to count requests without waiting
+ * @return Number queued (fewer when the ring is full)
+ */
+size_t calc_shm_submit(calc_shm_t *shm, const calc_request_t *requests,
+                       size_t count);
+
+/**
+ * @brief Takes up to max replies, waiting until there is at least one
+ * @return Number of replies, or 0 if the daemon has stopped
+ */
+size_t calc_shm_receive(calc_shm_t *shm, calc_reply_t *replies, size_t max);
+
+#endif // CALC_DAEMON_H
@@ -0,0 +1,529 @@
+/**
+ * @file calc_load.c
+ * @brief Load generator for the calculator daemon
+ *
+ * Starts a daemon (calc_daemon_run() in a child process), then sends it
+ * the same random operations through each transport and measures every
+ * single request, from the moment it is sent to the moment its reply
+ * arrives:
+ *   - fork + exec: a new ./calculator --batch process per operation,
+ *     the way services called the calculator before the daemon existed
+ *   - the Unix socket with 1 request in flight (send, wait, send, ...)
+ *     and with 16 and 256 (pipelined)
+ *   - shared memory, the same way
+ *
+ * For each it reports requests per second and latency percentiles. Every
+ * reply is checked against plain C arithmetic: the same double, bit for
+ * bit, or the right error. The socket is also sent a malformed frame
+ * and a frame that is too long, and the shared memory is first taken
+ * over from a client that exited without detaching.
+ *
+ * Usage: ./calc_load [requests]   (default 200000 per run)
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "calc_batch.h"
+#include "calc_daemon.h"
+
+// Processes started by the fork + exec baseline
+#define SPAWN_RUNS 200
+
+// Largest number of requests in flight
+#define MAX_DEPTH 256
+
+static const size_t depths[] = {1, 16, MAX_DEPTH};
+
+// One transport's run
+typedef struct {
+    const char *transport;
+    size_t depth;
+    size_t requests;
+    double seconds;
+    uint64_t *latency_ns;   // Per request
+    uint64_t *sent_ns;
+    unsigned char *seen;
+    size_t wrong;
+} run_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t random_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t random_bits(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// ---------------------------------------------------------------------
+// Requests and the replies they should get
+// ---------------------------------------------------------------------
+
+static calc_request_t *requests;
+static calc_reply_t *expected;
+
+static void make_requests(size_t n) {
+    static const char operations[] = "+-*/";
+    for (size_t i = 0; i < n; i++) {
+        calc_request_t *request = &requests[i];
+        uint64_t bits = random_bits();
+        memset(request, 0, sizeof(*request));
+        request->id = (uint32_t)i;
+        request->operation = (uint8_t)operations[bits & 3];
+        // -1000..1000 and 0..199.9, so 1 in 2000 divisions is by zero
+        request->num1 = (double)((int64_t)(bits >> 8) % 2000000 - 1000000) /
+                        1000.0;
+        request->num2 = (double)((int64_t)(bits >> 30) % 2000) / 10.0;
+        if ((bits >> 50) % 64 == 0) {
+            request->operation = '%';       // Not an operator
+        }
+
+        calc_reply_t *reply = &expected[i];
+        memset(reply, 0, sizeof(*reply));
+        reply->id = request->id;
+        switch (request->operation) {
+        case '+': reply->result = request->num1 + request->num2; break;
+        case '-': reply->result = request->num1 - request->num2; break;
+        case '*': reply->result = request->num1 * request->num2; break;
+        case '/':
+            if (request->num2 == 0) {
+                reply->status = CALC_ERROR_DIVIDE_BY_ZERO;
+            } else {
+                reply->result = request->num1 / request->num2;
+            }
+            break;
+        default:
+            reply->status = CALC_ERROR_INVALID_OPERATION;
+        }
+    }
+}
+
+static void start_run(run_t *run, const char *transport, size_t depth,
+                      size_t n) {
+    run->transport = transport;
+    run->depth = depth;
+    run->requests = n;
+    run->wrong = 0;
+    memset(run->seen, 0, n);
+}
+
+// Records a reply that arrived at time t
+static void take_reply(run_t *run, const calc_reply_t *reply, uint64_t t) {
+    uint32_t id = reply->id;
+    if (id >= run->requests || run->seen[id] ||
+        reply->status != expected[id].status ||
+        memcmp(&reply->result, &expected[id].result, sizeof(double)) != 0) {
+        run->wrong++;
+        return;
+    }
+    run->seen[id] = 1;
+    run->latency_ns[id] = t - run->sent_ns[id];
+}
+
+// ---------------------------------------------------------------------
+// Transports
+// ---------------------------------------------------------------------
+
+static int write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Keeps up to depth requests in flight on the socket
+ */
+static int run_socket(int fd, run_t *run) {
+    static char out[MAX_DEPTH * CALC_REQUEST_FRAME];
+    static char in[64 * 1024];
+    size_t in_used = 0;
+    size_t sent = 0;
+    size_t received = 0;
+    size_t n = run->requests;
+    uint64_t start = now_ns();
+
+    while (received < n) {
+        size_t length = 0;
+        uint64_t t = now_ns();
+        while (sent < n && sent - received < run->depth) {
+            calc_frame_request(out + length, &requests[sent]);
+            run->sent_ns[sent++] = t;
+            length += CALC_REQUEST_FRAME;
+        }
+        if (length > 0 && write_all(fd, out, length) != 0) {
+            return -1;
+        }
+
+        ssize_t got = read(fd, in + in_used, sizeof(in) - in_used);
+        if (got <= 0) {
+            return -1;
+        }
+        in_used += (size_t)got;
+        t = now_ns();
+
+        const char *p = in;
+        const char *end = in + in_used;
+        calc_reply_t reply;
+        long used;
+        while ((used = calc_unframe_reply(p, end, &reply)) > 0) {
+            take_reply(run, &reply, t);
+            received++;
+            p += used;
+        }
+        if (used < 0) {
+            return -1;
+        }
+        in_used = (size_t)(end - p);
+        memmove(in, p, in_used);
+    }
+    run->seconds = (double)(now_ns() - start) / 1e9;
+    return 0;
+}
+
+/**
+ * @brief Keeps up to depth requests in flight in shared memory
+ */
+static int run_shm(calc_shm_t *shm, run_t *run) {
+    static calc_reply_t replies[MAX_DEPTH];
+    size_t sent = 0;
+    size_t received = 0;
+    size_t n = run->requests;
+    uint64_t start = now_ns();
+
+    while (received < n) {
+        size_t want = run->depth - (sent - received);
+        if (want > n - sent) {
+            want = n - sent;
+        }
+        uint64_t t = now_ns();
+        size_t queued = calc_shm_submit(shm, &requests[sent], want);
+        for (size_t i = 0; i < queued; i++) {
+            run->sent_ns[sent + i] = t;
+        }
+        sent += queued;
+
+        size_t got = calc_shm_receive(shm, replies, MAX_DEPTH);
+        if (got == 0) {
+            return -1;
+        }
+        t = now_ns();
+        for (size_t i = 0; i < got; i++) {
+            take_reply(run, &replies[i], t);
+        }
+        received += got;
+    }
+    run->seconds = (double)(now_ns() - start) / 1e9;
+    return 0;
+}
+
+/**
+ * @brief Starts ./calculator --batch for every operation
+ */
+static int run_spawn(run_t *run) {
+    uint64_t start = now_ns();
+
+    for (size_t i = 0; i < run->requests; i++) {
+        int input[2];
+        if (pipe(input) != 0) {
+            return -1;
+        }
+        run->sent_ns[i] = now_ns();
+        pid_t pid = fork();
+        if (pid < 0) {
+            return -1;
+        }
+        if (pid == 0) {
+            dup2(input[0], STDIN_FILENO);
+            close(input[0]);
+            close(input[1]);
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            execl("./calculator", "calculator", "--batch", (char *)NULL);
+            _exit(127);
+        }
+        close(input[0]);
+        char line[64];
+        int length = snprintf(line, sizeof(line), "%.17g %c %.17g\n",
+                              requests[i].num1, requests[i].operation,
+                              requests[i].num2);
+        int status;
+        int ok = write_all(input[1], line, (size_t)length) == 0;
+        close(input[1]);
+        ok &= waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+              WEXITSTATUS(status) == 0;
+        run->latency_ns[i] = now_ns() - run->sent_ns[i];
+        run->seen[i] = 1;
+        run->wrong += !ok;
+    }
+    run->seconds = (double)(now_ns() - start) / 1e9;
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+// Report
+// ---------------------------------------------------------------------
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const uint64_t *sorted, size_t n, double q) {
+    return (double)sorted[(size_t)(q * (double)(n - 1))] / 1000.0;
+}
+
+static void print_run(run_t *run) {
+    size_t n = run->requests;
+    size_t missing = 0;
+    for (size_t i = 0; i < n; i++) {
+        missing += !run->seen[i];
+    }
+    qsort(run->latency_ns, n, sizeof(uint64_t), compare_u64);
+    printf("%-14s %6zu %12.0f %9.1f %9.1f %9.1f %9.1f %9.1f  %s\n",
+           run->transport, run->depth, (double)n / run->seconds,
+           percentile_us(run->latency_ns, n, 0.50),
+           percentile_us(run->latency_ns, n, 0.90),
+           percentile_us(run->latency_ns, n, 0.99),
+           percentile_us(run->latency_ns, n, 0.999),
+           percentile_us(run->latency_ns, n, 1.0),
+           run->wrong == 0 && missing == 0 ? "ok" : "WRONG");
+}
+
+// ---------------------------------------------------------------------
+// Checks of the framing
+// ---------------------------------------------------------------------
+
+/**
+ * @brief A 3-byte frame gets an error reply; a huge one closes the
+ *        connection
+ * @return Number of failures
+ */
+static int check_framing(const char *socket_path) {
+    int failures = 0;
+    int fd = calc_daemon_connect(socket_path);
+    char frame[CALC_REQUEST_FRAME + 7];
+    uint32_t length = 3;
+    calc_reply_t reply;
+
+    memcpy(frame, &length, 4);
+    memcpy(frame + 4, "abc", 3);
+    calc_frame_request(frame + 7, &requests[0]);
+    char in[2 * CALC_REPLY_FRAME];
+    size_t have = 0;
+    if (fd < 0 || write_all(fd, frame, sizeof(frame)) != 0) {
+        return 1;
+    }
+    while (have < sizeof(in)) {
+        ssize_t got = read(fd, in + have, sizeof(in) - have);
+        if (got <= 0) {
+            break;
+        }
+        have += (size_t)got;
+    }
+    if (have != sizeof(in) ||
+        calc_unframe_reply(in, in + have, &reply) <= 0 ||
+        reply.status != CALC_ERROR_MALFORMED_RECORD ||
+        calc_unframe_reply(in + CALC_REPLY_FRAME, in + have, &reply) <= 0 ||
+        reply.id != 0 || reply.status != expected[0].status) {
+        failures++;
+    }
+
+    length = CALC_FRAME_MAX + 1;
+    if (write_all(fd, (const char *)&length, 4) != 0 ||
+        read(fd, in, sizeof(in)) != 0) {
+        failures++;
+    }
+    close(fd);
+    printf("Malformed and oversized frames: %s\n",
+           failures == 0 ? "rejected" : "FAILED");
+    return failures;
+}
+
+/**
+ * @brief Attaches to the shared memory after a client crashed holding it
+ *
+ * A child attaches, queues requests and exits without detaching or
+ * taking its replies. The region must be handed over anyway, with none
+ * of the child's replies left in it.
+ *
+ * @return The region, attached, or NULL
+ */
+static calc_shm_t *attach_after_crash(const char *shm_name, int *failures) {
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        return NULL;
+    }
+    if (child == 0) {
+        calc_shm_t *shm = calc_shm_attach(shm_name);
+        if (shm == NULL) {
+            _exit(1);
+        }
+        calc_request_t leftover[64];
+        for (size_t i = 0; i < 64; i++) {
+            leftover[i] = requests[i];
+            leftover[i].id = UINT32_MAX;
+        }
+        calc_shm_submit(shm, leftover, 64);
+        usleep(20000);                          // Let the replies pile up
+        _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+
+    calc_shm_t *shm = calc_shm_attach(shm_name);
+    calc_reply_t reply;
+    int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && shm != NULL &&
+             calc_shm_submit(shm, &requests[1], 1) == 1 &&
+             calc_shm_receive(shm, &reply, 1) == 1 && reply.id == 1 &&
+             reply.status == expected[1].status;
+    printf("Shared memory left by a crashed client: %s\n",
+           ok ? "reclaimed" : "FAILED");
+    *failures += !ok;
+    return shm;
+}
+
+// ---------------------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : 200000;
+    if (n < SPAWN_RUNS) {
+        fprintf(stderr, "Usage: %s [requests]   (at least %d)\n", argv[0],
+                SPAWN_RUNS);
+        return 1;
+    }
+
+    char socket_path[64];
+    char shm_name[64];
+    snprintf(socket_path, sizeof(socket_path), "/tmp/calc_load-%ld.sock",
+             (long)getpid());
+    snprintf(shm_name, sizeof(shm_name), "/calc_load-%ld", (long)getpid());
+
+    requests = malloc(n * sizeof(*requests));
+    expected = malloc(n * sizeof(*expected));
+    run_t run;
+    run.latency_ns = malloc(n * sizeof(uint64_t));
+    run.sent_ns = malloc(n * sizeof(uint64_t));
+    run.seen = malloc(n);
+    if (requests == NULL || expected == NULL || run.latency_ns == NULL ||
+        run.sent_ns == NULL || run.seen == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    make_requests(n);
+
+    fflush(stdout);
+    pid_t daemon = fork();
+    if (daemon < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (daemon == 0) {
+        _exit(calc_daemon_run(socket_path, shm_name) == 0 ? 0 : 1);
+    }
+
+    // Wait for the daemon to listen
+    int fd = -1;
+    for (int tries = 0; tries < 200 && fd < 0; tries++) {
+        fd = calc_daemon_connect(socket_path);
+        if (fd < 0) {
+            usleep(10000);
+        }
+    }
+    if (fd < 0) {
+        perror("cannot reach the daemon");
+        kill(daemon, SIGTERM);
+        return 1;
+    }
+
+    printf("=== CALCULATOR DAEMON LOAD ===\n");
+    printf("%zu random requests per run (+ - * /, some divide by zero or "
+           "use a bad operator)\n\n", n);
+    int failures = check_framing(socket_path);
+    calc_shm_t *shm = attach_after_crash(shm_name, &failures);
+    if (shm == NULL) {
+        perror("cannot attach to the shared memory");
+        kill(daemon, SIGTERM);
+        return 1;
+    }
+    printf("\n%-14s %6s %12s %9s %9s %9s %9s %9s\n", "Transport", "depth",
+           "requests/s", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+
+    if (access("./calculator", X_OK) == 0) {
+        start_run(&run, "fork + exec", 1, SPAWN_RUNS);
+        if (run_spawn(&run) == 0) {
+            print_run(&run);
+            failures += run.wrong != 0;
+        }
+    } else {
+        printf("%-14s (./calculator not built, skipped)\n", "fork + exec");
+    }
+
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        start_run(&run, "socket", depths[d], n);
+        if (run_socket(fd, &run) != 0) {
+            printf("socket: connection lost\n");
+            failures++;
+            break;
+        }
+        print_run(&run);
+        failures += run.wrong != 0;
+    }
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        start_run(&run, "shared memory", depths[d], n);
+        if (run_shm(shm, &run) != 0) {
+            printf("shared memory: daemon stopped\n");
+            failures++;
+            break;
+        }
+        print_run(&run);
+        failures += run.wrong != 0;
+    }
+
+    printf("\nDepth is the number of requests sent before waiting for a "
+           "reply. Latency\nruns from sending a request to receiving its "
+           "reply.\n");
+
+    calc_shm_detach(shm);
+    close(fd);
+    kill(daemon, SIGTERM);
+    waitpid(daemon, NULL, 0);
+    free(requests);
+    free(expected);
+    free(run.latency_ns);
+    free(run.sent_ns);
+    free(run.seen);
+
+    if (failures != 0) {
+        printf("\n%d check(s) FAILED\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,303 @@
+/**
+ * @file calc_simd.c
+ * @brief SIMD column kernels for + - * / with masked divide-by-zero
+ *
+ * Each instruction set gets its own copy of the kernel, compiled with
+ * GCC's target attribute so the whole file can still be built with
+ * plain -O2. The dispatcher checks the CPU once (CPUID, through
+ * __builtin_cpu_supports) and calls the widest kernel available.
+ *
+ * Division never branches per element: the kernel compares the divisor
+ * with zero for a whole vector at once, which gives a lane mask. The
+ * mask zeroes those lanes of the quotient and is packed into the error
+ * bitmap with one movemask instruction.
+ */
+
+#include "calc_simd.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CALC_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define CALC_SIMD_X86 0
+#endif
+
+// ---------------------------------------------------------------------
+// Scalar reference kernels (also used for the last few rows)
+// ---------------------------------------------------------------------
+
+#define DEFINE_SCALAR_KERNEL(NAME, TYPE)                                    \
+    static long NAME(char operation, const TYPE *a, const TYPE *b,         \
+                     TYPE *out, uint64_t *error_bits, size_t start,        \
+                     size_t n) {                                           \
+        long errors = 0;                                                   \
+        switch (operation) {                                               \
+        case '+':                                                          \
+            for (size_t i = start; i < n; i++) out[i] = a[i] + b[i];       \
+            break;                                                         \
+        case '-':                                                          \
+            for (size_t i = start; i < n; i++) out[i] = a[i] - b[i];       \
+            break;                                                         \
+        case '*':                                                          \
+            for (size_t i = start; i < n; i++) out[i] = a[i] * b[i];       \
+            break;                                                         \
+        case '/':                                                          \
+            for (size_t i = start; i < n; i++) {                           \
+                if (b[i] == 0) {                                           \
+                    out[i] = 0;                                            \
+                    errors++;                                              \
+                    if (error_bits != NULL) {                              \
+                        error_bits[i / 64] |= (uint64_t)1 << (i % 64);     \
+                    }                                                      \
+                } else {                                                   \
+                    out[i] = a[i] / b[i];                                  \
+                }                                                          \
+            }                                                              \
+            break;                                                         \
+        default:                                                           \
+            return -1;                                                     \
+        }                                                                  \
+        return errors;                                                     \
+    }
+
+DEFINE_SCALAR_KERNEL(scalar_f32, float)
+DEFINE_SCALAR_KERNEL(scalar_f64, double)
+
+#if CALC_SIMD_X86
+
+// ---------------------------------------------------------------------
+// SSE2 and AVX2 kernels
+//
+// Both use the same loop; only the vector type, width and intrinsics
+// differ. Comparisons are "ordered equal", so a NaN divisor is not
+// treated as zero, exactly like the scalar "b[i] == 0".
+// ---------------------------------------------------------------------
+
+#define DEFINE_VECTOR_KERNEL(NAME, TARGET, TYPE, VEC, WIDTH, LOAD, STORE,   \
+                             ADD, SUB, MUL, DIV, ZERO, CMPEQ, MOVEMASK,    \
+                             ANDNOT, SCALAR)                               \
+    __attribute__((target(TARGET)))                                        \
+    static long NAME(char operation, const TYPE *a, const TYPE *b,         \
+                     TYPE *out, uint64_t *error_bits, size_t n) {          \
+        size_t i = 0;                                                      \
+        long errors = 0;                                                   \
+        switch (operation) {                                               \
+        case '+':                                                          \
+            for (; i + WIDTH <= n; i += WIDTH)                             \
+                STORE(out + i, ADD(LOAD(a + i), LOAD(b + i)));             \
+            break;                                                         \
+        case '-':                                                          \
+            for (; i + WIDTH <= n; i += WIDTH)                             \
+                STORE(out + i, SUB(LOAD(a + i), LOAD(b + i)));             \
+            break;                                                         \
+        case '*':                                                          \
+            for (; i + WIDTH <= n; i += WIDTH)                             \
+                STORE(out + i, MUL(LOAD(a + i), LOAD(b + i)));             \
+            break;                                                         \
+        case '/': {                                                        \
+            const VEC zero = ZERO();                                       \
+            for (; i + WIDTH <= n; i += WIDTH) {                           \
+                VEC divisor = LOAD(b + i);                                 \
+                VEC is_zero = CMPEQ(divisor, zero);                        \
+                VEC quotient = DIV(LOAD(a + i), divisor);                  \
+                STORE(out + i, ANDNOT(is_zero, quotient));                 \
+                unsigned int lanes = (unsigned int)MOVEMASK(is_zero);      \
+                if (lanes != 0) {                                          \
+                    errors += __builtin_popcount(lanes);                   \
+                    if (error_bits != NULL) {                              \
+                        error_bits[i / 64] |= (uint64_t)lanes << (i % 64); \
+                    }                                                      \
+                }                                                          \
+            }                                                              \
+            break;                                                         \
+        }                                                                  \
+        default:                                                           \
+            return -1;                                                     \
+        }                                                                  \
+        return errors + SCALAR(operation, a, b, out, error_bits, i, n);    \
+    }
+
+__attribute__((target("avx")))
+static inline __m256 avx_cmpeq_ps(__m256 x, __m256 y) {
+    return _mm256_cmp_ps(x, y, _CMP_EQ_OQ);
+}
+
+__attribute__((target("avx")))
+static inline __m256d avx_cmpeq_pd(__m256d x, __m256d y) {
+    return _mm256_cmp_pd(x, y, _CMP_EQ_OQ);
+}
+
+DEFINE_VECTOR_KERNEL(sse2_f32, "sse2", float, __m128, 4,
+                     _mm_loadu_ps, _mm_storeu_ps, _mm_add_ps, _mm_sub_ps,
+                     _mm_mul_ps, _mm_div_ps, _mm_setzero_ps, _mm_cmpeq_ps,
+                     _mm_movemask_ps, _mm_andnot_ps, scalar_f32)
+
+DEFINE_VECTOR_KERNEL(sse2_f64, "sse2", double, __m128d, 2,
+                     _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd, _mm_sub_pd,
+                     _mm_mul_pd, _mm_div_pd, _mm_setzero_pd, _mm_cmpeq_pd,
+                     _mm_movemask_pd, _mm_andnot_pd, scalar_f64)
+
+DEFINE_VECTOR_KERNEL(avx2_f32, "avx2", float, __m256, 8,
+                     _mm256_loadu_ps, _mm256_storeu_ps, _mm256_add_ps,
+                     _mm256_sub_ps, _mm256_mul_ps, _mm256_div_ps,
+                     _mm256_setzero_ps, avx_cmpeq_ps, _mm256_movemask_ps,
+                     _mm256_andnot_ps, scalar_f32)
+
+DEFINE_VECTOR_KERNEL(avx2_f64, "avx2", double, __m256d, 4,
+                     _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd,
+                     _mm256_sub_pd, _mm256_mul_pd, _mm256_div_pd,
+                     _mm256_setzero_pd, avx_cmpeq_pd, _mm256_movemask_pd,
+                     _mm256_andnot_pd, scalar_f64)
+
+// ---------------------------------------------------------------------
+// AVX-512 kernels
+//
+// AVX-512 compares straight into a mask register, and the division
+// itself can be masked so zero lanes are never divided at all.
+// ---------------------------------------------------------------------
+
+#define DEFINE_AVX512_KERNEL(NAME, TYPE, VEC, MASK, WIDTH, LOAD, STORE,     \
+                             ADD, SUB, MUL, MASKZ_DIV, ZERO, CMP_MASK,     \
+                             SCALAR)                                       \
+    __attribute__((target("avx512f")))                                     \
+    static long NAME(char operation, const TYPE *a, const TYPE *b,         \
+                     TYPE *out, uint64_t *error_bits, size_t n) {          \
+        size_t i = 0;                                                      \
+        long errors = 0;                                                   \
+        switch (operation) {                                               \
+        case '+':                                                          \
+            for (; i + WIDTH <= n; i += WIDTH)                             \
+                STORE(out + i, ADD(LOAD(a + i), LOAD(b + i)));             \
+            break;                                                         \
+        case '-':                                                          \
+            for (; i + WIDTH <= n; i += WIDTH)                             \
+                STORE(out + i, SUB(LOAD(a + i), LOAD(b + i)));             \
+            break;                                                         \
+        case '*':                                                          \
+            for (; i + WIDTH <= n; i += WIDTH)                             \
+                STORE(out + i, MUL(LOAD(a + i), LOAD(b + i)));             \
+            break;                                                         \
+        case '/': {                                                        \
+            const VEC zero = ZERO();                                       \
+            for (; i + WIDTH <= n; i += WIDTH) {                           \
+                VEC divisor = LOAD(b + i);                                 \
+                MASK is_zero = CMP_MASK(divisor, zero, _CMP_EQ_OQ);        \
+                STORE(out + i, MASKZ_DIV((MASK)~is_zero, LOAD(a + i),      \
+                                         divisor));                        \
+                if (is_zero != 0) {                                        \
+                    errors += __builtin_popcount(is_zero);                 \
+                    if (error_bits != NULL) {                              \
+                        error_bits[i / 64] |= (uint64_t)is_zero << (i % 64); \
+                    }                                                      \
+                }                                                          \
+            }                                                              \
+            break;                                                         \
+        }                                                                  \
+        default:                                                           \
+            return -1;                                                     \
+        }                                                                  \
+        return errors + SCALAR(operation, a, b, out, error_bits, i, n);    \
+    }
+
+DEFINE_AVX512_KERNEL(avx512_f32, float, __m512, __mmask16, 16,
+                     _mm512_loadu_ps, _mm512_storeu_ps, _mm512_add_ps,
+                     _mm512_sub_ps, _mm512_mul_ps, _mm512_maskz_div_ps,
+                     _mm512_setzero_ps, _mm512_cmp_ps_mask, scalar_f32)
+
+DEFINE_AVX512_KERNEL(avx512_f64, double, __m512d, __mmask8, 8,
+                     _mm512_loadu_pd, _mm512_storeu_pd, _mm512_add_pd,
+                     _mm512_sub_pd, _mm512_mul_pd, _mm512_maskz_div_pd,
+                     _mm512_setzero_pd, _mm512_cmp_pd_mask, scalar_f64)
+
+#endif // CALC_SIMD_X86
+
+// ---------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------
+
+calc_simd_level_t calc_simd_detect(void) {
+    // Threads may race to fill it in; they all store the same value
+    static _Atomic int detected = -1;
+
+    int cached = atomic_load_explicit(&detected, memory_order_relaxed);
+    if (cached >= 0) {
+        return (calc_simd_level_t)cached;
+    }
+    int level = CALC_SIMD_SCALAR;
+#if CALC_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        level = CALC_SIMD_AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        level = CALC_SIMD_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        level = CALC_SIMD_SSE2;
+    }
+#endif
+    atomic_store_explicit(&detected, level, memory_order_relaxed);
+    return (calc_simd_level_t)level;
+}
+
+const char *calc_simd_level_name(calc_simd_level_t level) {
+    static const char *const names[CALC_SIMD_LEVEL_COUNT] = {
+        "scalar", "SSE2", "AVX2", "AVX-512"
+    };
+    return (level < CALC_SIMD_LEVEL_COUNT) ? names[level] : "unknown";
+}
+
+long calc_columns_f32_level(calc_simd_level_t level, char operation,
+                            const float *a, const float *b, float *out,
+                            uint64_t *error_bits, size_t n) {
+    if (error_bits != NULL) {
+        memset(error_bits, 0, CALC_ERROR_WORDS(n) * sizeof(uint64_t));
+    }
+
+    switch (level) {
+#if CALC_SIMD_X86
+    case CALC_SIMD_AVX512:
+        return avx512_f32(operation, a, b, out, error_bits, n);
+    case CALC_SIMD_AVX2:
+        return avx2_f32(operation, a, b, out, error_bits, n);
+    case CALC_SIMD_SSE2:
+        return sse2_f32(operation, a, b, out, error_bits, n);
+#endif
+    default:
+        return scalar_f32(operation, a, b, out, error_bits, 0, n);
+    }
+}
+
+long calc_columns_f64_level(calc_simd_level_t level, char operation,
+                            const double *a, const double *b, double *out,
+                            uint64_t *error_bits, size_t n) {
+    if (error_bits != NULL) {
+        memset(error_bits, 0, CALC_ERROR_WORDS(n) * sizeof(uint64_t));
+    }
+
+    switch (level) {
+#if CALC_SIMD_X86
+    case CALC_SIMD_AVX512:
+        return avx512_f64(operation, a, b, out, error_bits, n);
+    case CALC_SIMD_AVX2:
+        return avx2_f64(operation, a, b, out, error_bits, n);
+    case CALC_SIMD_SSE2:
+        return sse2_f64(operation, a, b, out, error_bits, n);
+#endif
+    default:
+        return scalar_f64(operation, a, b, out, error_bits, 0, n);
+    }
+}
+
+long calc_columns_f32(char operation, const float *a, const float *b,
+                      float *out, uint64_t *error_bits, size_t n) {
+    return calc_columns_f32_level(calc_simd_detect(), operation, a, b, out,
+                                  error_bits, n);
+}
+
+long calc_columns_f64(char operation, const double *a, const double *b,
+                      double *out, uint64_t *error_bits, size_t n) {
+    return calc_columns_f64_level(calc_simd_detect(), operation, a, b, out,
+                                  error_bits, n);
+}
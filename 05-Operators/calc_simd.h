@@ -0,0 +1,83 @@
+/**
+ * @file calc_simd.h
+ * @brief Column-at-a-time versions of the calculator's four operators
+ *
+ * Instead of one "num1 op num2" at a time, these kernels compute
+ * out[i] = a[i] op b[i] for whole arrays ("columns") of floats or
+ * doubles using SIMD instructions, which work on 4 to 16 numbers at
+ * once. The best instruction set the CPU supports (SSE2, AVX2 or
+ * AVX-512) is picked at run time.
+ *
+ * Division by zero does not stop the loop. Instead, out[i] is set to
+ * 0 and bit i of the error bitmap is set (bit i lives in word i / 64,
+ * position i % 64). Every level, including the plain C one, produces
+ * bit-identical results.
+ */
+
+#ifndef CALC_SIMD_H
+#define CALC_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Instruction sets the kernels can use, from slowest to fastest
+typedef enum {
+    CALC_SIMD_SCALAR = 0,
+    CALC_SIMD_SSE2,
+    CALC_SIMD_AVX2,
+    CALC_SIMD_AVX512,
+    CALC_SIMD_LEVEL_COUNT
+} calc_simd_level_t;
+
+// Number of 64-bit words needed for an error bitmap of n rows
+#define CALC_ERROR_WORDS(n) (((n) + 63) / 64)
+
+/**
+ * @brief Best level supported by this CPU (checked once with CPUID)
+ */
+calc_simd_level_t calc_simd_detect(void);
+
+/**
+ * @brief Human-readable name of a level, e.g. "AVX2"
+ */
+const char *calc_simd_level_name(calc_simd_level_t level);
+
+/**
+ * @brief Computes out[i] = a[i] op b[i] for float columns
+ * @param operation One of '+', '-', '*', '/'
+ * @param a First operand column
+ * @param b Second operand column
+ * @param out Result column (may be the same array as a or b)
+ * @param error_bits Bitmap of CALC_ERROR_WORDS(n) words; bit i is set
+ *                   when row i divides by zero (may be NULL)
+ * @param n Number of rows
+ * @return Number of rows that divided by zero, or -1 for an invalid operation
+ */
+long calc_columns_f32(char operation, const float *a, const float *b,
+                      float *out, uint64_t *error_bits, size_t n);
+
+/**
+ * @brief Computes out[i] = a[i] op b[i] for double columns
+ * @see calc_columns_f32
+ */
+long calc_columns_f64(char operation, const double *a, const double *b,
+                      double *out, uint64_t *error_bits, size_t n);
+
+/**
+ * @brief Same as calc_columns_f32 but forces a specific level
+ *
+ * Used by the benchmark to compare levels. The level must not be
+ * higher than calc_simd_detect() returns.
+ */
+long calc_columns_f32_level(calc_simd_level_t level, char operation,
+                            const float *a, const float *b, float *out,
+                            uint64_t *error_bits, size_t n);
+
+/**
+ * @brief Same as calc_columns_f64 but forces a specific level
+ */
+long calc_columns_f64_level(calc_simd_level_t level, char operation,
+                            const double *a, const double *b, double *out,
+                            uint64_t *error_bits, size_t n);
+
+#endif // CALC_SIMD_H
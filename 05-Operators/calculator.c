@@ -1,23 +1,648 @@
 /*
  * Simple Calculator Example
  * Demonstrates arithmetic operators, input/output, and if-else statements
+ *
+ * Usage:
+ *   ./calculator                  Interactive: asks for one operation
+ *   ./calculator --batch [file]   Batch: one "num1 op num2" per line,
+ *                                 read from file (or stdin if omitted)
+ *   ./calculator --expr "formula" [file]
+ *                                 Formula: compile once, then evaluate it
+ *                                 for each line of variable values
+ *   ./calculator --int TYPE [file]
+ *                                 Integers: "num1 op num2" per line in one
+ *                                 integer type (i8, u8, ... i64, u64); a
+ *                                 result that does not fit is an error
+ *   ./calculator --saturate TYPE [file]
+ *                                 Same, but such a result is clamped to
+ *                                 the type's minimum or maximum
+ *   ./calculator --money [file]   Money: "num1 op num2" per line in exact
+ *                                 decimal amounts (see common/money.h)
+ *   ./calculator --daemon SOCKET [--shm NAME]
+ *                                 Server: answers binary requests on a
+ *                                 Unix socket (and in shared memory) until
+ *                                 Ctrl+C (see calc_daemon.h)
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "calc_batch.h"
+#include "calc_daemon.h"
+#include "checked.h"
+#include "expr.h"
+#include "money.h"
+#include "scanner.h"
+#include "trace.h"
+
+// Variable bindings evaluated together in formula mode
+#define EXPR_ROWS_PER_BLOCK 4096
+
+// Records evaluated together in integer mode
+#define INT_ROWS_PER_BLOCK 4096
+
+// Whitespace strtod() would skip
+#define SPACES " \t\r\n\v\f"
+
+// Runs the streaming batch mode (see calc_batch.h)
+int run_batch_mode(const char *path) {
+    int in_fd = STDIN_FILENO;
+    calc_batch_stats_t stats;
+
+    if (path != NULL) {
+        in_fd = open(path, O_RDONLY);
+        if (in_fd < 0) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    int status = calc_batch_run(in_fd, STDOUT_FILENO, &stats);
+    if (path != NULL) {
+        close(in_fd);
+    }
+    if (status != 0) {
+        perror("calculator");
+        return 1;
+    }
+
+    fprintf(stderr, "Processed %llu records (%llu errors)\n",
+            stats.records, stats.errors);
+    return 0;
+}
+
+// Prints one block of formula results, or an error for each bad line
+void print_expression_block(const expr_program_t *program, const double *rows,
+                            const int *line_ok, const unsigned long *lines,
+                            size_t count) {
+    double results[EXPR_ROWS_PER_BLOCK];
+    unsigned char statuses[EXPR_ROWS_PER_BLOCK];
+
+    TRACE_BEGIN(evaluate);
+    expr_run_batch(program, rows, count, results, statuses);
+    TRACE_END(evaluate);
+
+    TRACE_BEGIN(format);
+    for (size_t i = 0; i < count; i++) {
+        if (!line_ok[i]) {
+            printf("Line %lu: Error: Expected %d value(s)\n", lines[i],
+                   expr_variable_count(program));
+        } else if (statuses[i] == EXPR_ERROR_DIVIDE_BY_ZERO) {
+            printf("Line %lu: Error: Cannot divide by zero!\n", lines[i]);
+        } else {
+            printf("%.2f\n", results[i]);
+        }
+    }
+    TRACE_END(format);
+}
+
+// Compiles a formula once and evaluates it for every line of values
+int run_expression_mode(const char *formula, const char *path) {
+    expr_error_t error;
+    expr_program_t *program = expr_compile(formula, &error);
+
+    if (program == NULL) {
+        fprintf(stderr, "Error in formula: %s\n", error.message);
+        fprintf(stderr, "  %s\n  %*s^\n", formula, error.position, "");
+        return 1;
+    }
+
+    FILE *input = (path != NULL) ? fopen(path, "r") : stdin;
+    if (input == NULL) {
+        perror(path);
+        expr_free(program);
+        return 1;
+    }
+
+    int variables = expr_variable_count(program);
+    fprintf(stderr, "Values per line:");
+    for (int i = 0; i < variables; i++) {
+        fprintf(stderr, " %s", expr_variable_name(program, i));
+    }
+    fprintf(stderr, "\n");
+
+    double *rows = malloc(sizeof(double) * EXPR_ROWS_PER_BLOCK *
+                          (variables > 0 ? variables : 1));
+    int line_ok[EXPR_ROWS_PER_BLOCK];
+    unsigned long lines[EXPR_ROWS_PER_BLOCK];
+    char line[4096];
+    unsigned long line_number = 0;
+    size_t count = 0;
+
+    if (rows == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        expr_free(program);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), input) != NULL) {
+        const char *p = line;
+        const char *line_end = line + strlen(line);
+        double *row = rows + count * variables;
+        int values = 0;
+
+        line_number++;
+        TRACE_BEGIN(parse);
+        while (values < variables) {
+            p += strspn(p, SPACES);
+            const char *next = scan_parse_double(p, line_end, &row[values]);
+            if (next == NULL) {
+                break;
+            }
+            p = next;
+            values++;
+        }
+        p += strspn(p, SPACES);  // Anything else on the line is an error
+        TRACE_END(parse);
+        if (values == 0 && p == line_end && variables > 0) {
+            continue;     // Skip blank lines
+        }
+
+        line_ok[count] = (values == variables && p == line_end);
+        if (!line_ok[count]) {
+            memset(row, 0, sizeof(double) * variables);
+        }
+        lines[count] = line_number;
+        if (++count == EXPR_ROWS_PER_BLOCK) {
+            print_expression_block(program, rows, line_ok, lines, count);
+            count = 0;
+            TRACE_POLL();
+        }
+    }
+    print_expression_block(program, rows, line_ok, lines, count);
+
+    if (input != stdin) {
+        fclose(input);
+    }
+    free(rows);
+    expr_free(program);
+    return 0;
+}
+
+// Reads one record line. A line that does not fit into `line` is read
+// up to its newline and thrown away, so that its tail is never taken
+// for a record of its own. Returns 1 for a line, -1 for one that was too
+// long, 0 at the end of the input.
+int read_record_line(char *line, int size, FILE *input) {
+    if (fgets(line, size, input) == NULL) {
+        return 0;
+    }
+    size_t length = strlen(line);
+    if (length + 1 < (size_t)size || line[length - 1] == '\n') {
+        return 1;
+    }
+    int c = getc(input);
+    if (c == EOF || c == '\n') {
+        return 1;         // It just fit
+    }
+    while ((c = getc(input)) != EOF && c != '\n') {
+    }
+    return -1;
+}
+
+// Why an integer-mode line could not be evaluated
+typedef enum {
+    INT_LINE_OK,
+    INT_LINE_MALFORMED,
+    INT_LINE_OUT_OF_RANGE,
+    INT_LINE_BAD_OPERATION,
+    INT_LINE_TOO_LONG
+} int_line_status_t;
+
+// One block of integer records. Operands are kept as 64-bit patterns
+// (sign-extended for signed types) until they are sorted by operator into
+// columns of the real type, one group per operator.
+typedef struct {
+    checked_type_t type;
+    int mode;
+    size_t count;
+    unsigned long lines[INT_ROWS_PER_BLOCK];
+    unsigned char status[INT_ROWS_PER_BLOCK];
+    char operation[INT_ROWS_PER_BLOCK];
+    uint64_t num1[INT_ROWS_PER_BLOCK];
+    uint64_t num2[INT_ROWS_PER_BLOCK];
+    unsigned short group_row[INT_ROWS_PER_BLOCK];
+
+    uint64_t a[4][INT_ROWS_PER_BLOCK];
+    uint64_t b[4][INT_ROWS_PER_BLOCK];
+    uint64_t out[4][INT_ROWS_PER_BLOCK];
+    uint64_t overflow[4][CHECKED_OVERFLOW_WORDS(INT_ROWS_PER_BLOCK)];
+
+    unsigned long long records;
+    unsigned long long errors;
+    unsigned long long saturated;
+} int_block_t;
+
+static const char int_operations[4] = {'+', '-', '*', '/'};
+
+// Stores a 64-bit pattern as element k of a column of the given type
+void store_integer(checked_type_t type, void *column, size_t k,
+                   uint64_t bits) {
+    switch (type) {
+    case CHECKED_I8:  ((int8_t *)column)[k] = (int8_t)bits; break;
+    case CHECKED_U8:  ((uint8_t *)column)[k] = (uint8_t)bits; break;
+    case CHECKED_I16: ((int16_t *)column)[k] = (int16_t)bits; break;
+    case CHECKED_U16: ((uint16_t *)column)[k] = (uint16_t)bits; break;
+    case CHECKED_I32: ((int32_t *)column)[k] = (int32_t)bits; break;
+    case CHECKED_U32: ((uint32_t *)column)[k] = (uint32_t)bits; break;
+    default:          ((uint64_t *)column)[k] = bits; break;
+    }
+}
+
+// Reads element k of a column back as a (sign-extended) 64-bit pattern
+uint64_t load_integer(checked_type_t type, const void *column, size_t k) {
+    switch (type) {
+    case CHECKED_I8:  return (uint64_t)(int64_t)((const int8_t *)column)[k];
+    case CHECKED_U8:  return ((const uint8_t *)column)[k];
+    case CHECKED_I16: return (uint64_t)(int64_t)((const int16_t *)column)[k];
+    case CHECKED_U16: return ((const uint16_t *)column)[k];
+    case CHECKED_I32: return (uint64_t)(int64_t)((const int32_t *)column)[k];
+    case CHECKED_U32: return ((const uint32_t *)column)[k];
+    default:          return ((const uint64_t *)column)[k];
+    }
+}
+
+// Prints a 64-bit pattern as a number of the given type
+void print_integer(checked_type_t type, uint64_t bits) {
+    if (checked_type_is_signed(type)) {
+        printf("%lld", (long long)(int64_t)bits);
+    } else {
+        printf("%llu", (unsigned long long)bits);
+    }
+}
+
+// Parses one operand and checks that it fits the type. Returns the
+// position after it, or NULL (errno is ERANGE if it was a number that
+// does not fit).
+const char *parse_integer(checked_type_t type, const char *p,
+                          const char *end, uint64_t *bits) {
+    unsigned width = (unsigned)checked_type_size(type) * 8;
+    const char *next;
+
+    errno = 0;
+    if (checked_type_is_signed(type)) {
+        long value;
+        long max = (long)((1ull << (width - 1)) - 1);
+        next = scan_parse_long(p, end, &value);
+        if (next != NULL && (value > max || value < -max - 1)) {
+            errno = ERANGE;
+            return NULL;
+        }
+        *bits = (uint64_t)(int64_t)value;
+    } else if (p < end && *p == '-') {
+        long value;     // Only "-0" fits an unsigned type
+        next = scan_parse_long(p, end, &value);
+        if (next != NULL && value != 0) {
+            errno = ERANGE;
+            return NULL;
+        }
+        *bits = 0;
+    } else {
+        unsigned long value;
+        unsigned long max = width == 64 ? ~0ul : (1ul << width) - 1;
+        next = scan_parse_ulong(p, end, &value);
+        if (next != NULL && value > max) {
+            errno = ERANGE;
+            return NULL;
+        }
+        *bits = value;
+    }
+    return next;
+}
+
+// Reads one "num1 op num2" line into row k of the block
+void read_integer_line(int_block_t *block, const char *line, size_t k) {
+    const char *p = line + strspn(line, SPACES);
+    const char *end = line + strlen(line);
+
+    block->status[k] = INT_LINE_MALFORMED;
+    p = parse_integer(block->type, p, end, &block->num1[k]);
+    if (p == NULL) {
+        if (errno == ERANGE) {
+            block->status[k] = INT_LINE_OUT_OF_RANGE;
+        }
+        return;
+    }
+    p += strspn(p, SPACES);
+    if (p == end) {
+        return;
+    }
+    block->operation[k] = *p++;
+    p += strspn(p, SPACES);
+    p = parse_integer(block->type, p, end, &block->num2[k]);
+    if (p == NULL) {
+        if (errno == ERANGE) {
+            block->status[k] = INT_LINE_OUT_OF_RANGE;
+        }
+        return;
+    }
+    if (p[strspn(p, SPACES)] != '\0') {
+        return;
+    }
+    block->status[k] = memchr(int_operations, block->operation[k], 4) != NULL
+                           ? INT_LINE_OK : INT_LINE_BAD_OPERATION;
+}
+
+// Evaluates a block: rows are sorted into one column group per operator,
+// each group is computed with one checked_columns() call, and the
+// results are printed in the original order
+void run_integer_block(int_block_t *block) {
+    checked_type_t type = block->type;
+    size_t group_count[4] = {0, 0, 0, 0};
+
+    for (size_t k = 0; k < block->count; k++) {
+        if (block->status[k] != INT_LINE_OK) {
+            continue;
+        }
+        int op = (int)((const char *)memchr(int_operations,
+                                            block->operation[k], 4) -
+                       int_operations);
+        size_t g = group_count[op]++;
+        store_integer(type, block->a[op], g, block->num1[k]);
+        store_integer(type, block->b[op], g, block->num2[k]);
+        block->group_row[k] = (unsigned short)g;
+    }
+    TRACE_BEGIN(evaluate);
+    for (int op = 0; op < 4; op++) {
+        checked_columns(type, int_operations[op], block->a[op], block->b[op],
+                        block->out[op], group_count[op], block->mode,
+                        block->overflow[op]);
+    }
+    TRACE_END(evaluate);
+
+    TRACE_BEGIN(format);
+    for (size_t k = 0; k < block->count; k++) {
+        unsigned long line = block->lines[k];
+        char operation = block->operation[k];
+
+        block->records++;
+        if (block->status[k] == INT_LINE_MALFORMED) {
+            printf("Line %lu: Error: Malformed record\n", line);
+            block->errors++;
+            continue;
+        }
+        if (block->status[k] == INT_LINE_OUT_OF_RANGE) {
+            printf("Line %lu: Error: Number out of range for %s\n", line,
+                   checked_type_name(type));
+            block->errors++;
+            continue;
+        }
+        if (block->status[k] == INT_LINE_TOO_LONG) {
+            printf("Line %lu: Error: Line too long\n", line);
+            block->errors++;
+            continue;
+        }
+        if (block->status[k] == INT_LINE_BAD_OPERATION) {
+            printf("Line %lu: Error: Invalid operation '%c'\n", line,
+                   operation);
+            block->errors++;
+            continue;
+        }
+
+        int op = (int)((const char *)memchr(int_operations, operation, 4) -
+                       int_operations);
+        size_t g = block->group_row[k];
+        int overflowed = (int)((block->overflow[op][g / 64] >> (g % 64)) & 1);
+
+        if (overflowed && operation == '/' && block->num2[k] == 0) {
+            printf("Line %lu: Error: Cannot divide by zero!\n", line);
+            block->errors++;
+            continue;
+        }
+        if (overflowed && block->mode == CHECKED_WRAP) {
+            printf("Line %lu: Error: Result does not fit in %s\n", line,
+                   checked_type_name(type));
+            block->errors++;
+            continue;
+        }
+        print_integer(type, block->num1[k]);
+        printf(" %c ", operation);
+        print_integer(type, block->num2[k]);
+        printf(" = ");
+        print_integer(type, load_integer(type, block->out[op], g));
+        if (overflowed) {
+            printf(" (saturated)");
+            block->saturated++;
+        }
+        printf("\n");
+    }
+    TRACE_END(format);
+    TRACE_COUNTER(records, block->records);
+    block->count = 0;
+}
+
+// Integer mode: every line is "num1 op num2" in one integer type
+int run_integer_mode(const char *type_name, int mode, const char *path) {
+    checked_type_t type = checked_type_from_name(type_name);
+    if (type == CHECKED_TYPE_COUNT) {
+        fprintf(stderr, "Unknown integer type '%s' (use i8, u8, i16, u16, "
+                        "i32, u32, i64 or u64)\n", type_name);
+        return 1;
+    }
+
+    FILE *input = (path != NULL) ? fopen(path, "r") : stdin;
+    if (input == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    int_block_t *block = calloc(1, sizeof(*block));
+    if (block == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        if (input != stdin) {
+            fclose(input);
+        }
+        return 1;
+    }
+    block->type = type;
+    block->mode = mode;
+
+    char line[4096];
+    unsigned long line_number = 0;
+    int got;
+    while ((got = read_record_line(line, sizeof(line), input)) != 0) {
+        line_number++;
+        if (got > 0 && line[strspn(line, SPACES)] == '\0') {
+            continue;     // Skip blank lines
+        }
+        block->lines[block->count] = line_number;
+        TRACE_BEGIN(parse);
+        if (got > 0) {
+            read_integer_line(block, line, block->count);
+        } else {
+            block->status[block->count] = INT_LINE_TOO_LONG;
+        }
+        TRACE_END(parse);
+        if (++block->count == INT_ROWS_PER_BLOCK) {
+            run_integer_block(block);
+            TRACE_POLL();
+        }
+    }
+    run_integer_block(block);
+
+    fprintf(stderr, "Processed %llu %s records (%llu errors", block->records,
+            checked_type_name(type), block->errors);
+    if (mode == CHECKED_SATURATE) {
+        fprintf(stderr, ", %llu saturated", block->saturated);
+    }
+    fprintf(stderr, ")\n");
+
+    if (input != stdin) {
+        fclose(input);
+    }
+    free(block);
+    return 0;
+}
+
+// Money mode: every line is "num1 op num2" in exact decimal amounts. + and
+// - are exact; * and / round once, to the nearest cent (or unit)
+int run_money_mode(const char *path) {
+    FILE *input = (path != NULL) ? fopen(path, "r") : stdin;
+    if (input == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    char line[4096];
+    unsigned long line_number = 0;
+    unsigned long long records = 0, errors = 0;
+
+    int got;
+    while ((got = read_record_line(line, sizeof(line), input)) != 0) {
+        const char *p = line + strspn(line, SPACES);
+        const char *end = line + strlen(line);
+        money_t num1, num2, result;
+        char operation = 0;
+
+        line_number++;
+        if (got > 0 && p == end) {
+            continue;     // Skip blank lines
+        }
+        records++;
+        errors++;         // Until the line turns out fine
+        if (got < 0) {
+            printf("Line %lu: Error: Line too long\n", line_number);
+            continue;
+        }
+
+        p = money_parse(p, end, &num1);
+        if (p != NULL) {
+            p += strspn(p, SPACES);
+            operation = p < end ? *p++ : 0;
+            p += strspn(p, SPACES);
+            p = money_parse(p, end, &num2);
+        }
+        if (p == NULL || p[strspn(p, SPACES)] != '\0') {
+            printf("Line %lu: Error: %s\n", line_number,
+                   errno == ERANGE ? "Amount too large" : "Malformed record");
+            errno = 0;
+            continue;
+        }
+
+        int overflow;
+        if (operation == '+') {
+            overflow = money_add(num1, num2, &result);
+        } else if (operation == '-') {
+            overflow = money_sub(num1, num2, &result);
+        } else if (operation == '*') {
+            overflow = money_mul(num1, num2, &result);
+        } else if (operation == '/') {
+            if (num2.units == 0) {
+                printf("Line %lu: Error: Cannot divide by zero!\n",
+                       line_number);
+                continue;
+            }
+            overflow = money_div(num1, num2, &result);
+        } else {
+            printf("Line %lu: Error: Invalid operation '%c'\n", line_number,
+                   operation);
+            continue;
+        }
+        if (overflow) {
+            printf("Line %lu: Error: Result too large\n", line_number);
+            continue;
+        }
+
+        char text1[MONEY_TEXT_MAX], text2[MONEY_TEXT_MAX];
+        char text_result[MONEY_TEXT_MAX];
+        money_format(text1, num1);
+        money_format(text2, num2);
+        money_format(text_result, result);
+        printf("%s %c %s = %s\n", text1, operation, text2, text_result);
+        errors--;
+    }
+
+    fprintf(stderr, "Processed %llu money records (%llu errors)\n", records,
+            errors);
+    if (input != stdin) {
+        fclose(input);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // Compiled in only with make trace (see common/trace.h)
+    TRACE_INIT("calculator.trace.json");
+    TRACE_THREAD_NAME("main");
+
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        return run_batch_mode(argc >= 3 ? argv[2] : NULL);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--expr") == 0) {
+        return run_expression_mode(argv[2], argc >= 4 ? argv[3] : NULL);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--int") == 0) {
+        return run_integer_mode(argv[2], CHECKED_WRAP,
+                                argc >= 4 ? argv[3] : NULL);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--money") == 0) {
+        return run_money_mode(argc >= 3 ? argv[2] : NULL);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--saturate") == 0) {
+        return run_integer_mode(argv[2], CHECKED_SATURATE,
+                                argc >= 4 ? argv[3] : NULL);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--daemon") == 0) {
+        const char *shm_name = NULL;
+        if (argc >= 5 && strcmp(argv[3], "--shm") == 0) {
+            shm_name = argv[4];
+        }
+        fprintf(stderr, "Listening on %s%s%s (Ctrl+C to stop)\n", argv[2],
+                shm_name ? " and in shared memory " : "",
+                shm_name ? shm_name : "");
+        return calc_daemon_run(argv[2], shm_name) == 0 ? 0 : 1;
+    }
 
-int main() {
     float num1, num2, result;
     char operation;
+    static char input_storage[4096];
+    scanner_t input;
+
+    scanner_init(&input, STDIN_FILENO, input_storage, sizeof(input_storage));
+    input.flush_before_read = stdout;
     
     printf("=== SIMPLE CALCULATOR ===\n");
     printf("Enter first number: ");
-    scanf("%f", &num1);
+    if (scanner_float(&input, &num1) != SCAN_OK) {
+        return scanner_exit_error(&input);
+    }
     
     printf("Enter operation (+, -, *, /): ");
-    scanf(" %c", &operation);
+    if (scanner_char(&input, &operation) != SCAN_OK) {
+        return scanner_exit_error(&input);
+    }
     
     printf("Enter second number: ");
-    scanf("%f", &num2);
+    if (scanner_float(&input, &num2) != SCAN_OK) {
+        return scanner_exit_error(&input);
+    }
     
     // Perform calculation based on operation
     if (operation == '+') {
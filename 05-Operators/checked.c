@@ -0,0 +1,456 @@
+/**
+ * @file checked.c
+ * @brief Column kernels for checked and saturating integer arithmetic
+ *
+ * Each (type, operation) pair gets a kernel per instruction set level,
+ * written once as a macro and compiled with GCC's target attribute,
+ * like calc_simd.c. The scalar level calls the __builtin_*_overflow
+ * functions of checked.h, one row and one branch at a time; it is the
+ * reference the other levels must match bit for bit.
+ *
+ * The SIMD levels compute each row without a branch so the compiler
+ * vectorizes the loop:
+ *
+ *   - 8-, 16- and 32-bit lanes compute in a type twice as wide, where
+ *     the exact result always fits, then compare it with the narrow
+ *     type's range: out of range is overflow, and a select picks the
+ *     wrapped or the saturated value
+ *   - 64-bit lanes have nothing wider, so + and - use the sign bits:
+ *     a signed sum overflowed when it has a different sign from both
+ *     operands ((a ^ r) & (b ^ r) < 0), an unsigned one when r < a
+ *   - 64-bit * and all divisions have no SIMD form; they stay scalar
+ *     (64-bit * at least picks its saturated value without a branch)
+ *
+ * The overflow flags of a block of rows are collected as bytes and then
+ * packed into the bitmap eight at a time with one multiplication.
+ */
+
+#include "checked.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+// The range checks compare, e.g., an unsigned result with 0; for some
+// types that is always false, which is the point
+#pragma GCC diagnostic ignored "-Wtype-limits"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHECKED_X86 1
+#else
+#define CHECKED_X86 0
+#endif
+
+// Rows per block: a multiple of 64, so bitmap words are never shared
+#define CHECKED_BLOCK 512
+
+// ---------------------------------------------------------------------
+// Type descriptions, looked up by token pasting on the short names
+// ---------------------------------------------------------------------
+
+#define TYPE_i8 int8_t
+#define TYPE_u8 uint8_t
+#define TYPE_i16 int16_t
+#define TYPE_u16 uint16_t
+#define TYPE_i32 int32_t
+#define TYPE_u32 uint32_t
+#define TYPE_i64 int64_t
+#define TYPE_u64 uint64_t
+
+#define MIN_i8 INT8_MIN
+#define MIN_u8 0
+#define MIN_i16 INT16_MIN
+#define MIN_u16 0
+#define MIN_i32 INT32_MIN
+#define MIN_u32 0
+#define MIN_i64 INT64_MIN
+#define MIN_u64 0
+#define MAX_i8 INT8_MAX
+#define MAX_u8 UINT8_MAX
+#define MAX_i16 INT16_MAX
+#define MAX_u16 UINT16_MAX
+#define MAX_i32 INT32_MAX
+#define MAX_u32 UINT32_MAX
+#define MAX_i64 INT64_MAX
+#define MAX_u64 UINT64_MAX
+
+// Types wide enough for any sum or difference (WIDE) and product (PRODUCT)
+#define WIDE_i8 int16_t
+#define WIDE_u8 int16_t
+#define WIDE_i16 int32_t
+#define WIDE_u16 int32_t
+#define WIDE_i32 int64_t
+#define WIDE_u32 int64_t
+#define PRODUCT_i8 int16_t
+#define PRODUCT_u8 uint16_t
+#define PRODUCT_i16 int32_t
+#define PRODUCT_u16 uint32_t
+#define PRODUCT_i32 int64_t
+#define PRODUCT_u32 uint64_t
+
+// How the SIMD levels compute each type
+#define KIND_i8 WIDE
+#define KIND_u8 WIDE
+#define KIND_i16 WIDE
+#define KIND_u16 WIDE
+#define KIND_i32 WIDE
+#define KIND_u32 WIDE
+#define KIND_i64 SIGNED64
+#define KIND_u64 UNSIGNED64
+
+#define KIND_scalar(T) BUILTIN
+#define KIND_sse2(T) KIND_##T
+#define KIND_avx2(T) KIND_##T
+#define KIND_avx512(T) KIND_##T
+
+// ---------------------------------------------------------------------
+// One row, per kind
+//
+// Each sets r to the result and bad to 1 if it overflowed. MODE is a
+// constant, so the unused branches disappear.
+// ---------------------------------------------------------------------
+
+// The builtins of checked.h, one branch per row
+#define ELEMENT_BUILTIN(T, OP, MODE, a, b, r, bad)                          \
+    do {                                                                    \
+        TYPE_##T r_;                                                        \
+        int bad_ = checked_##OP##_##T((a), (b), &r_);                       \
+        if ((MODE) == CHECKED_SATURATE && bad_) {                           \
+            r_ = saturating_##OP##_##T((a), (b));                           \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)bad_;                                              \
+    } while (0)
+
+// 8-, 16- and 32-bit: exact result in a wider type, then a range check
+#define ELEMENT_WIDENED(T, WIDER, SYMBOL, MODE, a, b, r, bad)               \
+    do {                                                                    \
+        WIDER w_ = (WIDER)((WIDER)(a) SYMBOL (WIDER)(b));                   \
+        int high_ = w_ > (WIDER)MAX_##T;                                    \
+        int low_ = w_ < (WIDER)MIN_##T;                                     \
+        TYPE_##T r_ = (TYPE_##T)w_;                                         \
+        if ((MODE) == CHECKED_SATURATE) {                                   \
+            r_ = high_ ? (TYPE_##T)MAX_##T : r_;                            \
+            r_ = low_ ? (TYPE_##T)MIN_##T : r_;                             \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)(high_ | low_);                                    \
+    } while (0)
+
+#define ELEMENT_WIDE_add(T, MODE, a, b, r, bad)                             \
+    ELEMENT_WIDENED(T, WIDE_##T, +, MODE, a, b, r, bad)
+#define ELEMENT_WIDE_sub(T, MODE, a, b, r, bad)                             \
+    ELEMENT_WIDENED(T, WIDE_##T, -, MODE, a, b, r, bad)
+#define ELEMENT_WIDE_mul(T, MODE, a, b, r, bad)                             \
+    ELEMENT_WIDENED(T, PRODUCT_##T, *, MODE, a, b, r, bad)
+#define ELEMENT_WIDE_div(T, MODE, a, b, r, bad)                             \
+    ELEMENT_BUILTIN(T, div, MODE, a, b, r, bad)
+
+// 64-bit products: the builtin, but the saturated value is picked from
+// the signs instead of multiplying a second time
+#define ELEMENT_MUL64(T, MODE, a, b, r, bad)                                \
+    do {                                                                    \
+        TYPE_##T a_ = (a);                                                  \
+        TYPE_##T b_ = (b);                                                  \
+        TYPE_##T r_;                                                        \
+        int over_ = __builtin_mul_overflow(a_, b_, &r_);                    \
+        if ((MODE) == CHECKED_SATURATE) {                                   \
+            TYPE_##T limit_ = (a_ < 1) != (b_ < 1) ? (TYPE_##T)MIN_##T      \
+                                                   : (TYPE_##T)MAX_##T;     \
+            r_ = over_ ? limit_ : r_;                                       \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)over_;                                             \
+    } while (0)
+
+// Signed 64-bit: wrap in unsigned arithmetic, then look at the signs.
+// A sum overflowed when its sign differs from both operands', a
+// difference when the operands' signs differ and the result's differs
+// from a's. Either way it went past the end a is on.
+#define ELEMENT_SIGNED64(SYMBOL, SIGNS, MODE, a, b, r, bad)                 \
+    do {                                                                    \
+        int64_t a_ = (a);                                                   \
+        int64_t b_ = (b);                                                   \
+        int64_t r_ = (int64_t)((uint64_t)a_ SYMBOL (uint64_t)b_);           \
+        int over_ = (SIGNS) < 0;                                            \
+        if ((MODE) == CHECKED_SATURATE) {                                   \
+            int64_t limit_ = a_ < 0 ? INT64_MIN : INT64_MAX;                \
+            r_ = over_ ? limit_ : r_;                                       \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)over_;                                             \
+    } while (0)
+
+#define ELEMENT_SIGNED64_add(T, MODE, a, b, r, bad)                         \
+    ELEMENT_SIGNED64(+, (a_ ^ r_) & (b_ ^ r_), MODE, a, b, r, bad)
+#define ELEMENT_SIGNED64_sub(T, MODE, a, b, r, bad)                         \
+    ELEMENT_SIGNED64(-, (a_ ^ b_) & (a_ ^ r_), MODE, a, b, r, bad)
+#define ELEMENT_SIGNED64_mul(T, MODE, a, b, r, bad)                         \
+    ELEMENT_MUL64(T, MODE, a, b, r, bad)
+#define ELEMENT_SIGNED64_div(T, MODE, a, b, r, bad)                         \
+    ELEMENT_BUILTIN(T, div, MODE, a, b, r, bad)
+
+// Unsigned 64-bit: a sum wrapped if it is smaller than a, a difference
+// if b was larger than a
+#define ELEMENT_UNSIGNED64_add(T, MODE, a, b, r, bad)                       \
+    do {                                                                    \
+        uint64_t a_ = (a);                                                  \
+        uint64_t r_ = a_ + (b);                                             \
+        int over_ = r_ < a_;                                                \
+        if ((MODE) == CHECKED_SATURATE) {                                   \
+            r_ = over_ ? UINT64_MAX : r_;                                   \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)over_;                                             \
+    } while (0)
+
+#define ELEMENT_UNSIGNED64_sub(T, MODE, a, b, r, bad)                       \
+    do {                                                                    \
+        uint64_t a_ = (a);                                                  \
+        uint64_t b_ = (b);                                                  \
+        int over_ = a_ < b_;                                                \
+        uint64_t r_ = a_ - b_;                                              \
+        if ((MODE) == CHECKED_SATURATE) {                                   \
+            r_ = over_ ? 0 : r_;                                            \
+        }                                                                   \
+        (r) = r_;                                                           \
+        (bad) = (uint8_t)over_;                                             \
+    } while (0)
+
+#define ELEMENT_UNSIGNED64_mul(T, MODE, a, b, r, bad)                       \
+    ELEMENT_MUL64(T, MODE, a, b, r, bad)
+#define ELEMENT_UNSIGNED64_div(T, MODE, a, b, r, bad)                       \
+    ELEMENT_BUILTIN(T, div, MODE, a, b, r, bad)
+
+#define ELEMENT_BUILTIN_add(T, MODE, a, b, r, bad)                          \
+    ELEMENT_BUILTIN(T, add, MODE, a, b, r, bad)
+#define ELEMENT_BUILTIN_sub(T, MODE, a, b, r, bad)                          \
+    ELEMENT_BUILTIN(T, sub, MODE, a, b, r, bad)
+#define ELEMENT_BUILTIN_mul(T, MODE, a, b, r, bad)                          \
+    ELEMENT_BUILTIN(T, mul, MODE, a, b, r, bad)
+#define ELEMENT_BUILTIN_div(T, MODE, a, b, r, bad)                          \
+    ELEMENT_BUILTIN(T, div, MODE, a, b, r, bad)
+
+// Picks the element macro of the level's kind (the extra steps let
+// KIND_level(T) expand before it is pasted)
+#define ELEMENT_PASTE(KIND, OP, ...) ELEMENT_##KIND##_##OP(__VA_ARGS__)
+#define ELEMENT_OF(KIND, OP, ...) ELEMENT_PASTE(KIND, OP, __VA_ARGS__)
+#define ELEMENT(LEVEL, T, OP, ...) ELEMENT_OF(KIND_##LEVEL(T), OP, T, __VA_ARGS__)
+
+/**
+ * @brief Packs 0/1 flag bytes into bitmap words; returns how many are set
+ *
+ * start is a multiple of 64. Multiplying eight flag bytes by
+ * 0x0102040810204080 gathers them into the top byte, first flag in the
+ * lowest bit.
+ */
+static size_t pack_flags(uint8_t *flags, size_t count, uint64_t *bits,
+                         size_t start) {
+    size_t set = 0;
+    memset(flags + count, 0, (CHECKED_BLOCK - count) % 64);
+    for (size_t w = 0; w * 64 < count; w++) {
+        uint64_t word = 0;
+        for (size_t k = 0; k < 8; k++) {
+            uint64_t eight;
+            memcpy(&eight, flags + w * 64 + k * 8, 8);
+            word |= ((eight * 0x0102040810204080ull) >> 56) << (8 * k);
+        }
+        set += (size_t)__builtin_popcountll(word);
+        if (bits != NULL) {
+            bits[start / 64 + w] = word;
+        }
+    }
+    return set;
+}
+
+// ---------------------------------------------------------------------
+// The kernel for one type and operation at one level
+// ---------------------------------------------------------------------
+
+#define CHECKED_BLOCK_LOOP(LEVEL, T, OP, MODE)                              \
+    for (size_t j = 0; j < count; j++) {                                    \
+        TYPE_##T r;                                                         \
+        ELEMENT(LEVEL, T, OP, MODE, x[j], y[j], r, flags[j]);               \
+        z[j] = r;                                                           \
+    }
+
+#define DEFINE_KERNEL(LEVEL, T, OP)                                         \
+    ATTRIBUTES_##LEVEL                                                      \
+    static size_t OP##_##T##_##LEVEL(const void *a, const void *b,          \
+                                     void *out, size_t n, int mode,         \
+                                     uint64_t *bits) {                      \
+        size_t overflows = 0;                                               \
+        uint8_t flags[CHECKED_BLOCK];                                       \
+        for (size_t start = 0; start < n; start += CHECKED_BLOCK) {         \
+            size_t count = n - start < CHECKED_BLOCK ? n - start            \
+                                                     : CHECKED_BLOCK;       \
+            const TYPE_##T *x = (const TYPE_##T *)a + start;                \
+            const TYPE_##T *y = (const TYPE_##T *)b + start;                \
+            TYPE_##T *z = (TYPE_##T *)out + start;                          \
+            if (mode == CHECKED_SATURATE) {                                 \
+                CHECKED_BLOCK_LOOP(LEVEL, T, OP, CHECKED_SATURATE)          \
+            } else {                                                        \
+                CHECKED_BLOCK_LOOP(LEVEL, T, OP, CHECKED_WRAP)              \
+            }                                                               \
+            overflows += pack_flags(flags, count, bits, start);             \
+        }                                                                   \
+        return overflows;                                                   \
+    }
+
+#define DEFINE_TYPE_KERNELS(LEVEL, T)                                       \
+    DEFINE_KERNEL(LEVEL, T, add)                                            \
+    DEFINE_KERNEL(LEVEL, T, sub)                                            \
+    DEFINE_KERNEL(LEVEL, T, mul)                                            \
+    DEFINE_KERNEL(LEVEL, T, div)
+
+#define ALL_TYPES(X, LEVEL)                                                 \
+    X(LEVEL, i8) X(LEVEL, u8) X(LEVEL, i16) X(LEVEL, u16)                   \
+    X(LEVEL, i32) X(LEVEL, u32) X(LEVEL, i64) X(LEVEL, u64)
+
+typedef size_t checked_kernel_t(const void *a, const void *b, void *out,
+                                size_t n, int mode, uint64_t *bits);
+
+// Operations in table order
+enum { OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_COUNT };
+
+#define TABLE_ROW(LEVEL, T)                                                 \
+    {add_##T##_##LEVEL, sub_##T##_##LEVEL, mul_##T##_##LEVEL,               \
+     div_##T##_##LEVEL},
+
+// The scalar baseline: one row and one branch at a time
+#define ATTRIBUTES_scalar __attribute__((optimize("no-tree-vectorize")))
+ALL_TYPES(DEFINE_TYPE_KERNELS, scalar)
+
+static checked_kernel_t *const scalar_kernels[CHECKED_TYPE_COUNT][OP_COUNT] = {
+    ALL_TYPES(TABLE_ROW, scalar)
+};
+
+#if CHECKED_X86
+// -O2 only vectorizes loops where it costs nothing extra; ask for more
+#define VECTORIZE optimize("tree-vectorize", "vect-cost-model=dynamic")
+#define ATTRIBUTES_sse2 __attribute__((target("sse2"), VECTORIZE))
+#define ATTRIBUTES_avx2 __attribute__((target("avx2"), VECTORIZE))
+#define ATTRIBUTES_avx512                                                   \
+    __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"), VECTORIZE))
+
+ALL_TYPES(DEFINE_TYPE_KERNELS, sse2)
+ALL_TYPES(DEFINE_TYPE_KERNELS, avx2)
+ALL_TYPES(DEFINE_TYPE_KERNELS, avx512)
+
+static checked_kernel_t *const sse2_kernels[CHECKED_TYPE_COUNT][OP_COUNT] = {
+    ALL_TYPES(TABLE_ROW, sse2)
+};
+
+static checked_kernel_t *const avx2_kernels[CHECKED_TYPE_COUNT][OP_COUNT] = {
+    ALL_TYPES(TABLE_ROW, avx2)
+};
+
+static checked_kernel_t *const avx512_kernels[CHECKED_TYPE_COUNT][OP_COUNT] = {
+    ALL_TYPES(TABLE_ROW, avx512)
+};
+#endif // CHECKED_X86
+
+// ---------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------
+
+static const char *const type_names[CHECKED_TYPE_COUNT] = {
+    "i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64"
+};
+
+const char *checked_type_name(checked_type_t type) {
+    return type < CHECKED_TYPE_COUNT ? type_names[type] : "unknown";
+}
+
+size_t checked_type_size(checked_type_t type) {
+    static const size_t sizes[CHECKED_TYPE_COUNT] = {1, 1, 2, 2, 4, 4, 8, 8};
+    return type < CHECKED_TYPE_COUNT ? sizes[type] : 0;
+}
+
+int checked_type_is_signed(checked_type_t type) {
+    return type < CHECKED_TYPE_COUNT && type_names[type][0] == 'i';
+}
+
+checked_type_t checked_type_from_name(const char *name) {
+    int type = 0;
+    while (type < CHECKED_TYPE_COUNT && strcmp(name, type_names[type]) != 0) {
+        type++;
+    }
+    return (checked_type_t)type;
+}
+
+checked_level_t checked_detect(void) {
+    // Any thread may get here first; each one finds the same level
+    static _Atomic int detected = -1;
+
+    int cached = atomic_load_explicit(&detected, memory_order_relaxed);
+    if (cached >= 0) {
+        return (checked_level_t)cached;
+    }
+    int level = CHECKED_LEVEL_SCALAR;
+#if CHECKED_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl")) {
+        level = CHECKED_LEVEL_AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        level = CHECKED_LEVEL_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        level = CHECKED_LEVEL_SSE2;
+    }
+#endif
+    atomic_store_explicit(&detected, level, memory_order_relaxed);
+    return (checked_level_t)level;
+}
+
+const char *checked_level_name(checked_level_t level) {
+    static const char *const names[CHECKED_LEVEL_COUNT] = {
+        "scalar", "SSE2", "AVX2", "AVX-512"
+    };
+    return level < CHECKED_LEVEL_COUNT ? names[level] : "unknown";
+}
+
+long checked_columns_level(checked_level_t level, checked_type_t type,
+                           char operation, const void *a, const void *b,
+                           void *out, size_t n, int mode,
+                           uint64_t *overflow_bits) {
+    int op;
+    switch (operation) {
+    case '+': op = OP_ADD; break;
+    case '-': op = OP_SUB; break;
+    case '*': op = OP_MUL; break;
+    case '/': op = OP_DIV; break;
+    default: return -1;
+    }
+    if (type >= CHECKED_TYPE_COUNT ||
+        (mode != CHECKED_WRAP && mode != CHECKED_SATURATE)) {
+        return -1;
+    }
+
+    checked_kernel_t *kernel;
+    switch (level) {
+#if CHECKED_X86
+    case CHECKED_LEVEL_AVX512:
+        kernel = avx512_kernels[type][op];
+        break;
+    case CHECKED_LEVEL_AVX2:
+        kernel = avx2_kernels[type][op];
+        break;
+    case CHECKED_LEVEL_SSE2:
+        kernel = sse2_kernels[type][op];
+        break;
+#endif
+    default:
+        kernel = scalar_kernels[type][op];
+        break;
+    }
+    return (long)kernel(a, b, out, n, mode, overflow_bits);
+}
+
+long checked_columns(checked_type_t type, char operation, const void *a,
+                     const void *b, void *out, size_t n, int mode,
+                     uint64_t *overflow_bits) {
+    return checked_columns_level(checked_detect(), type, operation, a, b,
+                                 out, n, mode, overflow_bits);
+}
@@ -0,0 +1,200 @@
+/**
+ * @file checked.h
+ * @brief Integer arithmetic that notices overflow: checked and saturating
+ *
+ * In C, unsigned arithmetic silently wraps around ((unsigned char)255 + 1
+ * is 0) and signed overflow is undefined behavior. The functions here
+ * say when a result did not fit, using GCC's __builtin_add_overflow()
+ * and friends, which compile to the add plus a jump-free test of the
+ * CPU's overflow or carry flag:
+ *
+ *     int32_t total;
+ *     if (checked_add_i32(a, b, &total)) {
+ *         // a + b does not fit; total holds the wrapped-around value
+ *     }
+ *     int8_t level = saturating_add_i8(120, 10);     // 127, not -126
+ *
+ * Division also "overflows" when dividing by zero (result 0) and for
+ * the one signed case that does not fit, MIN / -1 (result MIN, or MAX
+ * when saturating).
+ *
+ * checked_columns() does the same for whole arrays ("columns") of one
+ * type, out[i] = a[i] op b[i], like calc_simd.h does for floats. It
+ * never stops at an overflow: every row gets a result (wrapped around or
+ * saturated), and bit i of the overflow bitmap tells which rows did not
+ * fit. Its + - * kernels are compiled for SSE2, AVX2 and AVX-512 and
+ * the widest the CPU supports is used; they compute in a wider type (or,
+ * for 64-bit lanes, from the sign bits) without a branch per row.
+ */
+
+#ifndef CHECKED_H
+#define CHECKED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Element types of the columns
+typedef enum {
+    CHECKED_I8,
+    CHECKED_U8,
+    CHECKED_I16,
+    CHECKED_U16,
+    CHECKED_I32,
+    CHECKED_U32,
+    CHECKED_I64,
+    CHECKED_U64,
+    CHECKED_TYPE_COUNT
+} checked_type_t;
+
+// What a row that overflows gets
+#define CHECKED_WRAP 0          // The wrapped-around value, like C
+#define CHECKED_SATURATE 1      // The type's minimum or maximum
+
+// Instruction sets the column kernels are compiled for
+typedef enum {
+    CHECKED_LEVEL_SCALAR = 0,   // One row at a time, with the builtins
+    CHECKED_LEVEL_SSE2,
+    CHECKED_LEVEL_AVX2,
+    CHECKED_LEVEL_AVX512,       // With the BW/DQ/VL extensions
+    CHECKED_LEVEL_COUNT
+} checked_level_t;
+
+// Number of 64-bit words needed for an overflow bitmap of n rows
+#define CHECKED_OVERFLOW_WORDS(n) (((n) + 63) / 64)
+
+// ---------------------------------------------------------------------
+// One value at a time
+//
+// checked_OP_T(a, b, &r) returns 1 if the result did not fit (r is then
+// the wrapped-around value), 0 otherwise. saturating_OP_T(a, b) returns
+// the result clamped to the type's range.
+// ---------------------------------------------------------------------
+
+#define CHECKED_DEFINE_SCALAR(T, TYPE, MIN, MAX)                            \
+    static inline int checked_add_##T(TYPE a, TYPE b, TYPE *result) {       \
+        return __builtin_add_overflow(a, b, result);                        \
+    }                                                                       \
+    static inline int checked_sub_##T(TYPE a, TYPE b, TYPE *result) {       \
+        return __builtin_sub_overflow(a, b, result);                        \
+    }                                                                       \
+    static inline int checked_mul_##T(TYPE a, TYPE b, TYPE *result) {       \
+        return __builtin_mul_overflow(a, b, result);                        \
+    }                                                                       \
+    static inline int checked_div_##T(TYPE a, TYPE b, TYPE *result) {       \
+        if (b == 0) {                                                       \
+            *result = 0;                                                    \
+            return 1;                                                       \
+        }                                                                   \
+        if ((MIN) != 0 && a == (TYPE)(MIN) && b == (TYPE)-1) {              \
+            *result = a;                                                    \
+            return 1;                                                       \
+        }                                                                   \
+        *result = (TYPE)(a / b);                                            \
+        return 0;                                                           \
+    }                                                                       \
+    static inline TYPE saturating_add_##T(TYPE a, TYPE b) {                 \
+        TYPE result;                                                        \
+        if (__builtin_add_overflow(a, b, &result)) {                        \
+            return b < 1 ? (TYPE)(MIN) : (TYPE)(MAX);                       \
+        }                                                                   \
+        return result;                                                      \
+    }                                                                       \
+    static inline TYPE saturating_sub_##T(TYPE a, TYPE b) {                 \
+        TYPE result;                                                        \
+        if (__builtin_sub_overflow(a, b, &result)) {                        \
+            return b > 0 ? (TYPE)(MIN) : (TYPE)(MAX);                       \
+        }                                                                   \
+        return result;                                                      \
+    }                                                                       \
+    static inline TYPE saturating_mul_##T(TYPE a, TYPE b) {                 \
+        TYPE result;                                                        \
+        if (__builtin_mul_overflow(a, b, &result)) {                        \
+            return (a < 1) != (b < 1) ? (TYPE)(MIN) : (TYPE)(MAX);          \
+        }                                                                   \
+        return result;                                                      \
+    }                                                                       \
+    static inline TYPE saturating_div_##T(TYPE a, TYPE b) {                 \
+        TYPE result;                                                        \
+        if (checked_div_##T(a, b, &result)) {                               \
+            return b == 0 ? (TYPE)0 : (TYPE)(MAX);                          \
+        }                                                                   \
+        return result;                                                      \
+    }
+
+CHECKED_DEFINE_SCALAR(i8, int8_t, INT8_MIN, INT8_MAX)
+CHECKED_DEFINE_SCALAR(u8, uint8_t, 0, UINT8_MAX)
+CHECKED_DEFINE_SCALAR(i16, int16_t, INT16_MIN, INT16_MAX)
+CHECKED_DEFINE_SCALAR(u16, uint16_t, 0, UINT16_MAX)
+CHECKED_DEFINE_SCALAR(i32, int32_t, INT32_MIN, INT32_MAX)
+CHECKED_DEFINE_SCALAR(u32, uint32_t, 0, UINT32_MAX)
+CHECKED_DEFINE_SCALAR(i64, int64_t, INT64_MIN, INT64_MAX)
+CHECKED_DEFINE_SCALAR(u64, uint64_t, 0, UINT64_MAX)
+
+// ---------------------------------------------------------------------
+// Whole columns
+// ---------------------------------------------------------------------
+
+/**
+ * @brief Short name of a type, e.g. "i16"
+ */
+const char *checked_type_name(checked_type_t type);
+
+/**
+ * @brief Size of one element of the type in bytes
+ */
+size_t checked_type_size(checked_type_t type);
+
+/**
+ * @brief 1 for the signed types (i8 ... i64), 0 for the unsigned ones
+ */
+int checked_type_is_signed(checked_type_t type);
+
+/**
+ * @brief Looks a type up by its short name
+ * @return The type, or CHECKED_TYPE_COUNT if the name is unknown
+ */
+checked_type_t checked_type_from_name(const char *name);
+
+/**
+ * @brief Computes out[i] = a[i] op b[i] for columns of one integer type
+ *
+ * @param type Element type of a, b and out
+ * @param operation One of '+', '-', '*', '/'
+ * @param a First operand column
+ * @param b Second operand column
+ * @param out Result column (may be the same array as a or b)
+ * @param n Number of rows
+ * @param mode CHECKED_WRAP or CHECKED_SATURATE
+ * @param overflow_bits Bitmap of CHECKED_OVERFLOW_WORDS(n) words; bit i
+ *                      is set when row i overflowed or divided by zero
+ *                      (may be NULL)
+ * @return Number of rows that overflowed, or -1 for an invalid type,
+ *         operation or mode
+ */
+long checked_columns(checked_type_t type, char operation, const void *a,
+                     const void *b, void *out, size_t n, int mode,
+                     uint64_t *overflow_bits);
+
+/**
+ * @brief Best level supported by this CPU (checked once with CPUID)
+ */
+checked_level_t checked_detect(void);
+
+/**
+ * @brief Human-readable name of a level, e.g. "AVX2"
+ */
+const char *checked_level_name(checked_level_t level);
+
+/**
+ * @brief Same as checked_columns() but forces a specific level
+ *
+ * Used by the benchmark to compare levels. The level must not be
+ * higher than checked_detect() returns. Every level gives bit-identical
+ * results.
+ */
+long checked_columns_level(checked_level_t level, checked_type_t type,
+                           char operation, const void *a, const void *b,
+                           void *out, size_t n, int mode,
+                           uint64_t *overflow_bits);
+
+#endif // CHECKED_H
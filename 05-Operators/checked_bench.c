@@ -0,0 +1,434 @@
+/**
+ * @file checked_bench.c
+ * @brief What noticing integer overflow costs
+ *
+ * First the checked column kernels are verified:
+ *   - the scalar level (the __builtin_*_overflow functions) against exact
+ *     128-bit arithmetic, for every type, operation and mode
+ *   - every SIMD level against the scalar level, bit for bit: results,
+ *     overflow bitmaps and counts, also with out == a (in place)
+ * The inputs mix random numbers with the values where overflow happens:
+ * MIN, MAX, 0, 1, -1 and their neighbours.
+ *
+ * Then, for each type and operation, it times plain C arithmetic (which
+ * wraps around silently) compiled for the same instruction set against
+ * the checked kernels: the builtins one row at a time, the branch-free
+ * kernel that wraps and reports, and the one that saturates. The
+ * operands are random over the whole range of the type, so many sums and
+ * nearly all products overflow; divisors are never 0 or -1, so the plain
+ * division does not trap.
+ *
+ * Usage: ./checked_bench [rows]   (default 16384, fits in the L2 cache)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "checked.h"
+
+// Minimum number of rows processed per measurement
+#define ROWS_PER_MEASUREMENT 50000000.0
+
+// Rows used by the correctness checks (odd, so the tails are exercised)
+#define VERIFY_ROWS 100003
+
+static const char operations[] = "+-*/";
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_state = 0x9e3779b97f4a7c15ull;
+
+// xorshift64: rand() only gives 31 bits
+static uint64_t random_bits(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// ---------------------------------------------------------------------
+// Columns of any type, seen through 64-bit patterns
+// ---------------------------------------------------------------------
+
+static unsigned type_bits(checked_type_t type) {
+    return (unsigned)checked_type_size(type) * 8;
+}
+
+// The low bits of a pattern that a column of the type keeps
+static uint64_t type_mask(checked_type_t type) {
+    unsigned width = type_bits(type);
+    return width == 64 ? ~0ull : (1ull << width) - 1;
+}
+
+static uint64_t load_bits(checked_type_t type, const void *column, size_t i) {
+    uint64_t bits = 0;
+    memcpy(&bits, (const char *)column + i * checked_type_size(type),
+           checked_type_size(type));     // Little-endian, like x86
+    return bits;
+}
+
+static void store_bits(checked_type_t type, void *column, size_t i,
+                       uint64_t bits) {
+    memcpy((char *)column + i * checked_type_size(type), &bits,
+           checked_type_size(type));
+}
+
+// Fills a column with random values; every fourth one is an edge value
+static void fill_column(checked_type_t type, void *column, size_t n) {
+    uint64_t sign = 1ull << (type_bits(type) - 1);
+    uint64_t edges[] = {
+        0, 1, ~0ull, 2, ~0ull - 1,              // 0, 1, -1 (MAX), 2, -2
+        sign, sign + 1, sign - 1, sign - 2,     // MIN, MIN + 1, MAX, MAX - 1
+        type_mask(type)                         // -1 or the unsigned MAX
+    };
+    for (size_t i = 0; i < n; i++) {
+        uint64_t bits = random_bits();
+        if (bits % 4 == 0) {
+            bits = edges[(bits >> 8) % (sizeof(edges) / sizeof(edges[0]))];
+        }
+        store_bits(type, column, i, bits & type_mask(type));
+    }
+}
+
+// ---------------------------------------------------------------------
+// The exact reference
+// ---------------------------------------------------------------------
+
+__extension__ typedef __int128 exact_t;
+__extension__ typedef unsigned __int128 exact_unsigned_t;
+
+static exact_t exact_value(checked_type_t type, uint64_t bits) {
+    unsigned width = type_bits(type);
+    if (checked_type_is_signed(type) && (bits >> (width - 1)) & 1) {
+        return (exact_t)bits - ((exact_t)1 << width);
+    }
+    return (exact_t)bits;
+}
+
+/**
+ * @brief Computes what row a op b must give, with 128-bit integers
+ * @return 1 if the row overflows (or divides by zero)
+ */
+static int reference_row(checked_type_t type, char operation, uint64_t a,
+                         uint64_t b, int mode, uint64_t *result) {
+    unsigned width = type_bits(type);
+    int is_signed = checked_type_is_signed(type);
+    exact_t min = is_signed ? -((exact_t)1 << (width - 1)) : 0;
+    exact_t max = is_signed ? ((exact_t)1 << (width - 1)) - 1
+                            : (exact_t)type_mask(type);
+    exact_t x = exact_value(type, a), y = exact_value(type, b);
+    exact_t exact = 0;
+
+    switch (operation) {
+    case '+': exact = x + y; break;
+    case '-': exact = x - y; break;
+    case '*':
+        if (type == CHECKED_U64) {
+            // The only product that does not fit in a signed __int128
+            exact_unsigned_t product = (exact_unsigned_t)a * b;
+            *result = (product > UINT64_MAX && mode == CHECKED_SATURATE)
+                          ? UINT64_MAX : (uint64_t)product;
+            return product > UINT64_MAX;
+        }
+        exact = x * y;
+        break;
+    default:
+        if (y == 0) {
+            *result = 0;
+            return 1;
+        }
+        exact = x / y;
+        break;
+    }
+
+    int overflow = exact < min || exact > max;
+    if (overflow && mode == CHECKED_SATURATE) {
+        exact = exact < min ? min : max;
+    }
+    *result = (uint64_t)exact & type_mask(type);
+    return overflow;
+}
+
+static int bit_set(const uint64_t *bits, size_t i) {
+    return (int)((bits[i / 64] >> (i % 64)) & 1);
+}
+
+// ---------------------------------------------------------------------
+// Correctness
+// ---------------------------------------------------------------------
+
+/**
+ * @brief Checks the scalar level against the reference and every other
+ *        level against the scalar level
+ * @return 1 if everything matches
+ */
+static int verify(checked_level_t best) {
+    size_t n = VERIFY_ROWS, words = CHECKED_OVERFLOW_WORDS(n);
+    uint64_t *a = malloc(n * 8), *b = malloc(n * 8);
+    uint64_t *expected = malloc(n * 8), *actual = malloc(n * 8);
+    uint64_t *expected_bits = malloc(words * 8);
+    uint64_t *actual_bits = malloc(words * 8);
+    int ok = 1;
+
+    if (!a || !b || !expected || !actual || !expected_bits || !actual_bits) {
+        fprintf(stderr, "Out of memory\n");
+        return 0;
+    }
+
+    for (int t = 0; t < CHECKED_TYPE_COUNT; t++) {
+        checked_type_t type = (checked_type_t)t;
+        size_t bytes = n * checked_type_size(type);
+        fill_column(type, a, n);
+        fill_column(type, b, n);
+
+        for (int op = 0; op < 4; op++) {
+            for (int mode = CHECKED_WRAP; mode <= CHECKED_SATURATE; mode++) {
+                long count = checked_columns_level(
+                    CHECKED_LEVEL_SCALAR, type, operations[op], a, b,
+                    expected, n, mode, expected_bits);
+                long reference_count = 0;
+
+                for (size_t i = 0; i < n; i++) {
+                    uint64_t result;
+                    int overflow = reference_row(type, operations[op],
+                                                 load_bits(type, a, i),
+                                                 load_bits(type, b, i),
+                                                 mode, &result);
+                    reference_count += overflow;
+                    if (result != load_bits(type, expected, i) ||
+                        overflow != bit_set(expected_bits, i)) {
+                        printf("Mismatch: %s %c, row %zu: scalar level "
+                               "differs from exact arithmetic\n",
+                               checked_type_name(type), operations[op], i);
+                        ok = 0;
+                        break;
+                    }
+                }
+                ok &= count == reference_count;
+
+                for (int level = CHECKED_LEVEL_SSE2; level <= (int)best;
+                     level++) {
+                    long level_count = checked_columns_level(
+                        (checked_level_t)level, type, operations[op], a, b,
+                        actual, n, mode, actual_bits);
+                    int same = level_count == count &&
+                               memcmp(actual, expected, bytes) == 0 &&
+                               memcmp(actual_bits, expected_bits,
+                                      words * 8) == 0;
+                    if (!same) {
+                        printf("Mismatch: %s %c (%s): %s differs from "
+                               "scalar\n", checked_type_name(type),
+                               operations[op],
+                               mode == CHECKED_WRAP ? "wrap" : "saturate",
+                               checked_level_name((checked_level_t)level));
+                    }
+                    ok &= same;
+                }
+
+                // In place: the result overwrites the first operand
+                memcpy(actual, a, bytes);
+                long in_place_count = checked_columns_level(
+                    best, type, operations[op], actual, b, actual, n, mode,
+                    actual_bits);
+                ok &= in_place_count == count &&
+                      memcmp(actual, expected, bytes) == 0;
+            }
+        }
+    }
+
+    free(a); free(b); free(expected); free(actual);
+    free(expected_bits); free(actual_bits);
+    return ok;
+}
+
+// ---------------------------------------------------------------------
+// Plain arithmetic, for the baseline
+//
+// Computed in an unsigned type so that wrapping around is defined (and
+// uint16_t * uint16_t does not overflow an int); compiled with the same
+// target and vectorizer settings as the checked kernels.
+// ---------------------------------------------------------------------
+
+#define BENCH_TYPES(X, LEVEL)                                               \
+    X(LEVEL, i8, int8_t, unsigned) X(LEVEL, u8, uint8_t, unsigned)          \
+    X(LEVEL, i16, int16_t, unsigned) X(LEVEL, u16, uint16_t, unsigned)      \
+    X(LEVEL, i32, int32_t, unsigned) X(LEVEL, u32, uint32_t, unsigned)      \
+    X(LEVEL, i64, int64_t, uint64_t) X(LEVEL, u64, uint64_t, uint64_t)
+
+#define DEFINE_PLAIN(LEVEL, T, TYPE, UNSIGNED)                              \
+    ATTRIBUTES_##LEVEL                                                      \
+    static void plain_add_##T##_##LEVEL(const void *a, const void *b,       \
+                                        void *out, size_t n) {              \
+        const TYPE *x = a, *y = b;                                          \
+        TYPE *z = out;                                                      \
+        for (size_t i = 0; i < n; i++) {                                    \
+            z[i] = (TYPE)((UNSIGNED)x[i] + (UNSIGNED)y[i]);                 \
+        }                                                                   \
+    }                                                                       \
+    ATTRIBUTES_##LEVEL                                                      \
+    static void plain_sub_##T##_##LEVEL(const void *a, const void *b,       \
+                                        void *out, size_t n) {              \
+        const TYPE *x = a, *y = b;                                          \
+        TYPE *z = out;                                                      \
+        for (size_t i = 0; i < n; i++) {                                    \
+            z[i] = (TYPE)((UNSIGNED)x[i] - (UNSIGNED)y[i]);                 \
+        }                                                                   \
+    }                                                                       \
+    ATTRIBUTES_##LEVEL                                                      \
+    static void plain_mul_##T##_##LEVEL(const void *a, const void *b,       \
+                                        void *out, size_t n) {              \
+        const TYPE *x = a, *y = b;                                          \
+        TYPE *z = out;                                                      \
+        for (size_t i = 0; i < n; i++) {                                    \
+            z[i] = (TYPE)((UNSIGNED)x[i] * (UNSIGNED)y[i]);                 \
+        }                                                                   \
+    }                                                                       \
+    ATTRIBUTES_##LEVEL                                                      \
+    static void plain_div_##T##_##LEVEL(const void *a, const void *b,       \
+                                        void *out, size_t n) {              \
+        const TYPE *x = a, *y = b;                                          \
+        TYPE *z = out;                                                      \
+        for (size_t i = 0; i < n; i++) {                                    \
+            z[i] = (TYPE)(x[i] / y[i]);                                     \
+        }                                                                   \
+    }
+
+typedef void plain_kernel_t(const void *a, const void *b, void *out,
+                            size_t n);
+
+#define PLAIN_ROW(LEVEL, T, TYPE, UNSIGNED)                                 \
+    {plain_add_##T##_##LEVEL, plain_sub_##T##_##LEVEL,                      \
+     plain_mul_##T##_##LEVEL, plain_div_##T##_##LEVEL},
+
+#define ATTRIBUTES_scalar __attribute__((optimize("no-tree-vectorize")))
+BENCH_TYPES(DEFINE_PLAIN, scalar)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VECTORIZE optimize("tree-vectorize", "vect-cost-model=dynamic")
+#define ATTRIBUTES_sse2 __attribute__((target("sse2"), VECTORIZE))
+#define ATTRIBUTES_avx2 __attribute__((target("avx2"), VECTORIZE))
+#define ATTRIBUTES_avx512                                                   \
+    __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"), VECTORIZE))
+
+BENCH_TYPES(DEFINE_PLAIN, sse2)
+BENCH_TYPES(DEFINE_PLAIN, avx2)
+BENCH_TYPES(DEFINE_PLAIN, avx512)
+#endif
+
+static plain_kernel_t *const plain_kernels[CHECKED_LEVEL_COUNT]
+                                          [CHECKED_TYPE_COUNT][4] = {
+    {BENCH_TYPES(PLAIN_ROW, scalar)},
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    {BENCH_TYPES(PLAIN_ROW, sse2)},
+    {BENCH_TYPES(PLAIN_ROW, avx2)},
+    {BENCH_TYPES(PLAIN_ROW, avx512)},
+#endif
+};
+
+// ---------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------
+
+typedef struct {
+    checked_level_t level;      // CHECKED_LEVEL_COUNT: the plain kernel
+    int mode;
+} variant_t;
+
+// Million rows per second of one variant on columns of n rows
+static double measure(variant_t variant, checked_type_t type, int op,
+                      checked_level_t best, const void *a, const void *b,
+                      void *out, size_t n, uint64_t *bits) {
+    int repeats = (int)(ROWS_PER_MEASUREMENT / n) + 1;
+    double start = now_seconds();
+
+    for (int r = 0; r < repeats; r++) {
+        if (variant.level == CHECKED_LEVEL_COUNT) {
+            plain_kernels[best][type][op](a, b, out, n);
+        } else {
+            checked_columns_level(variant.level, type, operations[op], a, b,
+                                  out, n, variant.mode, bits);
+        }
+    }
+    return (double)n * repeats / (now_seconds() - start) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 16384;
+    checked_level_t best = checked_detect();
+
+    if (argc >= 2) {
+        n = strtoul(argv[1], NULL, 10);
+        if (n == 0) {
+            fprintf(stderr, "Usage: %s [rows]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("=== CHECKED INTEGER ARITHMETIC BENCHMARK ===\n");
+    printf("Best level on this CPU: %s\n", checked_level_name(best));
+
+    if (!verify(best)) {
+        fprintf(stderr, "Error: checked results are wrong!\n");
+        return 1;
+    }
+    printf("Scalar level matches exact 128-bit arithmetic; all levels "
+           "bit-identical to scalar\n(values, overflow bitmaps and counts, "
+           "wrap and saturate, also in place)\n");
+
+    uint64_t *a = malloc(n * 8), *b = malloc(n * 8), *out = malloc(n * 8);
+    uint64_t *bits = malloc(CHECKED_OVERFLOW_WORDS(n) * 8);
+    if (!a || !b || !out || !bits) {
+        fprintf(stderr, "Out of memory for %zu rows\n", n);
+        return 1;
+    }
+
+    variant_t variants[] = {
+        {CHECKED_LEVEL_COUNT, CHECKED_WRAP},    // Plain C, at the best level
+        {CHECKED_LEVEL_SCALAR, CHECKED_WRAP},   // The builtins, row by row
+        {best, CHECKED_WRAP},
+        {best, CHECKED_SATURATE}
+    };
+
+    printf("\n--- %zu rows, million rows per second (%s) ---\n", n,
+           checked_level_name(best));
+    printf("%-4s %2s %9s %9s %9s %9s %10s %10s\n", "Type", "Op", "plain",
+           "builtins", "checked", "saturate", "checked%", "saturate%");
+
+    for (int t = 0; t < CHECKED_TYPE_COUNT; t++) {
+        checked_type_t type = (checked_type_t)t;
+        uint64_t minus_one = type_mask(type);
+
+        fill_column(type, a, n);
+        fill_column(type, b, n);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t divisor = load_bits(type, b, i);
+            if (divisor == 0 || divisor == minus_one) {
+                store_bits(type, b, i, 3);   // Keep the plain division legal
+            }
+        }
+
+        for (int op = 0; op < 4; op++) {
+            double rate[4];
+            for (int v = 0; v < 4; v++) {
+                rate[v] = measure(variants[v], type, op, best, a, b, out, n,
+                                  bits);
+            }
+            // Overhead: extra time per row compared with plain arithmetic
+            printf("%-4s %2c %9.0f %9.0f %9.0f %9.0f %+9.0f%% %+9.0f%%\n",
+                   checked_type_name(type), operations[op], rate[0], rate[1],
+                   rate[2], rate[3], (rate[0] / rate[2] - 1) * 100,
+                   (rate[0] / rate[3] - 1) * 100);
+        }
+    }
+
+    free(a); free(b); free(out); free(bits);
+    return 0;
+}
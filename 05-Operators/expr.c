@@ -0,0 +1,1011 @@
+/**
+ * @file expr.c
+ * @brief Expression compiler and bytecode virtual machine
+ *
+ * Compilation happens in three steps:
+ *   1. A recursive-descent parser builds a syntax tree.
+ *   2. The optimizer folds constant sub-expressions ("2 * 3" becomes 6)
+ *      and removes branches that can never run ("1 ? a : b" becomes a).
+ *   3. The code generator turns the tree into stack-machine bytecode.
+ *
+ * The virtual machine then runs the bytecode with a small local stack.
+ * With GCC or Clang it jumps straight from one instruction handler to
+ * the next ("computed goto"); other compilers use a switch statement.
+ */
+
+#include "expr.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && !defined(EXPR_NO_COMPUTED_GOTO)
+#define EXPR_COMPUTED_GOTO 1
+#else
+#define EXPR_COMPUTED_GOTO 0
+#endif
+
+// Deepest nesting the recursive parser accepts
+#define MAX_PARSE_DEPTH 200
+
+// Most syntax tree nodes. A chain like "x+x+...+x" is as deep as it is
+// long and the passes over the tree recurse, so it is limited here; its
+// bytecode could not be longer than UINT16_MAX + 1 instructions anyway.
+#define MAX_NODES 65536
+
+// Bytecode instructions (also used as operators in the syntax tree)
+typedef enum {
+    OP_CONST,           // push constants[arg]
+    OP_VAR,             // push variables[arg]
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_POW,
+    OP_ADD_K, OP_SUB_K, OP_MUL_K, OP_DIV_K,   // top = top op constants[arg]
+    OP_ADD_V, OP_SUB_V, OP_MUL_V, OP_DIV_V,   // top = top op variables[arg]
+    OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE,
+    OP_NEG, OP_NOT, OP_BOOL,
+    OP_SQRT, OP_ABS, OP_FLOOR, OP_CEIL, OP_MIN, OP_MAX,
+    OP_JUMP,            // continue at arg
+    OP_JUMP_IF_FALSE,   // pop; continue at arg if it was 0
+    OP_AND,             // if top is 0 continue at arg, else pop
+    OP_OR,              // if top is not 0 set it to 1 and continue at arg
+    OP_RETURN,
+    OP_COUNT
+} opcode_t;
+
+static const char *const OPCODE_NAMES[OP_COUNT] = {
+    "CONST", "VAR", "ADD", "SUB", "MUL", "DIV", "MOD", "POW",
+    "ADD_K", "SUB_K", "MUL_K", "DIV_K", "ADD_V", "SUB_V", "MUL_V", "DIV_V",
+    "EQ", "NE", "LT", "LE", "GT", "GE", "NEG", "NOT", "BOOL",
+    "SQRT", "ABS", "FLOOR", "CEIL", "MIN", "MAX",
+    "JUMP", "JUMP_IF_FALSE", "AND", "OR", "RETURN"
+};
+
+// One 4-byte instruction
+typedef struct {
+    uint16_t op;
+    uint16_t arg;
+} expr_insn_t;
+
+typedef enum {
+    NODE_NUMBER,
+    NODE_VARIABLE,
+    NODE_UNARY,     // op child[0]
+    NODE_BINARY,    // child[0] op child[1]
+    NODE_TERNARY    // child[0] ? child[1] : child[2]
+} node_kind_t;
+
+typedef struct {
+    node_kind_t kind;
+    int op;
+    double value;
+    int variable;
+    int child[3];
+} node_t;
+
+struct expr_program {
+    node_t *tree;              // Syntax tree exactly as parsed
+    int tree_root;
+    int node_count;
+    expr_insn_t *code;
+    size_t code_length;
+    double *constants;
+    int constant_count;
+    int variable_count;
+    char names[EXPR_MAX_VARIABLES][EXPR_MAX_NAME_LENGTH];
+};
+
+// ---------------------------------------------------------------------
+// Operator semantics shared by the folder, the tree walker and the VM
+// ---------------------------------------------------------------------
+
+static inline double apply_binary(int op, double a, double b,
+                                  expr_status_t *status) {
+    switch (op) {
+    case OP_ADD: return a + b;
+    case OP_SUB: return a - b;
+    case OP_MUL: return a * b;
+    case OP_DIV:
+        if (b == 0) {
+            *status = EXPR_ERROR_DIVIDE_BY_ZERO;
+        }
+        return a / b;
+    case OP_MOD:
+        if (b == 0) {
+            *status = EXPR_ERROR_DIVIDE_BY_ZERO;
+        }
+        return fmod(a, b);
+    case OP_POW: return pow(a, b);
+    case OP_EQ: return a == b;
+    case OP_NE: return a != b;
+    case OP_LT: return a < b;
+    case OP_LE: return a <= b;
+    case OP_GT: return a > b;
+    case OP_GE: return a >= b;
+    case OP_MIN: return a < b ? a : b;
+    case OP_MAX: return a > b ? a : b;
+    default: return 0;
+    }
+}
+
+static inline double apply_unary(int op, double a) {
+    switch (op) {
+    case OP_NEG: return -a;
+    case OP_NOT: return a == 0;
+    case OP_BOOL: return a != 0;
+    case OP_SQRT: return sqrt(a);
+    case OP_ABS: return fabs(a);
+    case OP_FLOOR: return floor(a);
+    case OP_CEIL: return ceil(a);
+    default: return 0;
+    }
+}
+
+// ---------------------------------------------------------------------
+// Parser
+// ---------------------------------------------------------------------
+
+typedef struct {
+    const char *source;
+    const char *p;
+    expr_program_t *program;
+    expr_error_t *error;
+    int capacity;
+    int depth;
+    int failed;
+} parser_t;
+
+static void parse_fail(parser_t *parser, const char *message) {
+    if (!parser->failed) {
+        parser->failed = 1;
+        if (parser->error != NULL) {
+            parser->error->position = (int)(parser->p - parser->source);
+            snprintf(parser->error->message, sizeof(parser->error->message),
+                     "%s", message);
+        }
+    }
+}
+
+static int new_node(parser_t *parser, node_kind_t kind, int op) {
+    expr_program_t *program = parser->program;
+
+    if (program->node_count == MAX_NODES) {
+        parse_fail(parser, "Expression is too large");
+        return -1;
+    }
+    if (program->node_count == parser->capacity) {
+        int capacity = parser->capacity ? parser->capacity * 2 : 32;
+        node_t *tree = realloc(program->tree, capacity * sizeof(node_t));
+        if (tree == NULL) {
+            parse_fail(parser, "Out of memory");
+            return -1;
+        }
+        program->tree = tree;
+        parser->capacity = capacity;
+    }
+
+    node_t *node = &program->tree[program->node_count];
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->op = op;
+    node->child[0] = node->child[1] = node->child[2] = -1;
+    return program->node_count++;
+}
+
+static int make_unary(parser_t *parser, int op, int operand) {
+    if (parser->failed) {
+        return -1;
+    }
+    int index = new_node(parser, NODE_UNARY, op);
+    if (index >= 0) {
+        parser->program->tree[index].child[0] = operand;
+    }
+    return index;
+}
+
+static int make_binary(parser_t *parser, int op, int left, int right) {
+    if (parser->failed) {
+        return -1;
+    }
+    int index = new_node(parser, NODE_BINARY, op);
+    if (index >= 0) {
+        parser->program->tree[index].child[0] = left;
+        parser->program->tree[index].child[1] = right;
+    }
+    return index;
+}
+
+static void skip_spaces(parser_t *parser) {
+    while (isspace((unsigned char)*parser->p)) {
+        parser->p++;
+    }
+}
+
+// Consumes token if it is next in the input
+static int accept(parser_t *parser, const char *token) {
+    size_t length = strlen(token);
+
+    skip_spaces(parser);
+    if (strncmp(parser->p, token, length) != 0) {
+        return 0;
+    }
+    // Do not read "<=" as "<" or "==" as "="
+    if (length == 1 && (token[0] == '<' || token[0] == '>' ||
+                        token[0] == '!') && parser->p[1] == '=') {
+        return 0;
+    }
+    parser->p += length;
+    return 1;
+}
+
+static int parse_expression(parser_t *parser);
+static int parse_unary(parser_t *parser);
+
+static int find_or_add_variable(parser_t *parser, const char *name,
+                                size_t length) {
+    expr_program_t *program = parser->program;
+
+    for (int i = 0; i < program->variable_count; i++) {
+        if (strlen(program->names[i]) == length &&
+            strncmp(program->names[i], name, length) == 0) {
+            return i;
+        }
+    }
+    if (program->variable_count == EXPR_MAX_VARIABLES) {
+        parse_fail(parser, "Too many variables");
+        return -1;
+    }
+    if (length >= EXPR_MAX_NAME_LENGTH) {
+        parse_fail(parser, "Variable name is too long");
+        return -1;
+    }
+    memcpy(program->names[program->variable_count], name, length);
+    program->names[program->variable_count][length] = '\0';
+    return program->variable_count++;
+}
+
+static int function_opcode(const char *name, size_t length, int *arguments) {
+    static const struct { const char *name; int op; int arguments; } table[] = {
+        {"sqrt", OP_SQRT, 1}, {"abs", OP_ABS, 1}, {"floor", OP_FLOOR, 1},
+        {"ceil", OP_CEIL, 1}, {"min", OP_MIN, 2}, {"max", OP_MAX, 2}
+    };
+
+    for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++) {
+        if (strlen(table[i].name) == length &&
+            strncmp(table[i].name, name, length) == 0) {
+            *arguments = table[i].arguments;
+            return table[i].op;
+        }
+    }
+    return -1;
+}
+
+// primary := number | name | name '(' args ')' | '(' expression ')'
+static int parse_primary(parser_t *parser) {
+    skip_spaces(parser);
+
+    if (accept(parser, "(")) {
+        int inner = parse_expression(parser);
+        if (!accept(parser, ")")) {
+            parse_fail(parser, "Expected ')'");
+        }
+        return inner;
+    }
+
+    if (isdigit((unsigned char)*parser->p) || *parser->p == '.') {
+        char *end;
+        double value = strtod(parser->p, &end);
+        if (end == parser->p) {
+            parse_fail(parser, "Invalid number");
+            return -1;
+        }
+        parser->p = end;
+        int index = new_node(parser, NODE_NUMBER, OP_CONST);
+        if (index >= 0) {
+            parser->program->tree[index].value = value;
+        }
+        return index;
+    }
+
+    if (isalpha((unsigned char)*parser->p) || *parser->p == '_') {
+        const char *name = parser->p;
+        while (isalnum((unsigned char)*parser->p) || *parser->p == '_') {
+            parser->p++;
+        }
+        size_t length = (size_t)(parser->p - name);
+
+        if (accept(parser, "(")) {
+            int arguments;
+            int op = function_opcode(name, length, &arguments);
+            if (op < 0) {
+                parser->p = name;
+                parse_fail(parser, "Unknown function");
+                return -1;
+            }
+            int first = parse_expression(parser);
+            int result;
+            if (arguments == 2) {
+                if (!accept(parser, ",")) {
+                    parse_fail(parser, "Expected ',' (function takes 2 arguments)");
+                }
+                int second = parse_expression(parser);
+                result = make_binary(parser, op, first, second);
+            } else {
+                result = make_unary(parser, op, first);
+            }
+            if (!accept(parser, ")")) {
+                parse_fail(parser, "Expected ')'");
+            }
+            return result;
+        }
+
+        int variable = find_or_add_variable(parser, name, length);
+        int index = new_node(parser, NODE_VARIABLE, OP_VAR);
+        if (index >= 0) {
+            parser->program->tree[index].variable = variable;
+        }
+        return index;
+    }
+
+    parse_fail(parser, *parser->p ? "Unexpected character"
+                                  : "Unexpected end of expression");
+    return -1;
+}
+
+// power := primary ('^' unary)?      (so 2^-1 and 2^3^2 work)
+static int parse_power(parser_t *parser) {
+    int base = parse_primary(parser);
+    if (accept(parser, "^")) {
+        int exponent = parse_unary(parser);
+        return make_binary(parser, OP_POW, base, exponent);
+    }
+    return base;
+}
+
+// unary := ('-' | '+' | '!') unary | power
+static int parse_unary(parser_t *parser) {
+    if (++parser->depth > MAX_PARSE_DEPTH) {
+        parse_fail(parser, "Expression nests too deeply");
+        return -1;
+    }
+
+    int result;
+    if (accept(parser, "-")) {
+        result = make_unary(parser, OP_NEG, parse_unary(parser));
+    } else if (accept(parser, "+")) {
+        result = parse_unary(parser);
+    } else if (accept(parser, "!")) {
+        result = make_unary(parser, OP_NOT, parse_unary(parser));
+    } else {
+        result = parse_power(parser);
+    }
+
+    parser->depth--;
+    return result;
+}
+
+static int parse_multiplicative(parser_t *parser) {
+    int left = parse_unary(parser);
+
+    while (!parser->failed) {
+        if (accept(parser, "*")) {
+            left = make_binary(parser, OP_MUL, left, parse_unary(parser));
+        } else if (accept(parser, "/")) {
+            left = make_binary(parser, OP_DIV, left, parse_unary(parser));
+        } else if (accept(parser, "%")) {
+            left = make_binary(parser, OP_MOD, left, parse_unary(parser));
+        } else {
+            break;
+        }
+    }
+    return left;
+}
+
+static int parse_additive(parser_t *parser) {
+    int left = parse_multiplicative(parser);
+
+    while (!parser->failed) {
+        if (accept(parser, "+")) {
+            left = make_binary(parser, OP_ADD, left,
+                               parse_multiplicative(parser));
+        } else if (accept(parser, "-")) {
+            left = make_binary(parser, OP_SUB, left,
+                               parse_multiplicative(parser));
+        } else {
+            break;
+        }
+    }
+    return left;
+}
+
+static int parse_relational(parser_t *parser) {
+    int left = parse_additive(parser);
+
+    while (!parser->failed) {
+        if (accept(parser, "<=")) {
+            left = make_binary(parser, OP_LE, left, parse_additive(parser));
+        } else if (accept(parser, ">=")) {
+            left = make_binary(parser, OP_GE, left, parse_additive(parser));
+        } else if (accept(parser, "<")) {
+            left = make_binary(parser, OP_LT, left, parse_additive(parser));
+        } else if (accept(parser, ">")) {
+            left = make_binary(parser, OP_GT, left, parse_additive(parser));
+        } else {
+            break;
+        }
+    }
+    return left;
+}
+
+static int parse_equality(parser_t *parser) {
+    int left = parse_relational(parser);
+
+    while (!parser->failed) {
+        if (accept(parser, "==")) {
+            left = make_binary(parser, OP_EQ, left, parse_relational(parser));
+        } else if (accept(parser, "!=")) {
+            left = make_binary(parser, OP_NE, left, parse_relational(parser));
+        } else {
+            break;
+        }
+    }
+    return left;
+}
+
+static int parse_and(parser_t *parser) {
+    int left = parse_equality(parser);
+
+    while (!parser->failed && accept(parser, "&&")) {
+        left = make_binary(parser, OP_AND, left, parse_equality(parser));
+    }
+    return left;
+}
+
+static int parse_or(parser_t *parser) {
+    int left = parse_and(parser);
+
+    while (!parser->failed && accept(parser, "||")) {
+        left = make_binary(parser, OP_OR, left, parse_and(parser));
+    }
+    return left;
+}
+
+// expression := or ('?' expression ':' expression)?
+static int parse_expression(parser_t *parser) {
+    if (++parser->depth > MAX_PARSE_DEPTH) {
+        parse_fail(parser, "Expression nests too deeply");
+        return -1;
+    }
+
+    int condition = parse_or(parser);
+    if (!parser->failed && accept(parser, "?")) {
+        int if_true = parse_expression(parser);
+        if (!accept(parser, ":")) {
+            parse_fail(parser, "Expected ':'");
+        }
+        int if_false = parse_expression(parser);
+        if (!parser->failed) {
+            int index = new_node(parser, NODE_TERNARY, 0);
+            if (index >= 0) {
+                node_t *node = &parser->program->tree[index];
+                node->child[0] = condition;
+                node->child[1] = if_true;
+                node->child[2] = if_false;
+            }
+            condition = index;
+        }
+    }
+
+    parser->depth--;
+    return condition;
+}
+
+// ---------------------------------------------------------------------
+// Optimizer: constant folding and dead-branch elimination
+// ---------------------------------------------------------------------
+
+static int is_number(const node_t *nodes, int index) {
+    return nodes[index].kind == NODE_NUMBER;
+}
+
+static void make_number(node_t *node, double value) {
+    node->kind = NODE_NUMBER;
+    node->op = OP_CONST;
+    node->value = value;
+}
+
+/**
+ * @brief Simplifies the tree in place (works on a copy of the parse tree)
+ */
+static void optimize(node_t *nodes, int index) {
+    node_t *node = &nodes[index];
+
+    for (int i = 0; i < 3; i++) {
+        if (node->child[i] >= 0) {
+            optimize(nodes, node->child[i]);
+        }
+    }
+
+    if (node->kind == NODE_UNARY && is_number(nodes, node->child[0])) {
+        make_number(node, apply_unary(node->op, nodes[node->child[0]].value));
+    } else if (node->kind == NODE_TERNARY &&
+               is_number(nodes, node->child[0])) {
+        // Only one branch can ever run: keep it, drop the other
+        int taken = nodes[node->child[0]].value != 0 ? node->child[1]
+                                                      : node->child[2];
+        *node = nodes[taken];
+    } else if (node->kind == NODE_BINARY &&
+               (node->op == OP_AND || node->op == OP_OR) &&
+               is_number(nodes, node->child[0])) {
+        int left_true = nodes[node->child[0]].value != 0;
+        if (node->op == OP_AND && !left_true) {
+            make_number(node, 0);             // 0 && x  ->  0
+        } else if (node->op == OP_OR && left_true) {
+            make_number(node, 1);             // 1 || x  ->  1
+        } else {
+            // 1 && x  and  0 || x  both reduce to "x != 0"
+            node->kind = NODE_UNARY;
+            node->op = OP_BOOL;
+            node->child[0] = node->child[1];
+            node->child[1] = -1;
+            if (is_number(nodes, node->child[0])) {
+                make_number(node, nodes[node->child[0]].value != 0);
+            }
+        }
+    } else if (node->kind == NODE_BINARY &&
+               node->op != OP_AND && node->op != OP_OR &&
+               is_number(nodes, node->child[0]) &&
+               is_number(nodes, node->child[1])) {
+        expr_status_t status = EXPR_OK;
+        double value = apply_binary(node->op, nodes[node->child[0]].value,
+                                    nodes[node->child[1]].value, &status);
+        // A constant division by zero is left for run time to report
+        if (status == EXPR_OK) {
+            make_number(node, value);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+// Code generator
+// ---------------------------------------------------------------------
+
+typedef struct {
+    expr_program_t *program;
+    const node_t *nodes;
+    size_t capacity;
+    int constant_capacity;
+    int depth;
+    int max_depth;
+    int failed;
+} codegen_t;
+
+static size_t emit(codegen_t *gen, int op, int arg) {
+    expr_program_t *program = gen->program;
+
+    if (program->code_length == gen->capacity) {
+        size_t capacity = gen->capacity ? gen->capacity * 2 : 32;
+        // Jump targets are 16-bit, so programs stay below 64K instructions
+        expr_insn_t *code = NULL;
+        if (capacity <= UINT16_MAX + 1u) {
+            code = realloc(program->code, capacity * sizeof(expr_insn_t));
+        }
+        if (code == NULL) {
+            gen->failed = 1;
+            return 0;
+        }
+        program->code = code;
+        gen->capacity = capacity;
+    }
+    program->code[program->code_length].op = (uint16_t)op;
+    program->code[program->code_length].arg = (uint16_t)arg;
+    return program->code_length++;
+}
+
+static void push_depth(codegen_t *gen, int change) {
+    gen->depth += change;
+    if (gen->depth > gen->max_depth) {
+        gen->max_depth = gen->depth;
+    }
+}
+
+static int add_constant(codegen_t *gen, double value) {
+    expr_program_t *program = gen->program;
+
+    for (int i = 0; i < program->constant_count; i++) {
+        if (memcmp(&program->constants[i], &value, sizeof(value)) == 0) {
+            return i;
+        }
+    }
+    if (program->constant_count == gen->constant_capacity) {
+        int capacity = gen->constant_capacity ? gen->constant_capacity * 2 : 8;
+        double *constants = NULL;
+        if (capacity <= UINT16_MAX + 1) {
+            constants = realloc(program->constants, capacity * sizeof(double));
+        }
+        if (constants == NULL) {
+            gen->failed = 1;
+            return 0;
+        }
+        program->constants = constants;
+        gen->constant_capacity = capacity;
+    }
+    program->constants[program->constant_count] = value;
+    return program->constant_count++;
+}
+
+static int is_leaf(const node_t *node) {
+    return node->kind == NODE_NUMBER || node->kind == NODE_VARIABLE;
+}
+
+static void generate(codegen_t *gen, int index) {
+    const node_t *node = &gen->nodes[index];
+
+    if (gen->failed) {
+        return;
+    }
+
+    switch (node->kind) {
+    case NODE_NUMBER:
+        emit(gen, OP_CONST, add_constant(gen, node->value));
+        push_depth(gen, 1);
+        break;
+
+    case NODE_VARIABLE:
+        emit(gen, OP_VAR, node->variable);
+        push_depth(gen, 1);
+        break;
+
+    case NODE_UNARY:
+        generate(gen, node->child[0]);
+        emit(gen, node->op, 0);
+        break;
+
+    case NODE_TERNARY: {
+        generate(gen, node->child[0]);
+        size_t to_else = emit(gen, OP_JUMP_IF_FALSE, 0);
+        push_depth(gen, -1);
+        generate(gen, node->child[1]);
+        size_t to_end = emit(gen, OP_JUMP, 0);
+        push_depth(gen, -1);
+        gen->program->code[to_else].arg = (uint16_t)gen->program->code_length;
+        generate(gen, node->child[2]);
+        gen->program->code[to_end].arg = (uint16_t)gen->program->code_length;
+        break;
+    }
+
+    case NODE_BINARY: {
+        int op = node->op;
+        const node_t *left = &gen->nodes[node->child[0]];
+        const node_t *right = &gen->nodes[node->child[1]];
+        int left_index = node->child[0];
+        int right_index = node->child[1];
+
+        if (op == OP_AND || op == OP_OR) {
+            generate(gen, left_index);
+            size_t jump = emit(gen, op, 0);
+            push_depth(gen, -1);
+            generate(gen, right_index);
+            emit(gen, OP_BOOL, 0);
+            gen->program->code[jump].arg = (uint16_t)gen->program->code_length;
+            break;
+        }
+
+        // a + b == b + a, so put a lone number or variable on the right
+        // where it can be folded into the instruction
+        if ((op == OP_ADD || op == OP_MUL) && is_leaf(left) &&
+            !is_leaf(right)) {
+            const node_t *swap = left;
+            left = right;
+            right = swap;
+            left_index = node->child[1];
+            right_index = node->child[0];
+        }
+
+        generate(gen, left_index);
+        if (op >= OP_ADD && op <= OP_DIV && right->kind == NODE_NUMBER) {
+            emit(gen, OP_ADD_K + (op - OP_ADD),
+                 add_constant(gen, right->value));
+        } else if (op >= OP_ADD && op <= OP_DIV &&
+                   right->kind == NODE_VARIABLE) {
+            emit(gen, OP_ADD_V + (op - OP_ADD), right->variable);
+        } else {
+            generate(gen, right_index);
+            emit(gen, op, 0);
+            push_depth(gen, -1);
+        }
+        break;
+    }
+    }
+}
+
+// ---------------------------------------------------------------------
+// Public interface
+// ---------------------------------------------------------------------
+
+expr_program_t *expr_compile(const char *source, expr_error_t *error) {
+    expr_program_t *program = calloc(1, sizeof(*program));
+    parser_t parser = {source, source, program, error, 0, 0, 0};
+
+    if (program == NULL) {
+        return NULL;
+    }
+
+    program->tree_root = parse_expression(&parser);
+    skip_spaces(&parser);
+    if (!parser.failed && *parser.p != '\0') {
+        parse_fail(&parser, "Unexpected text after expression");
+    }
+    if (parser.failed) {
+        expr_free(program);
+        return NULL;
+    }
+
+    // Optimize a copy so expr_eval_tree() still sees the original tree
+    node_t *optimized = malloc(program->node_count * sizeof(node_t));
+    codegen_t gen = {program, optimized, 0, 0, 0, 0, 0};
+    if (optimized == NULL) {
+        expr_free(program);
+        return NULL;
+    }
+    memcpy(optimized, program->tree, program->node_count * sizeof(node_t));
+    optimize(optimized, program->tree_root);
+    generate(&gen, program->tree_root);
+    emit(&gen, OP_RETURN, 0);
+    free(optimized);
+
+    if (gen.failed || gen.max_depth > EXPR_MAX_STACK) {
+        if (error != NULL) {
+            error->position = 0;
+            snprintf(error->message, sizeof(error->message), "%s",
+                     gen.failed ? "Expression is too large"
+                                : "Expression needs too much stack");
+        }
+        expr_free(program);
+        return NULL;
+    }
+    return program;
+}
+
+void expr_free(expr_program_t *program) {
+    if (program != NULL) {
+        free(program->tree);
+        free(program->code);
+        free(program->constants);
+        free(program);
+    }
+}
+
+int expr_variable_count(const expr_program_t *program) {
+    return program->variable_count;
+}
+
+const char *expr_variable_name(const expr_program_t *program, int index) {
+    return program->names[index];
+}
+
+size_t expr_instruction_count(const expr_program_t *program) {
+    return program->code_length;
+}
+
+void expr_disassemble(const expr_program_t *program, FILE *out) {
+    for (size_t i = 0; i < program->code_length; i++) {
+        const expr_insn_t *insn = &program->code[i];
+        fprintf(out, "%4zu  %-14s", i, OPCODE_NAMES[insn->op]);
+        switch (insn->op) {
+        case OP_CONST: case OP_ADD_K: case OP_SUB_K: case OP_MUL_K:
+        case OP_DIV_K:
+            fprintf(out, "%g", program->constants[insn->arg]);
+            break;
+        case OP_VAR: case OP_ADD_V: case OP_SUB_V: case OP_MUL_V:
+        case OP_DIV_V:
+            fprintf(out, "%s", program->names[insn->arg]);
+            break;
+        case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_AND: case OP_OR:
+            fprintf(out, "-> %u", insn->arg);
+            break;
+        default:
+            break;
+        }
+        fprintf(out, "\n");
+    }
+}
+
+// The VM's instruction handlers are written once and expand either to
+// labels reached by computed goto or to the cases of a switch statement
+#if EXPR_COMPUTED_GOTO
+#define VM_LABEL(op) [op] = __extension__ &&label_##op
+#define VM_CASE(op) label_##op
+#define VM_NEXT() __extension__ ({ insn = *ip++; goto *dispatch[insn.op]; })
+#else
+#define VM_CASE(op) case op
+#define VM_NEXT() continue
+#endif
+
+double expr_run(const expr_program_t *program, const double *variables,
+                expr_status_t *status) {
+    double stack[EXPR_MAX_STACK + 1];
+    double *sp = stack;            // sp points at the top value
+    const expr_insn_t *code = program->code;
+    const expr_insn_t *ip = code;
+    const double *constants = program->constants;
+    expr_status_t result_status = EXPR_OK;
+    expr_insn_t insn;
+    double b;
+
+#if EXPR_COMPUTED_GOTO
+    static const void *const dispatch[OP_COUNT] = {
+        VM_LABEL(OP_CONST), VM_LABEL(OP_VAR),
+        VM_LABEL(OP_ADD), VM_LABEL(OP_SUB), VM_LABEL(OP_MUL),
+        VM_LABEL(OP_DIV), VM_LABEL(OP_MOD), VM_LABEL(OP_POW),
+        VM_LABEL(OP_ADD_K), VM_LABEL(OP_SUB_K), VM_LABEL(OP_MUL_K),
+        VM_LABEL(OP_DIV_K), VM_LABEL(OP_ADD_V), VM_LABEL(OP_SUB_V),
+        VM_LABEL(OP_MUL_V), VM_LABEL(OP_DIV_V),
+        VM_LABEL(OP_EQ), VM_LABEL(OP_NE), VM_LABEL(OP_LT), VM_LABEL(OP_LE),
+        VM_LABEL(OP_GT), VM_LABEL(OP_GE),
+        VM_LABEL(OP_NEG), VM_LABEL(OP_NOT), VM_LABEL(OP_BOOL),
+        VM_LABEL(OP_SQRT), VM_LABEL(OP_ABS), VM_LABEL(OP_FLOOR),
+        VM_LABEL(OP_CEIL), VM_LABEL(OP_MIN), VM_LABEL(OP_MAX),
+        VM_LABEL(OP_JUMP), VM_LABEL(OP_JUMP_IF_FALSE),
+        VM_LABEL(OP_AND), VM_LABEL(OP_OR), VM_LABEL(OP_RETURN)
+    };
+    VM_NEXT();
+#else
+    for (;;) {
+        insn = *ip++;
+        switch (insn.op) {
+#endif
+
+    VM_CASE(OP_CONST): *++sp = constants[insn.arg]; VM_NEXT();
+    VM_CASE(OP_VAR):   *++sp = variables[insn.arg]; VM_NEXT();
+
+    VM_CASE(OP_ADD): sp--; *sp = *sp + sp[1]; VM_NEXT();
+    VM_CASE(OP_SUB): sp--; *sp = *sp - sp[1]; VM_NEXT();
+    VM_CASE(OP_MUL): sp--; *sp = *sp * sp[1]; VM_NEXT();
+    VM_CASE(OP_DIV):
+        sp--;
+        if (sp[1] == 0) {
+            result_status = EXPR_ERROR_DIVIDE_BY_ZERO;
+        }
+        *sp = *sp / sp[1];
+        VM_NEXT();
+    VM_CASE(OP_MOD):
+        sp--;
+        *sp = apply_binary(OP_MOD, *sp, sp[1], &result_status);
+        VM_NEXT();
+    VM_CASE(OP_POW): sp--; *sp = pow(*sp, sp[1]); VM_NEXT();
+
+    VM_CASE(OP_ADD_K): *sp = *sp + constants[insn.arg]; VM_NEXT();
+    VM_CASE(OP_SUB_K): *sp = *sp - constants[insn.arg]; VM_NEXT();
+    VM_CASE(OP_MUL_K): *sp = *sp * constants[insn.arg]; VM_NEXT();
+    VM_CASE(OP_DIV_K):
+        b = constants[insn.arg];
+        if (b == 0) {
+            result_status = EXPR_ERROR_DIVIDE_BY_ZERO;
+        }
+        *sp = *sp / b;
+        VM_NEXT();
+
+    VM_CASE(OP_ADD_V): *sp = *sp + variables[insn.arg]; VM_NEXT();
+    VM_CASE(OP_SUB_V): *sp = *sp - variables[insn.arg]; VM_NEXT();
+    VM_CASE(OP_MUL_V): *sp = *sp * variables[insn.arg]; VM_NEXT();
+    VM_CASE(OP_DIV_V):
+        b = variables[insn.arg];
+        if (b == 0) {
+            result_status = EXPR_ERROR_DIVIDE_BY_ZERO;
+        }
+        *sp = *sp / b;
+        VM_NEXT();
+
+    VM_CASE(OP_EQ): sp--; *sp = *sp == sp[1]; VM_NEXT();
+    VM_CASE(OP_NE): sp--; *sp = *sp != sp[1]; VM_NEXT();
+    VM_CASE(OP_LT): sp--; *sp = *sp < sp[1]; VM_NEXT();
+    VM_CASE(OP_LE): sp--; *sp = *sp <= sp[1]; VM_NEXT();
+    VM_CASE(OP_GT): sp--; *sp = *sp > sp[1]; VM_NEXT();
+    VM_CASE(OP_GE): sp--; *sp = *sp >= sp[1]; VM_NEXT();
+
+    VM_CASE(OP_NEG):   *sp = -*sp; VM_NEXT();
+    VM_CASE(OP_NOT):   *sp = *sp == 0; VM_NEXT();
+    VM_CASE(OP_BOOL):  *sp = *sp != 0; VM_NEXT();
+    VM_CASE(OP_SQRT):  *sp = sqrt(*sp); VM_NEXT();
+    VM_CASE(OP_ABS):   *sp = fabs(*sp); VM_NEXT();
+    VM_CASE(OP_FLOOR): *sp = floor(*sp); VM_NEXT();
+    VM_CASE(OP_CEIL):  *sp = ceil(*sp); VM_NEXT();
+    VM_CASE(OP_MIN): sp--; *sp = *sp < sp[1] ? *sp : sp[1]; VM_NEXT();
+    VM_CASE(OP_MAX): sp--; *sp = *sp > sp[1] ? *sp : sp[1]; VM_NEXT();
+
+    VM_CASE(OP_JUMP): ip = code + insn.arg; VM_NEXT();
+    VM_CASE(OP_JUMP_IF_FALSE):
+        if (*sp-- == 0) {
+            ip = code + insn.arg;
+        }
+        VM_NEXT();
+    VM_CASE(OP_AND):
+        if (*sp == 0) {
+            *sp = 0;
+            ip = code + insn.arg;
+        } else {
+            sp--;
+        }
+        VM_NEXT();
+    VM_CASE(OP_OR):
+        if (*sp != 0) {
+            *sp = 1;
+            ip = code + insn.arg;
+        } else {
+            sp--;
+        }
+        VM_NEXT();
+
+    VM_CASE(OP_RETURN):
+        goto done;
+
+#if !EXPR_COMPUTED_GOTO
+        default:
+            goto done;
+        }
+    }
+#endif
+
+done:
+    *status = result_status;
+    return *sp;
+}
+
+size_t expr_run_batch(const expr_program_t *program, const double *rows,
+                      size_t count, double *results,
+                      unsigned char *statuses) {
+    size_t stride = (size_t)program->variable_count;
+    size_t errors = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        expr_status_t status;
+        results[i] = expr_run(program, rows + i * stride, &status);
+        if (statuses != NULL) {
+            statuses[i] = (unsigned char)status;
+        }
+        errors += (status != EXPR_OK);
+    }
+    return errors;
+}
+
+static double eval_node(const node_t *nodes, int index,
+                        const double *variables, expr_status_t *status) {
+    const node_t *node = &nodes[index];
+
+    switch (node->kind) {
+    case NODE_NUMBER:
+        return node->value;
+    case NODE_VARIABLE:
+        return variables[node->variable];
+    case NODE_UNARY:
+        return apply_unary(node->op,
+                           eval_node(nodes, node->child[0], variables, status));
+    case NODE_TERNARY:
+        if (eval_node(nodes, node->child[0], variables, status) != 0) {
+            return eval_node(nodes, node->child[1], variables, status);
+        }
+        return eval_node(nodes, node->child[2], variables, status);
+    case NODE_BINARY:
+        if (node->op == OP_AND) {
+            return eval_node(nodes, node->child[0], variables, status) != 0 &&
+                   eval_node(nodes, node->child[1], variables, status) != 0;
+        }
+        if (node->op == OP_OR) {
+            return eval_node(nodes, node->child[0], variables, status) != 0 ||
+                   eval_node(nodes, node->child[1], variables, status) != 0;
+        }
+        {
+            double a = eval_node(nodes, node->child[0], variables, status);
+            double b = eval_node(nodes, node->child[1], variables, status);
+            return apply_binary(node->op, a, b, status);
+        }
+    }
+    return 0;
+}
+
+double expr_eval_tree(const expr_program_t *program, const double *variables,
+                      expr_status_t *status) {
+    *status = EXPR_OK;
+    return eval_node(program->tree, program->tree_root, variables, status);
+}
@@ -0,0 +1,115 @@
+/**
+ * @file expr.h
+ * @brief Expression compiler and bytecode virtual machine
+ *
+ * The simple calculator handles one operator between two numbers.
+ * This module handles whole formulas such as "price * (1 + tax) - d"
+ * with C-style operator precedence, parentheses and variables.
+ *
+ * A formula is compiled once into compact bytecode (with constants
+ * folded and dead branches removed) and can then be evaluated very
+ * quickly for millions of different variable values.
+ *
+ * Supported syntax, from lowest to highest precedence:
+ *   c ? a : b                 conditional
+ *   ||  &&                    logical or / and (short-circuit)
+ *   ==  !=  <  <=  >  >=      comparisons (result is 1 or 0)
+ *   +  -                      addition, subtraction
+ *   *  /  %                   multiplication, division, remainder
+ *   -x  +x  !x                unary operators
+ *   x ^ y                     power (right-associative)
+ *   sqrt abs floor ceil min max   built-in functions
+ */
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Limits for one compiled expression
+#define EXPR_MAX_VARIABLES 64
+#define EXPR_MAX_NAME_LENGTH 32
+#define EXPR_MAX_STACK 64
+
+// Evaluation status
+typedef enum {
+    EXPR_OK = 0,
+    EXPR_ERROR_DIVIDE_BY_ZERO
+} expr_status_t;
+
+// Describes why compilation failed
+typedef struct {
+    int position;          // Offset into the source text
+    char message[96];
+} expr_error_t;
+
+// A compiled expression (opaque)
+typedef struct expr_program expr_program_t;
+
+/**
+ * @brief Compiles an expression into bytecode
+ * @param source Expression text, e.g. "a * x + b"
+ * @param error Receives position and message if compilation fails
+ * @return Compiled program, or NULL on a syntax error
+ */
+expr_program_t *expr_compile(const char *source, expr_error_t *error);
+
+/**
+ * @brief Releases a compiled program
+ */
+void expr_free(expr_program_t *program);
+
+/**
+ * @brief Number of distinct variables, in order of first appearance
+ */
+int expr_variable_count(const expr_program_t *program);
+
+/**
+ * @brief Name of variable number index
+ */
+const char *expr_variable_name(const expr_program_t *program, int index);
+
+/**
+ * @brief Number of bytecode instructions after optimization
+ */
+size_t expr_instruction_count(const expr_program_t *program);
+
+/**
+ * @brief Prints a readable listing of the bytecode
+ */
+void expr_disassemble(const expr_program_t *program, FILE *out);
+
+/**
+ * @brief Evaluates the bytecode for one set of variable values
+ * @param program Compiled program
+ * @param variables One value per variable (see expr_variable_name)
+ * @param status Receives EXPR_OK or EXPR_ERROR_DIVIDE_BY_ZERO
+ * @return Value of the expression
+ */
+double expr_run(const expr_program_t *program, const double *variables,
+                expr_status_t *status);
+
+/**
+ * @brief Evaluates the bytecode for many rows of variable values
+ * @param program Compiled program
+ * @param rows Row-major values, expr_variable_count() per row
+ * @param count Number of rows
+ * @param results Receives one value per row
+ * @param statuses Receives one status per row (may be NULL)
+ * @return Number of rows that divided by zero
+ */
+size_t expr_run_batch(const expr_program_t *program, const double *rows,
+                      size_t count, double *results,
+                      unsigned char *statuses);
+
+/**
+ * @brief Evaluates the unoptimized syntax tree by walking it recursively
+ *
+ * This is the naive evaluator the bytecode VM is benchmarked against.
+ * It gives the same answers as expr_run().
+ */
+double expr_eval_tree(const expr_program_t *program, const double *variables,
+                      expr_status_t *status);
+
+#endif // EXPR_H
@@ -0,0 +1,312 @@
+/**
+ * @file scan_bench.c
+ * @brief Number parsing benchmark: scanner.h against scanf and strtod
+ *
+ * Generates 100 million numeric tokens (by default) in memory - scores
+ * like "87.05", whole numbers, short scientific numbers like "6.02e23"
+ * and full 17-digit doubles with large exponents - and parses all of
+ * them four ways:
+ *
+ *   - fscanf("%lf"), the way the interactive programs used to read
+ *   - strtod() over the text, with whitespace skipped by hand
+ *   - scan_parse_double() over the text
+ *   - scanner_double(), reading the file descriptor in blocks
+ *
+ * Before timing anything, every token is checked against strtod() and
+ * strtof(): scan_parse_double() and scan_parse_float() must return
+ * bit for bit the same value and stop at the same character. Each
+ * timed method must then produce the same fingerprint of all values.
+ *
+ * Usage: ./scan_bench [tokens]   (default 100000000)
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "scanner.h"
+
+#define DEFAULT_TOKENS 100000000UL
+#define GENERATE_CHUNK (1 << 20)
+#define SCANNER_STORAGE (64 * 1024)
+#define MISMATCHES_SHOWN 5
+
+typedef enum {
+    METHOD_SCANF, METHOD_STRTOD, METHOD_PARSE, METHOD_SCANNER, METHOD_COUNT
+} method_t;
+
+static const char *method_names[METHOD_COUNT] = {
+    "fscanf(\"%lf\")", "strtod()", "scan_parse_double()", "scanner_double()"
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_state = 88172645463325252ull;
+static uint64_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+           c == '\f';
+}
+
+// Writes at least min_digits decimal digits of value
+static char *put_digits(char *p, uint64_t value, int min_digits) {
+    char digits[24];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0 || count < min_digits);
+    while (count > 0) {
+        *p++ = digits[--count];
+    }
+    return p;
+}
+
+static char *put_exponent(char *p, int exponent) {
+    *p++ = 'e';
+    if (exponent < 0) {
+        *p++ = '-';
+        exponent = -exponent;
+    }
+    return put_digits(p, (uint64_t)exponent, 1);
+}
+
+// Appends one random token of one of the five kinds
+static char *put_token(char *p) {
+    uint64_t r = next_random();
+    uint64_t digits = r >> 8;
+    switch (r % 5) {
+    case 0:
+    case 1:     // A score: 87.05
+        p = put_digits(p, digits % 101, 1);
+        *p++ = '.';
+        return put_digits(p, (digits >> 8) % 100, 2);
+    case 2:     // A whole number: -12345
+        if (digits & 1) {
+            *p++ = '-';
+        }
+        return put_digits(p, (digits >> 1) % 1000000, 1);
+    case 3:     // Short scientific: 6.022e23
+        p = put_digits(p, 1 + digits % 9, 1);
+        *p++ = '.';
+        p = put_digits(p, (digits >> 4) % 1000, 3);
+        return put_exponent(p, (int)((digits >> 16) % 61) - 30);
+    default:    // All 17 digits of a double: 1.2345678901234567e-123
+        p = put_digits(p, 1 + digits % 9, 1);
+        *p++ = '.';
+        p = put_digits(p, next_random() % 10000000000000000ull, 16);
+        return put_exponent(p, (int)((digits >> 8) % 615) - 307);
+    }
+}
+
+/**
+ * @brief Fills a memory file with count tokens, eight per line
+ * @return The file descriptor, or -1
+ */
+static int generate_tokens(unsigned long count, size_t *size) {
+    static char chunk[GENERATE_CHUNK + 64];
+    int fd = memfd_create("scan_bench", 0);
+    size_t used = 0;
+
+    *size = 0;
+    for (unsigned long i = 0; fd >= 0 && i < count; i++) {
+        char *p = put_token(chunk + used);
+        *p++ = (i % 8 == 7 || i + 1 == count) ? '\n' : ' ';
+        used = (size_t)(p - chunk);
+        if (used >= GENERATE_CHUNK || i + 1 == count) {
+            if (write(fd, chunk, used) != (ssize_t)used) {
+                close(fd);
+                return -1;
+            }
+            *size += used;
+            used = 0;
+        }
+    }
+    return fd;
+}
+
+static void fingerprint(uint64_t *hash, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    *hash = (*hash ^ bits) * 0xFF51AFD7ED558CCDull;
+    *hash ^= *hash >> 29;
+}
+
+/**
+ * @brief Compares every token with strtod() and strtof()
+ *
+ * The text ends with a newline, where strtod() stops, so it does not
+ * need a terminating NUL.
+ *
+ * @return Number of tokens that differ
+ */
+static unsigned long check_tokens(const char *text, size_t size,
+                                  unsigned long *tokens) {
+    const char *p = text;
+    const char *end = text + size;
+    unsigned long mismatches = 0;
+
+    *tokens = 0;
+    for (;;) {
+        while (p < end && is_space(*p)) {
+            p++;
+        }
+        if (p == end) {
+            return mismatches;
+        }
+        char *stop;
+        char *stop_float;
+        double expected = strtod(p, &stop);
+        float expected_float = strtof(p, &stop_float);
+        double value = 0;
+        float value_float = 0;
+        const char *after = scan_parse_double(p, end, &value);
+        const char *after_float = scan_parse_float(p, end, &value_float);
+        if (after != stop || after_float != stop_float ||
+            memcmp(&value, &expected, sizeof(value)) != 0 ||
+            memcmp(&value_float, &expected_float, sizeof(value_float)) != 0) {
+            if (mismatches++ < MISMATCHES_SHOWN) {
+                printf("  Mismatch: \"%.*s\": %.17g / %.9g, strtod %.17g / "
+                       "%.9g\n", (int)(stop - p), p, value, value_float,
+                       expected, expected_float);
+            }
+        }
+        (*tokens)++;
+        p = stop > p ? stop : p + 1;
+    }
+}
+
+// Parses all tokens with one method; returns the token count or -1
+static long run_method(method_t method, int fd, const char *text, size_t size,
+                       uint64_t *hash) {
+    const char *p = text;
+    const char *end = text + size;
+    long tokens = 0;
+    double value;
+
+    *hash = 0x9E3779B97F4A7C15ull;
+    if (lseek(fd, 0, SEEK_SET) != 0) {
+        return -1;
+    }
+    if (method == METHOD_SCANF) {
+        FILE *file = fdopen(dup(fd), "r");
+        if (file == NULL) {
+            return -1;
+        }
+        while (fscanf(file, "%lf", &value) == 1) {
+            fingerprint(hash, value);
+            tokens++;
+        }
+        fclose(file);
+    } else if (method == METHOD_SCANNER) {
+        static char storage[SCANNER_STORAGE];
+        scanner_t in;
+        scan_status_t status;
+        scanner_init(&in, fd, storage, sizeof(storage));
+        while ((status = scanner_double(&in, &value)) == SCAN_OK) {
+            fingerprint(hash, value);
+            tokens++;
+        }
+        if (status == SCAN_ERROR) {
+            scanner_print_error(&in, stderr);
+            return -1;
+        }
+    } else {
+        for (;;) {
+            while (p < end && is_space(*p)) {
+                p++;
+            }
+            if (p == end) {
+                break;
+            }
+            const char *stop;
+            if (method == METHOD_STRTOD) {
+                char *strtod_stop;
+                value = strtod(p, &strtod_stop);
+                stop = strtod_stop;
+            } else {
+                stop = scan_parse_double(p, end, &value);
+            }
+            if (stop == NULL || stop == p) {
+                return -1;
+            }
+            fingerprint(hash, value);
+            tokens++;
+            p = stop;
+        }
+    }
+    return tokens;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long count = argc >= 2 ? strtoul(argv[1], NULL, 10)
+                                    : DEFAULT_TOKENS;
+    size_t size;
+
+    printf("=== NUMBER PARSING BENCHMARK ===\n");
+    int fd = generate_tokens(count, &size);
+    if (fd < 0 || size == 0) {
+        perror("scan_bench: cannot generate tokens");
+        return 1;
+    }
+    const char *text = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (text == MAP_FAILED) {
+        perror("scan_bench: mmap");
+        return 1;
+    }
+    printf("%lu tokens, %.2f GB of text in memory\n", count, size / 1e9);
+
+    unsigned long checked;
+    unsigned long mismatches = check_tokens(text, size, &checked);
+    if (mismatches > 0 || checked != count) {
+        printf("Error: %lu of %lu tokens differ from strtod()/strtof()\n",
+               mismatches, checked);
+        return 1;
+    }
+    printf("All tokens bit-identical to strtod() and strtof()\n\n");
+
+    printf("%-22s | %8s | %9s | %8s | %7s\n", "Method", "Seconds",
+           "ns/token", "MB/s", "Speedup");
+    printf("-----------------------|----------|-----------|----------|"
+           "--------\n");
+    uint64_t reference = 0;
+    double baseline = 0;
+    for (int method = 0; method < METHOD_COUNT; method++) {
+        uint64_t hash;
+        double start = now_seconds();
+        long tokens = run_method((method_t)method, fd, text, size, &hash);
+        double seconds = now_seconds() - start;
+        if (method == METHOD_SCANF) {
+            reference = hash;
+            baseline = seconds;
+        }
+        if (tokens != (long)count || hash != reference) {
+            printf("Error: %s read different values\n", method_names[method]);
+            return 1;
+        }
+        printf("%-22s | %8.3f | %9.1f | %8.0f | %6.1fx\n",
+               method_names[method], seconds, seconds * 1e9 / count,
+               size / seconds / 1e6, baseline / seconds);
+    }
+    printf("\nAll methods read the same values.\n");
+
+    munmap((void *)text, size);
+    close(fd);
+    return 0;
+}
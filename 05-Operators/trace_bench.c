@@ -0,0 +1,327 @@
+/**
+ * @file trace_bench.c
+ * @brief What a trace event costs, and whether the trace is right
+ *
+ * First the rings and the writer are checked:
+ *   - several threads record spans at once; each must find exactly its
+ *     own events in its own ring, the newest TRACE_RING_EVENTS of them
+ *   - the JSON file must hold one event per event still in the rings,
+ *     and one name per named thread
+ *   - SIGUSR1 must only set the flag, and TRACE_POLL() must then write
+ *     the trace and clear it
+ *
+ * Then it times a loop with a span (TRACE_BEGIN + TRACE_END) or a
+ * counter around a trivial body against the same loop without one. The
+ * difference is what an event costs; the budget is 20 ns, small enough
+ * to trace every record of a hot loop. The loops run far past the ring
+ * size, so the cost includes overwriting old events.
+ *
+ * Built with -DTRACE_ENABLED (make trace_bench); it writes its own
+ * trace to trace_bench.trace.json, which can be opened in Perfetto.
+ *
+ * Usage: ./trace_bench [iterations]   (default 1000000 per measurement)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+
+#ifndef TRACE_ENABLED
+#error "trace_bench measures tracing: build it with -DTRACE_ENABLED"
+#endif
+
+// Nanoseconds an event may cost
+#define BUDGET_NS 20.0
+
+// Measurements per loop; the median is reported
+#define REPEATS 9
+
+// Threads and spans per thread of the ring check (more than a ring holds)
+#define CHECK_THREADS 4
+#define CHECK_SPANS (TRACE_RING_EVENTS + 1000)
+
+#define TRACE_PATH "trace_bench.trace.json"
+
+static volatile unsigned long sink;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------------------------------------------------------------------
+// Checks
+// ---------------------------------------------------------------------
+
+typedef struct {
+    int index;
+    trace_ring_t *ring;
+    int failures;
+} check_arg_t;
+
+static const char *check_names[CHECK_THREADS] = {
+    "check 0", "check 1", "check 2", "check 3"
+};
+
+static void *record_spans(void *argument) {
+    check_arg_t *arg = argument;
+
+    TRACE_THREAD_NAME(check_names[arg->index]);
+    for (long i = 0; i < CHECK_SPANS; i++) {
+        // The value tells which thread wrote the event, and when
+        trace_record("check", TRACE_KIND_SPAN, trace_now(),
+                     (int64_t)arg->index * CHECK_SPANS + i);
+    }
+
+    // Only the newest events are left, in order
+    trace_ring_t *ring = trace_current_ring;
+    uint64_t head = atomic_load(&ring->head);
+    if (head != CHECK_SPANS) {
+        arg->failures++;
+    }
+    for (uint64_t i = head - TRACE_RING_EVENTS; i < head; i++) {
+        const trace_event_t *event = &ring->events[i % TRACE_RING_EVENTS];
+        if (event->value != (int64_t)(arg->index * CHECK_SPANS + i) ||
+            strcmp(event->name, "check") != 0) {
+            arg->failures++;
+        }
+    }
+    arg->ring = ring;
+    return NULL;
+}
+
+static size_t count_text(const char *text, const char *pattern) {
+    size_t count = 0;
+    for (const char *p = strstr(text, pattern); p != NULL;
+         p = strstr(p + 1, pattern)) {
+        count++;
+    }
+    return count;
+}
+
+static char *read_file(const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        return NULL;
+    }
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char *text = malloc((size_t)size + 1);
+    if (text != NULL) {
+        size_t got = fread(text, 1, (size_t)size, in);
+        text[got] = '\0';
+    }
+    fclose(in);
+    return text;
+}
+
+/**
+ * @brief Checks the written trace against the events in the rings
+ * @return Number of failures
+ */
+static int check_file(uint64_t spans, uint64_t counters, size_t names) {
+    char *text = read_file(TRACE_PATH);
+    if (text == NULL) {
+        printf("  cannot read %s\n", TRACE_PATH);
+        return 1;
+    }
+    size_t length = strlen(text);
+    int failures = 0;
+    size_t found_spans = count_text(text, "\"ph\":\"X\"");
+    size_t found_counters = count_text(text, "\"ph\":\"C\"");
+    size_t found_names = count_text(text, "\"ph\":\"M\"");
+
+    if (strncmp(text, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 38) !=
+            0 ||
+        length < 4 || strcmp(text + length - 4, "\n]}\n") != 0) {
+        printf("  %s is not a trace-event document\n", TRACE_PATH);
+        failures++;
+    }
+    if (found_spans != spans || found_counters != counters ||
+        found_names != names) {
+        printf("  %s: %zu spans, %zu counters, %zu names; expected %llu, "
+               "%llu, %zu\n", TRACE_PATH, found_spans, found_counters,
+               found_names, (unsigned long long)spans,
+               (unsigned long long)counters, names);
+        failures++;
+    }
+    free(text);
+    return failures;
+}
+
+static int run_checks(void) {
+    pthread_t threads[CHECK_THREADS];
+    check_arg_t args[CHECK_THREADS];
+    int failures = 0;
+
+    for (int t = 0; t < CHECK_THREADS; t++) {
+        args[t].index = t;
+        args[t].ring = NULL;
+        args[t].failures = 0;
+        if (pthread_create(&threads[t], NULL, record_spans, &args[t]) != 0) {
+            printf("  cannot start thread %d\n", t);
+            return 1;
+        }
+    }
+    for (int t = 0; t < CHECK_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        failures += args[t].failures;
+        for (int u = 0; u < t; u++) {
+            failures += args[u].ring == args[t].ring;   // Shared ring
+        }
+    }
+    printf("  %d threads x %u spans: %s\n", CHECK_THREADS, CHECK_SPANS,
+           failures == 0 ? "each ring holds its own newest events" : "FAILED");
+
+    // This thread: a few spans and counters, then a dump
+    for (int i = 0; i < 10; i++) {
+        TRACE_BEGIN(main_span);
+        sink = (unsigned long)i;
+        TRACE_END(main_span);
+        TRACE_COUNTER(main_counter, i);
+    }
+    if (trace_dump() != 0) {
+        return failures + 1;
+    }
+    // All names: the check threads and "main"
+    int file_failures = check_file(
+        (uint64_t)CHECK_THREADS * TRACE_RING_EVENTS + 10, 10,
+        CHECK_THREADS + 1);
+    printf("  %s: %s\n", TRACE_PATH,
+           file_failures == 0 ? "valid, every event present" : "FAILED");
+    failures += file_failures;
+
+    // SIGUSR1 sets the flag; the next poll writes the trace
+    remove(TRACE_PATH);
+    raise(SIGUSR1);
+    int flagged = trace_dump_requested != 0;
+    TRACE_POLL();
+    FILE *written = fopen(TRACE_PATH, "r");
+    int signal_ok = flagged && trace_dump_requested == 0 && written != NULL;
+    if (written != NULL) {
+        fclose(written);
+    }
+    printf("  SIGUSR1 then TRACE_POLL(): %s\n",
+           signal_ok ? "trace written" : "FAILED");
+    failures += !signal_ok;
+    return failures;
+}
+
+// ---------------------------------------------------------------------
+// Cost of an event
+// ---------------------------------------------------------------------
+
+typedef enum {
+    LOOP_EMPTY,
+    LOOP_NOW,
+    LOOP_SPAN,
+    LOOP_COUNTER
+} loop_t;
+
+static const char *loop_names[] = {
+    "nothing", "trace_now() only", "span (BEGIN + END)", "counter"
+};
+
+__attribute__((noinline))
+static double time_loop(loop_t loop, long iterations) {
+    double start = now_seconds();
+    switch (loop) {
+    case LOOP_EMPTY:
+        for (long i = 0; i < iterations; i++) {
+            sink = (unsigned long)i;
+        }
+        break;
+    case LOOP_SPAN:
+        for (long i = 0; i < iterations; i++) {
+            TRACE_BEGIN(loop);
+            sink = (unsigned long)i;
+            TRACE_END(loop);
+        }
+        break;
+    case LOOP_COUNTER:
+        for (long i = 0; i < iterations; i++) {
+            sink = (unsigned long)i;
+            TRACE_COUNTER(loop, i);
+        }
+        break;
+    case LOOP_NOW:
+        for (long i = 0; i < iterations; i++) {
+            sink = (unsigned long)trace_now();
+        }
+        break;
+    }
+    return (now_seconds() - start) / iterations * 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_ns(loop_t loop, long iterations) {
+    double samples[REPEATS];
+    for (int r = 0; r < REPEATS; r++) {
+        samples[r] = time_loop(loop, iterations);
+    }
+    qsort(samples, REPEATS, sizeof(samples[0]), compare_doubles);
+    return samples[REPEATS / 2];
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    if (iterations < 1) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    TRACE_INIT(TRACE_PATH);
+    TRACE_THREAD_NAME("main");
+
+    printf("=== TRACE EVENT COST ===\n");
+    printf("Ring: %u events of %zu bytes per thread\n\n",
+           (unsigned)TRACE_RING_EVENTS, sizeof(trace_event_t));
+
+    printf("Checks:\n");
+    int failures = run_checks();
+    printf("\n");
+
+    time_loop(LOOP_SPAN, iterations);      // Warm up the ring and the clock
+    double empty = median_ns(LOOP_EMPTY, iterations);
+    double clock = median_ns(LOOP_NOW, iterations) - empty;
+
+    printf("%-20s %8s %9s %9s %9s %7s\n", "Per iteration", "ns",
+           "extra ns", "clock ns", "ring ns", "budget");
+    printf("%-20s %8.2f\n", loop_names[LOOP_EMPTY], empty);
+    printf("%-20s %8.2f %9.2f\n", loop_names[LOOP_NOW], empty + clock, clock);
+    for (loop_t loop = LOOP_SPAN; loop <= LOOP_COUNTER; loop++) {
+        double extra = median_ns(loop, iterations) - empty;
+        double clock_part = (loop == LOOP_SPAN ? 2 : 1) * clock;
+        printf("%-20s %8.2f %9.2f %9.2f %9.2f %7s\n", loop_names[loop],
+               empty + extra, extra, clock_part, extra - clock_part,
+               extra < BUDGET_NS ? "ok" : "OVER");
+    }
+    printf("\nBudget: under %.0f ns per event. \"clock ns\" is the timestamps "
+           "(a span\nreads two), \"ring ns\" the rest. Without TRACE_ENABLED "
+           "every macro is\nempty and costs nothing.\n", BUDGET_NS);
+    if (clock > BUDGET_NS / 2) {
+        printf("Reading the clock alone takes %.1f ns here; rdtsc usually "
+               "takes 5-10 ns,\nbut some virtual machines make it much "
+               "slower.\n", clock);
+    }
+
+    if (failures != 0) {
+        printf("\n%d check(s) FAILED\n", failures);
+        return 1;
+    }
+    return 0;
+}
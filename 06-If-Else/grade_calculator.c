@@ -1,25 +1,306 @@
 /*
  * Grade Calculator Example
  * Demonstrates if-else chains and logical decision making
+ *
+ * Usage:
+ *   ./grade_calculator                  Interactive: one student, 3 tests
+ *   ./grade_calculator --roster file    Roster: grade every student in a
+ *                                       CSV file (see roster.h)
+ *   ./grade_calculator --roster file --threads N
+ *                                       Same report, graded by N threads
+ *                                       (see roster_parallel.h)
+ *   ./grade_calculator --regrade file edits
+ *                                       Regrade: apply "student,test,score"
+ *                                       edits to a roster and report every
+ *                                       grade that flips (see gradebook.h)
+ *   ./grade_calculator --stats file [--approximate]
+ *                                       Statistics: every student's class
+ *                                       rank, then median, deciles and
+ *                                       points needed to pass (see
+ *                                       roster_stats.h)
+ *   ./grade_calculator --live terminals graders submissions
+ *                                       Live: simulated exam terminals
+ *                                       send submissions to grading
+ *                                       threads; prints the honor-roll
+ *                                       leaderboard (see live_grading.h)
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gradebook.h"
+#include "live_grading.h"
+#include "outbuf.h"
+#include "roster.h"
+#include "roster_parallel.h"
+#include "roster_stats.h"
+#include "scanner.h"
+#include "trace.h"
+
+// Grades a whole roster file, report to stdout and summary to stderr
+int run_roster_mode(const char *path, int threads) {
+    roster_summary_t summary;
+    int status = threads > 1
+        ? roster_run_parallel(path, STDOUT_FILENO, threads, &summary)
+        : roster_run(path, STDOUT_FILENO, &summary);
+
+    if (status != 0) {
+        perror(path);
+        return 1;
+    }
+    roster_print_summary(stderr, &summary);
+    return 0;
+}
+
+// Prints one student whose result flipped after an edit
+void print_change(void *context, const gradebook_change_t *change) {
+    const gradebook_t *book = context;
+    const char *separator = " ";
+
+    printf("%s:", gradebook_name(book, change->student));
+    if (change->new_grade != change->old_grade) {
+        printf("%sgrade %c -> %c", separator, change->old_grade,
+               change->new_grade);
+        separator = ", ";
+    }
+    if (change->new_passed != change->old_passed) {
+        printf("%s%s", separator, change->new_passed ? "FAILED -> PASSED"
+                                                     : "PASSED -> FAILED");
+        separator = ", ";
+    }
+    if (change->new_honor_roll != change->old_honor_roll) {
+        printf("%shonor roll %s", separator,
+               change->new_honor_roll ? "no -> yes" : "yes -> no");
+    }
+    printf("\n");
+}
+
+// Loads a roster, applies edits line by line ("student,test,score", both
+// numbered from 1) and prints every result that flips
+int run_regrade_mode(const char *roster_path, const char *edits_path) {
+    gradebook_t book;
+    gradebook_init(&book, 0);
+    if (gradebook_load(&book, roster_path) != 0) {
+        perror(roster_path);
+        gradebook_free(&book);
+        return 1;
+    }
+    FILE *edits = fopen(edits_path, "r");
+    if (edits == NULL) {
+        perror(edits_path);
+        gradebook_free(&book);
+        return 1;
+    }
+
+    gradebook_on_change(&book, print_change, &book);
+    char line[256];
+    unsigned long line_number = 0;
+    while (fgets(line, sizeof(line), edits) != NULL) {
+        const char *end = line + strcspn(line, "\r\n");
+        unsigned long student, test;
+        float score;
+        const char *p;
+
+        line_number++;
+        if (end == line) {
+            continue;
+        }
+        if ((p = scan_parse_ulong(line, end, &student)) == NULL ||
+            *p++ != ',' || (p = scan_parse_ulong(p, end, &test)) == NULL ||
+            *p++ != ',' || scan_parse_float(p, end, &score) != end ||
+            student == 0 || test == 0 || test > ROSTER_MAX_TESTS ||
+            gradebook_set_score(&book, student - 1, (int)test - 1,
+                                score) != 0) {
+            fprintf(stderr, "Line %lu: Error: invalid edit\n", line_number);
+        }
+    }
+    fclose(edits);
+
+    roster_print_summary(stderr, gradebook_summary(&book));
+    gradebook_free(&book);
+    return 0;
+}
+
+// Ranks every student of a roster file: "student,average,rank" to
+// stdout, class statistics to stderr. Approximate ranks come from a
+// sketch: 1 + the estimated number of students with a higher average.
+int run_stats_mode(const char *path, int approximate) {
+    gradebook_t book;
+    gradebook_init(&book, 0);
+    if (gradebook_load(&book, path) != 0) {
+        perror(path);
+        gradebook_free(&book);
+        return 1;
+    }
+    float *averages = malloc((book.students ? book.students : 1) *
+                             sizeof(float));
+    if (averages == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        gradebook_free(&book);
+        return 1;
+    }
+    for (size_t i = 0; i < book.students; i++) {
+        averages[i] = book.results[i].average;
+    }
+
+    roster_ranking_t ranking = {0, NULL, NULL};
+    roster_sketch_t *sketch = NULL;
+    roster_stats_t stats;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int status = 0;
+    if (approximate) {
+        sketch = roster_sketch_new(1);
+        for (size_t i = 0; sketch != NULL && i < book.students; i++) {
+            status |= roster_sketch_add(sketch, roster_score_key(averages[i]));
+        }
+        status |= sketch == NULL;
+    } else {
+        status = roster_rank_exact(averages, book.students,
+                                   threads < 1 ? 1 : (int)threads, &ranking);
+    }
+    if (status != 0) {
+        fprintf(stderr, "Out of memory\n");
+        roster_sketch_free(sketch);
+        free(averages);
+        gradebook_free(&book);
+        return 1;
+    }
+
+    static char report_storage[65536];
+    outbuf_t report;
+    outbuf_init(&report, STDOUT_FILENO, report_storage,
+                sizeof(report_storage));
+    outbuf_text(&report, "student,average,rank\n");
+    for (size_t i = 0; i < book.students; i++) {
+        unsigned long long rank;
+        if (approximate) {
+            uint32_t key = roster_score_key(averages[i]);
+            rank = 1 + book.students -
+                   roster_sketch_rank_below(sketch, key == UINT32_MAX
+                                                        ? key : key + 1);
+        } else {
+            rank = ranking.rank[i];
+        }
+        outbuf_puts(&report, gradebook_name(&book, i));
+        outbuf_printf(&report, ",%.2f,", averages[i]);
+        outbuf_uint(&report, rank);
+        outbuf_putc(&report, '\n');
+    }
+    status = outbuf_flush(&report) == 0 ? 0 : 1;
+
+    if (approximate) {
+        roster_stats_approximate(sketch, &stats);
+    } else {
+        roster_stats_exact(&ranking, &stats);
+    }
+    roster_print_stats(stderr, &stats, approximate);
+
+    roster_sketch_free(sketch);
+    roster_ranking_free(&ranking);
+    free(averages);
+    gradebook_free(&book);
+    return status;
+}
+
+// Grades simulated submissions as they arrive: the top 10 honor roll to
+// stdout, the class summary and how fast it went to stderr
+int run_live_mode(int terminals, int graders, unsigned long long submissions) {
+    live_config_t config = {
+        terminals, graders, 1, submissions, 100000, 4096, 10
+    };
+    leaderboard_t board;
+    leaderboard_entry_t entries[LEADERBOARD_MAX];
+    live_result_t result;
+
+    if (leaderboard_init(&board, config.top, graders) != 0 ||
+        live_run(&config, &board, &result) != 0) {
+        fprintf(stderr, "Error: cannot start the grading threads\n");
+        leaderboard_free(&board);
+        return 1;
+    }
+    int count = leaderboard_read(&board, entries);
+    printf("=== HONOR ROLL LEADERBOARD ===\n");
+    for (int i = 0; i < count; i++) {
+        printf("%2d. Student%u  %.2f\n", i + 1, entries[i].student,
+               entries[i].average);
+    }
+    roster_print_summary(stderr, &result.summary);
+    fprintf(stderr, "Graded %.0f submissions/s, latency p50 %.1f us, "
+            "p99 %.1f us\n", submissions / result.seconds,
+            live_latency_percentile(&result, 0.5) / 1e3,
+            live_latency_percentile(&result, 0.99) / 1e3);
+    leaderboard_free(&board);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // Compiled in only with make trace (see common/trace.h)
+    TRACE_INIT("grade_calculator.trace.json");
+    TRACE_THREAD_NAME("main");
+
+    if (argc >= 3 && strcmp(argv[1], "--roster") == 0) {
+        int threads = 1;
+        if (argc >= 5 && strcmp(argv[3], "--threads") == 0) {
+            threads = atoi(argv[4]);
+        }
+        if (threads < 1 || threads > ROSTER_MAX_THREADS) {
+            fprintf(stderr, "Error: --threads must be 1 to %d\n",
+                    ROSTER_MAX_THREADS);
+            return 1;
+        }
+        return run_roster_mode(argv[2], threads);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--regrade") == 0) {
+        return run_regrade_mode(argv[2], argv[3]);
+    }
+    if (argc >= 5 && strcmp(argv[1], "--live") == 0) {
+        int terminals = atoi(argv[2]);
+        int graders = atoi(argv[3]);
+        long long submissions = atoll(argv[4]);
+        if (terminals < 1 || terminals > ROSTER_MAX_THREADS || graders < 1 ||
+            graders > ROSTER_MAX_THREADS || submissions < 1) {
+            fprintf(stderr, "Error: --live needs 1 to %d terminals and "
+                    "graders, and 1 or more submissions\n",
+                    ROSTER_MAX_THREADS);
+            return 1;
+        }
+        return run_live_mode(terminals, graders,
+                             (unsigned long long)submissions);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--stats") == 0) {
+        return run_stats_mode(argv[2], argc >= 4 &&
+                                       strcmp(argv[3], "--approximate") == 0);
+    }
 
-int main() {
     float test1, test2, test3, average;
     char letterGrade;
+    static char input_storage[4096];
+    scanner_t input;
+
+    scanner_init(&input, STDIN_FILENO, input_storage, sizeof(input_storage));
+    input.flush_before_read = stdout;
     
     printf("=== STUDENT GRADE CALCULATOR ===\n");
     
     // Get test scores
     printf("Enter score for Test 1: ");
-    scanf("%f", &test1);
+    if (scanner_float(&input, &test1) != SCAN_OK) {
+        return scanner_exit_error(&input);
+    }
     
     printf("Enter score for Test 2: ");
-    scanf("%f", &test2);
+    if (scanner_float(&input, &test2) != SCAN_OK) {
+        return scanner_exit_error(&input);
+    }
     
     printf("Enter score for Test 3: ");
-    scanf("%f", &test3);
+    if (scanner_float(&input, &test3) != SCAN_OK) {
+        return scanner_exit_error(&input);
+    }
     
     // Calculate average
     average = (test1 + test2 + test3) / 3.0;
@@ -37,37 +318,43 @@ int main() {
         letterGrade = 'F';
     }
     
-    // Display results
-    printf("\n=== GRADE REPORT ===\n");
-    printf("Test 1 Score: %.2f\n", test1);
-    printf("Test 2 Score: %.2f\n", test2);
-    printf("Test 3 Score: %.2f\n", test3);
-    printf("Average Score: %.2f\n", average);
-    printf("Letter Grade: %c\n", letterGrade);
+    // Display results: the report is built in one buffer and written
+    // with one system call (numbers formatted by fmt.h, see outbuf.h)
+    static char report_storage[1024];
+    outbuf_t report;
+    outbuf_init(&report, STDOUT_FILENO, report_storage,
+                sizeof(report_storage));
+    fflush(stdout);
+    outbuf_text(&report, "\n=== GRADE REPORT ===\n");
+    outbuf_printf(&report, "Test 1 Score: %.2f\n", test1);
+    outbuf_printf(&report, "Test 2 Score: %.2f\n", test2);
+    outbuf_printf(&report, "Test 3 Score: %.2f\n", test3);
+    outbuf_printf(&report, "Average Score: %.2f\n", average);
+    outbuf_printf(&report, "Letter Grade: %c\n", letterGrade);
     
     // Additional feedback based on grade
     if (letterGrade == 'A') {
-        printf("Status: Excellent work! 🌟\n");
+        outbuf_text(&report, "Status: Excellent work! 🌟\n");
     } else if (letterGrade == 'B') {
-        printf("Status: Good job! Keep it up! 👍\n");
+        outbuf_text(&report, "Status: Good job! Keep it up! 👍\n");
     } else if (letterGrade == 'C') {
-        printf("Status: Satisfactory. Room for improvement. 📚\n");
+        outbuf_text(&report, "Status: Satisfactory. Room for improvement. 📚\n");
     } else if (letterGrade == 'D') {
-        printf("Status: Needs significant improvement. 📖\n");
+        outbuf_text(&report, "Status: Needs significant improvement. 📖\n");
     } else {
-        printf("Status: Failed. Please study more and retake. ❌\n");
+        outbuf_text(&report, "Status: Failed. Please study more and retake. ❌\n");
     }
     
     // Check if passing (nested if example)
     if (average >= 60) {
-        printf("Result: PASSED ✅\n");
+        outbuf_text(&report, "Result: PASSED ✅\n");
         if (average >= 85) {
-            printf("Bonus: Eligible for honor roll!\n");
+            outbuf_text(&report, "Bonus: Eligible for honor roll!\n");
         }
     } else {
-        printf("Result: FAILED ❌\n");
-        printf("You need %.2f more points to pass.\n", 60.0 - average);
+        outbuf_text(&report, "Result: FAILED ❌\n");
+        outbuf_printf(&report, "You need %.2f more points to pass.\n", 60.0 - average);
     }
     
-    return 0;
+    return outbuf_flush(&report) == 0 ? 0 : 1;
 }
@@ -0,0 +1,136 @@
+/**
+ * @file grade_policy.cpp
+ * @brief Runtime grading scales: checking them and loading them from files
+ */
+
+#include "grade_policy.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace grading {
+
+RuntimeGradePolicy::RuntimeGradePolicy(std::vector<int> cutoffs,
+                                       int pass_line, int honor_line,
+                                       std::vector<int> weights)
+    : cutoffs_(std::move(cutoffs)),
+      pass_line_(pass_line),
+      honor_line_(honor_line),
+      weights_(std::move(weights)),
+      weight_total_(0),
+      levels_{},
+      letters_{} {
+    if (cutoffs_.empty() || cutoffs_.size() > 5) {
+        throw std::invalid_argument("need between 1 and 5 cutoffs");
+    }
+    for (std::size_t i = 0; i < cutoffs_.size(); i++) {
+        if (cutoffs_[i] < 1 || cutoffs_[i] > 100 ||
+            (i > 0 && cutoffs_[i] >= cutoffs_[i - 1])) {
+            throw std::invalid_argument(
+                "cutoffs must be 1 to 100 and strictly decreasing");
+        }
+    }
+    if (weights_.empty()) {
+        throw std::invalid_argument("need at least one test weight");
+    }
+    for (int weight : weights_) {
+        if (weight < 0) {
+            throw std::invalid_argument("weights cannot be negative");
+        }
+        weight_total_ += weight;
+    }
+    if (weight_total_ <= 0) {
+        throw std::invalid_argument("weights must not all be zero");
+    }
+
+    int count = static_cast<int>(cutoffs_.size());
+    for (int s = 0; s <= 100; s++) {
+        for (int cutoff : cutoffs_) {
+            levels_[s] += s >= cutoff;
+        }
+    }
+    for (int level = 0; level <= count; level++) {
+        letters_[level] = detail::letter_for_level(level, count);
+    }
+}
+
+namespace {
+
+std::vector<int> parse_numbers(std::istringstream &values) {
+    std::vector<int> numbers;
+    int number;
+    while (values >> number) {
+        numbers.push_back(number);
+    }
+    if (!values.eof()) {
+        throw std::invalid_argument("expected whole numbers");
+    }
+    return numbers;
+}
+
+int parse_single_number(std::istringstream &values) {
+    std::vector<int> numbers = parse_numbers(values);
+    if (numbers.size() != 1) {
+        throw std::invalid_argument("expected exactly one number");
+    }
+    return numbers[0];
+}
+
+} // namespace
+
+RuntimeGradePolicy RuntimeGradePolicy::from_file(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error(path + ": cannot open file");
+    }
+
+    // Defaults are grade_calculator.c's scale
+    std::vector<int> cutoffs = {90, 80, 70, 60};
+    int pass_line = 60;
+    int honor_line = 85;
+    std::vector<int> weights = {1, 1, 1};
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+
+        std::size_t equals = line.find('=');
+        std::string where = path + ":" + std::to_string(line_number) + ": ";
+        if (equals == std::string::npos) {
+            throw std::runtime_error(where + "expected 'name = value'");
+        }
+        std::string key = line.substr(first, equals - first);
+        key.erase(key.find_last_not_of(" \t") + 1);
+        std::istringstream values(line.substr(equals + 1));
+
+        try {
+            if (key == "cutoffs") {
+                cutoffs = parse_numbers(values);
+            } else if (key == "pass") {
+                pass_line = parse_single_number(values);
+            } else if (key == "honor") {
+                honor_line = parse_single_number(values);
+            } else if (key == "weights") {
+                weights = parse_numbers(values);
+            } else {
+                throw std::invalid_argument("unknown setting '" + key + "'");
+            }
+        } catch (const std::invalid_argument &error) {
+            throw std::runtime_error(where + error.what());
+        }
+    }
+
+    try {
+        return RuntimeGradePolicy(cutoffs, pass_line, honor_line, weights);
+    } catch (const std::invalid_argument &error) {
+        throw std::runtime_error(path + ": " + error.what());
+    }
+}
+
+} // namespace grading
@@ -0,0 +1,294 @@
+/**
+ * @file grade_policy.hpp
+ * @brief Grading scales as C++ types, classified without branches
+ *
+ * grade_calculator.c decides a letter grade with an if-else chain:
+ *
+ *     if (average >= 90) 'A' else if (average >= 80) 'B' ... else 'F'
+ *
+ * Each `if` is a branch the CPU has to guess. When averages arrive in
+ * random order it guesses wrong about half the time, and every wrong
+ * guess costs 15-20 cycles. The same decision can be made by counting
+ * how many cutoffs the average reaches:
+ *
+ *     level = (average >= 90) + (average >= 80) +
+ *             (average >= 70) + (average >= 60)
+ *
+ * which is four comparisons and three additions, with nothing to guess.
+ * Level 4 is an A, level 0 is an F.
+ *
+ * GradePolicy fixes the cutoffs, the pass and honor-roll lines and the
+ * test weights at compile time, so the compiler unrolls every loop and
+ * folds the constants into the instructions:
+ *
+ *     using Classic = GradePolicy<Cutoffs<90, 80, 70, 60>, 60, 85,
+ *                                 EqualWeights<3>>;
+ *     GradeResult r = Classic::grade(scores);
+ *
+ * RuntimeGradePolicy does the same for scales only known when the
+ * program runs, for example a school's scale loaded from a file.
+ * grade_policy_bench compares both with the if-else chain; the C
+ * grade_calculator keeps its own chain and does not link this code.
+ */
+
+#ifndef GRADE_POLICY_HPP
+#define GRADE_POLICY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace grading {
+
+// Everything one student's grade consists of
+struct GradeResult {
+    float average;
+    char letter;
+    bool passed;
+    bool honor_roll;
+};
+
+// Letter-grade cutoffs, highest first, e.g. Cutoffs<90, 80, 70, 60>
+template <int... Values>
+struct Cutoffs {
+    static constexpr std::size_t count = sizeof...(Values);
+    static constexpr std::array<int, count> values = {Values...};
+};
+
+// Relative weight of each test, e.g. Weights<1, 1, 2> for a double final
+template <int... Values>
+struct Weights {
+    static constexpr std::size_t count = sizeof...(Values);
+    static constexpr std::array<int, count> values = {Values...};
+    static constexpr int total = (Values + ... + 0);
+};
+
+namespace detail {
+
+template <typename Sequence>
+struct EqualWeightsOf;
+
+template <int... Index>
+struct EqualWeightsOf<std::integer_sequence<int, Index...>> {
+    using type = Weights<(Index * 0 + 1)...>;
+};
+
+// Letter for level 0 (no cutoff reached) up to level `count` (all reached)
+constexpr char letter_for_level(int level, int count) {
+    return level == 0 ? 'F' : static_cast<char>('A' + (count - level));
+}
+
+// Index into a level table for any score, NaN included (index 0)
+inline int table_index(float score) {
+    return static_cast<int>(std::min(100.0f, std::max(0.0f, score)));
+}
+
+} // namespace detail
+
+// The same weight for every one of `Tests` tests
+template <int Tests>
+using EqualWeights = typename detail::EqualWeightsOf<
+    std::make_integer_sequence<int, Tests>>::type;
+
+/**
+ * @brief A grading scale fixed at compile time
+ * @tparam Scale Cutoffs<...> for the letter grades, highest first
+ * @tparam PassLine Lowest passing average
+ * @tparam HonorLine Lowest honor-roll average
+ * @tparam TestWeights Weights<...>, one per test
+ */
+template <typename Scale, int PassLine, int HonorLine, typename TestWeights>
+class GradePolicy {
+    static_assert(Scale::count >= 1 && Scale::count <= 5,
+                  "between 1 and 5 letter cutoffs (A to E, then F)");
+    static_assert(TestWeights::count >= 1 && TestWeights::total > 0,
+                  "at least one test with a positive weight");
+
+    static constexpr bool cutoffs_are_valid() {
+        for (std::size_t i = 0; i < Scale::count; i++) {
+            if (Scale::values[i] < 1 || Scale::values[i] > 100 ||
+                (i > 0 && Scale::values[i] >= Scale::values[i - 1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(cutoffs_are_valid(),
+                  "cutoffs must be 1 to 100 and strictly decreasing");
+
+    // levels[s] = number of cutoffs reached by a score of s (0 to 100)
+    static constexpr std::array<std::uint8_t, 101> build_levels() {
+        std::array<std::uint8_t, 101> levels{};
+        for (int s = 0; s <= 100; s++) {
+            for (int cutoff : Scale::values) {
+                levels[s] += s >= cutoff;
+            }
+        }
+        return levels;
+    }
+
+    static constexpr std::array<char, Scale::count + 1> build_letters() {
+        std::array<char, Scale::count + 1> letters{};
+        for (std::size_t level = 0; level <= Scale::count; level++) {
+            letters[level] = detail::letter_for_level(static_cast<int>(level),
+                                                      Scale::count);
+        }
+        return letters;
+    }
+
+    template <std::size_t... Index>
+    static float weighted_average(const float *scores,
+                                  std::index_sequence<Index...>) {
+        float sum = 0;
+        // Left to right, like the loop in grade_calculator.c
+        ((sum += static_cast<float>(TestWeights::values[Index]) *
+                 scores[Index]),
+         ...);
+        return static_cast<float>(sum /
+                                  static_cast<double>(TestWeights::total));
+    }
+
+public:
+    static constexpr int tests = static_cast<int>(TestWeights::count);
+    static constexpr std::array<std::uint8_t, 101> levels =
+        build_levels();
+    static constexpr std::array<char, Scale::count + 1> letters =
+        build_letters();
+
+    /**
+     * @brief Weighted average of `tests` scores
+     *
+     * With equal weights this is exactly grade_calculator.c's average.
+     */
+    static float average(const float *scores) {
+        return weighted_average(scores, std::make_index_sequence<tests>{});
+    }
+
+    /**
+     * @brief Number of cutoffs an average reaches, by comparison sum
+     */
+    static int level(float average) {
+        return static_cast<int>(
+            level_sum(average, std::make_index_sequence<Scale::count>{}));
+    }
+
+    /**
+     * @brief Number of cutoffs an average reaches, by table lookup
+     *
+     * The cutoffs are whole numbers, so only the whole part of the
+     * average matters: one clamp, one conversion and one load.
+     */
+    static int level_lookup(float average) {
+        return levels[detail::table_index(average)];
+    }
+
+    static char letter(float average) { return letters[level(average)]; }
+
+    static GradeResult grade(const float *scores) {
+        float avg = average(scores);
+        bool passed = avg >= PassLine;
+        return GradeResult{avg, letter(avg), passed,
+                           static_cast<bool>(passed & (avg >= HonorLine))};
+    }
+
+    /**
+     * @brief Letter grades for a whole array of averages
+     */
+    static void classify(const float *averages, char *out, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = letters[level(averages[i])];
+        }
+    }
+
+private:
+    template <std::size_t... Index>
+    static unsigned level_sum(float average, std::index_sequence<Index...>) {
+        return ((average >= static_cast<float>(Scale::values[Index]) ? 1u : 0u)
+                + ...);
+    }
+};
+
+// The scale grade_calculator.c uses: 90/80/70/60, pass 60, honor 85
+using ClassicPolicy = GradePolicy<Cutoffs<90, 80, 70, 60>, 60, 85,
+                                  EqualWeights<3>>;
+
+/**
+ * @brief A grading scale chosen while the program runs
+ *
+ * Uses the same level table as GradePolicy::level_lookup(), built when
+ * the scale is set instead of at compile time.
+ */
+class RuntimeGradePolicy {
+public:
+    /**
+     * @brief Checks and stores a scale
+     * @throws std::invalid_argument if the scale is not valid
+     */
+    RuntimeGradePolicy(std::vector<int> cutoffs, int pass_line,
+                       int honor_line, std::vector<int> weights);
+
+    /**
+     * @brief Loads a scale from a text file
+     *
+     * One setting per line; blank lines and lines starting with '#'
+     * are ignored:
+     *
+     *     cutoffs = 93 85 77 70
+     *     pass = 70
+     *     honor = 90
+     *     weights = 1 1 2
+     *
+     * @throws std::runtime_error naming the file and line on any problem
+     */
+    static RuntimeGradePolicy from_file(const std::string &path);
+
+    int tests() const { return static_cast<int>(weights_.size()); }
+    const std::vector<int> &cutoffs() const { return cutoffs_; }
+    int pass_line() const { return pass_line_; }
+    int honor_line() const { return honor_line_; }
+    const std::vector<int> &weights() const { return weights_; }
+
+    float average(const float *scores) const {
+        float sum = 0;
+        for (std::size_t i = 0; i < weights_.size(); i++) {
+            sum += static_cast<float>(weights_[i]) * scores[i];
+        }
+        return static_cast<float>(sum / static_cast<double>(weight_total_));
+    }
+
+    int level(float average) const {
+        return levels_[detail::table_index(average)];
+    }
+
+    char letter(float average) const { return letters_[level(average)]; }
+
+    GradeResult grade(const float *scores) const {
+        float avg = average(scores);
+        bool passed = avg >= pass_line_;
+        return GradeResult{avg, letter(avg), passed,
+                           static_cast<bool>(passed & (avg >= honor_line_))};
+    }
+
+    void classify(const float *averages, char *out, std::size_t n) const {
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = letters_[levels_[detail::table_index(averages[i])]];
+        }
+    }
+
+private:
+    std::vector<int> cutoffs_;
+    int pass_line_;
+    int honor_line_;
+    std::vector<int> weights_;
+    int weight_total_;
+    std::array<std::uint8_t, 101> levels_;
+    std::array<char, 6> letters_;
+};
+
+} // namespace grading
+
+#endif // GRADE_POLICY_HPP
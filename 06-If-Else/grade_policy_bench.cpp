@@ -0,0 +1,247 @@
+/**
+ * @file grade_policy_bench.cpp
+ * @brief Branchy if-else chain vs branchless grading policies
+ *
+ * Classifies the same averages four ways: the if-else chain from
+ * grade_calculator.c, GradePolicy's comparison sum, GradePolicy's
+ * lookup table and RuntimeGradePolicy. Each runs on uniformly random
+ * averages (the branch predictor guesses wrong a lot) and on the same
+ * averages sorted (it almost never does). All methods must produce the
+ * same letters before any time is shown.
+ *
+ * Usage: ./grade_policy_bench [scores] [scale_file]   (default 10000000)
+ *
+ * With a scale file the runtime policy uses that scale and is timed on
+ * its own, since the other methods only know the classic scale.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <vector>
+
+#include "grade_policy.hpp"
+
+using grading::ClassicPolicy;
+using grading::GradeResult;
+using grading::RuntimeGradePolicy;
+
+namespace {
+
+// Repeat each measurement and keep the fastest run
+constexpr int kRuns = 5;
+
+// Same if-else chain as grade_calculator.c
+char letter_branchy(float average) {
+    if (average >= 90) {
+        return 'A';
+    } else if (average >= 80) {
+        return 'B';
+    } else if (average >= 70) {
+        return 'C';
+    } else if (average >= 60) {
+        return 'D';
+    } else {
+        return 'F';
+    }
+}
+
+// Three tests graded with grade_calculator.c's nested if-else logic
+GradeResult grade_branchy(const float *scores) {
+    GradeResult result;
+    result.average = (float)((scores[0] + scores[1] + scores[2]) / 3.0);
+    result.letter = letter_branchy(result.average);
+    result.passed = false;
+    result.honor_roll = false;
+    if (result.average >= 60) {
+        result.passed = true;
+        if (result.average >= 85) {
+            result.honor_roll = true;
+        }
+    }
+    return result;
+}
+
+template <typename Function>
+double best_seconds(Function &&function) {
+    double best = 1e30;
+    for (int run = 0; run < kRuns; run++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void print_row(const char *method, const char *order, std::size_t n,
+               double seconds, double baseline) {
+    std::printf("%-22s %-8s %10.2f %12.1f %9.2fx\n", method, order,
+                seconds * 1e9 / n, n / seconds / 1e6, baseline / seconds);
+}
+
+bool same_grades(const GradeResult &a, const GradeResult &b) {
+    return std::memcmp(&a.average, &b.average, sizeof(float)) == 0 &&
+           a.letter == b.letter && a.passed == b.passed &&
+           a.honor_roll == b.honor_roll;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t n = 10000000;
+    if (argc >= 2) {
+        n = std::strtoul(argv[1], nullptr, 10);
+    }
+
+    RuntimeGradePolicy runtime({90, 80, 70, 60}, 60, 85, {1, 1, 1});
+    bool custom_scale = argc >= 3;
+    if (custom_scale) {
+        try {
+            runtime = RuntimeGradePolicy::from_file(argv[2]);
+        } catch (const std::exception &error) {
+            std::fprintf(stderr, "Error: %s\n", error.what());
+            return 1;
+        }
+    }
+
+    std::printf("=== BRANCHLESS GRADING BENCHMARK ===\n");
+    std::printf("%zu averages, best of %d runs\n", n, kRuns);
+
+    // Averages of three tests, scores in hundredths like "87.25"
+    std::mt19937 random(6);
+    std::uniform_int_distribution<int> hundredths(0, 10000);
+    std::vector<float> scores(n * 3);
+    for (float &score : scores) {
+        score = hundredths(random) / 100.0f;
+    }
+    std::vector<float> uniform(n);
+    for (std::size_t i = 0; i < n; i++) {
+        uniform[i] = ClassicPolicy::average(&scores[i * 3]);
+    }
+    std::vector<float> sorted = uniform;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<char> expected(n), actual(n);
+    std::vector<GradeResult> results(n);
+
+    if (custom_scale) {
+        std::printf("\nScale from %s: cutoffs", argv[2]);
+        for (int cutoff : runtime.cutoffs()) {
+            std::printf(" %d", cutoff);
+        }
+        std::printf(", pass %d, honor %d, %d tests\n", runtime.pass_line(),
+                    runtime.honor_line(), runtime.tests());
+        std::printf("\n%-22s %-8s %10s %12s\n", "Method", "Order",
+                    "ns/score", "M scores/s");
+        for (const std::vector<float> *data : {&uniform, &sorted}) {
+            double seconds = best_seconds(
+                [&] { runtime.classify(data->data(), actual.data(), n); });
+            std::printf("%-22s %-8s %10.2f %12.1f\n", "runtime table",
+                        data == &uniform ? "random" : "sorted",
+                        seconds * 1e9 / n, n / seconds / 1e6);
+        }
+        return 0;
+    }
+
+    // Every method must agree with the if-else chain
+    for (std::size_t i = 0; i < n; i++) {
+        expected[i] = letter_branchy(uniform[i]);
+        if (expected[i] != ClassicPolicy::letter(uniform[i]) ||
+            expected[i] != ClassicPolicy::letters[
+                               ClassicPolicy::level_lookup(uniform[i])] ||
+            expected[i] != runtime.letter(uniform[i]) ||
+            !same_grades(grade_branchy(&scores[i * 3]),
+                         ClassicPolicy::grade(&scores[i * 3])) ||
+            !same_grades(grade_branchy(&scores[i * 3]),
+                         runtime.grade(&scores[i * 3]))) {
+            std::fprintf(stderr, "Error: methods disagree on %.9g\n",
+                         uniform[i]);
+            return 1;
+        }
+    }
+    std::printf("All methods agree on every letter, average and flag\n");
+
+    std::printf("\n--- Letter grade only ---\n");
+    std::printf("%-22s %-8s %10s %12s %10s\n", "Method", "Order", "ns/score",
+                "M scores/s", "vs if-else");
+    for (const std::vector<float> *data : {&uniform, &sorted}) {
+        const float *averages = data->data();
+        char *out = actual.data();
+        const char *order = data == &uniform ? "random" : "sorted";
+
+        double branchy = best_seconds([&] {
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = letter_branchy(averages[i]);
+            }
+        });
+        print_row("if-else chain", order, n, branchy, branchy);
+
+        double sum = best_seconds(
+            [&] { ClassicPolicy::classify(averages, out, n); });
+        print_row("comparison sum", order, n, sum, branchy);
+
+        double lookup = best_seconds([&] {
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = ClassicPolicy::letters[
+                    ClassicPolicy::level_lookup(averages[i])];
+            }
+        });
+        print_row("lookup table", order, n, lookup, branchy);
+
+        double table = best_seconds(
+            [&] { runtime.classify(averages, out, n); });
+        print_row("runtime table", order, n, table, branchy);
+    }
+
+    std::printf("\n--- Whole student: average, letter, pass, honor roll ---\n");
+    std::printf("%-22s %-8s %10s %12s %10s\n", "Method", "Order",
+                "ns/student", "M students/s", "vs if-else");
+    // Sorting the students by average makes every branch predictable
+    std::vector<float> sorted_scores(n * 3);
+    {
+        std::vector<std::size_t> order(n);
+        for (std::size_t i = 0; i < n; i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(),
+                  [&](std::size_t a, std::size_t b) {
+                      return uniform[a] < uniform[b];
+                  });
+        for (std::size_t i = 0; i < n; i++) {
+            std::copy_n(&scores[order[i] * 3], 3, &sorted_scores[i * 3]);
+        }
+    }
+    for (const std::vector<float> *data : {&scores, &sorted_scores}) {
+        const float *students = data->data();
+        GradeResult *out = results.data();
+        const char *order = data == &scores ? "random" : "sorted";
+
+        double branchy = best_seconds([&] {
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = grade_branchy(&students[i * 3]);
+            }
+        });
+        print_row("if-else chain", order, n, branchy, branchy);
+
+        double policy = best_seconds([&] {
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = ClassicPolicy::grade(&students[i * 3]);
+            }
+        });
+        print_row("GradePolicy", order, n, policy, branchy);
+
+        double table = best_seconds([&] {
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = runtime.grade(&students[i * 3]);
+            }
+        });
+        print_row("RuntimeGradePolicy", order, n, table, branchy);
+    }
+    return 0;
+}
@@ -0,0 +1,281 @@
+/**
+ * @file gradebook.c
+ * @brief Incremental grading: one score changes, the totals follow
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "gradebook.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Position of a letter in roster_summary_t.grade_counts
+static int grade_slot(char letter) {
+    return letter == 'F' ? 4 : letter - 'A';
+}
+
+static int is_passed(float average) {
+    return average >= ROSTER_PASSING_AVERAGE;
+}
+
+static int is_honor_roll(float average) {
+    return is_passed(average) && average >= ROSTER_HONOR_ROLL_AVERAGE;
+}
+
+static void honor_join(gradebook_t *book, size_t student) {
+    book->results[student].honor_place = (int32_t)book->honor_count;
+    book->honor_members[book->honor_count++] = (uint32_t)student;
+}
+
+// The last member takes the leaving student's place
+static void honor_leave(gradebook_t *book, size_t student) {
+    int32_t place = book->results[student].honor_place;
+    uint32_t last = book->honor_members[--book->honor_count];
+    book->honor_members[place] = last;
+    book->results[last].honor_place = place;
+    book->results[student].honor_place = -1;
+}
+
+/**
+ * @brief Grades one student from their scores and counts the result in
+ */
+static void grade_into_totals(gradebook_t *book, size_t student) {
+    roster_summary_t *summary = &book->summary;
+    float average = roster_average(book->scores + student * book->tests,
+                                   book->tests);
+    char grade = roster_letter_grade(average);
+    int passed = is_passed(average);
+
+    book->results[student].average = average;
+    book->results[student].grade = grade;
+    summary->students++;
+    summary->grade_counts[grade_slot(grade)]++;
+    summary->passed += passed;
+    summary->failed += !passed;
+    summary->sum_of_averages += roster_fixed_average(average);
+    book->results[student].honor_place = -1;
+    if (is_honor_roll(average)) {
+        honor_join(book, student);
+        summary->honor_roll++;
+    }
+}
+
+int gradebook_init(gradebook_t *book, int tests) {
+    memset(book, 0, sizeof(*book));
+    if (tests < 0 || tests > ROSTER_MAX_TESTS) {
+        return -1;
+    }
+    book->tests = tests;
+    return 0;
+}
+
+void gradebook_free(gradebook_t *book) {
+    free(book->scores);
+    free(book->results);
+    free(book->names);
+    free(book->name_start);
+    free(book->honor_members);
+    memset(book, 0, sizeof(*book));
+}
+
+// realloc() that leaves the old block alone on failure
+static int grow(void **array, size_t count, size_t size) {
+    void *bigger = realloc(*array, count * size);
+    if (bigger == NULL) {
+        return -1;
+    }
+    *array = bigger;
+    return 0;
+}
+
+static int make_room(gradebook_t *book, size_t name_length) {
+    if (book->students == book->capacity) {
+        size_t capacity = book->capacity ? book->capacity * 2 : 1024;
+        if (capacity > INT32_MAX ||
+            grow((void **)&book->scores, capacity,
+                 sizeof(float) * (size_t)book->tests) != 0 ||
+            grow((void **)&book->results, capacity,
+                 sizeof(gradebook_result_t)) != 0 ||
+            grow((void **)&book->name_start, capacity, sizeof(size_t)) != 0 ||
+            grow((void **)&book->honor_members, capacity,
+                 sizeof(uint32_t)) != 0) {
+            return -1;
+        }
+        book->capacity = capacity;
+    }
+    if (book->names_capacity - book->names_used < name_length + 1) {
+        size_t capacity = book->names_capacity ? book->names_capacity * 2
+                                               : 16384;
+        while (capacity - book->names_used < name_length + 1) {
+            capacity *= 2;
+        }
+        if (grow((void **)&book->names, capacity, 1) != 0) {
+            return -1;
+        }
+        book->names_capacity = capacity;
+    }
+    return 0;
+}
+
+long gradebook_add(gradebook_t *book, const roster_student_t *student) {
+    if (book->tests == 0) {
+        book->tests = student->test_count;
+    }
+    if (student->test_count != book->tests ||
+        make_room(book, student->name_length) != 0) {
+        return -1;
+    }
+
+    size_t index = book->students;
+    memcpy(book->scores + index * book->tests, student->scores,
+           sizeof(float) * (size_t)book->tests);
+    book->name_start[index] = book->names_used;
+    memcpy(book->names + book->names_used, student->name,
+           student->name_length);
+    book->names_used += student->name_length;
+    book->names[book->names_used++] = '\0';
+
+    grade_into_totals(book, index);
+    book->students++;
+    return (long)index;
+}
+
+int gradebook_load(gradebook_t *book, const char *path) {
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)info.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    const char *p = data;
+    const char *end = data + size;
+    int first_line = 1;
+    int status = 0;
+    roster_student_t student;
+
+    while (p < end && status == 0) {
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        const char *content_end = line_end;
+        while (content_end > p && (content_end[-1] == '\r' ||
+                                   content_end[-1] == ' ' ||
+                                   content_end[-1] == '\t')) {
+            content_end--;
+        }
+        if (content_end > p) {
+            if (roster_parse_line(p, content_end, &student) &&
+                (book->tests == 0 || student.test_count == book->tests)) {
+                if (gradebook_add(book, &student) < 0) {
+                    errno = ENOMEM;
+                    status = -1;
+                }
+            } else if (!first_line) {
+                // Only the first line may be something else (a header)
+                book->summary.invalid_lines++;
+            }
+            first_line = 0;
+        }
+        p = line_end < end ? line_end + 1 : end;
+    }
+
+    if (data != NULL) {
+        munmap((void *)data, size);
+    }
+    return status;
+}
+
+void gradebook_on_change(gradebook_t *book, gradebook_change_fn fn,
+                         void *context) {
+    book->on_change = fn;
+    book->change_context = context;
+}
+
+int gradebook_set_score(gradebook_t *book, size_t student, int test,
+                        float score) {
+    if (student >= book->students || test < 0 || test >= book->tests) {
+        return -1;
+    }
+    roster_summary_t *summary = &book->summary;
+    gradebook_result_t *result = &book->results[student];
+    float *scores = book->scores + student * book->tests;
+    float old_average = result->average;
+    char old_grade = result->grade;
+    int old_passed = is_passed(old_average);
+    int old_honor_roll = result->honor_place >= 0;
+
+    // Only this student's own scores are added up again
+    scores[test] = score;
+    float average = roster_average(scores, book->tests);
+    char grade = roster_letter_grade(average);
+    int passed = is_passed(average);
+    int honor_roll = is_honor_roll(average);
+
+    // Take the old result out of the totals and put the new one in
+    result->average = average;
+    summary->sum_of_averages += roster_fixed_average(average) -
+                                roster_fixed_average(old_average);
+    if (grade == old_grade && passed == old_passed &&
+        honor_roll == old_honor_roll) {
+        return 0;               // Nothing flipped: the common case
+    }
+
+    result->grade = grade;
+    summary->grade_counts[grade_slot(old_grade)]--;
+    summary->grade_counts[grade_slot(grade)]++;
+    if (passed != old_passed) {
+        summary->passed += passed ? 1 : -1ull;
+        summary->failed += passed ? -1ull : 1;
+    }
+    if (honor_roll != old_honor_roll) {
+        if (honor_roll) {
+            honor_join(book, student);
+            summary->honor_roll++;
+        } else {
+            honor_leave(book, student);
+            summary->honor_roll--;
+        }
+    }
+
+    if (book->on_change != NULL) {
+        gradebook_change_t change = {
+            student, old_grade, grade, old_passed, passed, old_honor_roll,
+            honor_roll
+        };
+        book->on_change(book->change_context, &change);
+    }
+    return 0;
+}
+
+void gradebook_recompute(gradebook_t *book) {
+    unsigned long long invalid_lines = book->summary.invalid_lines;
+
+    memset(&book->summary, 0, sizeof(book->summary));
+    book->summary.invalid_lines = invalid_lines;
+    book->honor_count = 0;
+    for (size_t i = 0; i < book->students; i++) {
+        grade_into_totals(book, i);
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ * @file gradebook.h
+ * @brief A gradebook that keeps its class totals up to date
+ *
+ * roster_run() grades a whole roster in one pass. When one test of one
+ * student is regraded, running it again redoes every student to change
+ * one line. A gradebook keeps the roster in memory together with the
+ * results that depend on it:
+ *
+ *   - each student's average, letter grade, pass/fail and honor roll
+ *   - the class totals of roster_summary_t: the grade histogram, pass
+ *     and fail counts, the honor roll count and the sum of averages
+ *   - the honor roll itself, as a list of students
+ *
+ * gradebook_set_score() changes one score and updates all of them in
+ * constant time, however many students there are: it recomputes that
+ * student's average (the same way as roster_average(), so the result is
+ * identical to grading from scratch), takes the student's old result
+ * out of the totals and puts the new one in. The sum of averages is a
+ * fixed-point integer, so taking a value out and putting one in is
+ * exact: the totals after a million edits are bit for bit those of a
+ * full recompute.
+ *
+ * When a student's letter grade, pass/fail result or honor roll place
+ * changes, the function registered with gradebook_on_change() is called.
+ */
+
+#ifndef GRADEBOOK_H
+#define GRADEBOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "roster.h"
+
+// What changed for one student (only sent when something flipped)
+typedef struct {
+    size_t student;
+    char old_grade;
+    char new_grade;
+    int old_passed;
+    int new_passed;
+    int old_honor_roll;
+    int new_honor_roll;
+} gradebook_change_t;
+
+typedef void (*gradebook_change_fn)(void *context,
+                                    const gradebook_change_t *change);
+
+// One student's results, kept together so an edit touches one cache
+// line besides the scores
+typedef struct {
+    float average;
+    int32_t honor_place;        // Index in honor_members, -1 if not on it
+    char grade;                 // 'A' ... 'F'
+} gradebook_result_t;
+
+typedef struct {
+    size_t students;
+    size_t capacity;
+    int tests;                  // Scores per student, the same for all
+
+    float *scores;              // students x tests, row by row
+    gradebook_result_t *results;
+    char *names;                // Every name, one after the other
+    size_t *name_start;         // Where each name starts in names
+    size_t names_used;
+    size_t names_capacity;
+
+    // The honor roll in no particular order; with each student's place
+    // in it, joining and leaving are O(1)
+    uint32_t *honor_members;
+    size_t honor_count;
+
+    roster_summary_t summary;
+
+    gradebook_change_fn on_change;
+    void *change_context;
+} gradebook_t;
+
+/**
+ * @brief Starts an empty gradebook for students with `tests` scores each
+ *        (0: as many as the first student added has)
+ * @return 0, or -1 if tests is not 0..ROSTER_MAX_TESTS
+ */
+int gradebook_init(gradebook_t *book, int tests);
+
+void gradebook_free(gradebook_t *book);
+
+/**
+ * @brief Adds a student (the name is copied) and grades it
+ * @return The student's number (0, 1, 2, ...), or -1 if the number of
+ *         scores does not match or memory runs out
+ */
+long gradebook_add(gradebook_t *book, const roster_student_t *student);
+
+/**
+ * @brief Reads a roster file like roster_run() does (the first line may
+ *        be a header) and adds every valid student
+ * @return 0, or -1 if the file cannot be read (errno is set)
+ */
+int gradebook_load(gradebook_t *book, const char *path);
+
+/**
+ * @brief Calls fn for every student whose result flips from now on
+ *        (NULL to stop)
+ */
+void gradebook_on_change(gradebook_t *book, gradebook_change_fn fn,
+                         void *context);
+
+/**
+ * @brief Changes one score and updates everything that depends on it
+ * @return 0, or -1 if the student or test does not exist
+ */
+int gradebook_set_score(gradebook_t *book, size_t student, int test,
+                        float score);
+
+/**
+ * @brief Grades every student again from their scores, the slow way
+ *
+ * Rebuilds the results, the totals and the honor roll; the benchmark
+ * compares it with the incremental updates.
+ */
+void gradebook_recompute(gradebook_t *book);
+
+static inline const roster_summary_t *
+gradebook_summary(const gradebook_t *book) {
+    return &book->summary;
+}
+
+static inline const char *gradebook_name(const gradebook_t *book,
+                                         size_t student) {
+    return book->names + book->name_start[student];
+}
+
+#endif // GRADEBOOK_H
@@ -0,0 +1,234 @@
+/**
+ * @file gradebook_bench.c
+ * @brief Incremental regrading vs grading the whole roster again
+ *
+ * Builds a gradebook of random students and applies a million random
+ * score edits with gradebook_set_score(), counting the change
+ * notifications. Then it checks the result:
+ *   - the totals must be exactly those of gradebook_recompute() (the
+ *     whole roster graded again from its final scores), and the honor
+ *     roll must have exactly the same members
+ *   - the notifications must match a plain replay of the edits that
+ *     grades the edited student before and after every edit
+ *
+ * Finally it times gradebook_recompute() itself: keeping the report up
+ * to date without the gradebook means one of those after every edit.
+ *
+ * Usage: ./gradebook_bench [students] [edits]   (default 1000000 each)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gradebook.h"
+
+// Tests per student, like grade_calculator.c
+#define TESTS 3
+
+// Full recomputes timed (the slowest strategy is estimated from them)
+#define RECOMPUTE_RUNS 5
+
+typedef struct {
+    size_t student;
+    int test;
+    float score;
+} edit_t;
+
+typedef struct {
+    unsigned long long changes;
+    unsigned long long grade_flips;
+    unsigned long long pass_flips;
+    unsigned long long honor_flips;
+} change_counts_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t random_bits(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// A score from 40.0 to 100.0 in steps of 0.1, like roster_bench
+static float random_score(void) {
+    return (float)(400 + (int)(random_bits() % 601)) / 10.0f;
+}
+
+static void count_change(void *context, const gradebook_change_t *change) {
+    change_counts_t *counts = context;
+    counts->changes++;
+    counts->grade_flips += change->old_grade != change->new_grade;
+    counts->pass_flips += change->old_passed != change->new_passed;
+    counts->honor_flips += change->old_honor_roll != change->new_honor_roll;
+}
+
+static int summaries_equal(const roster_summary_t *a,
+                           const roster_summary_t *b) {
+    return a->students == b->students && a->passed == b->passed &&
+           a->failed == b->failed && a->honor_roll == b->honor_roll &&
+           a->invalid_lines == b->invalid_lines &&
+           a->sum_of_averages == b->sum_of_averages &&
+           memcmp(a->grade_counts, b->grade_counts,
+                  sizeof(a->grade_counts)) == 0;
+}
+
+// Grades one student the way grade_calculator.c does
+static void grade(const float *scores, char *letter, int *passed,
+                  int *honor_roll) {
+    float average = roster_average(scores, TESTS);
+    *letter = roster_letter_grade(average);
+    *passed = average >= ROSTER_PASSING_AVERAGE;
+    *honor_roll = *passed && average >= ROSTER_HONOR_ROLL_AVERAGE;
+}
+
+/**
+ * @brief Counts the flips by replaying the edits on a copy of the scores
+ */
+static change_counts_t replay(float *scores, const edit_t *edits,
+                              size_t count) {
+    change_counts_t counts = {0, 0, 0, 0};
+    for (size_t i = 0; i < count; i++) {
+        float *row = scores + edits[i].student * TESTS;
+        char old_letter, letter;
+        int old_passed, passed, old_honor, honor;
+
+        grade(row, &old_letter, &old_passed, &old_honor);
+        row[edits[i].test] = edits[i].score;
+        grade(row, &letter, &passed, &honor);
+        counts.changes += letter != old_letter || passed != old_passed ||
+                          honor != old_honor;
+        counts.grade_flips += letter != old_letter;
+        counts.pass_flips += passed != old_passed;
+        counts.honor_flips += honor != old_honor;
+    }
+    return counts;
+}
+
+int main(int argc, char *argv[]) {
+    size_t students = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    size_t edit_count = argc > 2 ? (size_t)atol(argv[2]) : 1000000;
+    if (students == 0) {
+        fprintf(stderr, "Usage: %s [students] [edits]\n", argv[0]);
+        return 1;
+    }
+
+    printf("=== INCREMENTAL GRADEBOOK BENCHMARK ===\n");
+    printf("%zu students x %d tests, %zu random score edits\n\n", students,
+           TESTS, edit_count);
+
+    gradebook_t book;
+    gradebook_init(&book, TESTS);
+    roster_student_t student;
+    char name[32];
+    student.name = name;
+    student.test_count = TESTS;
+    for (size_t i = 0; i < students; i++) {
+        student.name_length = (size_t)snprintf(name, sizeof(name),
+                                               "Student%zu", i);
+        for (int t = 0; t < TESTS; t++) {
+            student.scores[t] = random_score();
+        }
+        if (gradebook_add(&book, &student) < 0) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    float *scores = malloc(students * TESTS * sizeof(float));
+    edit_t *edits = malloc((edit_count ? edit_count : 1) * sizeof(edit_t));
+    unsigned char *honor = malloc(students);
+    if (scores == NULL || edits == NULL || honor == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    memcpy(scores, book.scores, students * TESTS * sizeof(float));
+    for (size_t i = 0; i < edit_count; i++) {
+        edits[i].student = random_bits() % students;
+        edits[i].test = (int)(random_bits() % TESTS);
+        edits[i].score = random_score();
+    }
+
+    // Incremental: every edit updates the totals right away
+    change_counts_t counts = {0, 0, 0, 0};
+    gradebook_on_change(&book, count_change, &counts);
+    double start = now_seconds();
+    for (size_t i = 0; i < edit_count; i++) {
+        gradebook_set_score(&book, edits[i].student, edits[i].test,
+                            edits[i].score);
+    }
+    double incremental = now_seconds() - start;
+    gradebook_on_change(&book, NULL, NULL);
+
+    // Check against grading everything again
+    roster_summary_t kept = *gradebook_summary(&book);
+    for (size_t i = 0; i < students; i++) {
+        honor[i] = book.results[i].honor_place >= 0;
+    }
+    double recompute = 1e30;
+    for (int r = 0; r < RECOMPUTE_RUNS; r++) {
+        start = now_seconds();
+        gradebook_recompute(&book);
+        double seconds = now_seconds() - start;
+        recompute = seconds < recompute ? seconds : recompute;
+    }
+    int failures = 0;
+    if (!summaries_equal(&kept, gradebook_summary(&book))) {
+        printf("Totals differ from a full recompute: FAILED\n");
+        failures++;
+    }
+    size_t honor_differences = 0;
+    for (size_t i = 0; i < students; i++) {
+        honor_differences += honor[i] != (book.results[i].honor_place >= 0);
+    }
+    if (honor_differences != 0 || book.honor_count != kept.honor_roll) {
+        printf("Honor roll differs in %zu students: FAILED\n",
+               honor_differences);
+        failures++;
+    }
+    change_counts_t expected = replay(scores, edits, edit_count);
+    if (memcmp(&expected, &counts, sizeof(counts)) != 0) {
+        printf("Notifications: %llu, replay finds %llu: FAILED\n",
+               counts.changes, expected.changes);
+        failures++;
+    }
+    if (failures == 0) {
+        printf("Totals and honor roll identical to a full recompute; "
+               "notifications match a replay\n");
+    }
+    printf("Notifications: %llu (grade %llu, pass/fail %llu, honor roll "
+           "%llu)\n\n", counts.changes, counts.grade_flips,
+           counts.pass_flips, counts.honor_flips);
+
+    double per_edit = edit_count ? incremental / edit_count : 0;
+    printf("%-38s %12s %12s\n", "Keeping the report current", "seconds",
+           "per edit");
+    printf("%-38s %12.3f %9.1f ns\n", "gradebook_set_score() per edit",
+           incremental, per_edit * 1e9);
+    printf("%-38s %12.3f %9.1f ms\n", "one full recompute", recompute,
+           recompute * 1e3);
+    printf("%-38s %12.0f %9.1f ms  (estimated)\n",
+           "full recompute after every edit", recompute * edit_count,
+           recompute * 1e3);
+    if (per_edit > 0) {
+        printf("\nIncremental is %.0fx faster per edit\n",
+               recompute / per_edit);
+    }
+    roster_print_summary(stdout, gradebook_summary(&book));
+
+    free(scores);
+    free(edits);
+    free(honor);
+    gradebook_free(&book);
+    return failures == 0 ? 0 : 1;
+}
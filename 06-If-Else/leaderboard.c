@@ -0,0 +1,183 @@
+/**
+ * @file leaderboard.c
+ * @brief Sharded top-K honor roll, published under sequence locks
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "leaderboard.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roster.h"
+#include "roster_stats.h"
+
+static uint64_t pack_entry(uint32_t student, float average) {
+    return (uint64_t)roster_score_key(average) << 32 | (uint32_t)~student;
+}
+
+static uint32_t entry_student(uint64_t entry) {
+    return ~(uint32_t)entry;
+}
+
+int leaderboard_init(leaderboard_t *board, int top, int writers) {
+    memset(board, 0, sizeof(*board));
+    if (top < 1 || top > LEADERBOARD_MAX || writers < 1) {
+        return -1;
+    }
+    board->shards = aligned_alloc(_Alignof(leaderboard_shard_t),
+                                  (size_t)writers *
+                                      sizeof(leaderboard_shard_t));
+    if (board->shards == NULL) {
+        return -1;
+    }
+    memset(board->shards, 0, (size_t)writers * sizeof(leaderboard_shard_t));
+    for (int w = 0; w < writers; w++) {
+        leaderboard_shard_t *shard = &board->shards[w];
+        atomic_init(&shard->sequence, 0);
+        atomic_init(&shard->published_count, 0);
+        for (int i = 0; i < LEADERBOARD_MAX; i++) {
+            atomic_init(&shard->published[i], 0);
+        }
+    }
+    board->top = top;
+    board->shard_count = writers;
+    return 0;
+}
+
+void leaderboard_free(leaderboard_t *board) {
+    free(board->shards);
+    board->shards = NULL;
+}
+
+// Writer side of the sequence lock
+static void publish(leaderboard_shard_t *shard) {
+    uint32_t sequence = atomic_load_explicit(&shard->sequence,
+                                             memory_order_relaxed);
+    atomic_store_explicit(&shard->sequence, sequence + 1,
+                          memory_order_relaxed);
+    // Release stores: a reader that sees any new entry also sees the odd
+    // sequence written before it
+    for (int i = 0; i < shard->entry_count; i++) {
+        atomic_store_explicit(&shard->published[i], shard->entries[i],
+                              memory_order_release);
+    }
+    atomic_store_explicit(&shard->published_count, shard->entry_count,
+                          memory_order_release);
+    atomic_store_explicit(&shard->sequence, sequence + 2,
+                          memory_order_release);
+}
+
+int leaderboard_offer(leaderboard_t *board, int writer, uint32_t student,
+                      float average) {
+    if (!(average >= ROSTER_HONOR_ROLL_AVERAGE)) {
+        return 0;
+    }
+    leaderboard_shard_t *shard = &board->shards[writer];
+    uint64_t *entries = shard->entries;
+    uint64_t entry = pack_entry(student, average);
+    int count = shard->entry_count;
+
+    // Where the entry goes: a student already on the board moves up from
+    // their old place (or stays, if this is not their best); anyone else
+    // pushes the last entry off a full board
+    int place = count;
+    for (int i = 0; i < count; i++) {
+        if (entry_student(entries[i]) == student) {
+            if (entries[i] >= entry) {
+                return 0;
+            }
+            place = i;
+            break;
+        }
+    }
+    if (place == count) {
+        if (count == board->top) {
+            if (entries[count - 1] >= entry) {
+                return 0;
+            }
+            place = count - 1;
+        } else {
+            shard->entry_count++;
+        }
+    }
+    while (place > 0 && entries[place - 1] < entry) {
+        entries[place] = entries[place - 1];
+        place--;
+    }
+    entries[place] = entry;
+    publish(shard);
+    return 1;
+}
+
+/**
+ * @brief Reader side of the sequence lock: a consistent copy of one shard
+ */
+static int read_shard(const leaderboard_shard_t *shard, uint64_t *entries) {
+    for (;;) {
+        uint32_t before = atomic_load_explicit(&shard->sequence,
+                                               memory_order_acquire);
+        if (before & 1) {
+            sched_yield();      // Being written right now
+            continue;
+        }
+        // Acquire loads: the sequence is checked again only after every
+        // entry is read (no fences, so ThreadSanitizer follows along)
+        int count = atomic_load_explicit(&shard->published_count,
+                                         memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            entries[i] = atomic_load_explicit(&shard->published[i],
+                                              memory_order_acquire);
+        }
+        if (atomic_load_explicit(&shard->sequence, memory_order_relaxed) ==
+            before) {
+            return count;
+        }
+    }
+}
+
+static int compare_descending(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x < y) - (x > y);
+}
+
+int leaderboard_read(const leaderboard_t *board,
+                     leaderboard_entry_t *entries) {
+    uint64_t stack[8 * LEADERBOARD_MAX];
+    uint64_t *all = stack;
+    size_t room = (size_t)board->shard_count * LEADERBOARD_MAX;
+    if (room > sizeof(stack) / sizeof(stack[0])) {
+        all = malloc(room * sizeof(uint64_t));
+        if (all == NULL) {
+            return 0;
+        }
+    }
+    size_t total = 0;
+    for (int s = 0; s < board->shard_count; s++) {
+        total += (size_t)read_shard(&board->shards[s], all + total);
+    }
+    qsort(all, total, sizeof(uint64_t), compare_descending);
+
+    // Best first, so a student's first entry is their best
+    int count = 0;
+    for (size_t i = 0; i < total && count < board->top; i++) {
+        uint32_t student = entry_student(all[i]);
+        int seen = 0;
+        for (int j = 0; j < count && !seen; j++) {
+            seen = entries[j].student == student;
+        }
+        if (!seen) {
+            entries[count].student = student;
+            entries[count].average = (float)roster_key_average(
+                (uint32_t)(all[i] >> 32));
+            count++;
+        }
+    }
+    if (all != stack) {
+        free(all);
+    }
+    return count;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file leaderboard.h
+ * @brief Live honor-roll leaderboard: the top K averages of 85 and up
+ *
+ * Written by several grading threads and read by any number of others
+ * at the same time, without either side ever waiting for the other:
+ *
+ *   - every writer (grading thread) owns one shard: its own top K of
+ *     the students it graded, kept best first. Writers never share
+ *     anything, so they never contend.
+ *   - a shard is published under a sequence lock: the writer makes the
+ *     sequence odd, copies the entries, and makes it even again. A
+ *     reader copies a shard and keeps the copy only if the sequence was
+ *     even and unchanged; otherwise it copies again. Readers retry,
+ *     writers never wait.
+ *   - a read merges the shards. A student graded by two threads keeps
+ *     only their best average, so the result is the same top K as one
+ *     board that saw every submission.
+ *
+ * An entry is one 64-bit word: the average in hundredths (as
+ * roster_score_key() makes it) << 32 | ~student. Every published entry
+ * is read whole, and comparing two words orders them by average, then
+ * by lower student number.
+ */
+
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest K a leaderboard can have
+#define LEADERBOARD_MAX 64
+
+typedef struct {
+    uint32_t student;
+    float average;
+} leaderboard_entry_t;
+
+typedef struct {
+    _Alignas(64) _Atomic uint32_t sequence;     // Odd while being written
+    _Atomic int published_count;
+    _Atomic uint64_t published[LEADERBOARD_MAX];
+
+    // The writer's own copy, changed before it is published
+    uint64_t entries[LEADERBOARD_MAX];
+    int entry_count;
+} leaderboard_shard_t;
+
+typedef struct {
+    int top;                    // K
+    int shard_count;
+    leaderboard_shard_t *shards;
+} leaderboard_t;
+
+/**
+ * @brief Makes an empty leaderboard of the best `top` students, written
+ *        by `writers` threads
+ * @return 0, or -1 if top is not 1..LEADERBOARD_MAX or memory runs out
+ */
+int leaderboard_init(leaderboard_t *board, int top, int writers);
+
+void leaderboard_free(leaderboard_t *board);
+
+/**
+ * @brief Puts a student on the board if the average is on the honor roll
+ *        and among the best (only ever called by one thread per writer)
+ * @return 1 if the board changed, 0 if not
+ */
+int leaderboard_offer(leaderboard_t *board, int writer, uint32_t student,
+                      float average);
+
+/**
+ * @brief Copies the current top K, best first (any thread, any time)
+ * @param entries Room for board->top entries
+ * @return Number of entries
+ */
+int leaderboard_read(const leaderboard_t *board,
+                     leaderboard_entry_t *entries);
+
+#endif // LEADERBOARD_H
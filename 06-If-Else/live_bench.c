@@ -0,0 +1,240 @@
+/**
+ * @file live_bench.c
+ * @brief Stress test and benchmark of live grading (queue + leaderboard)
+ *
+ * Stress: a few runs with more threads than CPUs and a tiny queue, so
+ * the queue wraps around constantly and threads are preempted in the
+ * middle of everything. Every run is checked:
+ *   - each submission is graded exactly once (count and sum of numbers)
+ *   - the class totals equal grading the same submissions one by one
+ *   - the final leaderboard equals the top K worked out by brute force
+ *     (every student's best honor-roll average, sorted)
+ *   - no leaderboard query made during the run broke a rule (sorted,
+ *     all on the honor roll, nobody twice)
+ * `make tsan` runs only this part, built with ThreadSanitizer.
+ *
+ * Benchmark: 1, 2, 4 ... terminals x 1, 2, 4 ... graders (up to
+ * max_threads of each), with one leaderboard reader, each run checked
+ * the same way. Throughput is submissions graded per second; latency is
+ * from the push to the end of grading.
+ *
+ * Usage: ./live_bench [submissions] [max_threads]   (default 2000000, 4)
+ *        ./live_bench --stress
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "live_grading.h"
+#include "roster_stats.h"
+
+// Leaderboard size
+#define TOP 10
+
+// Queue size for the benchmark (the stress runs use tiny ones)
+#define QUEUE_CAPACITY 4096
+
+typedef struct {
+    roster_summary_t summary;
+    uint64_t entries[TOP];          // key << 32 | ~student, best first
+    int count;
+} expected_t;
+
+static int summaries_equal(const roster_summary_t *a,
+                           const roster_summary_t *b) {
+    return a->students == b->students && a->passed == b->passed &&
+           a->failed == b->failed && a->honor_roll == b->honor_roll &&
+           a->sum_of_averages == b->sum_of_averages &&
+           memcmp(a->grade_counts, b->grade_counts,
+                  sizeof(a->grade_counts)) == 0;
+}
+
+static int compare_descending(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x < y) - (x > y);
+}
+
+/**
+ * @brief Grades every submission one by one, and finds each student's
+ *        best honor-roll average
+ */
+static int expect(const live_config_t *config, expected_t *expected) {
+    uint32_t *best = calloc(config->students, sizeof(uint32_t));
+    if (best == NULL) {
+        return -1;
+    }
+    memset(expected, 0, sizeof(*expected));
+    for (uint64_t n = 0; n < config->submissions; n++) {
+        submission_t submission;
+        live_submission(n, config->students, &submission);
+        float average = roster_average(submission.scores, SUBMISSION_TESTS);
+        char grade = roster_letter_grade(average);
+        int passed = average >= ROSTER_PASSING_AVERAGE;
+        int honor = passed && average >= ROSTER_HONOR_ROLL_AVERAGE;
+        roster_summary_t *summary = &expected->summary;
+        summary->students++;
+        summary->grade_counts[grade == 'F' ? 4 : grade - 'A']++;
+        summary->passed += passed;
+        summary->failed += !passed;
+        summary->honor_roll += honor;
+        summary->sum_of_averages += roster_fixed_average(average);
+        if (honor && roster_score_key(average) > best[submission.student]) {
+            best[submission.student] = roster_score_key(average);
+        }
+    }
+
+    size_t honored = 0;
+    for (uint32_t s = 0; s < config->students; s++) {
+        honored += best[s] != 0;
+    }
+    uint64_t *all = malloc((honored ? honored : 1) * sizeof(uint64_t));
+    if (all == NULL) {
+        free(best);
+        return -1;
+    }
+    honored = 0;
+    for (uint32_t s = 0; s < config->students; s++) {
+        if (best[s] != 0) {
+            all[honored++] = (uint64_t)best[s] << 32 | (uint32_t)~s;
+        }
+    }
+    qsort(all, honored, sizeof(uint64_t), compare_descending);
+    expected->count = honored < TOP ? (int)honored : TOP;
+    memcpy(expected->entries, all, (size_t)expected->count * sizeof(uint64_t));
+    free(all);
+    free(best);
+    return 0;
+}
+
+/**
+ * @brief Runs one configuration and checks it
+ * @return 0 if every check passed
+ */
+static int run_checked(const live_config_t *config, const expected_t *expected,
+                       live_result_t *result) {
+    leaderboard_t board;
+    leaderboard_entry_t entries[TOP];
+    if (leaderboard_init(&board, TOP, config->graders) != 0 ||
+        live_run(config, &board, result) != 0) {
+        printf("Cannot start the run: FAILED\n");
+        return 1;
+    }
+    int count = leaderboard_read(&board, entries);
+    leaderboard_free(&board);
+
+    int failures = 0;
+    uint64_t n = config->submissions;
+    if (result->summary.students != n ||
+        result->number_sum != (n % 2 ? n * ((n - 1) / 2) : (n / 2) * (n - 1))) {
+        printf("Graded %llu of %llu submissions, or some twice: FAILED\n",
+               result->summary.students, (unsigned long long)n);
+        failures++;
+    }
+    if (!summaries_equal(&result->summary, &expected->summary)) {
+        printf("Class totals differ from grading one by one: FAILED\n");
+        failures++;
+    }
+    int board_matches = count == expected->count;
+    for (int i = 0; i < count && board_matches; i++) {
+        board_matches =
+            roster_score_key(entries[i].average) ==
+                (uint32_t)(expected->entries[i] >> 32) &&
+            entries[i].student == ~(uint32_t)expected->entries[i];
+    }
+    if (!board_matches) {
+        printf("Leaderboard differs from brute force: FAILED\n");
+        failures++;
+    }
+    if (result->bad_reads != 0) {
+        printf("%llu of %llu live leaderboard reads broke a rule: FAILED\n",
+               (unsigned long long)result->bad_reads,
+               (unsigned long long)result->reads);
+        failures++;
+    }
+    return failures;
+}
+
+static int stress(void) {
+    static const live_config_t runs[] = {
+        // terminals, graders, readers, submissions, students, queue, top
+        { 4, 4, 2, 200000, 1000, 2, TOP },
+        { 8, 2, 2, 200000, 100, 8, TOP },
+        { 2, 8, 4, 200000, 100000, 64, TOP },
+    };
+    int failures = 0;
+
+    printf("=== LIVE GRADING STRESS TEST ===\n");
+    for (size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++) {
+        expected_t expected;
+        live_result_t result;
+        if (expect(&runs[r], &expected) != 0) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        int run_failures = run_checked(&runs[r], &expected, &result);
+        printf("%d terminals, %d graders, %d readers, queue of %zu: "
+               "%llu graded, %llu full retries, %llu reads: %s\n",
+               runs[r].terminals, runs[r].graders, runs[r].readers,
+               runs[r].queue_capacity, result.summary.students,
+               (unsigned long long)result.full_retries,
+               (unsigned long long)result.reads,
+               run_failures == 0 ? "OK" : "FAILED");
+        failures += run_failures;
+    }
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--stress") == 0) {
+        return stress() == 0 ? 0 : 1;
+    }
+    uint64_t submissions = argc > 1 ? (uint64_t)atoll(argv[1]) : 2000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 4;
+    if (submissions == 0 || max_threads < 1 || max_threads > 64) {
+        fprintf(stderr, "Usage: %s [submissions] [max_threads (1-64)]\n"
+                        "       %s --stress\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    int failures = stress();
+    printf("\n=== LIVE GRADING BENCHMARK ===\n");
+    printf("%llu submissions from 1000000 students, queue of %d, top %d, "
+           "1 leaderboard reader\n\n", (unsigned long long)submissions,
+           QUEUE_CAPACITY, TOP);
+    printf("%9s %7s %12s %10s %10s %10s %9s %9s\n", "terminals", "graders",
+           "per second", "p50 us", "p99 us", "p99.9 us", "full %",
+           "reads");
+
+    live_config_t config = { 1, 1, 1, submissions, 1000000, QUEUE_CAPACITY,
+                             TOP };
+    expected_t expected;
+    if (expect(&config, &expected) != 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (int terminals = 1; terminals <= max_threads; terminals *= 2) {
+        for (int graders = 1; graders <= max_threads; graders *= 2) {
+            live_result_t result;
+            config.terminals = terminals;
+            config.graders = graders;
+            failures += run_checked(&config, &expected, &result);
+            printf("%9d %7d %12.0f %10.1f %10.1f %10.1f %8.2f%% %9llu\n",
+                   terminals, graders, submissions / result.seconds,
+                   live_latency_percentile(&result, 0.5) / 1e3,
+                   live_latency_percentile(&result, 0.99) / 1e3,
+                   live_latency_percentile(&result, 0.999) / 1e3,
+                   100.0 * result.full_retries / submissions,
+                   (unsigned long long)result.reads);
+        }
+    }
+    if (failures == 0) {
+        printf("\nEvery run graded each submission once, matched the totals "
+               "and leaderboard of\ngrading one by one, and every live read "
+               "was consistent\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,324 @@
+/**
+ * @file live_grading.c
+ * @brief Terminals, graders and leaderboard readers around one queue
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "live_grading.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Counters only one thread ever writes to, each on its own cache lines
+typedef struct {
+    _Alignas(SUBMISSION_CACHE_LINE) roster_summary_t summary;
+    uint64_t number_sum;
+    uint64_t full_retries;
+    uint64_t reads;
+    uint64_t bad_reads;
+    uint64_t latency_counts[LIVE_LATENCY_BUCKETS];
+} live_local_t;
+
+typedef struct {
+    const live_config_t *config;
+    leaderboard_t *board;
+    submission_queue_t queue;
+
+    // Threads wait here until all have started (or one could not)
+    pthread_mutex_t lock;
+    pthread_cond_t started;
+    int go;
+    int cancelled;
+
+    _Atomic int terminals_done;
+    _Atomic int graders_done;
+    live_local_t *locals;       // One per thread
+} live_shared_t;
+
+typedef struct {
+    live_shared_t *shared;
+    int index;                  // Among threads of its kind
+    live_local_t *local;
+} live_thread_t;
+
+/**
+ * @brief Waits until every thread is running
+ * @return 1 if the run was called off instead
+ */
+static int wait_for_start(live_shared_t *shared) {
+    pthread_mutex_lock(&shared->lock);
+    while (!shared->go) {
+        pthread_cond_wait(&shared->started, &shared->lock);
+    }
+    int cancelled = shared->cancelled;
+    pthread_mutex_unlock(&shared->lock);
+    return cancelled;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// splitmix64: consecutive numbers give unrelated bits
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+void live_submission(uint64_t number, uint32_t students,
+                     submission_t *submission) {
+    uint64_t bits = mix(number);
+    memset(submission, 0, sizeof(*submission));
+    submission->number = number;
+    submission->student = (uint32_t)(bits % students);
+    bits = mix(bits);
+    // Scores from 40.0 to 100.0 in steps of 0.1, like roster_bench
+    for (int t = 0; t < SUBMISSION_TESTS; t++) {
+        submission->scores[t] = (float)(400 + (int)(bits % 601)) / 10.0f;
+        bits /= 601;
+    }
+}
+
+static int latency_bucket(uint64_t ns) {
+    if (ns < 16) {
+        return (int)ns;
+    }
+    int top = 63 - __builtin_clzll(ns);
+    int bucket = 16 + (top - 4) * 8 + (int)((ns >> (top - 3)) & 7);
+    return bucket < LIVE_LATENCY_BUCKETS ? bucket : LIVE_LATENCY_BUCKETS - 1;
+}
+
+// Largest latency that falls in a bucket
+static double bucket_limit(int bucket) {
+    if (bucket < 16) {
+        return bucket;
+    }
+    int top = (bucket - 16) / 8 + 4;
+    uint64_t low = (1ull << top) + (uint64_t)((bucket - 16) % 8) *
+                                       (1ull << (top - 3));
+    return (double)(low + (1ull << (top - 3)) - 1);
+}
+
+double live_latency_percentile(const live_result_t *result, double p) {
+    uint64_t total = 0;
+    for (int b = 0; b < LIVE_LATENCY_BUCKETS; b++) {
+        total += result->latency_counts[b];
+    }
+    uint64_t wanted = (uint64_t)(p * (double)total);
+    uint64_t seen = 0;
+    for (int b = 0; b < LIVE_LATENCY_BUCKETS; b++) {
+        seen += result->latency_counts[b];
+        if (seen > wanted || seen == total) {
+            return bucket_limit(b);
+        }
+    }
+    return 0;
+}
+
+static void *terminal_main(void *arg) {
+    live_thread_t *self = arg;
+    live_shared_t *shared = self->shared;
+    const live_config_t *config = shared->config;
+    submission_t submission;
+
+    if (wait_for_start(shared)) {
+        return NULL;
+    }
+    for (uint64_t n = (uint64_t)self->index; n < config->submissions;
+         n += (uint64_t)config->terminals) {
+        live_submission(n, config->students, &submission);
+        submission.terminal = (uint32_t)self->index;
+        submission.submitted_ns = now_ns();
+        while (!submission_queue_push(&shared->queue, &submission)) {
+            self->local->full_retries++;
+            sched_yield();
+        }
+    }
+    // Release: every push above is complete before graders see this
+    atomic_fetch_add_explicit(&shared->terminals_done, 1,
+                              memory_order_release);
+    return NULL;
+}
+
+/**
+ * @brief Counts one average in a summary, like roster_run() does
+ */
+static void grade_into(roster_summary_t *summary, float average) {
+    char grade = roster_letter_grade(average);
+    int passed = average >= ROSTER_PASSING_AVERAGE;
+
+    summary->students++;
+    summary->grade_counts[grade == 'F' ? 4 : grade - 'A']++;
+    summary->passed += passed;
+    summary->failed += !passed;
+    summary->honor_roll += passed && average >= ROSTER_HONOR_ROLL_AVERAGE;
+    summary->sum_of_averages += roster_fixed_average(average);
+}
+
+static void *grader_main(void *arg) {
+    live_thread_t *self = arg;
+    live_shared_t *shared = self->shared;
+    live_local_t *local = self->local;
+    int terminals = shared->config->terminals;
+    submission_t submission;
+
+    if (wait_for_start(shared)) {
+        return NULL;
+    }
+    for (;;) {
+        if (!submission_queue_pop(&shared->queue, &submission)) {
+            if (atomic_load_explicit(&shared->terminals_done,
+                                     memory_order_acquire) < terminals) {
+                sched_yield();
+                continue;
+            }
+            // Every push is finished: empty now means empty for good
+            if (!submission_queue_pop(&shared->queue, &submission)) {
+                break;
+            }
+        }
+        float average = roster_average(submission.scores, SUBMISSION_TESTS);
+        grade_into(&local->summary, average);
+        leaderboard_offer(shared->board, self->index, submission.student,
+                          average);
+        local->number_sum += submission.number;
+        local->latency_counts[latency_bucket(now_ns() -
+                                             submission.submitted_ns)]++;
+    }
+    atomic_fetch_add_explicit(&shared->graders_done, 1, memory_order_release);
+    return NULL;
+}
+
+static void *reader_main(void *arg) {
+    live_thread_t *self = arg;
+    live_shared_t *shared = self->shared;
+    live_local_t *local = self->local;
+    leaderboard_entry_t entries[LEADERBOARD_MAX];
+
+    if (wait_for_start(shared)) {
+        return NULL;
+    }
+    while (atomic_load_explicit(&shared->graders_done, memory_order_acquire) <
+           shared->config->graders) {
+        int count = leaderboard_read(shared->board, entries);
+        int bad = 0;
+        for (int i = 0; i < count; i++) {
+            bad |= !(entries[i].average >= ROSTER_HONOR_ROLL_AVERAGE);
+            for (int j = 0; j < i; j++) {
+                bad |= entries[j].student == entries[i].student;
+            }
+            bad |= i > 0 && entries[i].average > entries[i - 1].average;
+        }
+        local->reads++;
+        local->bad_reads += bad;
+        // A dashboard, not a spin loop: let the graders have the CPU
+        sched_yield();
+    }
+    return NULL;
+}
+
+int live_run(const live_config_t *config, leaderboard_t *board,
+             live_result_t *result) {
+    int threads = config->terminals + config->graders + config->readers;
+    live_shared_t shared;
+    memset(result, 0, sizeof(*result));
+    memset(&shared, 0, sizeof(shared));
+    shared.config = config;
+    shared.board = board;
+    atomic_init(&shared.terminals_done, 0);
+    atomic_init(&shared.graders_done, 0);
+    if (config->terminals < 1 || config->graders < 1 ||
+        config->graders > board->shard_count || config->readers < 0 ||
+        config->students == 0 ||
+        submission_queue_init(&shared.queue, config->queue_capacity) != 0) {
+        return -1;
+    }
+    shared.locals = aligned_alloc(_Alignof(live_local_t),
+                                  (size_t)threads * sizeof(live_local_t));
+    live_thread_t *args = malloc((size_t)threads * sizeof(live_thread_t));
+    pthread_t *ids = malloc((size_t)threads * sizeof(pthread_t));
+    if (shared.locals == NULL || args == NULL || ids == NULL) {
+        free(shared.locals);
+        free(args);
+        free(ids);
+        submission_queue_free(&shared.queue);
+        return -1;
+    }
+    memset(shared.locals, 0, (size_t)threads * sizeof(live_local_t));
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.started, NULL);
+
+    int status = 0;
+    int started = 0;
+    for (int t = 0; t < threads && status == 0; t++) {
+        void *(*body)(void *) = terminal_main;
+        args[t].index = t;
+        if (t >= config->terminals + config->graders) {
+            body = reader_main;
+            args[t].index = t - config->terminals - config->graders;
+        } else if (t >= config->terminals) {
+            body = grader_main;
+            args[t].index = t - config->terminals;
+        }
+        args[t].shared = &shared;
+        args[t].local = &shared.locals[t];
+        if (pthread_create(&ids[t], NULL, body, &args[t]) != 0) {
+            status = -1;
+        } else {
+            started++;
+        }
+    }
+
+    // Every kind of thread needs the others: without all of them, the
+    // ones that did start leave right away
+    pthread_mutex_lock(&shared.lock);
+    shared.go = 1;
+    shared.cancelled = status != 0;
+    pthread_cond_broadcast(&shared.started);
+    pthread_mutex_unlock(&shared.lock);
+    uint64_t start = now_ns();
+    for (int t = 0; t < started && t < config->terminals + config->graders;
+         t++) {
+        pthread_join(ids[t], NULL);
+    }
+    result->seconds = (double)(now_ns() - start) / 1e9;
+    for (int t = config->terminals + config->graders; t < started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    pthread_cond_destroy(&shared.started);
+    pthread_mutex_destroy(&shared.lock);
+
+    for (int t = 0; t < threads; t++) {
+        const live_local_t *local = &shared.locals[t];
+        roster_summary_t *summary = &result->summary;
+        summary->students += local->summary.students;
+        for (int g = 0; g < 5; g++) {
+            summary->grade_counts[g] += local->summary.grade_counts[g];
+        }
+        summary->passed += local->summary.passed;
+        summary->failed += local->summary.failed;
+        summary->honor_roll += local->summary.honor_roll;
+        summary->sum_of_averages += local->summary.sum_of_averages;
+        result->number_sum += local->number_sum;
+        result->full_retries += local->full_retries;
+        result->reads += local->reads;
+        result->bad_reads += local->bad_reads;
+        for (int b = 0; b < LIVE_LATENCY_BUCKETS; b++) {
+            result->latency_counts[b] += local->latency_counts[b];
+        }
+    }
+
+    free(shared.locals);
+    free(args);
+    free(ids);
+    submission_queue_free(&shared.queue);
+    return status;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file live_grading.h
+ * @brief Grading submissions as exam terminals send them in
+ *
+ * A live run has three kinds of threads:
+ *
+ *   - terminals (producers) make up submissions (see live_submission())
+ *     and push them into a submission_queue_t; a full queue makes them
+ *     yield and try again
+ *   - graders (consumers) pop submissions, grade them with the rules of
+ *     roster.h, count them in their own roster_summary_t and offer
+ *     honor-roll averages to the leaderboard (each grader is one writer)
+ *   - readers query the leaderboard the whole time and check every
+ *     answer: best first, all on the honor roll, no student twice
+ *
+ * Every grader also records how long each submission waited between
+ * being queued and being graded.
+ */
+
+#ifndef LIVE_GRADING_H
+#define LIVE_GRADING_H
+
+#include <stdint.h>
+
+#include "leaderboard.h"
+#include "roster.h"
+#include "submission_queue.h"
+
+// Latency histogram: exact below 16 ns, then 8 buckets per power of 2
+#define LIVE_LATENCY_BUCKETS 320
+
+typedef struct {
+    int terminals;              // Producer threads
+    int graders;                // Consumer threads
+    int readers;                // Leaderboard reader threads
+    uint64_t submissions;       // In total, shared out among terminals
+    uint32_t students;          // Student numbers are 0 .. students - 1
+    size_t queue_capacity;
+    int top;                    // Leaderboard size
+} live_config_t;
+
+typedef struct {
+    roster_summary_t summary;   // Every grader's summary, added up
+    uint64_t number_sum;        // Of the submission numbers graded
+    uint64_t full_retries;      // Pushes that found the queue full
+    uint64_t reads;             // Leaderboard queries made while grading
+    uint64_t bad_reads;         // Queries that broke a rule
+    double seconds;             // First push to last submission graded
+    uint64_t latency_counts[LIVE_LATENCY_BUCKETS];
+} live_result_t;
+
+/**
+ * @brief Submission number n: always the same student and scores
+ */
+void live_submission(uint64_t number, uint32_t students,
+                     submission_t *submission);
+
+/**
+ * @brief Runs the terminals, graders and readers until every submission
+ *        is graded
+ * @param board Leaderboard with config->graders writers
+ * @return 0, or -1 if a thread or the queue cannot be created
+ */
+int live_run(const live_config_t *config, leaderboard_t *board,
+             live_result_t *result);
+
+/**
+ * @brief Latency under which a share p (0..1) of the submissions were
+ *        graded, in nanoseconds
+ */
+double live_latency_percentile(const live_result_t *result, double p);
+
+#endif // LIVE_GRADING_H
@@ -0,0 +1,127 @@
+/**
+ * @file roster.h
+ * @brief Bulk roster grading for the grade calculator
+ *
+ * A roster is a CSV file with one student per line: a name followed by
+ * any number of test scores, for example
+ *
+ *     student,test1,test2,test3
+ *     Alice,92,88,95
+ *     Bob,55,61,58
+ *
+ * The header line is optional. Every student is graded with the same
+ * rules as grade_calculator.c (90/80/70/60 letter grades, pass at 60,
+ * honor roll at 85) and one report line is written per student:
+ *
+ *     student,average,grade,result,honor_roll
+ *     Alice,91.67,A,PASSED,yes
+ *     Bob,58.00,F,FAILED,no
+ */
+
+#ifndef ROSTER_H
+#define ROSTER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Most test columns a roster may have
+#define ROSTER_MAX_TESTS 64
+
+// Grading rules from grade_calculator.c
+#define ROSTER_PASSING_AVERAGE 60
+#define ROSTER_HONOR_ROLL_AVERAGE 85
+
+// First line of every report
+#define ROSTER_REPORT_HEADER "student,average,grade,result,honor_roll\n"
+
+// Longest report line roster_grade_student() can produce
+#define ROSTER_MAX_REPORT_LINE 512
+
+// One parsed roster line (name points into the input, not copied)
+typedef struct {
+    const char *name;
+    size_t name_length;
+    int test_count;
+    float scores[ROSTER_MAX_TESTS];
+} roster_student_t;
+
+// Sum of averages as a whole number of 2^-32 units. Integer addition
+// gives the same total in any order, so a multi-threaded run reports
+// exactly the same class average as a single-threaded one.
+__extension__ typedef __int128 roster_fixed_sum_t;
+#define ROSTER_FIXED_ONE 4294967296.0
+
+// Class-wide totals, filled in while the report is written
+typedef struct {
+    unsigned long long students;
+    unsigned long long grade_counts[5];   // A, B, C, D, F
+    unsigned long long passed;
+    unsigned long long failed;
+    unsigned long long honor_roll;
+    unsigned long long invalid_lines;
+    roster_fixed_sum_t sum_of_averages;
+} roster_summary_t;
+
+/**
+ * @brief Letter grade for an average, using the 90/80/70/60 cutoffs
+ */
+char roster_letter_grade(float average);
+
+/**
+ * @brief Average of the scores, computed the way grade_calculator.c does
+ */
+float roster_average(const float *scores, int count);
+
+/**
+ * @brief What one average adds to roster_summary_t.sum_of_averages
+ *
+ * Absurd averages (not finite, or beyond 1e27) add nothing.
+ */
+roster_fixed_sum_t roster_fixed_average(float average);
+
+/**
+ * @brief Parses one CSV line "name,score,score,..."
+ * @param line Start of the line
+ * @param end End of the line (the newline is not included)
+ * @param student Receives the name and scores
+ * @return 1 on success, 0 if a score is missing or not a number
+ */
+int roster_parse_line(const char *line, const char *end,
+                      roster_student_t *student);
+
+/**
+ * @brief Grades one student, writes its report line and updates totals
+ * @param student Parsed student
+ * @param out Buffer with at least ROSTER_MAX_REPORT_LINE bytes free
+ * @param summary Totals to update
+ * @return Number of bytes written to out
+ */
+size_t roster_grade_student(const roster_student_t *student, char *out,
+                            roster_summary_t *summary);
+
+/**
+ * @brief Adds the totals of one summary into another
+ */
+void roster_summary_merge(roster_summary_t *total,
+                          const roster_summary_t *part);
+
+/**
+ * @brief Prints the class summary in a human-readable form
+ */
+void roster_print_summary(FILE *out, const roster_summary_t *summary);
+
+/**
+ * @brief Memory-maps a roster file and writes the report in one pass
+ *
+ * Pages that have been read are released as the scan moves forward,
+ * so memory use stays flat no matter how large the file is.
+ *
+ * @param path Roster CSV file
+ * @param out_fd File descriptor for the report
+ * @param summary Receives the class totals
+ * @return 0 on success, -1 if the file cannot be read or the report
+ *         cannot be written (errno is set)
+ */
+int roster_run(const char *path, int out_fd, roster_summary_t *summary);
+
+#endif // ROSTER_H
@@ -0,0 +1,189 @@
+/**
+ * @file roster_bench.c
+ * @brief Scaling benchmark for the multi-threaded roster engine
+ *
+ * Generates a roster in /tmp (a few deliberately bad lines included),
+ * grades it once with roster_run() and then with roster_run_parallel()
+ * for 1, 2, 4, ... threads up to the number of CPUs (or max_threads).
+ * Every parallel report and summary is checked byte for byte against
+ * the single-threaded one before its time is shown.
+ *
+ * Usage: ./roster_bench [students] [max_threads]   (default 2000000)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "roster.h"
+#include "roster_parallel.h"
+
+#define ROSTER_PATH "/tmp/roster_bench_input.csv"
+#define EXPECTED_PATH "/tmp/roster_bench_expected.csv"
+#define ACTUAL_PATH "/tmp/roster_bench_actual.csv"
+
+// Test columns per student
+#define TESTS 5
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int generate_roster(const char *path, long students) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    srand(5);
+    fprintf(file, "student,test1,test2,test3,test4,test5\n");
+    for (long i = 0; i < students; i++) {
+        if (i % 100000 == 99999) {
+            fprintf(file, "Broken%ld,not a score\n", i);  // Invalid line
+            continue;
+        }
+        fprintf(file, "Student%ld", i);
+        for (int t = 0; t < TESTS; t++) {
+            fprintf(file, ",%d.%d", 40 + rand() % 61, rand() % 10);
+        }
+        fprintf(file, "\n");
+    }
+    return fclose(file);
+}
+
+static int files_equal(const char *a, const char *b) {
+    FILE *fa = fopen(a, "rb");
+    FILE *fb = fopen(b, "rb");
+    char buffer_a[65536], buffer_b[65536];
+    int equal = fa != NULL && fb != NULL;
+
+    while (equal) {
+        size_t na = fread(buffer_a, 1, sizeof(buffer_a), fa);
+        size_t nb = fread(buffer_b, 1, sizeof(buffer_b), fb);
+        equal = na == nb && memcmp(buffer_a, buffer_b, na) == 0;
+        if (na == 0) {
+            break;
+        }
+    }
+    if (fa != NULL) {
+        fclose(fa);
+    }
+    if (fb != NULL) {
+        fclose(fb);
+    }
+    return equal;
+}
+
+static int summaries_equal(const roster_summary_t *a,
+                           const roster_summary_t *b) {
+    return a->students == b->students && a->passed == b->passed &&
+           a->failed == b->failed && a->honor_roll == b->honor_roll &&
+           a->invalid_lines == b->invalid_lines &&
+           a->sum_of_averages == b->sum_of_averages &&
+           memcmp(a->grade_counts, b->grade_counts,
+                  sizeof(a->grade_counts)) == 0;
+}
+
+/**
+ * @brief Grades the roster into a file
+ * @param threads 0 for roster_run(), otherwise roster_run_parallel()
+ * @return Seconds taken, or -1 on error
+ */
+static double grade(const char *out_path, int threads,
+                    roster_summary_t *summary) {
+    int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Invalid line messages are expected; keep them off the screen
+    fflush(stderr);
+    int saved_stderr = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDERR_FILENO);
+
+    double start = now_seconds();
+    int status = threads == 0
+        ? roster_run(ROSTER_PATH, fd, summary)
+        : roster_run_parallel(ROSTER_PATH, fd, threads, summary);
+    double seconds = now_seconds() - start;
+
+    fflush(stderr);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+    close(null_fd);
+    close(fd);
+    return status == 0 ? seconds : -1;
+}
+
+int main(int argc, char *argv[]) {
+    long students = 2000000;
+    long max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    roster_summary_t expected, actual;
+
+    if (argc >= 2) {
+        students = atol(argv[1]);
+    }
+    if (argc >= 3) {
+        max_threads = atol(argv[2]);
+    }
+    if (max_threads < 1) {
+        max_threads = 1;
+    }
+    if (max_threads > ROSTER_MAX_THREADS) {
+        max_threads = ROSTER_MAX_THREADS;
+    }
+
+    printf("=== ROSTER THREAD SCALING BENCHMARK ===\n");
+    printf("Generating %ld students in %s...\n", students, ROSTER_PATH);
+    if (generate_roster(ROSTER_PATH, students) != 0) {
+        perror(ROSTER_PATH);
+        return 1;
+    }
+
+    double base = grade(EXPECTED_PATH, 0, &expected);
+    if (base < 0) {
+        perror("roster_run");
+        return 1;
+    }
+    printf("\n%-16s %10s %14s %9s\n", "Engine", "Seconds", "Students/s",
+           "Speedup");
+    printf("%-16s %10.3f %14.0f %9s\n", "roster_run", base,
+           expected.students / base, "1.00x");
+
+    // 1, 2, 4, ... and finally max_threads itself
+    for (long threads = 1; threads <= max_threads; threads *= 2) {
+        if (threads * 2 > max_threads) {
+            threads = max_threads;
+        }
+        double seconds = grade(ACTUAL_PATH, (int)threads, &actual);
+        if (seconds < 0) {
+            perror("roster_run_parallel");
+            return 1;
+        }
+        if (!files_equal(EXPECTED_PATH, ACTUAL_PATH) ||
+            !summaries_equal(&expected, &actual)) {
+            fprintf(stderr, "Error: %ld-thread result differs from "
+                    "roster_run()!\n", threads);
+            return 1;
+        }
+        char label[32];
+        snprintf(label, sizeof(label), "%ld thread%s", threads,
+                 threads == 1 ? "" : "s");
+        printf("%-16s %10.3f %14.0f %8.2fx\n", label, seconds,
+               actual.students / seconds, base / seconds);
+    }
+
+    printf("\nAll reports and summaries identical to roster_run()\n");
+    roster_print_summary(stdout, &expected);
+    remove(ROSTER_PATH);
+    remove(EXPECTED_PATH);
+    remove(ACTUAL_PATH);
+    return 0;
+}
@@ -0,0 +1,556 @@
+/**
+ * @file roster_parallel.c
+ * @brief Multi-threaded roster grading with a work-stealing thread pool
+ *
+ * How the work is shared:
+ *   - The file is split into chunks that end at line breaks.
+ *   - Chunks are handed out in windows of a few chunks per thread. Each
+ *     thread starts with a contiguous range of the window's chunks.
+ *   - A thread's range is one 64-bit atomic word (first | last << 32).
+ *     The owner takes chunks from the front with compare-and-swap; a
+ *     thread with nothing left steals the back half of another range
+ *     the same way. No locks are taken while chunks are graded.
+ *   - The main thread writes finished chunk reports in file order while
+ *     the workers grade the next window, so at most two windows of
+ *     report text are in memory at any time.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "roster_parallel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+// Target size of one chunk of input
+#define CHUNK_SIZE (1UL << 20)
+
+// Chunks per thread in each window
+#define CHUNKS_PER_THREAD_PER_WINDOW 4
+
+#define CACHE_LINE_SIZE 64
+
+// One chunk of input lines and the report text graded from them
+typedef struct {
+    const char *begin;
+    const char *end;
+    char *report;
+    size_t report_length;
+    unsigned long long lines;          // Lines in this chunk
+    unsigned long long *bad_lines;     // Invalid lines (1 = first in chunk)
+    size_t bad_line_count;
+} chunk_t;
+
+// A thread's queue: the range [first, last) of chunk numbers it owns
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t range;
+} work_queue_t;
+
+// Counters only one thread ever writes to, each on its own cache lines
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) roster_summary_t summary;
+    unsigned int random_state;
+    int failed;
+} worker_local_t;
+
+typedef struct engine engine_t;
+
+typedef struct {
+    engine_t *engine;
+    int index;
+} worker_arg_t;
+
+struct engine {
+    chunk_t *chunks;
+    int expected_tests;
+    int threads;
+    work_queue_t *queues;
+    worker_local_t *locals;
+
+    // Window hand-off between the main thread and the workers
+    pthread_mutex_t lock;
+    pthread_cond_t window_ready;
+    pthread_cond_t window_finished;
+    unsigned long generation;
+    int busy_workers;
+    int stop;
+};
+
+static uint64_t pack_range(uint32_t first, uint32_t last) {
+    return (uint64_t)first | ((uint64_t)last << 32);
+}
+
+/**
+ * @brief Takes the next chunk from the front of a thread's own range
+ * @return Chunk number, or -1 if the range is empty
+ */
+static long take_own(work_queue_t *queue) {
+    uint64_t range = atomic_load(&queue->range);
+
+    for (;;) {
+        uint32_t first = (uint32_t)range;
+        uint32_t last = (uint32_t)(range >> 32);
+        if (first >= last) {
+            return -1;
+        }
+        if (atomic_compare_exchange_weak(&queue->range, &range,
+                                         pack_range(first + 1, last))) {
+            return first;
+        }
+    }
+}
+
+/**
+ * @brief Steals the back half of another thread's range
+ *
+ * The thief keeps the first stolen chunk to work on and puts the rest
+ * into its own (empty) queue.
+ *
+ * @return Chunk number, or -1 if the victim had nothing left
+ */
+static long steal(work_queue_t *victim, work_queue_t *own) {
+    uint64_t range = atomic_load(&victim->range);
+
+    for (;;) {
+        uint32_t first = (uint32_t)range;
+        uint32_t last = (uint32_t)(range >> 32);
+        if (first >= last) {
+            return -1;
+        }
+        uint32_t middle = first + (last - first) / 2;
+        if (atomic_compare_exchange_weak(&victim->range, &range,
+                                         pack_range(first, middle))) {
+            atomic_store(&own->range, pack_range(middle + 1, last));
+            return middle;
+        }
+    }
+}
+
+static const char *trim_line_end(const char *line, const char *end) {
+    while (end > line && (end[-1] == ' ' || end[-1] == '\t' ||
+                          end[-1] == '\r')) {
+        end--;
+    }
+    return end;
+}
+
+static int is_blank_line(const char *line, const char *end) {
+    for (const char *p = line; p < end; p++) {
+        if (*p != ' ' && *p != '\t') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Grades every line of one chunk into its own report buffer
+ */
+static void grade_chunk(engine_t *engine, chunk_t *chunk,
+                        worker_local_t *local) {
+    size_t capacity = (size_t)(chunk->end - chunk->begin) + 4096;
+    size_t bad_capacity = 0;
+    roster_student_t student;
+    const char *p = chunk->begin;
+
+    chunk->report = malloc(capacity);
+    chunk->report_length = 0;
+    chunk->lines = 0;
+    chunk->bad_lines = NULL;
+    chunk->bad_line_count = 0;
+    if (chunk->report == NULL) {
+        local->failed = 1;
+        return;
+    }
+
+    while (p < chunk->end) {
+        const char *line_end = memchr(p, '\n', (size_t)(chunk->end - p));
+        if (line_end == NULL) {
+            line_end = chunk->end;
+        }
+        chunk->lines++;
+
+        const char *content_end = trim_line_end(p, line_end);
+        if (!is_blank_line(p, content_end)) {
+            if (roster_parse_line(p, content_end, &student) &&
+                student.test_count == engine->expected_tests) {
+                if (capacity - chunk->report_length < ROSTER_MAX_REPORT_LINE) {
+                    char *bigger = realloc(chunk->report, capacity * 2);
+                    if (bigger == NULL) {
+                        local->failed = 1;
+                        return;
+                    }
+                    chunk->report = bigger;
+                    capacity *= 2;
+                }
+                chunk->report_length += roster_grade_student(
+                    &student, chunk->report + chunk->report_length,
+                    &local->summary);
+            } else {
+                if (chunk->bad_line_count == bad_capacity) {
+                    bad_capacity = bad_capacity ? bad_capacity * 2 : 16;
+                    unsigned long long *bigger = realloc(
+                        chunk->bad_lines, bad_capacity * sizeof(*bigger));
+                    if (bigger == NULL) {
+                        local->failed = 1;
+                        return;
+                    }
+                    chunk->bad_lines = bigger;
+                }
+                chunk->bad_lines[chunk->bad_line_count++] = chunk->lines;
+                local->summary.invalid_lines++;
+            }
+        }
+        // Step past the newline; a last line without one ends the chunk
+        p = line_end < chunk->end ? line_end + 1 : chunk->end;
+    }
+}
+
+/**
+ * @brief Grades chunks until no thread has any left in this window
+ */
+static void work_on_window(engine_t *engine, int self) {
+    work_queue_t *own = &engine->queues[self];
+    worker_local_t *local = &engine->locals[self];
+
+    for (;;) {
+        long chunk = take_own(own);
+
+        // Out of work: try the other threads, starting at a random one
+        if (chunk < 0) {
+            local->random_state = local->random_state * 1103515245u + 12345u;
+            int start = (int)(local->random_state >> 16) % engine->threads;
+            for (int i = 0; i < engine->threads && chunk < 0; i++) {
+                int victim = (start + i) % engine->threads;
+                if (victim != self) {
+                    chunk = steal(&engine->queues[victim], own);
+                }
+            }
+        }
+        if (chunk < 0) {
+            return;  // Every queue is empty
+        }
+        TRACE_BEGIN(grade_chunk);
+        grade_chunk(engine, &engine->chunks[chunk], local);
+        TRACE_END(grade_chunk);
+    }
+}
+
+static void *worker_main(void *argument) {
+    worker_arg_t *arg = argument;
+    engine_t *engine = arg->engine;
+    unsigned long seen_generation = 0;
+
+    TRACE_THREAD_NAME("worker");
+    for (;;) {
+        pthread_mutex_lock(&engine->lock);
+        while (engine->generation == seen_generation && !engine->stop) {
+            pthread_cond_wait(&engine->window_ready, &engine->lock);
+        }
+        if (engine->stop) {
+            pthread_mutex_unlock(&engine->lock);
+            return NULL;
+        }
+        seen_generation = engine->generation;
+        pthread_mutex_unlock(&engine->lock);
+
+        work_on_window(engine, arg->index);
+
+        pthread_mutex_lock(&engine->lock);
+        if (--engine->busy_workers == 0) {
+            pthread_cond_signal(&engine->window_finished);
+        }
+        pthread_mutex_unlock(&engine->lock);
+    }
+}
+
+/**
+ * @brief Splits chunks [first, last) between the threads and starts them
+ */
+static void start_window(engine_t *engine, size_t first, size_t last) {
+    size_t count = last - first;
+
+    for (int t = 0; t < engine->threads; t++) {
+        size_t from = first + count * t / engine->threads;
+        size_t to = first + count * (t + 1) / engine->threads;
+        atomic_store(&engine->queues[t].range,
+                     pack_range((uint32_t)from, (uint32_t)to));
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    engine->busy_workers = engine->threads;
+    engine->generation++;
+    pthread_cond_broadcast(&engine->window_ready);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+static void wait_for_window(engine_t *engine) {
+    pthread_mutex_lock(&engine->lock);
+    while (engine->busy_workers > 0) {
+        pthread_cond_wait(&engine->window_finished, &engine->lock);
+    }
+    pthread_mutex_unlock(&engine->lock);
+}
+
+static int write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds where graded records start and how many tests each has
+ *
+ * Mirrors roster_run(): the first non-blank line may be a header, and
+ * the first line that parses decides the number of test columns.
+ *
+ * @return Offset of the first line after an optional header
+ */
+static size_t scan_header(const char *data, size_t size, int *expected_tests) {
+    const char *p = data;
+    const char *end = data + size;
+    size_t start = 0;
+    int first_line = 1;
+    roster_student_t student;
+
+    *expected_tests = 0;
+    while (p < end) {
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        const char *content_end = trim_line_end(p, line_end);
+        if (!is_blank_line(p, content_end)) {
+            if (roster_parse_line(p, content_end, &student)) {
+                *expected_tests = student.test_count;
+                return start;
+            }
+            if (first_line) {
+                start = (size_t)(line_end - data) + (line_end < end);
+            }
+            first_line = 0;
+        }
+        p = line_end < end ? line_end + 1 : end;
+    }
+    return start;
+}
+
+/**
+ * @brief Cuts [start, size) into chunks that end just after a newline
+ */
+static chunk_t *make_chunks(const char *data, size_t start, size_t size,
+                            size_t *count) {
+    size_t capacity = (size - start) / CHUNK_SIZE + 2;
+    chunk_t *chunks = calloc(capacity, sizeof(chunk_t));
+    size_t n = 0;
+
+    if (chunks == NULL) {
+        return NULL;
+    }
+    while (start < size) {
+        size_t end = start + CHUNK_SIZE;
+        if (end >= size) {
+            end = size;
+        } else {
+            const char *newline = memchr(data + end, '\n', size - end);
+            end = newline ? (size_t)(newline - data) + 1 : size;
+        }
+        chunks[n].begin = data + start;
+        chunks[n].end = data + end;
+        n++;
+        start = end;
+    }
+    *count = n;
+    return chunks;
+}
+
+int roster_run_parallel(const char *path, int out_fd, int threads,
+                        roster_summary_t *summary) {
+    struct stat info;
+    int fd;
+    int status = 0;
+    engine_t engine;
+    pthread_t workers[ROSTER_MAX_THREADS];
+    worker_arg_t args[ROSTER_MAX_THREADS];
+
+    memset(summary, 0, sizeof(*summary));
+    if (threads < 1 || threads > ROSTER_MAX_THREADS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)info.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    // Lines before the first chunk (the header) still count for numbering
+    memset(&engine, 0, sizeof(engine));
+    size_t start = scan_header(data, size, &engine.expected_tests);
+    unsigned long long line_base = 0;
+    for (size_t i = 0; i < start; i++) {
+        line_base += (data[i] == '\n');
+    }
+
+    size_t chunk_count = 0;
+    engine.chunks = make_chunks(data, start, size, &chunk_count);
+    engine.threads = threads;
+    engine.queues = aligned_alloc(CACHE_LINE_SIZE,
+                                  sizeof(work_queue_t) * threads);
+    engine.locals = aligned_alloc(CACHE_LINE_SIZE,
+                                  sizeof(worker_local_t) * threads);
+    if (engine.chunks == NULL || engine.queues == NULL ||
+        engine.locals == NULL) {
+        free(engine.chunks);
+        free(engine.queues);
+        free(engine.locals);
+        if (data != NULL) {
+            munmap((void *)data, size);
+        }
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(engine.locals, 0, sizeof(worker_local_t) * threads);
+    pthread_mutex_init(&engine.lock, NULL);
+    pthread_cond_init(&engine.window_ready, NULL);
+    pthread_cond_init(&engine.window_finished, NULL);
+
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        atomic_init(&engine.queues[t].range, 0);
+        engine.locals[t].random_state = (unsigned int)t * 2654435761u + 1;
+        args[t].engine = &engine;
+        args[t].index = t;
+        if (pthread_create(&workers[t], NULL, worker_main, &args[t]) != 0) {
+            break;
+        }
+        started++;
+    }
+    if (started < threads) {
+        // Could not start every thread: run with the ones we have
+        engine.threads = started;
+        threads = started;
+    }
+
+    status = write_all(out_fd, ROSTER_REPORT_HEADER,
+                       strlen(ROSTER_REPORT_HEADER));
+
+    size_t window = (size_t)threads * CHUNKS_PER_THREAD_PER_WINDOW;
+    size_t next = 0;
+    size_t released = 0;
+    size_t page_mask = ~(size_t)(sysconf(_SC_PAGESIZE) - 1);
+
+    if (threads > 0 && chunk_count > 0) {
+        size_t last = next + window < chunk_count ? next + window : chunk_count;
+        start_window(&engine, next, last);
+
+        while (next < chunk_count) {
+            size_t first = next;
+            TRACE_BEGIN(wait);
+            wait_for_window(&engine);
+            TRACE_END(wait);
+            next = last;
+
+            // Let the workers start on the next window right away
+            if (next < chunk_count) {
+                last = next + window < chunk_count ? next + window
+                                                   : chunk_count;
+                start_window(&engine, next, last);
+            }
+
+            // Meanwhile, write this window's reports in file order
+            TRACE_BEGIN(write);
+            for (size_t c = first; c < next; c++) {
+                chunk_t *chunk = &engine.chunks[c];
+                for (size_t b = 0; b < chunk->bad_line_count; b++) {
+                    fprintf(stderr, "Line %llu: Error: invalid record\n",
+                            line_base + chunk->bad_lines[b]);
+                }
+                if (status == 0 && chunk->report != NULL) {
+                    status = write_all(out_fd, chunk->report,
+                                       chunk->report_length);
+                }
+                line_base += chunk->lines;
+                free(chunk->report);
+                free(chunk->bad_lines);
+                chunk->report = NULL;
+                chunk->bad_lines = NULL;
+            }
+            TRACE_END(write);
+            TRACE_COUNTER(lines, line_base);
+            TRACE_POLL();
+
+            // Give the graded input pages back to the kernel
+            size_t done = (size_t)(engine.chunks[next - 1].end - data) &
+                          page_mask;
+            if (done > released) {
+                madvise((void *)(data + released), done - released,
+                        MADV_DONTNEED);
+                released = done;
+            }
+        }
+    }
+    if (threads == 0) {
+        errno = EAGAIN;
+        status = -1;
+    }
+
+    pthread_mutex_lock(&engine.lock);
+    engine.stop = 1;
+    pthread_cond_broadcast(&engine.window_ready);
+    pthread_mutex_unlock(&engine.lock);
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+        roster_summary_merge(summary, &engine.locals[t].summary);
+        if (engine.locals[t].failed) {
+            errno = ENOMEM;
+            status = -1;
+        }
+    }
+
+    pthread_mutex_destroy(&engine.lock);
+    pthread_cond_destroy(&engine.window_ready);
+    pthread_cond_destroy(&engine.window_finished);
+    free(engine.chunks);
+    free(engine.queues);
+    free(engine.locals);
+    if (data != NULL) {
+        munmap((void *)data, size);
+    }
+    return status;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file roster_parallel.h
+ * @brief Multi-threaded roster grading with a work-stealing thread pool
+ *
+ * The roster file is cut into chunks of about 1 MiB that always end at
+ * a line break. Worker threads grade chunks using the same rules and
+ * report format as roster_run(); a thread that runs out of chunks
+ * steals half of the remaining chunks of another thread.
+ *
+ * Each thread counts grades in its own cache-line-aligned summary, so
+ * threads never write to shared memory while grading. The summaries
+ * are added together at the end, and chunk reports are written in file
+ * order: the output is byte-for-byte the same as roster_run()'s, for
+ * any number of threads.
+ */
+
+#ifndef ROSTER_PARALLEL_H
+#define ROSTER_PARALLEL_H
+
+#include "roster.h"
+
+// Most worker threads roster_run_parallel() will start
+#define ROSTER_MAX_THREADS 256
+
+/**
+ * @brief Grades a roster file using several threads
+ * @param path Roster CSV file
+ * @param out_fd File descriptor for the report
+ * @param threads Number of worker threads (1 to ROSTER_MAX_THREADS)
+ * @param summary Receives the class totals
+ * @return 0 on success, -1 on an I/O or resource error (errno is set)
+ */
+int roster_run_parallel(const char *path, int out_fd, int threads,
+                        roster_summary_t *summary);
+
+#endif // ROSTER_PARALLEL_H
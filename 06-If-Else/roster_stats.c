@@ -0,0 +1,746 @@
+/**
+ * @file roster_stats.c
+ * @brief Exact ranks by parallel radix sort, approximate ones by KLL sketch
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "roster_stats.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fmt.h"
+#include "roster.h"
+#include "roster_parallel.h"
+
+// Radix sort digits: 8 bits, on the key in the upper half of each entry
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Compactors a sketch may have (2^47 keys, far more than it will see)
+#define SKETCH_MAX_LEVELS 48
+
+// Lower compactors never shrink below this many keys
+#define SKETCH_MIN_CAPACITY 8
+
+// Keys level 0 collects before they are sorted and half move up
+#define SKETCH_BUFFER (4 * ROSTER_SKETCH_K)
+
+/* ---------------------------------------------------------------------- */
+/* Exact: parallel LSD radix sort                                          */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    const float *averages;
+    size_t count;
+    int threads;
+    uint64_t *keys;                     // Sorted here or in scratch
+    uint64_t *scratch;
+    uint64_t *sorted;                   // Whichever holds the result
+    uint32_t *rank;
+    size_t (*histograms)[RADIX_BUCKETS];  // One per thread
+    pthread_barrier_t barrier;
+
+    // Workers wait here until it is known how many of them started
+    pthread_mutex_t lock;
+    pthread_cond_t started;
+    int go;
+} sort_job_t;
+
+typedef struct {
+    sort_job_t *job;
+    int index;
+} sort_worker_t;
+
+// First entry whose key is above key (entries are sorted)
+static size_t entries_above(const uint64_t *sorted, size_t count,
+                            uint32_t key) {
+    uint64_t limit = ((uint64_t)key << 32) | UINT32_MAX;
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (sorted[middle] <= limit) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// First entry whose key is key or above
+static size_t entries_below(const uint64_t *sorted, size_t count,
+                            uint32_t key) {
+    return key == 0 ? 0 : entries_above(sorted, count, key - 1);
+}
+
+/**
+ * @brief One thread's share of the sort: its slice of the entries in
+ *        every pass, then the ranks of its slice of the sorted result
+ */
+static void *sort_worker(void *arg) {
+    sort_worker_t *worker = arg;
+    sort_job_t *job = worker->job;
+
+    pthread_mutex_lock(&job->lock);
+    while (!job->go) {
+        pthread_cond_wait(&job->started, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    size_t count = job->count;
+    size_t begin = count * (size_t)worker->index / (size_t)job->threads;
+    size_t end = count * (size_t)(worker->index + 1) / (size_t)job->threads;
+    size_t *histogram = job->histograms[worker->index];
+    uint64_t *source = job->keys;
+    uint64_t *target = job->scratch;
+
+    for (size_t i = begin; i < end; i++) {
+        source[i] = (uint64_t)roster_score_key(job->averages[i]) << 32 | i;
+    }
+
+    for (int shift = 32; shift < 64; shift += RADIX_BITS) {
+        memset(histogram, 0, sizeof(job->histograms[0]));
+        for (size_t i = begin; i < end; i++) {
+            histogram[(source[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+        }
+        pthread_barrier_wait(&job->barrier);
+
+        // Every thread sees the same counts, so all skip the same passes
+        size_t next[RADIX_BUCKETS];
+        size_t position = 0;
+        int skip = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            size_t total = 0;
+            size_t before = 0;
+            for (int t = 0; t < job->threads; t++) {
+                before += t < worker->index ? job->histograms[t][b] : 0;
+                total += job->histograms[t][b];
+            }
+            skip |= total == count;
+            next[b] = position + before;
+            position += total;
+        }
+        if (!skip) {
+            for (size_t i = begin; i < end; i++) {
+                uint64_t entry = source[i];
+                target[next[(entry >> shift) & (RADIX_BUCKETS - 1)]++] = entry;
+            }
+        }
+        // Nobody counts the next digit before everyone has moved this one
+        pthread_barrier_wait(&job->barrier);
+        if (!skip) {
+            uint64_t *swap = source;
+            source = target;
+            target = swap;
+        }
+    }
+    if (worker->index == 0) {
+        job->sorted = source;
+    }
+
+    // Walking down from the end of the slice, a run of equal keys gets
+    // 1 + the number of entries above its last one
+    size_t run_end = end;
+    for (size_t i = end; i > begin; i--) {
+        uint64_t entry = source[i - 1];
+        if (i == end || (entry >> 32) != (source[i] >> 32)) {
+            run_end = entries_above(source, count, (uint32_t)(entry >> 32));
+        }
+        job->rank[(uint32_t)entry] = (uint32_t)(count - run_end + 1);
+    }
+    return NULL;
+}
+
+int roster_rank_exact(const float *averages, size_t count, int threads,
+                      roster_ranking_t *ranking) {
+    memset(ranking, 0, sizeof(*ranking));
+    if (count > UINT32_MAX) {
+        return -1;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > ROSTER_MAX_THREADS) {
+        threads = ROSTER_MAX_THREADS;
+    }
+    if ((size_t)threads > count) {
+        threads = count > 0 ? (int)count : 1;
+    }
+
+    sort_job_t job;
+    sort_worker_t workers[ROSTER_MAX_THREADS];
+    pthread_t ids[ROSTER_MAX_THREADS];
+    size_t allocated = count > 0 ? count : 1;
+    job.averages = averages;
+    job.count = count;
+    job.threads = threads;
+    job.keys = malloc(allocated * sizeof(uint64_t));
+    job.scratch = malloc(allocated * sizeof(uint64_t));
+    job.rank = malloc(allocated * sizeof(uint32_t));
+    job.histograms = malloc((size_t)threads * sizeof(job.histograms[0]));
+    if (job.keys == NULL || job.scratch == NULL || job.rank == NULL ||
+        job.histograms == NULL) {
+        free(job.keys);
+        free(job.scratch);
+        free(job.rank);
+        free(job.histograms);
+        return -1;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.started, NULL);
+    job.go = 0;
+
+    int started = 1;
+    for (int t = 0; t < threads; t++) {
+        workers[t].job = &job;
+        workers[t].index = t;
+    }
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&ids[t], NULL, sort_worker, &workers[t]) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    // Could not start every thread: sort with the ones we have
+    job.threads = started;
+    pthread_barrier_init(&job.barrier, NULL, (unsigned)started);
+    pthread_mutex_lock(&job.lock);
+    job.go = 1;
+    pthread_cond_broadcast(&job.started);
+    pthread_mutex_unlock(&job.lock);
+
+    sort_worker(&workers[0]);
+    for (int t = 1; t < started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    pthread_barrier_destroy(&job.barrier);
+    pthread_cond_destroy(&job.started);
+    pthread_mutex_destroy(&job.lock);
+
+    free(job.sorted == job.keys ? job.scratch : job.keys);
+    free(job.histograms);
+    ranking->count = count;
+    ranking->sorted = job.sorted;
+    ranking->rank = job.rank;
+    return 0;
+}
+
+void roster_ranking_free(roster_ranking_t *ranking) {
+    free(ranking->sorted);
+    free(ranking->rank);
+    memset(ranking, 0, sizeof(*ranking));
+}
+
+// Nearest rank: the smallest key with at least q of all keys at or below
+static uint64_t nearest_rank(uint64_t count, double q) {
+    double position = q * (double)count;
+    uint64_t rank = (uint64_t)position;
+    rank += (double)rank < position;
+    return rank < 1 ? 1 : rank > count ? count : rank;
+}
+
+uint32_t roster_ranking_quantile(const roster_ranking_t *ranking, double q) {
+    if (ranking->count == 0) {
+        return 0;
+    }
+    return (uint32_t)(ranking->sorted[nearest_rank(ranking->count, q) - 1] >>
+                      32);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Approximate: KLL sketch                                                 */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * A stack of compactors. Level h holds keys that stand for 2^h keys each.
+ * When a level fills up, every other key of it in sorted order (starting
+ * at a random one of the first two) moves up a level, where it counts
+ * double; the rest are dropped. The top level holds ROSTER_SKETCH_K keys
+ * and each level below it 2/3 as many, so the sketch stays around 3 * K
+ * keys.
+ *
+ * Level 0, where every key arrives, is a plain buffer of 4 * K keys that
+ * is radix sorted when full (like the exact ranking, on 32-bit keys). The
+ * levels above it are always kept sorted: what moves up is sorted
+ * already and is merged in, so they never need sorting at all.
+ */
+struct roster_sketch {
+    uint64_t count;
+    uint64_t random;
+    int levels;
+    uint32_t *items[SKETCH_MAX_LEVELS];
+    size_t size[SKETCH_MAX_LEVELS];
+    size_t allocated[SKETCH_MAX_LEVELS];
+    size_t capacity[SKETCH_MAX_LEVELS];     // For the current level count
+    uint32_t *scratch;                      // Sorting and moving up
+    size_t scratch_allocated;
+
+    // Every key with the weight up to and including it, for queries;
+    // rebuilt after keys are added
+    uint32_t *view_keys;
+    uint64_t *view_weights;
+    size_t view_size;
+    size_t view_allocated;
+    int view_current;
+};
+
+static int compare_entries(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief LSD radix sort of 32-bit keys, skipping digits all keys share
+ *
+ * All four digits are counted in one pass over the keys.
+ */
+static void radix_sort_keys(uint32_t *keys, uint32_t *scratch, size_t count) {
+    uint32_t counts[32 / RADIX_BITS][RADIX_BUCKETS];
+    uint32_t *source = keys;
+    uint32_t *target = scratch;
+
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < count; i++) {
+        uint32_t key = keys[i];
+        for (int d = 0; d < 32 / RADIX_BITS; d++) {
+            counts[d][(key >> (d * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+    for (int d = 0; count > 0 && d < 32 / RADIX_BITS; d++) {
+        int shift = d * RADIX_BITS;
+        uint32_t *next = counts[d];
+        if (next[(keys[0] >> shift) & (RADIX_BUCKETS - 1)] == count) {
+            continue;
+        }
+        uint32_t position = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            uint32_t total = next[b];
+            next[b] = position;
+            position += total;
+        }
+        for (size_t i = 0; i < count; i++) {
+            target[next[(source[i] >> shift) & (RADIX_BUCKETS - 1)]++] =
+                source[i];
+        }
+        uint32_t *swap = source;
+        source = target;
+        target = swap;
+    }
+    if (source != keys) {
+        memcpy(keys, source, count * sizeof(uint32_t));
+    }
+}
+
+static uint64_t sketch_random(roster_sketch_t *sketch) {
+    sketch->random ^= sketch->random << 13;
+    sketch->random ^= sketch->random >> 7;
+    sketch->random ^= sketch->random << 17;
+    return sketch->random;
+}
+
+static void set_capacities(roster_sketch_t *sketch) {
+    double capacity = ROSTER_SKETCH_K;
+    for (int h = sketch->levels - 1; h >= 0; h--) {
+        sketch->capacity[h] = capacity > SKETCH_MIN_CAPACITY
+                                  ? (size_t)(capacity + 0.5)
+                                  : SKETCH_MIN_CAPACITY;
+        capacity *= 2.0 / 3.0;
+    }
+    sketch->capacity[0] = SKETCH_BUFFER;
+}
+
+// realloc() that leaves the old block alone on failure
+static int grow(uint32_t **keys, size_t *allocated, size_t size) {
+    if (size <= *allocated) {
+        return 0;
+    }
+    size_t bigger = *allocated * 2 > size ? *allocated * 2 : size;
+    uint32_t *moved = realloc(*keys, bigger * sizeof(uint32_t));
+    if (moved == NULL) {
+        return -1;
+    }
+    *keys = moved;
+    *allocated = bigger;
+    return 0;
+}
+
+static int reserve(roster_sketch_t *sketch, int level, size_t size) {
+    return grow(&sketch->items[level], &sketch->allocated[level], size);
+}
+
+static int add_level(roster_sketch_t *sketch) {
+    if (sketch->levels == SKETCH_MAX_LEVELS ||
+        reserve(sketch, sketch->levels,
+                sketch->levels == 0 ? SKETCH_BUFFER
+                                    : ROSTER_SKETCH_K + 1) != 0) {
+        return -1;
+    }
+    sketch->size[sketch->levels++] = 0;
+    set_capacities(sketch);
+    return 0;
+}
+
+/**
+ * @brief Merges sorted keys into a sorted level, from the back
+ */
+static int merge_into(roster_sketch_t *sketch, int level, const uint32_t *run,
+                      size_t count) {
+    size_t i = sketch->size[level];
+    size_t j = count;
+    size_t k = i + j;
+    if (reserve(sketch, level, k) != 0) {
+        return -1;
+    }
+    uint32_t *items = sketch->items[level];
+    while (j > 0) {
+        if (i > 0 && items[i - 1] > run[j - 1]) {
+            items[--k] = items[--i];
+        } else {
+            items[--k] = run[--j];
+        }
+    }
+    sketch->size[level] += count;
+    return 0;
+}
+
+/**
+ * @brief Moves every other key of a level one level up
+ *
+ * With an odd number of keys the smallest stays behind, so no weight is
+ * lost: what is promoted counts exactly twice what it replaces.
+ */
+static int compact(roster_sketch_t *sketch, int level) {
+    if (level + 1 == sketch->levels && add_level(sketch) != 0) {
+        return -1;
+    }
+    size_t size = sketch->size[level];
+    uint32_t *items = sketch->items[level];
+    if (grow(&sketch->scratch, &sketch->scratch_allocated, size) != 0) {
+        return -1;
+    }
+    if (level == 0) {
+        radix_sort_keys(items, sketch->scratch, size);
+    }
+
+    size_t kept = size & 1;
+    size_t moved = 0;
+    for (size_t i = kept + (sketch_random(sketch) >> 63); i < size; i += 2) {
+        sketch->scratch[moved++] = items[i];
+    }
+    sketch->size[level] = kept;
+    return merge_into(sketch, level + 1, sketch->scratch, moved);
+}
+
+// Compacts every level that is full, from the bottom up
+static int compress(roster_sketch_t *sketch) {
+    int compacted = 1;
+    while (compacted) {
+        compacted = 0;
+        for (int h = 0; h < sketch->levels; h++) {
+            if (sketch->size[h] >= sketch->capacity[h]) {
+                if (compact(sketch, h) != 0) {
+                    return -1;
+                }
+                compacted = 1;
+            }
+        }
+    }
+    return 0;
+}
+
+roster_sketch_t *roster_sketch_new(uint64_t seed) {
+    roster_sketch_t *sketch = calloc(1, sizeof(*sketch));
+    if (sketch == NULL) {
+        return NULL;
+    }
+    sketch->random = seed * 0x9e3779b97f4a7c15ull | 1;
+    if (add_level(sketch) != 0) {
+        free(sketch);
+        return NULL;
+    }
+    return sketch;
+}
+
+void roster_sketch_free(roster_sketch_t *sketch) {
+    if (sketch == NULL) {
+        return;
+    }
+    for (int h = 0; h < SKETCH_MAX_LEVELS; h++) {
+        free(sketch->items[h]);
+    }
+    free(sketch->scratch);
+    free(sketch->view_keys);
+    free(sketch->view_weights);
+    free(sketch);
+}
+
+int roster_sketch_add(roster_sketch_t *sketch, uint32_t key) {
+    sketch->items[0][sketch->size[0]++] = key;
+    sketch->count++;
+    sketch->view_current = 0;
+    // Level 0 never holds more than SKETCH_BUFFER keys; compacting a
+    // level can only fill the one above it
+    for (int h = 0; sketch->size[h] >= sketch->capacity[h]; h++) {
+        int levels = sketch->levels;
+        if (compact(sketch, h) != 0) {
+            return -1;
+        }
+        if (sketch->levels != levels) {
+            // A new top level makes every level below it smaller
+            return compress(sketch);
+        }
+    }
+    return 0;
+}
+
+int roster_sketch_merge(roster_sketch_t *into, const roster_sketch_t *from) {
+    while (into->levels < from->levels) {
+        if (add_level(into) != 0) {
+            return -1;
+        }
+    }
+    // Level 0 is not sorted yet, the others are merged in order
+    if (reserve(into, 0, into->size[0] + from->size[0]) != 0) {
+        return -1;
+    }
+    memcpy(into->items[0] + into->size[0], from->items[0],
+           from->size[0] * sizeof(uint32_t));
+    into->size[0] += from->size[0];
+    for (int h = 1; h < from->levels; h++) {
+        if (merge_into(into, h, from->items[h], from->size[h]) != 0) {
+            return -1;
+        }
+    }
+    into->count += from->count;
+    into->view_current = 0;
+    if (compress(into) != 0) {
+        return -1;
+    }
+    // Adding keys fills level 0 one at a time, so keep room for a full one
+    return reserve(into, 0, SKETCH_BUFFER);
+}
+
+uint64_t roster_sketch_count(const roster_sketch_t *sketch) {
+    return sketch->count;
+}
+
+size_t roster_sketch_bytes(const roster_sketch_t *sketch) {
+    size_t bytes = sizeof(*sketch);
+    for (int h = 0; h < sketch->levels; h++) {
+        bytes += sketch->allocated[h] * sizeof(uint32_t);
+    }
+    bytes += sketch->scratch_allocated * sizeof(uint32_t);
+    return bytes + sketch->view_allocated * (sizeof(uint32_t) +
+                                             sizeof(uint64_t));
+}
+
+/**
+ * @brief Lines up every key in order with the running total of weights
+ * @return 0, or -1 if memory runs out
+ */
+static int build_view(roster_sketch_t *sketch) {
+    if (sketch->view_current) {
+        return 0;
+    }
+    size_t total = 0;
+    for (int h = 0; h < sketch->levels; h++) {
+        total += sketch->size[h];
+    }
+    if (total > sketch->view_allocated) {
+        uint32_t *keys = realloc(sketch->view_keys, total * sizeof(uint32_t));
+        if (keys != NULL) {
+            sketch->view_keys = keys;
+        }
+        uint64_t *weights = realloc(sketch->view_weights,
+                                    total * sizeof(uint64_t));
+        if (weights != NULL) {
+            sketch->view_weights = weights;
+        }
+        if (keys == NULL || weights == NULL) {
+            return -1;
+        }
+        sketch->view_allocated = total;
+    }
+
+    // Sorted as key << 32 | level, then split again
+    uint64_t *entries = sketch->view_weights;
+    size_t n = 0;
+    for (int h = 0; h < sketch->levels; h++) {
+        for (size_t i = 0; i < sketch->size[h]; i++) {
+            entries[n++] = (uint64_t)sketch->items[h][i] << 32 | (uint64_t)h;
+        }
+    }
+    qsort(entries, n, sizeof(uint64_t), compare_entries);
+    uint64_t weight = 0;
+    for (size_t i = 0; i < n; i++) {
+        sketch->view_keys[i] = (uint32_t)(entries[i] >> 32);
+        weight += 1ull << (entries[i] & 0xff);
+        entries[i] = weight;
+    }
+    sketch->view_size = n;
+    sketch->view_current = 1;
+    return 0;
+}
+
+uint32_t roster_sketch_quantile(roster_sketch_t *sketch, double q) {
+    if (sketch->count == 0 || build_view(sketch) != 0) {
+        return 0;
+    }
+    uint64_t rank = nearest_rank(sketch->count, q);
+    size_t low = 0, high = sketch->view_size - 1;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (sketch->view_weights[middle] < rank) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return sketch->view_keys[low];
+}
+
+uint64_t roster_sketch_rank_below(roster_sketch_t *sketch, uint32_t key) {
+    if (sketch->count == 0 || build_view(sketch) != 0) {
+        return 0;
+    }
+    size_t low = 0, high = sketch->view_size;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (sketch->view_keys[middle] < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low == 0 ? 0 : sketch->view_weights[low - 1];
+}
+
+/* ---------------------------------------------------------------------- */
+/* Statistics                                                              */
+/* ---------------------------------------------------------------------- */
+
+// Either method answers the same two questions
+typedef struct {
+    uint64_t (*below)(void *source, uint32_t key);
+    uint32_t (*quantile)(void *source, double q);
+    void *source;
+} stats_source_t;
+
+static uint64_t exact_below(void *source, uint32_t key) {
+    const roster_ranking_t *ranking = source;
+    return entries_below(ranking->sorted, ranking->count, key);
+}
+
+static uint32_t exact_quantile(void *source, double q) {
+    return roster_ranking_quantile(source, q);
+}
+
+static uint64_t sketch_below(void *source, uint32_t key) {
+    return roster_sketch_rank_below(source, key);
+}
+
+static uint32_t sketch_quantile(void *source, double q) {
+    return roster_sketch_quantile(source, q);
+}
+
+static void fill_stats(const stats_source_t *from, uint64_t students,
+                       roster_stats_t *stats) {
+    // Points needed: 60.00 minus the average, for averages below 60.00
+    static const float bucket_limits[ROSTER_POINTS_BUCKETS] = {
+        ROSTER_PASSING_AVERAGE - 5, ROSTER_PASSING_AVERAGE - 10,
+        ROSTER_PASSING_AVERAGE - 20, -1e30f
+    };
+    static const double needed_fractions[3] = { 0.25, 0.5, 0.75 };
+    uint32_t passing = roster_score_key(ROSTER_PASSING_AVERAGE);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->students = students;
+    if (students == 0) {
+        return;
+    }
+    stats->median = roster_key_average(from->quantile(from->source, 0.5));
+    for (int d = 0; d < 9; d++) {
+        stats->deciles[d] = roster_key_average(
+            from->quantile(from->source, (d + 1) / 10.0));
+    }
+
+    stats->failing = from->below(from->source, passing);
+    uint64_t above_limit = stats->failing;
+    for (int b = 0; b < ROSTER_POINTS_BUCKETS; b++) {
+        uint64_t below_limit = b == ROSTER_POINTS_BUCKETS - 1
+            ? 0 : from->below(from->source, roster_score_key(bucket_limits[b]));
+        below_limit = below_limit < above_limit ? below_limit : above_limit;
+        stats->points_histogram[b] = above_limit - below_limit;
+        above_limit = below_limit;
+    }
+
+    // The students needing the fewest points are the highest failing
+    // ones: the r-th smallest need is failing average number
+    // failing + 1 - r, counting up from the lowest
+    for (int i = 0; i < 3 && stats->failing > 0; i++) {
+        uint64_t rank = stats->failing + 1 -
+                        nearest_rank(stats->failing, needed_fractions[i]);
+        uint32_t key = from->quantile(from->source,
+                                      ((double)rank - 0.5) / students);
+        stats->points_needed[i] = ROSTER_PASSING_AVERAGE -
+                                  roster_key_average(key);
+    }
+}
+
+void roster_stats_exact(const roster_ranking_t *ranking,
+                        roster_stats_t *stats) {
+    stats_source_t from = { exact_below, exact_quantile, (void *)ranking };
+    fill_stats(&from, ranking->count, stats);
+}
+
+void roster_stats_approximate(roster_sketch_t *sketch, roster_stats_t *stats) {
+    stats_source_t from = { sketch_below, sketch_quantile, sketch };
+    fill_stats(&from, sketch->count, stats);
+}
+
+void roster_print_stats(FILE *out, const roster_stats_t *stats,
+                        int approximate) {
+    static const char *bucket_names[ROSTER_POINTS_BUCKETS] = {
+        "up to 5", "5 to 10", "10 to 20", "over 20"
+    };
+    char text[1024];
+    size_t n = 0;
+
+    n += (size_t)fmt_format(text + n, sizeof(text) - n,
+                            "\n=== CLASS STATISTICS (%s) ===\n"
+                            "Students ranked: %llu\n",
+                            approximate ? "approximate" : "exact",
+                            (unsigned long long)stats->students);
+    if (stats->students > 0) {
+        n += (size_t)fmt_format(text + n, sizeof(text) - n,
+                                "Median average: %.2f\nDeciles:",
+                                stats->median);
+        for (int d = 0; d < 9; d++) {
+            n += (size_t)fmt_format(text + n, sizeof(text) - n, " %.2f",
+                                    stats->deciles[d]);
+        }
+        n += (size_t)fmt_format(text + n, sizeof(text) - n,
+                                "\nBelow %d: %llu\n", ROSTER_PASSING_AVERAGE,
+                                (unsigned long long)stats->failing);
+    }
+    if (stats->failing > 0) {
+        n += (size_t)fmt_format(text + n, sizeof(text) - n,
+                                "Points needed to pass: 25%% %.2f  "
+                                "median %.2f  75%% %.2f\n",
+                                stats->points_needed[0],
+                                stats->points_needed[1],
+                                stats->points_needed[2]);
+        for (int b = 0; b < ROSTER_POINTS_BUCKETS; b++) {
+            n += (size_t)fmt_format(text + n, sizeof(text) - n,
+                                    "  %-9s points: %llu\n", bucket_names[b],
+                                    (unsigned long long)
+                                        stats->points_histogram[b]);
+        }
+    }
+    fwrite(text, 1, n, out);
+}
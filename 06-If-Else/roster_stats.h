@@ -0,0 +1,152 @@
+/**
+ * @file roster_stats.h
+ * @brief Class rank, median, deciles and points needed to pass
+ *
+ * Two ways to get them, for rosters of any size:
+ *
+ *   - exact: every average becomes a fixed-point key (hundredths of a
+ *     point, the precision of the report) and the keys are sorted with a
+ *     parallel LSD radix sort, 8 bits per pass. Each thread counts the
+ *     digits of its share of the keys, the counts give every thread its
+ *     own place to write to, and then all threads move their keys at
+ *     once. Passes whose digit is the same in every key are skipped, so
+ *     averages from 0 to 100 take two passes, not four. Memory: 20 bytes
+ *     per student.
+ *
+ *   - approximate: a KLL sketch reads each key once and keeps only a few
+ *     thousand of them, however many there are. Every thread fills its
+ *     own sketch and the sketches are merged at the end. A quantile is
+ *     off by at most about 1% of the class (in rank, not in points).
+ *
+ * Ranks are "competition" ranks: 1 + the number of students with a
+ * higher average, so equal averages share a rank (1, 2, 2, 4, ...).
+ */
+
+#ifndef ROSTER_STATS_H
+#define ROSTER_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// KLL accuracy: the top compactor keeps this many keys (error ~ 1/k)
+#define ROSTER_SKETCH_K 256
+
+// Buckets of the points-needed-to-pass histogram: up to 5, 10, 20, more
+#define ROSTER_POINTS_BUCKETS 4
+
+// Offset that lets negative averages sort below positive ones
+#define ROSTER_KEY_ZERO 2147483648u
+
+/**
+ * @brief An average as a fixed-point key: hundredths of a point, the
+ *        precision of the report (NaN sorts lowest)
+ */
+static inline uint32_t roster_score_key(float average) {
+    double hundredths = (double)average * 100.0;
+    if (!(hundredths > -2147483648.0)) {
+        return 0;                               // NaN or very negative
+    }
+    if (hundredths >= 2147483647.0) {
+        return UINT32_MAX;
+    }
+    hundredths += hundredths < 0 ? -0.5 : 0.5;
+    return (uint32_t)((int64_t)hundredths + ROSTER_KEY_ZERO);
+}
+
+static inline double roster_key_average(uint32_t key) {
+    return (double)((int64_t)key - ROSTER_KEY_ZERO) / 100.0;
+}
+
+// Every student, sorted by key
+typedef struct {
+    size_t count;
+    uint64_t *sorted;       // key << 32 | student, ascending
+    uint32_t *rank;         // Per student (in the original order)
+} roster_ranking_t;
+
+/**
+ * @brief Sorts the averages and ranks every student
+ * @param threads Sorting threads (1 to ROSTER_MAX_THREADS of
+ *                roster_parallel.h)
+ * @return 0, or -1 if memory runs out or there are 2^32 or more students
+ */
+int roster_rank_exact(const float *averages, size_t count, int threads,
+                      roster_ranking_t *ranking);
+
+void roster_ranking_free(roster_ranking_t *ranking);
+
+typedef struct roster_sketch roster_sketch_t;
+
+/**
+ * @brief An empty KLL sketch; seed makes its random choices repeatable
+ */
+roster_sketch_t *roster_sketch_new(uint64_t seed);
+
+void roster_sketch_free(roster_sketch_t *sketch);
+
+/**
+ * @brief Adds one key
+ * @return 0, or -1 if memory runs out
+ */
+int roster_sketch_add(roster_sketch_t *sketch, uint32_t key);
+
+/**
+ * @brief Adds everything from another sketch (which is not changed)
+ * @return 0, or -1 if memory runs out
+ */
+int roster_sketch_merge(roster_sketch_t *into, const roster_sketch_t *from);
+
+/**
+ * @brief Keys added so far
+ */
+uint64_t roster_sketch_count(const roster_sketch_t *sketch);
+
+/**
+ * @brief Bytes the sketch uses right now
+ */
+size_t roster_sketch_bytes(const roster_sketch_t *sketch);
+
+// Class statistics, from either method
+typedef struct {
+    uint64_t students;
+    double median;
+    double deciles[9];              // 10%, 20%, ... 90% (from the bottom)
+    uint64_t failing;               // Average below the passing mark
+    double points_needed[3];        // Failing students' 25%, 50%, 75%
+    uint64_t points_histogram[ROSTER_POINTS_BUCKETS];
+} roster_stats_t;
+
+/**
+ * @brief Statistics from an exact ranking
+ */
+void roster_stats_exact(const roster_ranking_t *ranking,
+                        roster_stats_t *stats);
+
+/**
+ * @brief Statistics from a sketch
+ */
+void roster_stats_approximate(roster_sketch_t *sketch, roster_stats_t *stats);
+
+/**
+ * @brief Key at quantile q (0 = lowest, 1 = highest), exactly
+ */
+uint32_t roster_ranking_quantile(const roster_ranking_t *ranking, double q);
+
+/**
+ * @brief Estimated key at quantile q
+ */
+uint32_t roster_sketch_quantile(roster_sketch_t *sketch, double q);
+
+/**
+ * @brief Estimated number of keys below key
+ */
+uint64_t roster_sketch_rank_below(roster_sketch_t *sketch, uint32_t key);
+
+/**
+ * @brief Prints the statistics in a human-readable form
+ */
+void roster_print_stats(FILE *out, const roster_stats_t *stats,
+                        int approximate);
+
+#endif // ROSTER_STATS_H
@@ -0,0 +1,377 @@
+/**
+ * @file stats_bench.c
+ * @brief Exact ranks (radix sort) vs a KLL sketch: time, memory, error
+ *
+ * For 10 million scores, then 10 times more up to `largest`:
+ *   - approximate: every thread streams its share of the generated
+ *     averages into its own sketch, then the sketches are merged. Only
+ *     the sketch work is timed, not making up the scores.
+ *   - exact: the same averages are stored and roster_rank_exact() sorts
+ *     and ranks them, if its 24 bytes per score (with the averages) fit
+ *     in memory; otherwise that row says how much it would need.
+ *
+ * Generated averages have only 6001 possible values (40.00 to 100.00),
+ * so a plain count of each value is also kept while streaming. That
+ * count is the reference both methods are checked against: the exact
+ * quantiles, the failing count and every single rank must equal it, and
+ * the sketch's error is measured against it even where exact does not
+ * fit. Error is in rank: a median reported at the 50.3% point of the
+ * class is off by 0.3%.
+ *
+ * First, both methods are given a tiny class whose statistics are
+ * known by hand.
+ *
+ * Usage: ./stats_bench [largest] [threads]
+ *        (default 100000000 and the number of CPUs; 1000000000 also runs
+ *        the billion, exact only with about 24 GB of memory)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "roster.h"
+#include "roster_parallel.h"
+#include "roster_stats.h"
+
+// Averages generated at a time (each chunk has its own random seed, so
+// streaming and storing make the same ones)
+#define CHUNK 65536
+
+// Tests per student, like grade_calculator.c
+#define TESTS 3
+
+// Possible generated averages in hundredths: 40.00 ... 100.00
+#define LOWEST_KEY (ROSTER_KEY_ZERO + 4000)
+#define VALUES 6001
+
+// Exact runs only if it needs less than this share of the memory
+#define MEMORY_SHARE 0.7
+
+typedef struct {
+    size_t scores;
+    int threads;
+    int index;
+    float *store;                   // Exact: where the averages go
+    roster_sketch_t *sketch;        // Approximate: what they go into
+    uint64_t counts[VALUES];        // Reference: how often each occurs
+    double sketch_seconds;
+    int failed;
+} stream_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_bits(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// The averages of chunk c: students with scores from 40.0 to 100.0 in
+// steps of 0.1, like roster_bench
+static void generate_chunk(size_t c, float *averages, size_t count) {
+    uint64_t state = (c + 1) * 0x9e3779b97f4a7c15ull;
+    float scores[TESTS];
+    for (size_t i = 0; i < count; i++) {
+        for (int t = 0; t < TESTS; t++) {
+            scores[t] = (float)(400 + (int)(random_bits(&state) % 601)) /
+                        10.0f;
+        }
+        averages[i] = roster_average(scores, TESTS);
+    }
+}
+
+/**
+ * @brief Generates every threads-th chunk, starting at its own index
+ */
+static void *stream_worker(void *arg) {
+    stream_t *stream = arg;
+    float chunk[CHUNK];
+    size_t chunks = (stream->scores + CHUNK - 1) / CHUNK;
+
+    for (size_t c = (size_t)stream->index; c < chunks;
+         c += (size_t)stream->threads) {
+        size_t count = c == chunks - 1 ? stream->scores - c * CHUNK : CHUNK;
+        float *averages = stream->store ? stream->store + c * CHUNK : chunk;
+        generate_chunk(c, averages, count);
+        if (stream->sketch != NULL) {
+            double start = now_seconds();
+            for (size_t i = 0; i < count; i++) {
+                stream->failed |= roster_sketch_add(
+                    stream->sketch, roster_score_key(averages[i])) != 0;
+            }
+            stream->sketch_seconds += now_seconds() - start;
+            for (size_t i = 0; i < count; i++) {
+                stream->counts[roster_score_key(averages[i]) - LOWEST_KEY]++;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs the workers over `scores` averages
+ * @return The slowest thread's sketch time
+ */
+static double stream_all(stream_t *streams, int threads) {
+    pthread_t ids[ROSTER_MAX_THREADS];
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&ids[t], NULL, stream_worker, &streams[t]) != 0) {
+            fprintf(stderr, "Cannot start a thread\n");
+            exit(1);
+        }
+    }
+    stream_worker(&streams[0]);
+    double slowest = streams[0].sketch_seconds;
+    for (int t = 1; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        if (streams[t].sketch_seconds > slowest) {
+            slowest = streams[t].sketch_seconds;
+        }
+    }
+    return slowest;
+}
+
+// Reference rank of a key: how many averages are below it, and at it
+static void reference_rank(const uint64_t *below, uint32_t key,
+                           uint64_t *lowest, uint64_t *highest) {
+    size_t v = key < LOWEST_KEY ? 0
+             : key - LOWEST_KEY > VALUES ? VALUES : key - LOWEST_KEY;
+    *lowest = below[v];
+    *highest = v < VALUES ? below[v + 1] : below[VALUES];
+}
+
+/**
+ * @brief How far (as a share of the class) the key is from quantile q
+ */
+static double rank_error(const uint64_t *below, size_t scores, uint32_t key,
+                         double q) {
+    uint64_t lowest, highest;
+    reference_rank(below, key, &lowest, &highest);
+    double from = (double)lowest / scores;
+    double to = (double)highest / scores;
+    return q < from ? from - q : q > to ? q - to : 0;
+}
+
+static void print_row(size_t scores, const char *method, double seconds,
+                      double bytes, double error) {
+    const char *unit = bytes >= 1e9 ? "GB" : bytes >= 1e6 ? "MB" : "KB";
+    double scaled = bytes >= 1e9 ? bytes / 1e9
+                  : bytes >= 1e6 ? bytes / 1e6 : bytes / 1e3;
+    printf("%13zu %-12s %9.3f %9.1f %s %10.1f ns %11.3f%%\n", scores, method,
+           seconds, scaled, unit, seconds / scores * 1e9, error * 100);
+}
+
+/**
+ * @brief One size: approximate always, exact if it fits (exact->students
+ *        stays 0 if not)
+ * @return Number of failed checks
+ */
+static int run_size(size_t scores, int threads, double memory,
+                    roster_stats_t *approximate, roster_stats_t *exact) {
+    static stream_t streams[ROSTER_MAX_THREADS];
+    int failures = 0;
+
+    // Approximate, one pass, one sketch per thread
+    for (int t = 0; t < threads; t++) {
+        memset(&streams[t], 0, sizeof(streams[t]));
+        streams[t].scores = scores;
+        streams[t].threads = threads;
+        streams[t].index = t;
+        streams[t].sketch = roster_sketch_new((uint64_t)t + 1);
+        if (streams[t].sketch == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    double seconds = stream_all(streams, threads);
+    double start = now_seconds();
+    size_t bytes = 0;
+    roster_sketch_t *sketch = streams[0].sketch;
+    for (int t = 1; t < threads; t++) {
+        streams[0].failed |= roster_sketch_merge(sketch, streams[t].sketch);
+        bytes += roster_sketch_bytes(streams[t].sketch);
+        for (int v = 0; v < VALUES; v++) {
+            streams[0].counts[v] += streams[t].counts[v];
+        }
+        roster_sketch_free(streams[t].sketch);
+    }
+    roster_stats_approximate(sketch, approximate);
+    seconds += now_seconds() - start;
+    bytes += roster_sketch_bytes(sketch);
+
+    static uint64_t below[VALUES + 1];
+    below[0] = 0;
+    for (int v = 0; v < VALUES; v++) {
+        below[v + 1] = below[v] + streams[0].counts[v];
+    }
+    if (streams[0].failed || roster_sketch_count(sketch) != scores ||
+        below[VALUES] != scores) {
+        printf("Sketch lost count of the scores: FAILED\n");
+        failures++;
+    }
+    double error = 0;
+    for (int d = 1; d <= 9; d++) {
+        double e = rank_error(below, scores,
+                              roster_sketch_quantile(sketch, d / 10.0),
+                              d / 10.0);
+        error = e > error ? e : error;
+    }
+    print_row(scores, "approximate", seconds, (double)bytes, error);
+    roster_sketch_free(sketch);
+
+    // Exact, if the averages, the sorted entries and the ranks all fit
+    double needed = 24.0 * scores;
+    if (needed > memory * MEMORY_SHARE || scores > UINT32_MAX) {
+        printf("%13zu %-12s   skipped: needs %.1f GB, %.1f GB of memory\n",
+               scores, "exact", needed / 1e9, memory / 1e9);
+        return failures;
+    }
+    float *averages = malloc(scores * sizeof(float));
+    if (averages == NULL) {
+        printf("%13zu %-12s   skipped: out of memory\n", scores, "exact");
+        return failures;
+    }
+    for (int t = 0; t < threads; t++) {
+        streams[t].sketch = NULL;
+        streams[t].store = averages;
+    }
+    stream_all(streams, threads);
+
+    roster_ranking_t ranking;
+    start = now_seconds();
+    if (roster_rank_exact(averages, scores, threads, &ranking) != 0) {
+        printf("%13zu %-12s   skipped: out of memory\n", scores, "exact");
+        free(averages);
+        return failures;
+    }
+    roster_stats_exact(&ranking, exact);
+    seconds = now_seconds() - start;
+
+    // Every quantile and every rank must be what the counts say
+    error = 0;
+    for (int d = 1; d <= 9; d++) {
+        double e = rank_error(below, scores,
+                              roster_ranking_quantile(&ranking, d / 10.0),
+                              d / 10.0);
+        error = e > error ? e : error;
+    }
+    size_t wrong_ranks = 0;
+    for (size_t i = 0; i < scores; i++) {
+        uint64_t lowest, highest;
+        reference_rank(below, roster_score_key(averages[i]), &lowest,
+                       &highest);
+        wrong_ranks += ranking.rank[i] != scores - highest + 1;
+    }
+    if (error != 0 || wrong_ranks != 0 ||
+        exact->failing != below[roster_score_key(ROSTER_PASSING_AVERAGE) -
+                               LOWEST_KEY]) {
+        printf("Exact ranking: %zu wrong ranks: FAILED\n", wrong_ranks);
+        failures++;
+    }
+    print_row(scores, "exact", seconds, needed - 4.0 * scores, error);
+
+    roster_ranking_free(&ranking);
+    free(averages);
+    return failures;
+}
+
+/**
+ * @brief Checks both methods on a class small enough to work out by hand
+ *
+ * Four failing students need 4, 6, 8 and 10 points (averages 56, 54,
+ * 52 and 50); two more pass. By nearest rank, the failing students'
+ * 25%, 50% and 75% points needed are 4, 6 and 8.
+ *
+ * @return Number of failed checks
+ */
+static int check_known_answers(void) {
+    static const float averages[] = { 80, 56, 50, 90, 54, 52 };
+    static const double needed[3] = { 4, 6, 8 };
+    size_t count = sizeof(averages) / sizeof(averages[0]);
+    roster_ranking_t ranking;
+    roster_stats_t stats[2];
+    roster_sketch_t *sketch = roster_sketch_new(1);
+
+    if (sketch == NULL || roster_rank_exact(averages, count, 1, &ranking) != 0) {
+        printf("Known answers: out of memory: FAILED\n");
+        roster_sketch_free(sketch);
+        return 1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        roster_sketch_add(sketch, roster_score_key(averages[i]));
+    }
+    roster_stats_exact(&ranking, &stats[0]);
+    roster_stats_approximate(sketch, &stats[1]);   // Exact while this small
+    roster_ranking_free(&ranking);
+    roster_sketch_free(sketch);
+
+    int failures = 0;
+    for (int method = 0; method < 2; method++) {
+        int ok = stats[method].failing == 4;
+        for (int i = 0; i < 3; i++) {
+            ok = ok && fabs(stats[method].points_needed[i] - needed[i]) < 0.005;
+        }
+        if (!ok) {
+            printf("Known answers (%s): points needed %.2f %.2f %.2f, "
+                   "expected 4.00 6.00 8.00: FAILED\n",
+                   method == 0 ? "exact" : "approximate",
+                   stats[method].points_needed[0],
+                   stats[method].points_needed[1],
+                   stats[method].points_needed[2]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    size_t largest = argc > 1 ? (size_t)atoll(argv[1]) : 100000000;
+    long threads = argc > 2 ? atol(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+    double memory = (double)sysconf(_SC_PHYS_PAGES) *
+                    (double)sysconf(_SC_PAGE_SIZE);
+    if (largest == 0 || threads < 1 || threads > ROSTER_MAX_THREADS) {
+        fprintf(stderr, "Usage: %s [largest] [threads (1 to %d)]\n", argv[0],
+                ROSTER_MAX_THREADS);
+        return 1;
+    }
+
+    printf("=== CLASS STATISTICS BENCHMARK ===\n");
+    printf("%ld threads, KLL sketch with k = %d, %.1f GB of memory\n\n",
+           threads, ROSTER_SKETCH_K, memory / 1e9);
+    printf("%13s %-12s %9s %12s %13s %12s\n", "scores", "method", "seconds",
+           "memory", "per score", "rank error");
+
+    int failures = check_known_answers();
+    roster_stats_t approximate, exact;
+    size_t scores = largest < 10000000 ? largest : 10000000;
+    for (;;) {
+        memset(&exact, 0, sizeof(exact));
+        failures += run_size(scores, (int)threads, memory, &approximate,
+                             &exact);
+        if (scores >= largest) {
+            break;
+        }
+        scores = scores * 10 < largest ? scores * 10 : largest;
+    }
+    if (failures == 0) {
+        printf("\nExact quantiles, failing counts and every rank match a "
+               "count of each average\n");
+    }
+    if (exact.students > 0) {
+        roster_print_stats(stdout, &exact, 0);
+    }
+    roster_print_stats(stdout, &approximate, 1);
+    return failures == 0 ? 0 : 1;
+}
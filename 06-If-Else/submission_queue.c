@@ -0,0 +1,92 @@
+/**
+ * @file submission_queue.c
+ * @brief Bounded MPMC queue (Vyukov): one CAS per push or pop
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "submission_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int submission_queue_init(submission_queue_t *queue, size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+    memset(queue, 0, sizeof(*queue));
+    queue->cells = malloc(size * sizeof(submission_cell_t));
+    if (queue->cells == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+    }
+    queue->mask = size - 1;
+    atomic_init(&queue->enqueue_position, 0);
+    atomic_init(&queue->dequeue_position, 0);
+    return 0;
+}
+
+void submission_queue_free(submission_queue_t *queue) {
+    free(queue->cells);
+    queue->cells = NULL;
+}
+
+int submission_queue_push(submission_queue_t *queue,
+                          const submission_t *submission) {
+    size_t position = atomic_load_explicit(&queue->enqueue_position,
+                                           memory_order_relaxed);
+    for (;;) {
+        submission_cell_t *cell = &queue->cells[position & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence,
+                                               memory_order_acquire);
+        intptr_t lap = (intptr_t)sequence - (intptr_t)position;
+        if (lap == 0) {
+            // Free for this position: claim it (a failed CAS reloads it)
+            if (atomic_compare_exchange_weak_explicit(
+                    &queue->enqueue_position, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                cell->submission = *submission;
+                atomic_store_explicit(&cell->sequence, position + 1,
+                                      memory_order_release);
+                return 1;
+            }
+        } else if (lap < 0) {
+            return 0;           // Still full from the last lap
+        } else {
+            // Another producer got here first
+            position = atomic_load_explicit(&queue->enqueue_position,
+                                            memory_order_relaxed);
+        }
+    }
+}
+
+int submission_queue_pop(submission_queue_t *queue, submission_t *submission) {
+    size_t position = atomic_load_explicit(&queue->dequeue_position,
+                                           memory_order_relaxed);
+    for (;;) {
+        submission_cell_t *cell = &queue->cells[position & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence,
+                                               memory_order_acquire);
+        intptr_t lap = (intptr_t)sequence - (intptr_t)(position + 1);
+        if (lap == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &queue->dequeue_position, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                *submission = cell->submission;
+                atomic_store_explicit(&cell->sequence,
+                                      position + queue->mask + 1,
+                                      memory_order_release);
+                return 1;
+            }
+        } else if (lap < 0) {
+            return 0;           // Nothing written here yet
+        } else {
+            // Another consumer got here first
+            position = atomic_load_explicit(&queue->dequeue_position,
+                                            memory_order_relaxed);
+        }
+    }
+}
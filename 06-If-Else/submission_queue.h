@@ -0,0 +1,81 @@
+/**
+ * @file submission_queue.h
+ * @brief Bounded lock-free queue of score submissions, any number of
+ *        threads on either end
+ *
+ * Dmitry Vyukov's bounded MPMC queue: an array of cells, each with a
+ * sequence number that says whose turn the cell is.
+ *
+ *   - A cell whose sequence equals the enqueue position is free. A
+ *     producer claims the position with compare-and-swap, writes the
+ *     submission and sets the sequence to position + 1 (release).
+ *   - A cell whose sequence is position + 1 is full. A consumer claims
+ *     the dequeue position the same way, reads the submission and sets
+ *     the sequence to position + capacity: free for the next lap.
+ *
+ * No thread ever waits for a lock. Producers only contend with each
+ * other on the enqueue position, consumers on the dequeue position, and
+ * the two positions are on separate cache lines. A full or empty queue
+ * is reported, not waited on: the caller decides whether to retry.
+ */
+
+#ifndef SUBMISSION_QUEUE_H
+#define SUBMISSION_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tests per submission, like the interactive grade calculator
+#define SUBMISSION_TESTS 3
+
+#define SUBMISSION_CACHE_LINE 64
+
+// One student's scores, as sent by an exam terminal
+typedef struct {
+    uint64_t number;            // Submission number, unique
+    uint64_t submitted_ns;      // CLOCK_MONOTONIC when it was queued
+    uint32_t student;
+    uint32_t terminal;
+    float scores[SUBMISSION_TESTS];
+} submission_t;
+
+typedef struct {
+    _Atomic size_t sequence;
+    submission_t submission;
+} submission_cell_t;
+
+typedef struct {
+    submission_cell_t *cells;
+    size_t mask;                // Capacity - 1 (capacity is a power of 2)
+    _Alignas(SUBMISSION_CACHE_LINE) _Atomic size_t enqueue_position;
+    _Alignas(SUBMISSION_CACHE_LINE) _Atomic size_t dequeue_position;
+} submission_queue_t;
+
+/**
+ * @brief Makes an empty queue for capacity submissions (rounded up to a
+ *        power of 2, at least 2)
+ * @return 0, or -1 if memory runs out
+ */
+int submission_queue_init(submission_queue_t *queue, size_t capacity);
+
+void submission_queue_free(submission_queue_t *queue);
+
+/**
+ * @brief Adds a submission unless the queue is full
+ * @return 1 if added, 0 if full
+ */
+int submission_queue_push(submission_queue_t *queue,
+                          const submission_t *submission);
+
+/**
+ * @brief Takes the oldest submission unless the queue is empty
+ * @return 1 if taken, 0 if empty (or a push is still writing it)
+ */
+int submission_queue_pop(submission_queue_t *queue, submission_t *submission);
+
+static inline size_t submission_queue_capacity(const submission_queue_t *queue) {
+    return queue->mask + 1;
+}
+
+#endif // SUBMISSION_QUEUE_H
@@ -0,0 +1,1261 @@
+/**
+ * @file fmt.c
+ * @brief Number formatting: digit-pair tables, 128-bit rounding, Ryu
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fmt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <wchar.h>
+
+#include "fmt_ryu_table.h"
+
+__extension__ typedef unsigned __int128 fmt_u128;
+
+// "00" to "99": two digits per division by 100
+static const char DIGIT_PAIRS[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t POWERS_OF_TEN[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+    100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull,
+    10000000000000000000ull
+};
+
+// Largest precision the 128-bit fast paths handle (10^17 < 2^57)
+#define FAST_PRECISION_MAX 17
+
+static int count_digits(uint64_t value) {
+    int count = 1;
+    for (;;) {
+        if (value < 10) {
+            return count;
+        }
+        if (value < 100) {
+            return count + 1;
+        }
+        if (value < 1000) {
+            return count + 2;
+        }
+        if (value < 10000) {
+            return count + 3;
+        }
+        value /= 10000;
+        count += 4;
+    }
+}
+
+// Writes the digits of value so that the last one is just before end
+static void write_digits(char *end, uint64_t value) {
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100);
+        value /= 100;
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + 2 * pair, 2);
+    }
+    if (value >= 10) {
+        memcpy(end - 2, DIGIT_PAIRS + 2 * value, 2);
+    } else {
+        end[-1] = (char)('0' + value);
+    }
+}
+
+size_t fmt_u64(char *out, uint64_t value) {
+    int length = count_digits(value);
+    write_digits(out + length, value);
+    return (size_t)length;
+}
+
+size_t fmt_i64(char *out, int64_t value) {
+    if (value < 0) {
+        *out = '-';
+        // Negate in unsigned arithmetic so INT64_MIN works too
+        return 1 + fmt_u64(out + 1, 0 - (uint64_t)value);
+    }
+    return fmt_u64(out, (uint64_t)value);
+}
+
+size_t fmt_hex(char *out, uint64_t value, int upper) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    int length = 1;
+    while (length < 16 && (value >> (4 * length)) != 0) {
+        length++;
+    }
+    for (int i = length - 1; i >= 0; i--) {
+        out[i] = digits[value & 15];
+        value >>= 4;
+    }
+    return (size_t)length;
+}
+
+size_t fmt_octal(char *out, uint64_t value) {
+    int length = 1;
+    while (length < 22 && (value >> (3 * length)) != 0) {
+        length++;
+    }
+    for (int i = length - 1; i >= 0; i--) {
+        out[i] = (char)('0' + (value & 7));
+        value >>= 3;
+    }
+    return (size_t)length;
+}
+
+// Writes a 128-bit value in decimal (up to 39 digits)
+static size_t write_u128(char *out, fmt_u128 value) {
+    if (value <= UINT64_MAX) {
+        return fmt_u64(out, (uint64_t)value);
+    }
+    size_t length = write_u128(out, value / POWERS_OF_TEN[19]);
+    memset(out + length, '0', 19);
+    write_digits(out + length + 19, (uint64_t)(value % POWERS_OF_TEN[19]));
+    return length + 19;
+}
+
+static fmt_u128 power_of_ten(int n) {
+    return n <= 19 ? POWERS_OF_TEN[n]
+                   : (fmt_u128)POWERS_OF_TEN[19] * POWERS_OF_TEN[n - 19];
+}
+
+static int bit_length(fmt_u128 value) {
+    uint64_t high = (uint64_t)(value >> 64);
+    if (high != 0) {
+        return 128 - __builtin_clzll(high);
+    }
+    return value == 0 ? 0 : 64 - __builtin_clzll((uint64_t)value);
+}
+
+/**
+ * @brief A double split into sign, kind and mantissa * 2^exponent
+ */
+typedef struct {
+    uint64_t mantissa;
+    int exponent;
+    int negative;
+    int special;                 // 0 finite, 1 infinity, 2 NaN
+    uint64_t fraction;           // The raw fields, for Ryu
+    unsigned biased_exponent;
+} binary_t;
+
+static binary_t split_double(double value) {
+    binary_t number;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    number.negative = (int)(bits >> 63);
+    number.biased_exponent = (unsigned)(bits >> 52) & 0x7FF;
+    number.fraction = bits & ((1ull << 52) - 1);
+    number.special = 0;
+    if (number.biased_exponent == 0x7FF) {
+        number.special = number.fraction == 0 ? 1 : 2;
+    }
+    if (number.biased_exponent == 0) {
+        number.mantissa = number.fraction;          // Subnormal
+        number.exponent = -1074;
+    } else {
+        number.mantissa = number.fraction | (1ull << 52);
+        number.exponent = (int)number.biased_exponent - 1075;
+    }
+    return number;
+}
+
+// "inf", "-nan" and so on, as glibc prints them
+static size_t write_special(char *out, const binary_t *number, int upper) {
+    char *p = out;
+    if (number->negative) {
+        *p++ = '-';
+    }
+    const char *text = number->special == 1 ? (upper ? "INF" : "inf")
+                                             : (upper ? "NAN" : "nan");
+    memcpy(p, text, 3);
+    return (size_t)(p + 3 - out);
+}
+
+// Shifts right by 1..127 bits, rounding to nearest, ties to even
+static fmt_u128 shift_round(fmt_u128 value, int shift) {
+    fmt_u128 quotient = value >> shift;
+    fmt_u128 remainder = value & (((fmt_u128)1 << shift) - 1);
+    fmt_u128 half = (fmt_u128)1 << (shift - 1);
+    if (remainder > half || (remainder == half && (quotient & 1))) {
+        quotient++;
+    }
+    return quotient;
+}
+
+/**
+ * @brief mantissa * 2^exponent * 10^precision, rounded to an integer
+ *
+ * That is the value printf("%.*f") prints, without the decimal point.
+ * The product fits in 128 bits for precisions up to 17 and values
+ * below 2^70.
+ *
+ * @return 1 on success, 0 if the value needs the slow path
+ */
+static int scale_fixed(const binary_t *number, int precision,
+                       fmt_u128 *scaled) {
+    if (precision > FAST_PRECISION_MAX || number->exponent > 17) {
+        return 0;
+    }
+    fmt_u128 product = (fmt_u128)number->mantissa * POWERS_OF_TEN[precision];
+    if (number->exponent >= 0) {
+        *scaled = product << number->exponent;
+    } else if (number->exponent <= -128) {
+        *scaled = 0;                                // Far below 10^-17
+    } else {
+        *scaled = shift_round(product, -number->exponent);
+    }
+    return 1;
+}
+
+size_t fmt_fixed(char *out, double value, int precision) {
+    binary_t number = split_double(value);
+    fmt_u128 scaled;
+
+    if (precision < 0) {
+        precision = 6;
+    }
+    if (number.special) {
+        return write_special(out, &number, 0);
+    }
+    if (!scale_fixed(&number, precision, &scaled)) {
+        return (size_t)snprintf(out, FMT_NUMBER_MAX, "%.*f", precision, value);
+    }
+
+    char digits[48];
+    size_t count = write_u128(digits, scaled);
+    size_t fraction = (size_t)precision;
+    char *p = out;
+    if (number.negative) {
+        *p++ = '-';
+    }
+    if (count <= fraction) {
+        *p++ = '0';
+        if (fraction > 0) {
+            *p++ = '.';
+            memset(p, '0', fraction - count);
+            p += fraction - count;
+            memcpy(p, digits, count);
+            p += count;
+        }
+    } else {
+        memcpy(p, digits, count - fraction);
+        p += count - fraction;
+        if (fraction > 0) {
+            *p++ = '.';
+            memcpy(p, digits + count - fraction, fraction);
+            p += fraction;
+        }
+    }
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief The precision + 1 significant digits printf("%.*e") prints
+ *
+ * The decimal exponent is first estimated from the binary one, then
+ * corrected by one if the truncated digits show it was off.
+ *
+ * @return 1 on success, 0 if the value needs the slow path
+ */
+static int scientific_digits(const binary_t *number, int precision,
+                             uint64_t *digits, int *exponent10) {
+    if (precision > FAST_PRECISION_MAX) {
+        return 0;
+    }
+    uint64_t mantissa = number->mantissa;
+    int exponent = number->exponent;
+    int log2_value = exponent + 63 - __builtin_clzll(mantissa);
+    int guess = (log2_value * 78913) >> 18;         // floor(log10(2^n))
+    uint64_t low = POWERS_OF_TEN[precision];
+    uint64_t high = POWERS_OF_TEN[precision + 1];
+
+    for (int attempt = 0; attempt < 3; attempt++) {
+        int scale = precision - guess;
+        fmt_u128 quotient;
+        int round_up;
+        if (scale >= 0) {
+            if (scale > 22) {
+                return 0;
+            }
+            fmt_u128 product = (fmt_u128)mantissa * power_of_ten(scale);
+            if (exponent >= 0) {
+                if (bit_length(product) + exponent > 127) {
+                    return 0;
+                }
+                quotient = product << exponent;
+                round_up = 0;
+            } else if (-exponent >= 128) {
+                return 0;
+            } else {
+                int shift = -exponent;
+                quotient = product >> shift;
+                fmt_u128 remainder = product & (((fmt_u128)1 << shift) - 1);
+                fmt_u128 half = (fmt_u128)1 << (shift - 1);
+                round_up = remainder > half ||
+                           (remainder == half && (quotient & 1));
+            }
+        } else {
+            // Divide by 10^-scale, and by 2^-exponent if it is negative
+            if (-scale > 38 || exponent + 53 > 127) {
+                return 0;
+            }
+            fmt_u128 divisor = power_of_ten(-scale);
+            fmt_u128 shifted = mantissa;
+            if (exponent >= 0) {
+                shifted <<= exponent;
+            } else if (bit_length(divisor) - exponent > 127) {
+                return 0;
+            } else {
+                divisor <<= -exponent;
+            }
+            fmt_u128 remainder;
+            if ((shifted >> 64) == 0 && (divisor >> 64) == 0) {
+                quotient = (uint64_t)shifted / (uint64_t)divisor;
+                remainder = (uint64_t)shifted % (uint64_t)divisor;
+            } else {
+                quotient = shifted / divisor;
+                remainder = shifted % divisor;
+            }
+            round_up = remainder > divisor - remainder ||
+                       (remainder == divisor - remainder && (quotient & 1));
+        }
+
+        if (quotient >= high) {
+            guess++;
+            continue;
+        }
+        if (quotient < low) {
+            guess--;
+            continue;
+        }
+        *digits = (uint64_t)quotient + (uint64_t)round_up;
+        *exponent10 = guess;
+        if (*digits == high) {                      // 9.99 became 10.0
+            *digits = low;
+            (*exponent10)++;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// Writes "d.ddd" from count digits, then "e+XX"
+static size_t write_scientific(char *out, int negative, uint64_t digits,
+                               int count, int exponent10, int upper) {
+    char *p = out;
+    if (negative) {
+        *p++ = '-';
+    }
+    char text[24];
+    memset(text, '0', (size_t)count);              // Zero has one digit
+    write_digits(text + count, digits);
+    *p++ = text[0];
+    if (count > 1) {
+        *p++ = '.';
+        memcpy(p, text + 1, (size_t)count - 1);
+        p += count - 1;
+    }
+    *p++ = upper ? 'E' : 'e';
+    if (exponent10 < 0) {
+        *p++ = '-';
+        exponent10 = -exponent10;
+    } else {
+        *p++ = '+';
+    }
+    if (exponent10 >= 100) {
+        *p++ = (char)('0' + exponent10 / 100);
+        exponent10 %= 100;
+    }
+    memcpy(p, DIGIT_PAIRS + 2 * exponent10, 2);
+    return (size_t)(p + 2 - out);
+}
+
+size_t fmt_exp(char *out, double value, int precision, int upper) {
+    binary_t number = split_double(value);
+    uint64_t digits = 0;
+    int exponent10 = 0;
+
+    if (precision < 0) {
+        precision = 6;
+    }
+    if (number.special) {
+        return write_special(out, &number, upper);
+    }
+    if (precision > FAST_PRECISION_MAX ||
+        (number.mantissa != 0 &&
+         !scientific_digits(&number, precision, &digits, &exponent10))) {
+        return (size_t)snprintf(out, FMT_NUMBER_MAX, upper ? "%.*E" : "%.*e",
+                                precision, value);
+    }
+    return write_scientific(out, number.negative, digits, precision + 1,
+                            exponent10, upper);
+}
+
+// Drops trailing zeros after the point (and the point if nothing is left)
+static size_t trim_fraction(char *text, size_t length) {
+    if (memchr(text, '.', length) == NULL) {
+        return length;
+    }
+    while (text[length - 1] == '0') {
+        length--;
+    }
+    if (text[length - 1] == '.') {
+        length--;
+    }
+    return length;
+}
+
+/**
+ * @brief %g: %e if the exponent is below -4 or at least the precision,
+ *        %f otherwise; without '#', trailing zeros are removed
+ */
+static size_t format_general(char *out, double value, int precision,
+                             int upper, int alternate) {
+    binary_t number = split_double(value);
+    uint64_t digits = 0;
+    int exponent10 = 0;
+
+    if (precision < 0) {
+        precision = 6;
+    } else if (precision == 0) {
+        precision = 1;
+    }
+    if (number.special) {
+        return write_special(out, &number, upper);
+    }
+    if ((number.mantissa != 0 &&
+         !scientific_digits(&number, precision - 1, &digits, &exponent10)) ||
+        precision > FAST_PRECISION_MAX + 1) {
+        const char *format = alternate ? (upper ? "%#.*G" : "%#.*g")
+                                       : (upper ? "%.*G" : "%.*g");
+        return (size_t)snprintf(out, FMT_NUMBER_MAX, format, precision, value);
+    }
+
+    size_t length;
+    if (exponent10 >= -4 && exponent10 < precision) {
+        length = fmt_fixed(out, value, precision - 1 - exponent10);
+        if (!alternate) {
+            length = trim_fraction(out, length);
+        } else if (memchr(out, '.', length) == NULL) {
+            out[length++] = '.';
+        }
+        return length;
+    }
+
+    // Scientific: trim the digits before writing the exponent
+    int count = precision;
+    if (alternate && exponent10 == precision &&
+        (value < 0 ? -value : value) < (double)POWERS_OF_TEN[precision]) {
+        // glibc keeps no zeros when rounding up to 10^precision switched
+        // to scientific notation: "%#g" of 999999.5 is "1.e+06"
+        count = 1;
+        digits /= POWERS_OF_TEN[precision - 1];
+    } else if (!alternate) {
+        while (count > 1 && digits % 10 == 0) {
+            digits /= 10;
+            count--;
+        }
+    }
+    length = write_scientific(out, number.negative, digits, count,
+                              exponent10, upper);
+    if (alternate && count == 1) {
+        // "%#g" always shows the point: "1.e+20"
+        char *e = memchr(out, upper ? 'E' : 'e', length);
+        memmove(e + 1, e, length - (size_t)(e - out));
+        *e = '.';
+        length++;
+    }
+    return length;
+}
+
+size_t fmt_general(char *out, double value, int precision, int upper) {
+    return format_general(out, value, precision, upper, 0);
+}
+
+// Ryu: floor(log10(2^e)), floor(log10(5^e)) and ceil(log2(5^e))
+static int32_t log10_pow2(int32_t e) {
+    return (e * 78913) >> 18;
+}
+
+static int32_t log10_pow5(int32_t e) {
+    return (e * 732923) >> 20;
+}
+
+static int32_t pow5_bits(int32_t e) {
+    return ((e * 1217359) >> 19) + 1;
+}
+
+static int multiple_of_pow5(uint64_t value, int32_t p) {
+    int32_t count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count >= p;
+}
+
+static int multiple_of_pow2(uint64_t value, int32_t p) {
+    return (value & ((1ull << p) - 1)) == 0;
+}
+
+// (m * multiplier) >> shift, for a 125-bit multiplier and shift > 64
+static uint64_t mul_shift(uint64_t m, const uint64_t *multiplier,
+                          int32_t shift) {
+    fmt_u128 low = (fmt_u128)m * multiplier[0];
+    fmt_u128 high = (fmt_u128)m * multiplier[1];
+    return (uint64_t)(((low >> 64) + high) >> (shift - 64));
+}
+
+/**
+ * @brief Ryu (Ulf Adams, PLDI 2018): the shortest decimal in the
+ *        interval of values that round to this double
+ *
+ * The interval's ends and the value itself are scaled by a power of
+ * ten that leaves a few more digits than needed, then digits are
+ * dropped from all three at once for as long as the ends stay apart.
+ * The last dropped digit decides the rounding.
+ */
+static void shortest_digits(const binary_t *number, uint64_t *digits,
+                            int32_t *exponent10) {
+    int32_t e2;
+    uint64_t m2;
+    if (number->biased_exponent == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = number->fraction;
+    } else {
+        e2 = (int32_t)number->biased_exponent - 1023 - 52 - 2;
+        m2 = (1ull << 52) | number->fraction;
+    }
+    int accept_bounds = (m2 & 1) == 0;
+    uint64_t mv = 4 * m2;
+    // The gap below is half as wide at a power of two
+    uint32_t mm_shift = number->fraction != 0 || number->biased_exponent <= 1;
+
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    int vm_trailing_zeros = 0;
+    int vr_trailing_zeros = 0;
+    if (e2 >= 0) {
+        int32_t q = log10_pow2(e2) - (e2 > 3);
+        e10 = q;
+        int32_t k = FMT_POW5_INV_BITCOUNT + pow5_bits(q) - 1;
+        int32_t i = -e2 + q + k;
+        vr = mul_shift(4 * m2, fmt_pow5_inv[q], i);
+        vp = mul_shift(4 * m2 + 2, fmt_pow5_inv[q], i);
+        vm = mul_shift(4 * m2 - 1 - mm_shift, fmt_pow5_inv[q], i);
+        if (q <= 21) {
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = multiple_of_pow5(mv, q);
+            } else if (accept_bounds) {
+                vm_trailing_zeros = multiple_of_pow5(mv - 1 - mm_shift, q);
+            } else {
+                vp -= (uint64_t)multiple_of_pow5(mv + 2, q);
+            }
+        }
+    } else {
+        int32_t q = log10_pow5(-e2) - (-e2 > 1);
+        e10 = q + e2;
+        int32_t i = -e2 - q;
+        int32_t k = pow5_bits(i) - FMT_POW5_BITCOUNT;
+        int32_t j = q - k;
+        vr = mul_shift(4 * m2, fmt_pow5[i], j);
+        vp = mul_shift(4 * m2 + 2, fmt_pow5[i], j);
+        vm = mul_shift(4 * m2 - 1 - mm_shift, fmt_pow5[i], j);
+        if (q <= 1) {
+            vr_trailing_zeros = 1;
+            if (accept_bounds) {
+                vm_trailing_zeros = mm_shift == 1;
+            } else {
+                vp--;
+            }
+        } else if (q < 63) {
+            vr_trailing_zeros = multiple_of_pow2(mv, q);
+        }
+    }
+
+    int32_t removed = 0;
+    unsigned last_removed = 0;
+    uint64_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        // Rare: the exact value or the lower end ends in zeros
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = (unsigned)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = (unsigned)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+            last_removed = 4;                       // Exactly halfway: even
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) ||
+                       last_removed >= 5);
+    } else {
+        int round_up = 0;
+        if (vp / 100 > vm / 100) {                  // Two digits at a time
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    *digits = output;
+    *exponent10 = e10 + removed;
+}
+
+size_t fmt_shortest(char *out, double value) {
+    binary_t number = split_double(value);
+    char *p = out;
+
+    if (number.special) {
+        return write_special(out, &number, 0);
+    }
+    if (number.negative) {
+        *p++ = '-';
+    }
+    if (number.mantissa == 0) {
+        *p++ = '0';
+        return (size_t)(p - out);
+    }
+
+    uint64_t digits;
+    int32_t exponent10;
+    shortest_digits(&number, &digits, &exponent10);
+    int count = count_digits(digits);
+    int point = exponent10 + count;     // Digits before the decimal point
+    if (point - 1 < -4 || point - 1 >= 15) {
+        return (size_t)(p - out) +
+               write_scientific(p, 0, digits, count, point - 1, 0);
+    }
+
+    char text[24];
+    write_digits(text + count, digits);
+    if (point <= 0) {                               // 0.000ddd
+        memcpy(p, "0.", 2);
+        p += 2;
+        memset(p, '0', (size_t)-point);
+        p += -point;
+        memcpy(p, text, (size_t)count);
+        p += count;
+    } else if (point >= count) {                    // ddd000
+        memcpy(p, text, (size_t)count);
+        p += count;
+        memset(p, '0', (size_t)(point - count));
+        p += point - count;
+    } else {                                        // ddd.ddd
+        memcpy(p, text, (size_t)point);
+        p += point;
+        *p++ = '.';
+        memcpy(p, text + point, (size_t)(count - point));
+        p += count - point;
+    }
+    return (size_t)(p - out);
+}
+
+/**
+ * @brief Where fmt_vformat() writes: everything is counted, but only
+ *        what fits is stored
+ */
+typedef struct {
+    char *out;
+    size_t room;                 // Excluding the terminating NUL
+    size_t length;
+} sink_t;
+
+static void sink_put(sink_t *sink, const char *text, size_t length) {
+    if (sink->length < sink->room) {
+        size_t space = sink->room - sink->length;
+        memcpy(sink->out + sink->length, text, length < space ? length : space);
+    }
+    sink->length += length;
+}
+
+static void sink_fill(sink_t *sink, char c, size_t count) {
+    if (sink->length < sink->room) {
+        size_t space = sink->room - sink->length;
+        memset(sink->out + sink->length, c, count < space ? count : space);
+    }
+    sink->length += count;
+}
+
+#define FLAG_LEFT 0x01
+#define FLAG_PLUS 0x02
+#define FLAG_SPACE 0x04
+#define FLAG_ALTERNATE 0x08
+#define FLAG_ZERO 0x10
+#define FLAG_GROUPING 0x20       // "'": thousands separators (snprintf only)
+#define FLAG_LOCALE_DIGITS 0x40  // "I": glibc's locale digits (snprintf only)
+
+/**
+ * @brief One parsed conversion specification
+ */
+typedef struct {
+    unsigned flags;
+    int width;
+    int precision;               // -1 if not given
+    char length[3];              // "", "h", "hh", "l", "ll", "L", "z", ...
+    char conversion;
+} spec_t;
+
+/**
+ * @brief Writes prefix (sign, "0x"), zeros and body, padded to width
+ *
+ * Zeros from the '0' flag go between the prefix and the body, the way
+ * printf puts them: "-0042", "0x002a".
+ */
+static void put_field(sink_t *sink, const spec_t *spec, const char *prefix,
+                      size_t prefix_length, size_t zeros, const char *body,
+                      size_t body_length, int zero_pad) {
+    size_t total = prefix_length + zeros + body_length;
+    size_t padding = spec->width > 0 && (size_t)spec->width > total
+                         ? (size_t)spec->width - total : 0;
+    if (padding > 0 && !(spec->flags & FLAG_LEFT)) {
+        if (zero_pad && (spec->flags & FLAG_ZERO)) {
+            zeros += padding;
+        } else {
+            sink_fill(sink, ' ', padding);
+        }
+    }
+    sink_put(sink, prefix, prefix_length);
+    sink_fill(sink, '0', zeros);
+    sink_put(sink, body, body_length);
+    if (padding > 0 && (spec->flags & FLAG_LEFT)) {
+        sink_fill(sink, ' ', padding);
+    }
+}
+
+static void put_integer(sink_t *sink, const spec_t *spec, uint64_t magnitude,
+                        int negative) {
+    char prefix[3];
+    size_t prefix_length = 0;
+    char body[24];
+    size_t body_length;
+    char conversion = spec->conversion;
+
+    if (conversion == 'd' || conversion == 'i') {
+        if (negative) {
+            prefix[prefix_length++] = '-';
+        } else if (spec->flags & FLAG_PLUS) {
+            prefix[prefix_length++] = '+';
+        } else if (spec->flags & FLAG_SPACE) {
+            prefix[prefix_length++] = ' ';
+        }
+    }
+    if (conversion == 'x' || conversion == 'X') {
+        body_length = fmt_hex(body, magnitude, conversion == 'X');
+        if ((spec->flags & FLAG_ALTERNATE) && magnitude != 0) {
+            prefix[prefix_length++] = '0';
+            prefix[prefix_length++] = conversion;
+        }
+    } else if (conversion == 'o') {
+        body_length = fmt_octal(body, magnitude);
+    } else {
+        body_length = fmt_u64(body, magnitude);
+    }
+    if (spec->precision == 0 && magnitude == 0) {
+        body_length = 0;                            // "%.0d" of 0 is empty
+    }
+
+    size_t zeros = 0;
+    if (spec->precision > 0 && (size_t)spec->precision > body_length) {
+        zeros = (size_t)spec->precision - body_length;
+    }
+    if (conversion == 'o' && (spec->flags & FLAG_ALTERNATE) && zeros == 0 &&
+        (body_length == 0 || body[0] != '0')) {
+        zeros = 1;                                  // "%#o" starts with 0
+    }
+    put_field(sink, spec, prefix, prefix_length, zeros, body, body_length,
+              spec->precision < 0);
+}
+
+static void put_double(sink_t *sink, const spec_t *spec, double value) {
+    char text[FMT_NUMBER_MAX + 2];
+    char conversion = spec->conversion;
+    int upper = conversion == 'F' || conversion == 'E' || conversion == 'G';
+    int alternate = (spec->flags & FLAG_ALTERNATE) != 0;
+    size_t length;
+
+    switch (conversion) {
+    case 'f':
+    case 'F':
+        length = fmt_fixed(text, value, spec->precision);
+        if (upper) {
+            for (size_t i = 0; i < length; i++) {
+                if (text[i] >= 'a' && text[i] <= 'z') {
+                    text[i] = (char)(text[i] - 'a' + 'A');
+                }
+            }
+        }
+        break;
+    case 'e':
+    case 'E':
+        length = fmt_exp(text, value, spec->precision, upper);
+        break;
+    default:
+        length = format_general(text, value, spec->precision, upper,
+                                alternate);
+        break;
+    }
+
+    // "%#.0f" and "%#.0e" still show the point
+    char first = text[0] == '-' ? text[1] : text[0];
+    int finite = first >= '0' && first <= '9';
+    if (alternate && finite && conversion != 'g' && conversion != 'G' &&
+        memchr(text, '.', length) == NULL) {
+        char *e = memchr(text, upper ? 'E' : 'e', length);
+        if (e == NULL || conversion == 'f' || conversion == 'F') {
+            text[length] = '.';
+        } else {
+            memmove(e + 1, e, length - (size_t)(e - text));
+            *e = '.';
+        }
+        length++;
+    }
+
+    const char *body = text;
+    char prefix = 0;
+    if (text[0] == '-') {
+        prefix = '-';
+        body++;
+        length--;
+    } else if (spec->flags & FLAG_PLUS) {
+        prefix = '+';
+    } else if (spec->flags & FLAG_SPACE) {
+        prefix = ' ';
+    }
+    put_field(sink, spec, &prefix, prefix != 0, 0, body, length, finite);
+}
+
+// Reads a signed argument of the size the length modifier names
+static int64_t signed_argument(const spec_t *spec, va_list *args) {
+    const char *length = spec->length;
+    if (length[0] == 'h') {
+        int value = va_arg(*args, int);
+        return length[1] == 'h' ? (signed char)value : (short)value;
+    }
+    if (length[0] == 'l') {
+        return length[1] == 'l' ? va_arg(*args, long long)
+                                : va_arg(*args, long);
+    }
+    if (length[0] == 'z' || length[0] == 't') {
+        return va_arg(*args, ssize_t);
+    }
+    if (length[0] == 'j') {
+        return va_arg(*args, intmax_t);
+    }
+    return va_arg(*args, int);
+}
+
+static uint64_t unsigned_argument(const spec_t *spec, va_list *args) {
+    const char *length = spec->length;
+    if (length[0] == 'h') {
+        unsigned value = va_arg(*args, unsigned);
+        return length[1] == 'h' ? (unsigned char)value
+                                : (unsigned short)value;
+    }
+    if (length[0] == 'l') {
+        return length[1] == 'l' ? va_arg(*args, unsigned long long)
+                                : va_arg(*args, unsigned long);
+    }
+    if (length[0] == 'z' || length[0] == 't') {
+        return va_arg(*args, size_t);
+    }
+    if (length[0] == 'j') {
+        return va_arg(*args, uintmax_t);
+    }
+    return va_arg(*args, unsigned);
+}
+
+/**
+ * @brief Formats one conversion this file does not handle itself
+ *
+ * The specification is rebuilt with the width and precision filled in
+ * and given to snprintf() together with the argument. The argument is
+ * taken from the list the way snprintf() takes it, so the conversions
+ * after this one still line up with theirs: integers (with the "'"
+ * grouping flag, say) are read at their length modifier's size, and a
+ * conversion snprintf() does not know takes no argument.
+ */
+static void put_with_snprintf(sink_t *sink, const spec_t *spec,
+                              va_list *args) {
+    char format[32];
+    char *f = format;
+    *f++ = '%';
+    if (spec->flags & FLAG_LEFT) {
+        *f++ = '-';
+    }
+    if (spec->flags & FLAG_PLUS) {
+        *f++ = '+';
+    }
+    if (spec->flags & FLAG_SPACE) {
+        *f++ = ' ';
+    }
+    if (spec->flags & FLAG_ALTERNATE) {
+        *f++ = '#';
+    }
+    if (spec->flags & FLAG_ZERO) {
+        *f++ = '0';
+    }
+    if (spec->flags & FLAG_GROUPING) {
+        *f++ = '\'';
+    }
+    if (spec->flags & FLAG_LOCALE_DIGITS) {
+        *f++ = 'I';
+    }
+    if (spec->width > 0) {
+        f += fmt_u64(f, (uint64_t)spec->width);
+    }
+    if (spec->precision >= 0) {
+        *f++ = '.';
+        f += fmt_u64(f, (uint64_t)spec->precision);
+    }
+
+    // Take the argument; integers are passed on as intmax_t, having
+    // already been cut down to their length modifier's size
+    enum { NONE, SIGNED, UNSIGNED, DOUBLE, LONG_DOUBLE, POINTER, WIDE_CHAR }
+        kind = NONE;
+    intmax_t signed_value = 0;
+    uintmax_t unsigned_value = 0;
+    double double_value = 0;
+    long double long_double_value = 0;
+    const void *pointer = NULL;
+    wint_t wide_char = 0;
+    switch (spec->conversion) {
+    case 'd':
+    case 'i':
+        kind = SIGNED;
+        signed_value = signed_argument(spec, args);
+        break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        kind = UNSIGNED;
+        unsigned_value = unsigned_argument(spec, args);
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        if (spec->length[0] == 'L') {
+            kind = LONG_DOUBLE;
+            long_double_value = va_arg(*args, long double);
+        } else {
+            kind = DOUBLE;
+            double_value = va_arg(*args, double);
+        }
+        break;
+    case 'c':
+    case 'C':                                       // Same as %lc
+        kind = WIDE_CHAR;
+        wide_char = va_arg(*args, wint_t);
+        break;
+    case 's':
+    case 'S':                                       // Same as %ls
+    case 'p':
+        kind = POINTER;
+        pointer = va_arg(*args, const void *);
+        break;
+    default:                                        // %m, or unknown
+        break;
+    }
+    const char *length_modifier = kind == SIGNED || kind == UNSIGNED
+                                      ? "j"
+                                      : spec->length;
+    size_t length_size = strlen(length_modifier);
+    memcpy(f, length_modifier, length_size);
+    f += length_size;
+    *f++ = spec->conversion;
+    *f = '\0';
+
+    char small[512];
+    char *text = small;
+    int length = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        size_t room = text == small ? sizeof(small) : (size_t)length + 1;
+        switch (kind) {
+        case SIGNED:
+            length = snprintf(text, room, format, signed_value);
+            break;
+        case UNSIGNED:
+            length = snprintf(text, room, format, unsigned_value);
+            break;
+        case DOUBLE:
+            length = snprintf(text, room, format, double_value);
+            break;
+        case LONG_DOUBLE:
+            length = snprintf(text, room, format, long_double_value);
+            break;
+        case POINTER:
+            length = snprintf(text, room, format, pointer);
+            break;
+        case WIDE_CHAR:
+            length = snprintf(text, room, format, wide_char);
+            break;
+        default:
+            length = snprintf(text, room, format, 0);
+            break;
+        }
+        if (length < 0 || (size_t)length < room) {
+            break;
+        }
+        text = malloc((size_t)length + 1);
+        if (text == NULL) {
+            length = -1;
+            break;
+        }
+    }
+    if (length > 0) {
+        sink_put(sink, text, (size_t)length);
+    }
+    if (text != small) {
+        free(text);
+    }
+}
+
+// Stores the count so far for "%n"
+static void store_count(const spec_t *spec, size_t count, va_list *args) {
+    const char *length = spec->length;
+    if (length[0] == 'h') {
+        if (length[1] == 'h') {
+            *va_arg(*args, signed char *) = (signed char)count;
+        } else {
+            *va_arg(*args, short *) = (short)count;
+        }
+    } else if (length[0] == 'l') {
+        if (length[1] == 'l') {
+            *va_arg(*args, long long *) = (long long)count;
+        } else {
+            *va_arg(*args, long *) = (long)count;
+        }
+    } else if (length[0] == 'z' || length[0] == 't') {
+        *va_arg(*args, ssize_t *) = (ssize_t)count;
+    } else if (length[0] == 'j') {
+        *va_arg(*args, intmax_t *) = (intmax_t)count;
+    } else {
+        *va_arg(*args, int *) = (int)count;
+    }
+}
+
+// Parses flags, width, precision and length; returns the conversion end
+static const char *parse_spec(const char *p, spec_t *spec, va_list *args) {
+    spec->flags = 0;
+    spec->width = 0;
+    spec->precision = -1;
+    for (;; p++) {
+        if (*p == '-') {
+            spec->flags |= FLAG_LEFT;
+        } else if (*p == '+') {
+            spec->flags |= FLAG_PLUS;
+        } else if (*p == ' ') {
+            spec->flags |= FLAG_SPACE;
+        } else if (*p == '#') {
+            spec->flags |= FLAG_ALTERNATE;
+        } else if (*p == '0') {
+            spec->flags |= FLAG_ZERO;
+        } else if (*p == '\'') {
+            spec->flags |= FLAG_GROUPING;
+        } else if (*p == 'I') {
+            spec->flags |= FLAG_LOCALE_DIGITS;
+        } else {
+            break;
+        }
+    }
+    if (*p == '*') {
+        spec->width = va_arg(*args, int);
+        if (spec->width < 0) {
+            spec->flags |= FLAG_LEFT;
+            spec->width = -spec->width;
+        }
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            spec->width = spec->width * 10 + (*p++ - '0');
+        }
+    }
+    if (*p == '.') {
+        p++;
+        spec->precision = 0;
+        if (*p == '*') {
+            spec->precision = va_arg(*args, int);
+            if (spec->precision < 0) {
+                spec->precision = -1;               // As if not given
+            }
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                spec->precision = spec->precision * 10 + (*p++ - '0');
+            }
+        }
+    }
+    size_t length = 0;
+    if (*p == 'h' || *p == 'l') {                  // h, hh, l, ll
+        spec->length[length++] = *p++;
+        if (*p == spec->length[0]) {
+            spec->length[length++] = *p++;
+        }
+    } else if (*p == 'q') {                         // BSD's name for ll
+        spec->length[length++] = 'l';
+        spec->length[length++] = 'l';
+        p++;
+    } else if (*p == 'L' || *p == 'j' || *p == 'z' || *p == 't') {
+        spec->length[length++] = *p++;
+    }
+    spec->length[length] = '\0';
+    spec->conversion = *p;
+    return p;
+}
+
+int fmt_vformat(char *out, size_t room, const char *format, va_list args) {
+    sink_t sink = {out, room > 0 ? room - 1 : 0, 0};
+    int cut_off = 0;
+    va_list list;
+    va_copy(list, args);
+
+    const char *p = format;
+    while (*p != '\0') {
+        const char *percent = strchr(p, '%');
+        if (percent == NULL) {
+            sink_put(&sink, p, strlen(p));
+            break;
+        }
+        sink_put(&sink, p, (size_t)(percent - p));
+
+        spec_t spec;
+        const char *end = parse_spec(percent + 1, &spec, &list);
+        if ((spec.flags & (FLAG_GROUPING | FLAG_LOCALE_DIGITS)) &&
+            spec.conversion != '\0' && spec.conversion != 'n' &&
+            spec.conversion != '%') {
+            put_with_snprintf(&sink, &spec, &list);  // Flags only it knows
+            p = end + 1;
+            continue;
+        }
+        switch (spec.conversion) {
+        case 'd':
+        case 'i': {
+            int64_t value = signed_argument(&spec, &list);
+            put_integer(&sink, &spec,
+                        value < 0 ? 0 - (uint64_t)value : (uint64_t)value,
+                        value < 0);
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            put_integer(&sink, &spec, unsigned_argument(&spec, &list), 0);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            if (spec.length[0] == 'L' || spec.precision > FMT_MAX_PRECISION) {
+                put_with_snprintf(&sink, &spec, &list);
+            } else {
+                put_double(&sink, &spec, va_arg(list, double));
+            }
+            break;
+        case 'c':
+            if (spec.length[0] == 'l') {
+                put_with_snprintf(&sink, &spec, &list);
+            } else {
+                char c = (char)va_arg(list, int);
+                put_field(&sink, &spec, "", 0, 0, &c, 1, 0);
+            }
+            break;
+        case 's': {
+            if (spec.length[0] == 'l') {
+                put_with_snprintf(&sink, &spec, &list);
+                break;
+            }
+            va_list peek;
+            va_copy(peek, list);
+            const char *text = va_arg(peek, const char *);
+            va_end(peek);
+            if (text == NULL) {
+                put_with_snprintf(&sink, &spec, &list);  // glibc's "(null)"
+                break;
+            }
+            (void)va_arg(list, const char *);
+            size_t length = spec.precision >= 0
+                                ? strnlen(text, (size_t)spec.precision)
+                                : strlen(text);
+            put_field(&sink, &spec, "", 0, 0, text, length, 0);
+            break;
+        }
+        case 'p':
+        case 'a':
+        case 'A':
+            put_with_snprintf(&sink, &spec, &list);
+            break;
+        case 'n':
+            store_count(&spec, sink.length, &list);
+            break;
+        case '%':
+            sink_put(&sink, "%", 1);
+            break;
+        default:
+            if (spec.conversion == '\0') {
+                end--;                  // Cut off at the end: an error
+                cut_off = 1;
+            } else {
+                // %C, %S, %m, or one snprintf() does not know either:
+                // it takes (or skips) the argument the same way
+                put_with_snprintf(&sink, &spec, &list);
+            }
+            break;
+        }
+        p = end + 1;
+    }
+    va_end(list);
+
+    if (room > 0) {
+        out[sink.length < sink.room ? sink.length : sink.room] = '\0';
+    }
+    return cut_off ? -1 : (int)sink.length;
+}
+
+int fmt_format(char *out, size_t room, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = fmt_vformat(out, room, format, args);
+    va_end(args);
+    return length;
+}
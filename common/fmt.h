@@ -0,0 +1,104 @@
+/**
+ * @file fmt.h
+ * @brief Number formatting: printf's output, without printf's cost
+ *
+ * A report that prints a million averages with printf("%.2f") spends
+ * most of its time inside printf: interpreting the format string,
+ * taking the stream lock, and converting each double to decimal with
+ * arbitrary-precision arithmetic that works for every possible value,
+ * even though nearly all of them are small.
+ *
+ * The functions below produce exactly the same bytes as the printf
+ * conversion named next to them, but take shortcuts for common values:
+ *
+ *   - integers are written two digits per step from a table of "00"
+ *     to "99", after counting the digits so that no copy is needed
+ *   - fixed and scientific notation (%.2f, %.3e, %g) round the exact
+ *     binary value with 128-bit integer arithmetic when it fits, which
+ *     covers every number between about 1e-15 and 1e21; anything else
+ *     is handed to snprintf()
+ *   - fmt_shortest() writes the fewest digits that read back as the
+ *     same double (the Ryu algorithm), e.g. "0.1" where "%.17g" gives
+ *     "0.10000000000000001"
+ *
+ *     char text[FMT_NUMBER_MAX];
+ *     size_t length = fmt_fixed(text, 87.125, 2);   // "87.12", like %.2f
+ *
+ * fmt_format() is a drop-in snprintf() replacement for the common
+ * conversions (flags "-+ #0", width, precision, d i u x X o c s f F e
+ * E g G %) that uses the same converters; anything else (%p, %a, long
+ * double, wide characters, the "'" and "I" flags, unknown conversions)
+ * is passed on to snprintf() one conversion at a time, taking its
+ * argument as snprintf() would. outbuf_printf() formats with it.
+ *
+ * Written text is never NUL-terminated except by fmt_format().
+ */
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest precision the number functions accept
+#define FMT_MAX_PRECISION 100
+
+// Room one number needs: sign, 309 integer digits, point, precision
+#define FMT_NUMBER_MAX 416
+
+/**
+ * @brief Writes value in decimal, like printf("%llu") / ("%lld")
+ * @return Number of characters written (at most 20)
+ */
+size_t fmt_u64(char *out, uint64_t value);
+size_t fmt_i64(char *out, int64_t value);
+
+/**
+ * @brief Writes value in hexadecimal (%llx, or %llX if upper)
+ */
+size_t fmt_hex(char *out, uint64_t value, int upper);
+
+/**
+ * @brief Writes value in octal (%llo)
+ */
+size_t fmt_octal(char *out, uint64_t value);
+
+/**
+ * @brief Writes value like printf("%.*f", precision, value)
+ */
+size_t fmt_fixed(char *out, double value, int precision);
+
+/**
+ * @brief Writes value like printf("%.*e") (or "%.*E" if upper)
+ */
+size_t fmt_exp(char *out, double value, int precision, int upper);
+
+/**
+ * @brief Writes value like printf("%.*g") (or "%.*G" if upper)
+ */
+size_t fmt_general(char *out, double value, int precision, int upper);
+
+/**
+ * @brief Writes the shortest text that reads back as exactly value
+ *
+ * The digits are printed the way "%g" prints them: plain for decimal
+ * exponents from -4 to 14 ("0.1", "1234.5", "100"), scientific
+ * otherwise ("1e+300", "2.5e-07"). Of the shortest digit strings that
+ * read back exactly, the one nearest to value is chosen, so it never
+ * has more digits than the shortest "%.*g" that reads back.
+ */
+size_t fmt_shortest(char *out, double value);
+
+/**
+ * @brief snprintf() with the fast converters above
+ *
+ * @return Length of the complete text, even if room was too small
+ *         (the text is then cut off but still NUL-terminated), or -1
+ *         if the format ends in the middle of a conversion
+ */
+int fmt_format(char *out, size_t room, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+int fmt_vformat(char *out, size_t room, const char *format, va_list args);
+
+#endif // FMT_H
@@ -0,0 +1,217 @@
+/**
+ * @file money.c
+ * @brief Rounded multiply and divide, parsing and formatting of money_t
+ */
+
+#include "money.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "fmt.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+// -O2 only vectorizes loops where it costs nothing extra; ask for more
+#define VECTORIZE __attribute__((optimize("tree-vectorize", \
+                                          "vect-cost-model=dynamic")))
+#else
+#define VECTORIZE
+#endif
+
+// Rows per money_sum() chunk: 2^31 halves of at most 2^32 fit in 63 bits
+#define SUM_CHUNK ((size_t)1 << 31)
+
+/**
+ * @brief numerator / divisor rounded to the nearest integer, ties to even
+ *
+ * divisor must be positive. Returns 1 if the quotient does not fit in
+ * 64 bits.
+ */
+static int divide_rounded(money_int128_t numerator, money_int128_t divisor,
+                          int64_t *result) {
+    money_int128_t quotient = numerator / divisor;
+    money_int128_t remainder = numerator % divisor;   // Same sign as numerator
+    money_int128_t twice = remainder < 0 ? -2 * remainder : 2 * remainder;
+
+    if (twice > divisor || (twice == divisor && (quotient & 1) != 0)) {
+        quotient += numerator < 0 ? -1 : 1;
+    }
+    *result = (int64_t)quotient;
+    return quotient < INT64_MIN || quotient > INT64_MAX;
+}
+
+int money_mul(money_t a, money_t b, money_t *result) {
+    // |a * b| < 2^126, so the product itself always fits
+    money_int128_t product = (money_int128_t)a.units * b.units;
+    return divide_rounded(product, MONEY_ONE, &result->units);
+}
+
+int money_div(money_t a, money_t b, money_t *result) {
+    if (b.units == 0) {
+        result->units = 0;
+        return 1;
+    }
+    money_int128_t numerator = (money_int128_t)a.units * MONEY_ONE;
+    money_int128_t divisor = b.units;
+    if (divisor < 0) {
+        numerator = -numerator;
+        divisor = -divisor;
+    }
+    return divide_rounded(numerator, divisor, &result->units);
+}
+
+int money_div_int(money_t amount, int64_t count, money_t *result) {
+    if (count == 0) {
+        result->units = 0;
+        return 1;
+    }
+    money_int128_t numerator = amount.units;
+    money_int128_t divisor = count;
+    if (divisor < 0) {
+        numerator = -numerator;
+        divisor = -divisor;
+    }
+    return divide_rounded(numerator, divisor, &result->units);
+}
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+const char *money_parse(const char *p, const char *end, money_t *value) {
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    // Whole dollars first, kept at most limit / MONEY_ONE so that turning
+    // them into units cannot overflow
+    const uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : INT64_MAX;
+    uint64_t magnitude = 0;
+    int digits = 0;
+    int overflow = 0;
+
+    while (p < end && is_digit(*p)) {
+        uint64_t digit = (uint64_t)(*p - '0');
+        if (magnitude > (limit / MONEY_ONE - digit) / 10) {
+            overflow = 1;
+        } else {
+            magnitude = magnitude * 10 + digit;
+        }
+        digits++;
+        p++;
+    }
+    magnitude *= MONEY_ONE;
+
+    uint64_t fraction = 0;
+    int decimals = 0;
+    int round_digit = 0;        // First digit past the scale
+    int sticky = 0;             // Any nonzero digit after that one
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && is_digit(*p)) {
+            int digit = *p - '0';
+            if (decimals < MONEY_SCALE) {
+                fraction = fraction * 10 + (uint64_t)digit;
+            } else if (decimals == MONEY_SCALE) {
+                round_digit = digit;
+            } else {
+                sticky |= digit != 0;
+            }
+            decimals++;
+            digits++;
+            p++;
+        }
+    }
+    if (digits == 0) {
+        return NULL;
+    }
+    for (int d = decimals; d < MONEY_SCALE; d++) {
+        fraction *= 10;
+    }
+
+    // Round half to even, on the last kept unit
+    uint64_t units = magnitude + fraction;
+    if (round_digit > 5 || (round_digit == 5 && (sticky || (units & 1)))) {
+        units++;
+    }
+    if (overflow || units > limit) {
+        errno = ERANGE;
+        return NULL;
+    }
+    value->units = negative ? (int64_t)(0 - units) : (int64_t)units;
+    return p;
+}
+
+// Writes digits with leading zeros to exactly width characters
+static void format_padded(char *out, uint64_t value, size_t width) {
+    char digits[20];
+    size_t length = fmt_u64(digits, value);
+    memset(out, '0', width - length);
+    memcpy(out + width - length, digits, length);
+}
+
+// Writes the point, MONEY_SCALE decimals and the NUL
+static size_t format_fraction(char *out, uint64_t fraction) {
+    out[0] = '.';
+    format_padded(out + 1, fraction, MONEY_SCALE);
+    out[1 + MONEY_SCALE] = '\0';
+    return 1 + MONEY_SCALE;
+}
+
+size_t money_format(char *out, money_t value) {
+    uint64_t magnitude = value.units < 0 ? 0 - (uint64_t)value.units
+                                         : (uint64_t)value.units;
+    size_t n = 0;
+    if (value.units < 0) {
+        out[n++] = '-';
+    }
+    n += fmt_u64(out + n, magnitude / MONEY_ONE);
+    return n + format_fraction(out + n, magnitude % MONEY_ONE);
+}
+
+size_t money_wide_format(char *out, money_wide_t value) {
+    __extension__ typedef unsigned __int128 uint128_t;
+    const uint64_t ten19 = 10000000000000000000ull;
+    uint128_t magnitude = value.units < 0 ? 0 - (uint128_t)value.units
+                                          : (uint128_t)value.units;
+    uint128_t whole = magnitude / MONEY_ONE;
+    size_t n = 0;
+
+    if (value.units < 0) {
+        out[n++] = '-';
+    }
+    if (whole >= ten19) {
+        // Up to 39 digits: the top ones, then the last 19 with zeros
+        n += fmt_u64(out + n, (uint64_t)(whole / ten19));
+        format_padded(out + n, (uint64_t)(whole % ten19), 19);
+        n += 19;
+    } else {
+        n += fmt_u64(out + n, (uint64_t)whole);
+    }
+    return n + format_fraction(out + n, (uint64_t)(magnitude % MONEY_ONE));
+}
+
+VECTORIZE
+money_wide_t money_sum(const money_t *values, size_t n) {
+    money_wide_t total = {0};
+
+    for (size_t start = 0; start < n; start += SUM_CHUNK) {
+        size_t count = n - start < SUM_CHUNK ? n - start : SUM_CHUNK;
+        const money_t *chunk = values + start;
+        uint64_t low = 0;       // Sum of the low 32 bits (unsigned)
+        int64_t high = 0;       // Sum of the high 32 bits (signed)
+        for (size_t i = 0; i < count; i++) {
+            low += (uint64_t)chunk[i].units & 0xffffffffu;
+            high += chunk[i].units >> 32;
+        }
+        total.units += (money_int128_t)high * ((int64_t)1 << 32) + low;
+    }
+    return total;
+}
+
+int money_narrow(money_wide_t total, money_t *result) {
+    result->units = (int64_t)total.units;
+    return total.units < INT64_MIN || total.units > INT64_MAX;
+}
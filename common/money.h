@@ -0,0 +1,184 @@
+/**
+ * @file money.h
+ * @brief Exact decimal money: fixed-point amounts in 64 and 128 bits
+ *
+ * float cannot hold $19.99: the nearest float is 19.9899997711..., and
+ * adding a million such prices drifts by whole dollars. double and long
+ * double only move the error further to the right, and long double
+ * arithmetic runs on the slow x87 unit.
+ *
+ * A money_t is a whole number of the smallest unit, 1 / 10^MONEY_SCALE
+ * of a dollar (with the default scale of 2, cents: $19.99 is 1999), so
+ * adding and subtracting is exact integer arithmetic. Multiplying and
+ * dividing keep the full 128-bit intermediate result and round it once,
+ * to the nearest unit, ties to even ("banker's rounding", which does not
+ * drift up or down over a long ledger):
+ *
+ *     money_t price, total;
+ *     money_parse(text, text + length, &price);       // "19.99"
+ *     if (money_mul_int(price, 3, &total)) {
+ *         // Does not fit in 64 bits
+ *     }
+ *     char shown[MONEY_TEXT_MAX];
+ *     money_format(shown, total);                     // "59.97"
+ *
+ * Like checked.h, the arithmetic functions return 1 when the result does
+ * not fit (or on division by zero) and 0 otherwise. A money_t holds up to
+ * about 92 quadrillion dollars at scale 2; sums of many amounts can be
+ * kept in a money_wide_t (128 bits), which money_sum() computes exactly
+ * for a whole array.
+ *
+ * The scale is chosen at compile time, e.g. -DMONEY_SCALE=4 for amounts
+ * in hundredths of a cent; every file that uses money.h must be built
+ * with the same value.
+ */
+
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Decimal places of an amount
+#ifndef MONEY_SCALE
+#define MONEY_SCALE 2
+#endif
+
+#if MONEY_SCALE < 2 || MONEY_SCALE > 18
+#error "MONEY_SCALE must be between 2 (cents) and 18"
+#endif
+
+#define MONEY_POW10_2 100ll
+#define MONEY_POW10_3 1000ll
+#define MONEY_POW10_4 10000ll
+#define MONEY_POW10_5 100000ll
+#define MONEY_POW10_6 1000000ll
+#define MONEY_POW10_7 10000000ll
+#define MONEY_POW10_8 100000000ll
+#define MONEY_POW10_9 1000000000ll
+#define MONEY_POW10_10 10000000000ll
+#define MONEY_POW10_11 100000000000ll
+#define MONEY_POW10_12 1000000000000ll
+#define MONEY_POW10_13 10000000000000ll
+#define MONEY_POW10_14 100000000000000ll
+#define MONEY_POW10_15 1000000000000000ll
+#define MONEY_POW10_16 10000000000000000ll
+#define MONEY_POW10_17 100000000000000000ll
+#define MONEY_POW10_18 1000000000000000000ll
+#define MONEY_POW10_(scale) MONEY_POW10_##scale
+#define MONEY_POW10(scale) MONEY_POW10_(scale)
+
+// Units in one dollar (100 at the default scale)
+#define MONEY_ONE MONEY_POW10(MONEY_SCALE)
+
+// Room money_format() and money_wide_format() need, with the NUL
+#define MONEY_TEXT_MAX 24
+#define MONEY_WIDE_TEXT_MAX 48
+
+// An amount, in units of 1 / MONEY_ONE
+typedef struct {
+    int64_t units;
+} money_t;
+
+// A total of many amounts
+__extension__ typedef __int128 money_int128_t;
+typedef struct {
+    money_int128_t units;
+} money_wide_t;
+
+/**
+ * @brief An amount given in cents, e.g. money_from_cents(550000) for
+ *        $5500.00, whatever the scale (the cents must fit)
+ */
+static inline money_t money_from_cents(int64_t cents) {
+    money_t value = {cents * (MONEY_ONE / 100)};
+    return value;
+}
+
+/**
+ * @brief -1, 0 or 1 as a is less than, equal to or greater than b
+ */
+static inline int money_cmp(money_t a, money_t b) {
+    return (a.units > b.units) - (a.units < b.units);
+}
+
+static inline int money_add(money_t a, money_t b, money_t *result) {
+    return __builtin_add_overflow(a.units, b.units, &result->units);
+}
+
+static inline int money_sub(money_t a, money_t b, money_t *result) {
+    return __builtin_sub_overflow(a.units, b.units, &result->units);
+}
+
+/**
+ * @brief amount * count, e.g. a price times a quantity (exact)
+ */
+static inline int money_mul_int(money_t amount, int64_t count,
+                                money_t *result) {
+    return __builtin_mul_overflow(amount.units, count, &result->units);
+}
+
+/**
+ * @brief a * b, rounded to the nearest unit, ties to even
+ *
+ * For example a balance times an interest rate written as money
+ * (1.0325): 100.00 * 1.0325 needs MONEY_SCALE >= 4 to keep the rate.
+ */
+int money_mul(money_t a, money_t b, money_t *result);
+
+/**
+ * @brief a / b, rounded to the nearest unit, ties to even
+ *
+ * Division by zero gives 0 and returns 1.
+ */
+int money_div(money_t a, money_t b, money_t *result);
+
+/**
+ * @brief amount / count, e.g. a bill split count ways, rounded like
+ *        money_div()
+ */
+int money_div_int(money_t amount, int64_t count, money_t *result);
+
+/**
+ * @brief Parses an amount at the start of [p, end), like strtod()
+ *
+ * Accepts an optional sign, digits and an optional decimal point with
+ * more digits ("5500", "19.99", "-.5"); no exponent. Digits beyond the
+ * scale are rounded to the nearest unit, ties to even - exactly, since
+ * the text is already decimal. Leading whitespace is not skipped.
+ *
+ * @return Pointer just past the amount, or NULL if there was none (or
+ *         it does not fit; errno is then ERANGE)
+ */
+const char *money_parse(const char *p, const char *end, money_t *value);
+
+/**
+ * @brief Writes an amount with exactly MONEY_SCALE decimals, e.g.
+ *        "-1234.50"; NUL-terminated, so it can go straight to "%s"
+ * @return Number of characters written, without the NUL
+ */
+size_t money_format(char *out, money_t value);
+
+/**
+ * @brief Exact total of n amounts
+ *
+ * Vectorized: it splits each amount into 32-bit halves and adds them up
+ * separately in 64-bit lanes, which cannot overflow for 2^31 rows.
+ */
+money_wide_t money_sum(const money_t *values, size_t n);
+
+static inline void money_wide_add(money_wide_t *total, money_t value) {
+    total->units += value.units;
+}
+
+/**
+ * @brief Narrows a total back to a money_t; returns 1 if it does not fit
+ */
+int money_narrow(money_wide_t total, money_t *result);
+
+/**
+ * @brief money_format() for a 128-bit total
+ */
+size_t money_wide_format(char *out, money_wide_t value);
+
+#endif // MONEY_H
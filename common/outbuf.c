@@ -0,0 +1,170 @@
+/**
+ * @file outbuf.c
+ * @brief Output builder: appending in place, flushing with one system call
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "outbuf.h"
+
+#include "fmt.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void outbuf_init(outbuf_t *out, int fd, char *storage, size_t capacity) {
+    out->fd = fd;
+    out->data = storage;
+    out->used = 0;
+    out->capacity = capacity;
+    out->run_start = 0;
+    out->piece_count = 0;
+    out->error = 0;
+    out->syscalls = 0;
+}
+
+// Turns the copied text since the last reference into a piece
+static void close_run(outbuf_t *out) {
+    if (out->used > out->run_start) {
+        struct iovec *piece = &out->pieces[out->piece_count++];
+        piece->iov_base = out->data + out->run_start;
+        piece->iov_len = out->used - out->run_start;
+        out->run_start = out->used;
+    }
+}
+
+// Writes pieces[0..count), continuing after partial writes
+static int write_pieces(outbuf_t *out, struct iovec *pieces, int count) {
+    while (count > 0) {
+        ssize_t written;
+        if (count == 1) {
+            written = write(out->fd, pieces[0].iov_base, pieces[0].iov_len);
+        } else {
+            written = writev(out->fd, pieces, count);
+        }
+        out->syscalls++;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        // Skip what the kernel took; the rest goes in the next call
+        size_t left = (size_t)written;
+        while (count > 0 && left >= pieces[0].iov_len) {
+            left -= pieces[0].iov_len;
+            pieces++;
+            count--;
+        }
+        if (count > 0) {
+            pieces[0].iov_base = (char *)pieces[0].iov_base + left;
+            pieces[0].iov_len -= left;
+        }
+    }
+    return 0;
+}
+
+int outbuf_flush(outbuf_t *out) {
+    close_run(out);
+    if (out->piece_count > 0 &&
+        write_pieces(out, out->pieces, out->piece_count) != 0) {
+        out->error = 1;
+    }
+    out->used = 0;
+    out->run_start = 0;
+    out->piece_count = 0;
+
+    int result = out->error ? -1 : 0;
+    out->error = 0;
+    return result;
+}
+
+// Flushes early when the buffer or the piece list cannot take more
+static void make_room(outbuf_t *out, size_t length) {
+    if (length > out->capacity - out->used) {
+        int error = out->error;
+        if (outbuf_flush(out) != 0 || error) {
+            out->error = 1;
+        }
+    }
+}
+
+void outbuf_put(outbuf_t *out, const char *text, size_t length) {
+    make_room(out, length);
+    if (length > out->capacity) {
+        // Larger than the whole buffer: send it as it is
+        outbuf_ref(out, text, length);
+        make_room(out, out->capacity + 1);
+        return;
+    }
+    memcpy(out->data + out->used, text, length);
+    out->used += length;
+}
+
+void outbuf_puts(outbuf_t *out, const char *text) {
+    outbuf_put(out, text, strlen(text));
+}
+
+void outbuf_putc(outbuf_t *out, char c) {
+    make_room(out, 1);
+    out->data[out->used++] = c;
+}
+
+void outbuf_ref(outbuf_t *out, const char *text, size_t length) {
+    // A reference needs one piece, the copied run before it another,
+    // and the run after it a third when flushing
+    if (out->piece_count + 3 > OUTBUF_MAX_PIECES) {
+        make_room(out, out->capacity + 1);
+    }
+    close_run(out);
+    struct iovec *piece = &out->pieces[out->piece_count++];
+    piece->iov_base = (void *)text;
+    piece->iov_len = length;
+}
+
+void outbuf_uint(outbuf_t *out, unsigned long long value) {
+    char digits[20];
+    outbuf_put(out, digits, fmt_u64(digits, value));
+}
+
+void outbuf_int(outbuf_t *out, long long value) {
+    char digits[21];
+    outbuf_put(out, digits, fmt_i64(digits, value));
+}
+
+void outbuf_printf(outbuf_t *out, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t space = out->capacity - out->used;
+    int length = fmt_vformat(out->data + out->used, space, format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    }
+    if ((size_t)length < space) {
+        out->used += (size_t)length;
+        return;
+    }
+
+    // Did not fit: start a fresh buffer and format again
+    make_room(out, out->capacity + 1);
+    va_start(args, format);
+    if ((size_t)length < out->capacity) {
+        fmt_vformat(out->data, out->capacity, format, args);
+        out->used = (size_t)length;
+    } else {
+        char *text = malloc((size_t)length + 1);
+        if (text != NULL) {
+            fmt_vformat(text, (size_t)length + 1, format, args);
+            outbuf_put(out, text, (size_t)length);
+            free(text);
+        } else {
+            out->error = 1;
+        }
+    }
+    va_end(args);
+}
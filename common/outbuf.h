@@ -0,0 +1,120 @@
+/**
+ * @file outbuf.h
+ * @brief Output builder: a whole screen of text, written with one system call
+ *
+ * Every printf() call goes through stdio's buffer, and whether that
+ * buffer reaches the terminal or the pipe after each line or only when
+ * it fills up depends on where stdout points. A program that prints a
+ * banner with 20 printf() calls makes 20 write() system calls on a
+ * terminal, and each one costs far more than formatting the text.
+ *
+ * An outbuf_t collects the text instead, in a buffer the caller
+ * provides once. Text, characters and formatted numbers are appended
+ * in place, and outbuf_flush() hands everything to the kernel in a
+ * single write() - or a single writev() when large constant blocks
+ * were added by reference with outbuf_ref() instead of being copied.
+ *
+ *     static char storage[8192];
+ *     outbuf_t out;
+ *     outbuf_init(&out, STDOUT_FILENO, storage, sizeof(storage));
+ *     outbuf_text(&out, "Hello, World!\n");
+ *     outbuf_printf(&out, "%d students\n", count);
+ *     outbuf_flush(&out);
+ *
+ * If the buffer fills up, what is there is flushed automatically, so
+ * any amount of output works; a buffer sized for the screen means
+ * exactly one system call per screen.
+ *
+ * Do not mix outbuf_t and printf() on the same file descriptor without
+ * calling fflush(stdout) before outbuf_flush(), or the lines come out
+ * in the wrong order.
+ */
+
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// Pieces one flush can hand to writev(): copied runs and references
+#define OUTBUF_MAX_PIECES 32
+
+typedef struct {
+    int fd;
+    char *data;              // Caller's storage for copied text
+    size_t used;
+    size_t capacity;
+    size_t run_start;        // Start of the copied run not yet in pieces
+    struct iovec pieces[OUTBUF_MAX_PIECES];
+    int piece_count;
+    int error;               // 1 after a failed write (errno was set)
+    uint64_t syscalls;       // write()/writev() calls made so far
+} outbuf_t;
+
+/**
+ * @brief Prepares a builder that writes to fd using the given storage
+ */
+void outbuf_init(outbuf_t *out, int fd, char *storage, size_t capacity);
+
+/**
+ * @brief Appends length bytes of text (copied)
+ */
+void outbuf_put(outbuf_t *out, const char *text, size_t length);
+
+/**
+ * @brief Appends a string literal without measuring it at run time
+ */
+#define outbuf_text(out, literal) \
+    outbuf_put((out), "" literal, sizeof(literal) - 1)
+
+/**
+ * @brief Appends a NUL-terminated string (copied)
+ */
+void outbuf_puts(outbuf_t *out, const char *text);
+
+/**
+ * @brief Appends one character
+ */
+void outbuf_putc(outbuf_t *out, char c);
+
+/**
+ * @brief Appends text without copying it
+ *
+ * The text must stay unchanged until the next flush. Meant for large
+ * constant blocks (banners, help screens) that would otherwise be
+ * copied into the buffer on every report.
+ */
+void outbuf_ref(outbuf_t *out, const char *text, size_t length);
+
+/**
+ * @brief Appends a signed integer in decimal, like printf("%lld")
+ */
+void outbuf_int(outbuf_t *out, long long value);
+
+/**
+ * @brief Appends an unsigned integer in decimal, like printf("%llu")
+ */
+void outbuf_uint(outbuf_t *out, unsigned long long value);
+
+/**
+ * @brief Appends printf-style formatted text, formatted in place
+ *
+ * Formatting is done by fmt_vformat() (see fmt.h): the same text as
+ * printf(), with table-driven integers and fast %f/%e/%g.
+ */
+void outbuf_printf(outbuf_t *out, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Writes everything collected so far with one write()/writev()
+ *
+ * Partial writes (a full pipe, a signal) are continued until all text
+ * is out. The buffer is empty afterwards and can be reused.
+ *
+ * @return 0 on success, -1 if any write since the last flush failed
+ *         (errno is set)
+ */
+int outbuf_flush(outbuf_t *out);
+
+#endif // OUTBUF_H
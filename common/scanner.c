@@ -0,0 +1,609 @@
+/**
+ * @file scanner.c
+ * @brief Input scanner: block reads, tokens, Eisel-Lemire number parsing
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "scanner.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "scanner_pow5.h"
+
+__extension__ typedef unsigned __int128 scan_u128;
+
+// Significant digits that always fit in a uint64_t
+#define MAX_MANTISSA_DIGITS 19
+
+// Numbers longer than this are copied to the heap for strtod()
+#define SLOW_COPY_MAX 128
+
+// Powers of ten that are exactly representable as a double / a float
+static const double EXACT_POWERS_OF_TEN[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const float EXACT_POWERS_OF_TEN_F[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+/**
+ * @brief The parameters of one IEEE binary format for Eisel-Lemire
+ *
+ * Decimal exponents below smallest_power_of_ten round to zero for any
+ * 64-bit mantissa, and above largest_power_of_ten to infinity. Only
+ * for exponents within the round_to_even range can a product be exactly
+ * halfway between two floats.
+ */
+typedef struct {
+    int mantissa_bits;           // Explicit bits (52 for double)
+    int minimum_exponent;        // -bias
+    int infinite_power;          // Biased exponent of infinity
+    int smallest_power_of_ten;
+    int largest_power_of_ten;
+    int min_round_to_even;
+    int max_round_to_even;
+} binary_format_t;
+
+static const binary_format_t BINARY64 = {52, -1023, 0x7FF, -342, 308, -4, 23};
+static const binary_format_t BINARY32 = {23, -127, 0xFF, -64, 38, -17, 10};
+
+/**
+ * @brief A decimal number split into its parts: ±mantissa * 10^exponent
+ */
+typedef struct {
+    uint64_t mantissa;           // The first 19 significant digits
+    int64_t exponent;
+    int negative;
+    int truncated;               // Non-zero digits after the first 19
+    const char *stop;            // Just past the number
+} decimal_t;
+
+static int is_space(char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static int is_digit(char c) {
+    return (unsigned char)(c - '0') < 10;
+}
+
+/**
+ * @brief Splits the decimal number at p into mantissa and exponent
+ *
+ * An exponent marker is only part of the number if digits follow it,
+ * as with strtod(): "3e" is the number 3 followed by "e".
+ *
+ * @return 1 for a decimal number, 0 if there is none, -1 for anything
+ *         strtod() should look at ("inf", "nan", "0x1p4")
+ */
+static int parse_decimal(const char *p, const char *end, decimal_t *number) {
+    uint64_t mantissa = 0;
+    int64_t exponent = 0;
+    int significant = 0;
+    int any_digits = 0;
+
+    number->negative = 0;
+    number->truncated = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        number->negative = (*p == '-');
+        p++;
+    }
+    if (p < end && ((*p | 0x20) == 'i' || (*p | 0x20) == 'n')) {
+        return -1;
+    }
+    if (end - p >= 2 && p[0] == '0' && (p[1] | 0x20) == 'x') {
+        return -1;
+    }
+
+    while (p < end && is_digit(*p)) {
+        unsigned digit = (unsigned)(*p - '0');
+        if (significant < MAX_MANTISSA_DIGITS) {
+            mantissa = mantissa * 10 + digit;
+            significant += (mantissa != 0);
+        } else {
+            exponent++;
+            number->truncated |= (digit != 0);
+        }
+        any_digits = 1;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && is_digit(*p)) {
+            unsigned digit = (unsigned)(*p - '0');
+            if (significant < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + digit;
+                significant += (mantissa != 0);
+                exponent--;
+            } else {
+                number->truncated |= (digit != 0);
+            }
+            any_digits = 1;
+            p++;
+        }
+    }
+    if (!any_digits) {
+        return 0;
+    }
+
+    if (p < end && (*p | 0x20) == 'e') {
+        const char *q = p + 1;
+        int exponent_negative = 0;
+        int64_t written = 0;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exponent_negative = (*q == '-');
+            q++;
+        }
+        if (q < end && is_digit(*q)) {
+            while (q < end && is_digit(*q)) {
+                if (written < 100000000) {   // Far beyond any double
+                    written = written * 10 + (*q - '0');
+                }
+                q++;
+            }
+            exponent += exponent_negative ? -written : written;
+            p = q;
+        }
+    }
+    number->mantissa = mantissa;
+    number->exponent = exponent;
+    number->stop = p;
+    return 1;
+}
+
+/**
+ * @brief Eisel-Lemire: the binary float nearest to w * 10^q
+ *
+ * w * 5^q is approximated by multiplying the normalized w by the top
+ * 64 (and, when that is not precise enough to decide the rounding, the
+ * top 128) bits of 5^q; the factor 2^q only moves the binary exponent.
+ * For w < 2^64 this product always determines the correctly rounded
+ * result (Mushtak and Lemire, "Fast number parsing without fallback").
+ *
+ * @return The result's bits without the sign
+ */
+static uint64_t eisel_lemire(uint64_t w, int64_t q,
+                             const binary_format_t *format) {
+    if (w == 0 || q < format->smallest_power_of_ten) {
+        return 0;
+    }
+    if (q > format->largest_power_of_ten) {
+        return (uint64_t)format->infinite_power << format->mantissa_bits;
+    }
+
+    int leading_zeros = __builtin_clzll(w);
+    w <<= leading_zeros;
+    const uint64_t *power = scanner_pow5[q - SCANNER_POW5_MIN_EXPONENT];
+    uint64_t precision_mask = UINT64_MAX >> (format->mantissa_bits + 3);
+    scan_u128 product = (scan_u128)w * power[0];
+    uint64_t high = (uint64_t)(product >> 64);
+    uint64_t low = (uint64_t)product;
+    if ((high & precision_mask) == precision_mask) {
+        uint64_t second = (uint64_t)(((scan_u128)w * power[1]) >> 64);
+        low += second;
+        high += (second > low);
+    }
+
+    int upper_bit = (int)(high >> 63);
+    int shift = upper_bit + 64 - format->mantissa_bits - 3;
+    uint64_t mantissa = high >> shift;
+    // floor(log2(10^q)) + 63, computed without floating point
+    int32_t power2 = (int32_t)(((152170 + 65536) * q) >> 16) + 63 + upper_bit -
+                     leading_zeros - format->minimum_exponent;
+
+    if (power2 <= 0) {
+        // Subnormal (or zero): shift into place and round to nearest
+        if (-power2 + 1 >= 64) {
+            return 0;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < ((uint64_t)1 << format->mantissa_bits) ? 0 : 1;
+        return ((uint64_t)power2 << format->mantissa_bits) |
+               (mantissa & (((uint64_t)1 << format->mantissa_bits) - 1));
+    }
+
+    // Exactly halfway between two floats: round to even, not up
+    if (low <= 1 && q >= format->min_round_to_even &&
+        q <= format->max_round_to_even && (mantissa & 3) == 1 &&
+        (mantissa << shift) == high) {
+        mantissa &= ~(uint64_t)1;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= ((uint64_t)2 << format->mantissa_bits)) {
+        mantissa = (uint64_t)1 << format->mantissa_bits;
+        power2++;
+    }
+    mantissa &= ~((uint64_t)1 << format->mantissa_bits);
+    if (power2 >= format->infinite_power) {
+        return (uint64_t)format->infinite_power << format->mantissa_bits;
+    }
+    return ((uint64_t)power2 << format->mantissa_bits) | mantissa;
+}
+
+/**
+ * @brief Slow path: strtod() or strtof() on a NUL-terminated copy
+ */
+static const char *parse_slow(const char *p, const char *end, double *wide,
+                              float *narrow) {
+    char small[SLOW_COPY_MAX];
+    size_t length = 0;
+    while (p + length < end) {
+        char c = p[length];
+        if (!(is_digit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') ||
+              c == '.' || c == '+' || c == '-' || c == '_' || c == '(' ||
+              c == ')')) {
+            break;
+        }
+        length++;
+    }
+    char *copy = length < sizeof(small) ? small : malloc(length + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, p, length);
+    copy[length] = '\0';
+
+    char *stop;
+    int saved = errno;
+    if (wide != NULL) {
+        *wide = strtod(copy, &stop);
+    } else {
+        *narrow = strtof(copy, &stop);
+    }
+    errno = saved;
+    size_t used = (size_t)(stop - copy);
+    if (copy != small) {
+        free(copy);
+    }
+    return used == 0 ? NULL : p + used;
+}
+
+const char *scan_parse_double(const char *p, const char *end, double *value) {
+    decimal_t number;
+    int kind = parse_decimal(p, end, &number);
+    if (kind <= 0) {
+        return kind == 0 ? NULL : parse_slow(p, end, value, NULL);
+    }
+    if (number.truncated) {
+        return parse_slow(p, end, value, NULL);
+    }
+
+    double result;
+    if (number.mantissa <= (uint64_t)1 << 53 && number.exponent >= -22 &&
+        number.exponent <= 22) {
+        // Clinger: both operands are exact, so one rounding is all
+        result = (double)number.mantissa;
+        if (number.exponent < 0) {
+            result /= EXACT_POWERS_OF_TEN[-number.exponent];
+        } else {
+            result *= EXACT_POWERS_OF_TEN[number.exponent];
+        }
+    } else {
+        uint64_t bits = eisel_lemire(number.mantissa, number.exponent,
+                                     &BINARY64);
+        memcpy(&result, &bits, sizeof(result));
+    }
+    *value = number.negative ? -result : result;
+    return number.stop;
+}
+
+const char *scan_parse_float(const char *p, const char *end, float *value) {
+    decimal_t number;
+    int kind = parse_decimal(p, end, &number);
+    if (kind <= 0) {
+        return kind == 0 ? NULL : parse_slow(p, end, NULL, value);
+    }
+    if (number.truncated) {
+        return parse_slow(p, end, NULL, value);
+    }
+
+    float result;
+    if (number.mantissa <= (uint64_t)1 << 24 && number.exponent >= -10 &&
+        number.exponent <= 10) {
+        result = (float)number.mantissa;
+        if (number.exponent < 0) {
+            result /= EXACT_POWERS_OF_TEN_F[-number.exponent];
+        } else {
+            result *= EXACT_POWERS_OF_TEN_F[number.exponent];
+        }
+    } else {
+        uint32_t bits = (uint32_t)eisel_lemire(number.mantissa,
+                                               number.exponent, &BINARY32);
+        memcpy(&result, &bits, sizeof(result));
+    }
+    *value = number.negative ? -result : result;
+    return number.stop;
+}
+
+const char *scan_parse_long(const char *p, const char *end, long *value) {
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p == end || !is_digit(*p)) {
+        return NULL;
+    }
+
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : LONG_MAX;
+    unsigned long magnitude = 0;
+    int overflow = 0;
+    while (p < end && is_digit(*p)) {
+        unsigned digit = (unsigned)(*p - '0');
+        if (magnitude > (limit - digit) / 10) {
+            overflow = 1;
+        } else {
+            magnitude = magnitude * 10 + digit;
+        }
+        p++;
+    }
+    if (overflow) {
+        errno = ERANGE;
+        return NULL;
+    }
+    *value = negative ? (long)(0 - magnitude) : (long)magnitude;
+    return p;
+}
+
+const char *scan_parse_ulong(const char *p, const char *end,
+                             unsigned long *value) {
+    if (p < end && *p == '+') {
+        p++;
+    }
+    if (p == end || !is_digit(*p)) {
+        return NULL;
+    }
+
+    unsigned long magnitude = 0;
+    int overflow = 0;
+    while (p < end && is_digit(*p)) {
+        unsigned digit = (unsigned)(*p - '0');
+        if (magnitude > (ULONG_MAX - digit) / 10) {
+            overflow = 1;
+        } else {
+            magnitude = magnitude * 10 + digit;
+        }
+        p++;
+    }
+    if (overflow) {
+        errno = ERANGE;
+        return NULL;
+    }
+    *value = magnitude;
+    return p;
+}
+
+void scanner_init(scanner_t *in, int fd, char *storage, size_t capacity) {
+    in->fd = fd;
+    in->data = storage;
+    in->capacity = capacity;
+    in->start = 0;
+    in->end = 0;
+    in->at_eof = 0;
+    in->line = 1;
+    in->column = 1;
+    in->flush_before_read = NULL;
+    in->error_line = 1;
+    in->error_column = 1;
+    in->error[0] = '\0';
+}
+
+/**
+ * @brief Moves the unread bytes to the front and reads more after them
+ *
+ * @return Bytes read, 0 at the end of the input, -1 on error
+ */
+static ssize_t refill(scanner_t *in) {
+    if (in->start > 0) {
+        memmove(in->data, in->data + in->start, in->end - in->start);
+        in->end -= in->start;
+        in->start = 0;
+    }
+    if (in->flush_before_read != NULL) {
+        fflush(in->flush_before_read);
+    }
+    ssize_t got;
+    do {
+        got = read(in->fd, in->data + in->end, in->capacity - in->end);
+    } while (got < 0 && errno == EINTR);
+    if (got > 0) {
+        in->end += (size_t)got;
+    } else if (got == 0) {
+        in->at_eof = 1;
+    }
+    return got;
+}
+
+static scan_status_t read_failed(scanner_t *in) {
+    in->error_line = in->line;
+    in->error_column = in->column;
+    snprintf(in->error, sizeof(in->error), "cannot read input: %s",
+             strerror(errno));
+    return SCAN_ERROR;
+}
+
+// Skips whitespace, counting lines; stops at the next token or the end
+static scan_status_t skip_space(scanner_t *in, const char *expected) {
+    for (;;) {
+        // Locals, because stores through char pointers could alias *in
+        const char *data = in->data;
+        size_t start = in->start;
+        size_t end = in->end;
+        unsigned long line = in->line;
+        unsigned long column = in->column;
+        while (start < end && is_space(data[start])) {
+            if (data[start] == '\n') {
+                line++;
+                column = 0;
+            }
+            column++;
+            start++;
+        }
+        in->start = start;
+        in->line = line;
+        in->column = column;
+        in->error_line = line;
+        in->error_column = column;
+        if (start < end) {
+            return SCAN_OK;
+        }
+        ssize_t got = in->at_eof ? 0 : refill(in);
+        if (got < 0) {
+            return read_failed(in);
+        }
+        if (got == 0) {
+            snprintf(in->error, sizeof(in->error),
+                     "expected %s, found the end of the input", expected);
+            return SCAN_END;
+        }
+    }
+}
+
+static scan_status_t next_token(scanner_t *in, const char *expected,
+                                const char **token, size_t *length) {
+    scan_status_t status = skip_space(in, expected);
+    if (status != SCAN_OK) {
+        return status;
+    }
+    const char *p = in->data + in->start;
+    for (;;) {
+        const char *end = in->data + in->end;
+        while (p < end && !is_space(*p)) {
+            p++;
+        }
+        if (p < end || in->at_eof) {
+            break;
+        }
+        size_t size = (size_t)(p - (in->data + in->start));
+        if (size == in->capacity) {
+            snprintf(in->error, sizeof(in->error),
+                     "token longer than %zu characters", in->capacity);
+            in->start += size;
+            in->column += size;
+            return SCAN_ERROR;
+        }
+        ssize_t got = refill(in);
+        if (got < 0) {
+            return read_failed(in);
+        }
+        p = in->data + in->start + size;
+    }
+    *token = in->data + in->start;
+    *length = (size_t)(p - *token);
+    in->start += *length;
+    in->column += *length;
+    return SCAN_OK;
+}
+
+// Records "expected ..., found "token"" at the token's position
+static scan_status_t bad_token(scanner_t *in, const char *expected,
+                               const char *token, size_t length) {
+    int shown = length > SCANNER_QUOTE_MAX ? SCANNER_QUOTE_MAX : (int)length;
+    snprintf(in->error, sizeof(in->error), "expected %s, found \"%.*s%s\"",
+             expected, shown, token, length > SCANNER_QUOTE_MAX ? "..." : "");
+    return SCAN_ERROR;
+}
+
+scan_status_t scanner_token(scanner_t *in, const char **token,
+                            size_t *length) {
+    return next_token(in, "more input", token, length);
+}
+
+scan_status_t scanner_long(scanner_t *in, long *value) {
+    const char *token;
+    size_t length;
+    scan_status_t status = next_token(in, "a whole number", &token, &length);
+    if (status != SCAN_OK) {
+        return status;
+    }
+    errno = 0;
+    if (scan_parse_long(token, token + length, value) != token + length) {
+        return bad_token(in, errno == ERANGE ? "a smaller number"
+                                             : "a whole number",
+                         token, length);
+    }
+    return SCAN_OK;
+}
+
+scan_status_t scanner_int(scanner_t *in, int *value) {
+    long wide;
+    scan_status_t status = scanner_long(in, &wide);
+    if (status == SCAN_OK && (wide < INT_MIN || wide > INT_MAX)) {
+        snprintf(in->error, sizeof(in->error),
+                 "expected a smaller number, found %ld", wide);
+        return SCAN_ERROR;
+    }
+    if (status == SCAN_OK) {
+        *value = (int)wide;
+    }
+    return status;
+}
+
+scan_status_t scanner_float(scanner_t *in, float *value) {
+    const char *token;
+    size_t length;
+    scan_status_t status = next_token(in, "a number", &token, &length);
+    if (status != SCAN_OK) {
+        return status;
+    }
+    if (scan_parse_float(token, token + length, value) != token + length) {
+        return bad_token(in, "a number", token, length);
+    }
+    return SCAN_OK;
+}
+
+scan_status_t scanner_double(scanner_t *in, double *value) {
+    const char *token;
+    size_t length;
+    scan_status_t status = next_token(in, "a number", &token, &length);
+    if (status != SCAN_OK) {
+        return status;
+    }
+    if (scan_parse_double(token, token + length, value) != token + length) {
+        return bad_token(in, "a number", token, length);
+    }
+    return SCAN_OK;
+}
+
+scan_status_t scanner_char(scanner_t *in, char *value) {
+    scan_status_t status = skip_space(in, "a character");
+    if (status != SCAN_OK) {
+        return status;
+    }
+    *value = in->data[in->start++];
+    in->column++;
+    return SCAN_OK;
+}
+
+size_t scanner_format_error(const scanner_t *in, char *buffer, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    int length = snprintf(buffer, size, "Line %lu, column %lu: Error: %s\n",
+                          in->error_line, in->error_column, in->error);
+    if (length < 0) {
+        buffer[0] = '\0';
+        return 0;
+    }
+    return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+void scanner_print_error(const scanner_t *in, FILE *out) {
+    char message[64 + sizeof(in->error)];
+    scanner_format_error(in, message, sizeof(message));
+    fputs(message, out);
+}
+
+int scanner_exit_error(const scanner_t *in) {
+    scanner_print_error(in, stdout);
+    return 1;
+}
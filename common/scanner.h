@@ -0,0 +1,139 @@
+/**
+ * @file scanner.h
+ * @brief Input scanner: buffered tokens, fast exact numbers, precise errors
+ *
+ * scanf() is convenient for reading a number, but it is slow (every
+ * call re-interprets the format string and goes through stdio's locks
+ * and buffers) and it says very little when the input is wrong: "12a"
+ * reads as 12 and leaves "a" behind for the next call, and a word
+ * where a number belongs makes it return 0 without telling the user
+ * where the problem is.
+ *
+ * A scanner_t reads its file descriptor in large blocks into a buffer
+ * the caller provides once, splits the input into whitespace-separated
+ * tokens and converts each token with a hand-written parser. A token
+ * must be a number as a whole, and every failure records the line and
+ * column where the bad token starts:
+ *
+ *     static char storage[65536];
+ *     scanner_t in;
+ *     scanner_init(&in, STDIN_FILENO, storage, sizeof(storage));
+ *     float score;
+ *     if (scanner_float(&in, &score) != SCAN_OK) {
+ *         scanner_print_error(&in, stderr);
+ *         // Line 3, column 7: Error: expected a number, found "8O.5"
+ *     }
+ *
+ * The number parsers are also available on their own for text already
+ * in memory (scan_parse_float() and friends). They parse like strtod():
+ * the longest prefix that is a number, and return a pointer past it.
+ *
+ * Floating-point results are correctly rounded, bit for bit the value
+ * strtof() and strtod() return. Decimals with at most 19 significant
+ * digits - which is nearly every number people type - are converted
+ * with the Clinger fast path (one exact multiply or divide) or with the
+ * Eisel-Lemire algorithm (one or two 64x64-bit multiplications by a
+ * tabulated power of five). Longer numbers, hexadecimal floats, "inf"
+ * and "nan" go to strtod() on a copy of the token.
+ *
+ * The scanner reads with read(), so prompts written with printf() must
+ * be flushed before it is asked for the next token. Set
+ * flush_before_read to stdout to have the scanner do that itself.
+ */
+
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Longest token shown in an error message
+#define SCANNER_QUOTE_MAX 24
+
+typedef enum {
+    SCAN_ERROR = -1,         // Bad token or read error; see scanner_t.error
+    SCAN_END = 0,            // No more tokens (the error says so too)
+    SCAN_OK = 1
+} scan_status_t;
+
+typedef struct {
+    int fd;
+    char *data;              // Caller's storage; holds the longest token
+    size_t capacity;
+    size_t start;            // Next unread byte
+    size_t end;              // End of the bytes read so far
+    int at_eof;
+    unsigned long line;      // Position of data[start], counted from 1
+    unsigned long column;
+    FILE *flush_before_read; // Flushed before each read() if not NULL
+    unsigned long error_line;
+    unsigned long error_column;
+    char error[96 + SCANNER_QUOTE_MAX];
+} scanner_t;
+
+/**
+ * @brief Prepares a scanner that reads fd into the given storage
+ */
+void scanner_init(scanner_t *in, int fd, char *storage, size_t capacity);
+
+/**
+ * @brief Skips whitespace and returns the next token in place
+ *
+ * The token stays valid until the next call on the scanner.
+ */
+scan_status_t scanner_token(scanner_t *in, const char **token,
+                            size_t *length);
+
+/**
+ * @brief Reads the next token as a number of the given type
+ */
+scan_status_t scanner_int(scanner_t *in, int *value);
+scan_status_t scanner_long(scanner_t *in, long *value);
+scan_status_t scanner_float(scanner_t *in, float *value);
+scan_status_t scanner_double(scanner_t *in, double *value);
+
+/**
+ * @brief Skips whitespace and reads one character, like scanf(" %c")
+ */
+scan_status_t scanner_char(scanner_t *in, char *value);
+
+/**
+ * @brief Formats "Line L, column C: Error: ...\n" for the last failure
+ *
+ * For output that does not go through stdio. Returns the number of
+ * bytes stored in buffer, which always ends in a terminating zero.
+ */
+size_t scanner_format_error(const scanner_t *in, char *buffer, size_t size);
+
+/**
+ * @brief Prints "Line L, column C: Error: ..." for the last failure
+ */
+void scanner_print_error(const scanner_t *in, FILE *out);
+
+/**
+ * @brief Prints the last failure to stdout and returns 1 for main()
+ *
+ * For interactive programs that give up on the first bad answer:
+ *
+ *     if (scanner_float(&in, &score) != SCAN_OK) {
+ *         return scanner_exit_error(&in);
+ *     }
+ */
+int scanner_exit_error(const scanner_t *in);
+
+/**
+ * @brief Parses a number at the start of [p, end), like strtod()
+ *
+ * Leading whitespace is not skipped. Integers are decimal with an
+ * optional sign (only '+' for scan_parse_ulong()); on overflow errno is
+ * set to ERANGE and NULL returned.
+ *
+ * @return Pointer just past the number, or NULL if there was none
+ */
+const char *scan_parse_long(const char *p, const char *end, long *value);
+const char *scan_parse_ulong(const char *p, const char *end,
+                             unsigned long *value);
+const char *scan_parse_float(const char *p, const char *end, float *value);
+const char *scan_parse_double(const char *p, const char *end, double *value);
+
+#endif // SCANNER_H
@@ -0,0 +1,193 @@
+/**
+ * @file trace.c
+ * @brief Ring registration, clock calibration and the Chrome JSON writer
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+_Thread_local trace_ring_t *trace_current_ring = NULL;
+volatile sig_atomic_t trace_dump_requested = 0;
+
+// Every thread's ring, newest first; rings are never freed, so the
+// events of threads that have finished are still written out
+static _Atomic(trace_ring_t *) all_rings = NULL;
+static atomic_int thread_count = 0;
+
+static const char *trace_path = "trace.json";
+
+// Ticks and clock at the first event, to turn ticks into microseconds
+static _Atomic uint64_t base_ticks = 0;
+static uint64_t base_ns = 0;
+static atomic_flag base_taken = ATOMIC_FLAG_INIT;
+
+uint64_t trace_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void take_base(void) {
+    if (!atomic_flag_test_and_set(&base_taken)) {
+        base_ns = trace_clock_ns();
+        atomic_store(&base_ticks, trace_now());
+    }
+}
+
+static void dump_at_exit(void) {
+    trace_dump();
+}
+
+static void request_dump(int signal_number) {
+    (void)signal_number;
+    trace_dump_requested = 1;
+}
+
+void trace_init(const char *path) {
+    const char *from_environment = getenv("TRACE_FILE");
+    trace_path = from_environment != NULL ? from_environment : path;
+    take_base();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_dump;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+    atexit(dump_at_exit);
+}
+
+trace_ring_t *trace_register_thread(void) {
+    trace_ring_t *ring = calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        fprintf(stderr, "trace: out of memory, tracing stopped\n");
+        abort();
+    }
+    take_base();
+    ring->thread_number = atomic_fetch_add(&thread_count, 1) + 1;
+    ring->next = atomic_load(&all_rings);
+    while (!atomic_compare_exchange_weak(&all_rings, &ring->next, ring)) {
+        // ring->next was updated to the current head; try again
+    }
+    trace_current_ring = ring;
+    return ring;
+}
+
+void trace_thread_name(const char *name) {
+    trace_ring_t *ring = trace_current_ring;
+    if (ring == NULL) {
+        ring = trace_register_thread();
+    }
+    ring->thread_name = name;
+}
+
+/**
+ * @brief Writes text with the characters JSON does not allow escaped
+ */
+static void write_json_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (; *text != '\0'; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/**
+ * @brief Writes the events of one ring that are still in it
+ *
+ * The events are copied first and kept only if the owner did not
+ * overwrite them during the copy.
+ */
+static void write_ring(FILE *out, const trace_ring_t *ring, double us_per_tick,
+                       uint64_t origin, int *first) {
+    static trace_event_t copy[TRACE_RING_EVENTS];
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t oldest = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+
+    for (uint64_t i = oldest; i < head; i++) {
+        copy[i - oldest] = ring->events[i & (TRACE_RING_EVENTS - 1)];
+    }
+    uint64_t head_after = atomic_load_explicit(&ring->head,
+                                               memory_order_acquire);
+    uint64_t still_valid = head_after > TRACE_RING_EVENTS
+                               ? head_after - TRACE_RING_EVENTS : 0;
+
+    if (ring->thread_name != NULL) {
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,"
+                     "\"tid\":%d,\"args\":{\"name\":",
+                *first ? "" : ",", (long)getpid(), ring->thread_number);
+        write_json_string(out, ring->thread_name);
+        fputs("}}", out);
+        *first = 0;
+    }
+
+    for (uint64_t i = oldest > still_valid ? oldest : still_valid; i < head;
+         i++) {
+        const trace_event_t *event = &copy[i - oldest];
+        double ts = (double)(int64_t)(event->start - origin) * us_per_tick;
+
+        fprintf(out, "%s\n{\"name\":", *first ? "" : ",");
+        write_json_string(out, event->name);
+        if (event->kind == TRACE_KIND_SPAN) {
+            fprintf(out, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", ts,
+                    (double)event->value * us_per_tick);
+        } else {
+            fprintf(out, ",\"ph\":\"C\",\"ts\":%.3f,\"args\":{\"value\":%lld}",
+                    ts, (long long)event->value);
+        }
+        fprintf(out, ",\"pid\":%ld,\"tid\":%d}", (long)getpid(),
+                ring->thread_number);
+        *first = 0;
+    }
+}
+
+int trace_dump(void) {
+    trace_dump_requested = 0;
+    take_base();
+
+    // Ticks per microsecond, measured over the whole run so far
+    uint64_t origin = atomic_load(&base_ticks);
+    uint64_t elapsed_ns = trace_clock_ns() - base_ns;
+    uint64_t elapsed_ticks = trace_now() - origin;
+    double us_per_tick = 0.001;
+    if (elapsed_ns > 0 && elapsed_ticks > 0) {
+        us_per_tick = (double)elapsed_ns / 1000.0 / (double)elapsed_ticks;
+    }
+
+    FILE *out = fopen(trace_path, "w");
+    if (out == NULL) {
+        perror(trace_path);
+        return -1;
+    }
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    int first = 1;
+    for (trace_ring_t *ring = atomic_load(&all_rings); ring != NULL;
+         ring = ring->next) {
+        write_ring(out, ring, us_per_tick, origin, &first);
+    }
+    fputs("\n]}\n", out);
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+#else
+
+// Without TRACE_ENABLED there is nothing to compile
+typedef int trace_disabled_t;
+
+#endif // TRACE_ENABLED
@@ -0,0 +1,162 @@
+/**
+ * @file trace.h
+ * @brief Tracing: where the time goes, event by event, with almost no cost
+ *
+ * A profiler such as perf shows which functions are hot on average. A
+ * trace shows each individual step on a timeline: this chunk took 40 us
+ * to parse, that write() blocked for 2 ms, worker 3 sat idle. The
+ * macros below record such events:
+ *
+ *     TRACE_INIT("calculator.trace.json");
+ *     ...
+ *     TRACE_BEGIN(parse);
+ *     ok = calc_parse_record(line, end, &num1, &operation, &num2);
+ *     TRACE_END(parse);                  // One "parse" span
+ *     TRACE_COUNTER(records, count);     // A value that changes over time
+ *
+ * When the program exits (or is sent SIGUSR1) the events are written as
+ * Chrome trace-event JSON; open the file in https://ui.perfetto.dev or
+ * chrome://tracing to see the timeline, one row per thread.
+ *
+ * Tracing is compiled in only when TRACE_ENABLED is defined (make trace);
+ * otherwise every macro expands to nothing and costs nothing at all.
+ *
+ * How an event stays cheap (well under 20 ns, see trace_bench):
+ *   - timestamps are read with the rdtsc instruction (the CPU's cycle
+ *     counter, a few nanoseconds) and only converted to microseconds
+ *     when the trace is written; other CPUs use clock_gettime()
+ *   - each thread writes to its own ring buffer, found through a
+ *     thread-local pointer: no lock, no atomic read-modify-write, no
+ *     cache line shared with another thread
+ *   - a span is stored once, when it ends, as start and duration
+ *   - the ring keeps the newest TRACE_RING_EVENTS events of each thread
+ *     and overwrites the oldest, like a flight recorder
+ *
+ * Writing the trace from a signal handler is not safe, so SIGUSR1 only
+ * sets a flag; the program writes the trace at its next TRACE_POLL().
+ * A trace written while other threads are still recording may miss
+ * their oldest events.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef TRACE_ENABLED
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Events kept per thread (a power of two, 32 bytes each)
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS (1u << 16)
+#endif
+
+typedef enum {
+    TRACE_KIND_SPAN,
+    TRACE_KIND_COUNTER
+} trace_kind_t;
+
+typedef struct {
+    const char *name;        // A string literal; only the pointer is kept
+    uint64_t start;          // Ticks
+    int64_t value;           // Duration in ticks, or the counter's value
+    trace_kind_t kind;
+} trace_event_t;
+
+// One thread's events
+typedef struct trace_ring {
+    _Atomic uint64_t head;   // Events ever recorded; the next goes at head
+    int thread_number;
+    const char *thread_name;
+    struct trace_ring *next; // All rings, newest first
+    trace_event_t events[TRACE_RING_EVENTS];
+} trace_ring_t;
+
+// The calling thread's ring (NULL until its first event)
+extern _Thread_local trace_ring_t *trace_current_ring;
+
+// Set by SIGUSR1; TRACE_POLL() writes the trace when it is set
+extern volatile sig_atomic_t trace_dump_requested;
+
+/**
+ * @brief Sets where the trace is written (the TRACE_FILE environment
+ *        variable overrides path) and arranges for it to be written at
+ *        exit and after SIGUSR1
+ */
+void trace_init(const char *path);
+
+/**
+ * @brief Names the calling thread in the trace, e.g. "worker"
+ */
+void trace_thread_name(const char *name);
+
+/**
+ * @brief Writes every ring's events as Chrome trace-event JSON
+ * @return 0 on success, -1 if the file cannot be written
+ */
+int trace_dump(void);
+
+/**
+ * @brief Creates the calling thread's ring (first event only)
+ */
+trace_ring_t *trace_register_thread(void);
+
+/**
+ * @brief CLOCK_MONOTONIC in nanoseconds
+ */
+uint64_t trace_clock_ns(void);
+
+// Ticks: CPU cycles on x86, nanoseconds elsewhere
+static inline uint64_t trace_now(void) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    return trace_clock_ns();
+#endif
+}
+
+static inline void trace_record(const char *name, trace_kind_t kind,
+                                uint64_t start, int64_t value) {
+    trace_ring_t *ring = trace_current_ring;
+    if (__builtin_expect(ring == NULL, 0)) {
+        ring = trace_register_thread();
+    }
+    // Only this thread writes head; the release store publishes the event
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    trace_event_t *event = &ring->events[head & (TRACE_RING_EVENTS - 1)];
+    event->name = name;
+    event->start = start;
+    event->value = value;
+    event->kind = kind;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+#define TRACE_INIT(path) trace_init(path)
+#define TRACE_THREAD_NAME(name) trace_thread_name(name)
+#define TRACE_BEGIN(span) uint64_t trace_start_##span = trace_now()
+#define TRACE_END(span)                                                     \
+    trace_record(#span, TRACE_KIND_SPAN, trace_start_##span,                \
+                 (int64_t)(trace_now() - trace_start_##span))
+#define TRACE_COUNTER(counter, value)                                       \
+    trace_record(#counter, TRACE_KIND_COUNTER, trace_now(), (int64_t)(value))
+#define TRACE_POLL()                                                        \
+    do {                                                                    \
+        if (trace_dump_requested) {                                         \
+            trace_dump();                                                   \
+        }                                                                   \
+    } while (0)
+
+#else // !TRACE_ENABLED
+
+#define TRACE_INIT(path) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_BEGIN(span) ((void)0)
+#define TRACE_END(span) ((void)0)
+#define TRACE_COUNTER(counter, value) ((void)0)
+#define TRACE_POLL() ((void)0)
+
+#endif // TRACE_ENABLED
+
+#endif // TRACE_H